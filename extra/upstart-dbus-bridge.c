@@ -163,6 +163,7 @@ main (int   argc,
 	char                *user_session_addr = NULL;
 	nih_local char     **user_session_path = NULL;
 	char                *path_element = NULL;
+	char                *no_globs[] = { NULL };
 	DBusError            error;
 	char               **job_class_paths;
 
@@ -279,6 +280,16 @@ main (int   argc,
 		exit (EXIT_FAILURE);
 	}
 
+	/* We don't need any events or job state changes, so ask Upstart
+	 * not to send them; older versions will send them anyway.
+	 */
+	if (upstart_subscribe_sync (NULL, upstart, no_globs, no_globs) < 0) {
+		NihError *err;
+
+		err = nih_error_get ();
+		nih_free (err);
+	}
+
 	/* Request a list of all current jobs */
 	if (upstart_get_all_jobs_sync (NULL, upstart, &job_class_paths) < 0) {
 		NihError *err;
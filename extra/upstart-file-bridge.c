@@ -145,7 +145,9 @@
 #include <nih/watch.h>
 
 #include <nih-dbus/dbus_connection.h>
+#include <nih-dbus/dbus_error.h>
 #include <nih-dbus/dbus_proxy.h>
+#include <nih-dbus/errors.h>
 
 #include "dbus/upstart.h"
 #include "com.ubuntu.Upstart.h"
@@ -328,6 +330,12 @@ static void job_add_file (Job *job, char **file_info);
 static void emit_event_error (void *data, NihDBusMessage *message);
 static int  emit_event (const char *path, uint32_t event_type,
 				  const char  *match);
+static void flush_events (void *data, NihMainLoopFunc *func);
+static void send_event (UpstartEmitEventsEventsElement *event);
+static void emit_events_reply (UpstartEmitEventsEventsElement **events,
+			       NihDBusMessage *message);
+static void emit_events_error (UpstartEmitEventsEventsElement **events,
+			       NihDBusMessage *message);
 
 static FileEvent *file_event_new (void *parent, const char *path,
 				  uint32_t event, const char *match);
@@ -385,6 +393,31 @@ static NihHash *watched_dirs = NULL;
  **/
 static NihDBusProxy *upstart = NULL;
 
+/**
+ * pending_events:
+ *
+ * NULL-terminated array of events waiting to be emitted at the end of the
+ * current main loop iteration; all of the events resulting from the
+ * inotify events read at once are passed to Upstart in a single
+ * EmitEvents method call.
+ **/
+static UpstartEmitEventsEventsElement **pending_events = NULL;
+
+/**
+ * pending_events_len:
+ *
+ * Number of entries in pending_events.
+ **/
+static size_t pending_events_len = 0;
+
+/**
+ * use_emit_events:
+ *
+ * Set to FALSE once Upstart has been found not to support the EmitEvents
+ * method, after which each event is emitted with its own method call.
+ **/
+static int use_emit_events = TRUE;
+
 /**
  * user:
  *
@@ -428,6 +461,7 @@ main (int   argc,
 	char                *user_session_addr = NULL;
 	nih_local char     **user_session_path = NULL;
 	char                *path_element = NULL;
+	char                *no_globs[] = { NULL };
 	int                  ret;
 
 	nih_main_init (argv[0]);
@@ -521,6 +555,16 @@ main (int   argc,
 		exit (EXIT_FAILURE);
 	}
 
+	/* We don't need any events or job state changes, so ask Upstart
+	 * not to send them; older versions will send them anyway.
+	 */
+	if (upstart_subscribe_sync (NULL, upstart, no_globs, no_globs) < 0) {
+		NihError *err;
+
+		err = nih_error_get ();
+		nih_free (err);
+	}
+
 	/* Request a list of all current jobs */
 	if (upstart_get_all_jobs_sync (NULL, upstart, &job_class_paths) < 0) {
 		NihError *err;
@@ -606,6 +650,9 @@ main (int   argc,
 		NIH_MUST (nih_signal_add_handler (NULL, SIGINT, nih_main_term_signal, NULL));
 	}
 
+	/* Emit the events queued each time through the main loop */
+	NIH_MUST (nih_main_loop_add_func (NULL, flush_events, NULL));
+
 	ret = nih_main_loop ();
 
 	/* Destroy any PID file we may have created */
@@ -1367,41 +1414,120 @@ watched_dir_init (void)
  * @match: file match that resulted from @path if it contains glob
  *  wildcards (or NULL).
  *
- * Emit an Upstart event.
+ * Queue an Upstart event to be emitted by flush_events().
+ *
+ * Returns: TRUE.
  **/
 static int
 emit_event (const char   *path,
 	    uint32_t      event_type,
 	    const char   *match)
 {
-	DBusPendingCall    *pending_call;
-	nih_local char    **env = NULL;
-	nih_local char     *var = NULL;
-	size_t              env_len = 0;
+	UpstartEmitEventsEventsElement  *event;
+	char                           **env = NULL;
+	nih_local char                  *var = NULL;
+	size_t                           env_len = 0;
 
 	nih_assert (path);
 	nih_assert (event_type == IN_CREATE ||
 			event_type == IN_MODIFY ||
 			event_type == IN_DELETE);
 
-	env = NIH_MUST (nih_str_array_new (NULL));
+	pending_events = NIH_MUST (nih_realloc (pending_events, NULL,
+				(sizeof (UpstartEmitEventsEventsElement *)
+				 * (pending_events_len + 2))));
+
+	event = NIH_MUST (nih_new (pending_events,
+				   UpstartEmitEventsEventsElement));
+
+	event->item0 = NIH_MUST (nih_strdup (event, FILE_EVENT));
+
+	env = NIH_MUST (nih_str_array_new (event));
 
 	var = NIH_MUST (nih_sprintf (NULL, "FILE=%s", path));
-	NIH_MUST (nih_str_array_addp (&env, NULL, &env_len, var));
+	NIH_MUST (nih_str_array_addp (&env, event, &env_len, var));
 
 	var = NIH_MUST (nih_sprintf (NULL, "EVENT=%s",
 				event_type == IN_CREATE ? "create" :
 				event_type == IN_MODIFY ? "modify" :
 				"delete"));
-	NIH_MUST (nih_str_array_addp (&env, NULL, &env_len, var));
+	NIH_MUST (nih_str_array_addp (&env, event, &env_len, var));
 
 	if (match) {
 		var = NIH_MUST (nih_sprintf (NULL, "MATCH=%s", match));
-		NIH_MUST (nih_str_array_addp (&env, NULL, &env_len, var));
+		NIH_MUST (nih_str_array_addp (&env, event, &env_len, var));
+	}
+
+	event->item1 = env;
+
+	pending_events[pending_events_len++] = event;
+	pending_events[pending_events_len] = NULL;
+
+	return TRUE;
+}
+
+/**
+ * flush_events:
+ *
+ * @data: (unused),
+ * @func: main loop function (unused).
+ *
+ * Emit all of the events queued by emit_event() since the last call,
+ * in a single EmitEvents method call where possible.
+ **/
+static void
+flush_events (void            *data,
+	      NihMainLoopFunc *func)
+{
+	UpstartEmitEventsEventsElement **events;
+	DBusPendingCall                 *pending_call;
+
+	if (! pending_events)
+		return;
+
+	events = pending_events;
+	pending_events = NULL;
+	pending_events_len = 0;
+
+	if (use_emit_events && events[1]) {
+		pending_call = NIH_SHOULD (upstart_emit_events (upstart, events,
+					(UpstartEmitEventsReply)emit_events_reply,
+					(NihDBusErrorHandler)emit_events_error,
+					events, NIH_DBUS_TIMEOUT_NEVER));
+		if (pending_call) {
+			dbus_pending_call_unref (pending_call);
+			return;
+		} else {
+			NihError *err;
+
+			err = nih_error_get ();
+			nih_debug ("%s", err->message);
+			nih_free (err);
+		}
 	}
 
+	for (UpstartEmitEventsEventsElement **event = events; *event; event++)
+		send_event (*event);
+
+	nih_free (events);
+}
+
+/**
+ * send_event:
+ *
+ * @event: event to emit.
+ *
+ * Emit @event with the EmitEvent method.
+ **/
+static void
+send_event (UpstartEmitEventsEventsElement *event)
+{
+	DBusPendingCall *pending_call;
+
+	nih_assert (event);
+
 	pending_call = NIH_SHOULD (upstart_emit_event (upstart,
-				FILE_EVENT, env, FALSE,
+				event->item0, event->item1, FALSE,
 				NULL, emit_event_error, NULL,
 				NIH_DBUS_TIMEOUT_NEVER));
 	if (! pending_call) {
@@ -1410,10 +1536,74 @@ emit_event (const char   *path,
 		err = nih_error_get ();
 		nih_warn ("%s", err->message);
 		nih_free (err);
-		return FALSE;
+		return;
 	}
 
-	return TRUE;
+	dbus_pending_call_unref (pending_call);
+}
+
+/**
+ * emit_events_reply:
+ *
+ * @events: events emitted,
+ * @message: Nih D-Bus message (unused).
+ *
+ * Called when Upstart has queued @events, which are no longer needed.
+ **/
+static void
+emit_events_reply (UpstartEmitEventsEventsElement **events,
+		   NihDBusMessage                  *message)
+{
+	nih_free (events);
+}
+
+/**
+ * emit_events_error:
+ *
+ * @events: events emitted,
+ * @message: Nih D-Bus message (unused).
+ *
+ * Handle failure to emit @events.  If that's because Upstart predates
+ * the EmitEvents method, stop using it and emit each of the events
+ * individually instead; if one of @events was invalid, emit them
+ * individually this time so that only that one is lost; otherwise
+ * consume the raised error and display its details.
+ **/
+static void
+emit_events_error (UpstartEmitEventsEventsElement **events,
+		   NihDBusMessage                  *message)
+{
+	NihError *err;
+
+	err = nih_error_get ();
+	if ((err->number == NIH_DBUS_ERROR)
+	    && (! strcmp (((NihDBusError *)err)->name,
+			  DBUS_ERROR_UNKNOWN_METHOD))) {
+		nih_free (err);
+
+		use_emit_events = FALSE;
+
+		for (UpstartEmitEventsEventsElement **event = events;
+		     *event; event++)
+			send_event (*event);
+	} else if ((err->number == NIH_DBUS_ERROR)
+		   && (! strcmp (((NihDBusError *)err)->name,
+				 DBUS_ERROR_INVALID_ARGS))) {
+		/* Upstart rejects the whole batch when any one event is
+		 * invalid; emit them one at a time so that only that
+		 * event is lost.
+		 */
+		nih_free (err);
+
+		for (UpstartEmitEventsEventsElement **event = events;
+		     *event; event++)
+			send_event (*event);
+	} else {
+		nih_warn ("%s", err->message);
+		nih_free (err);
+	}
+
+	nih_free (events);
 }
 
 /**
@@ -420,6 +420,7 @@ upstart_connect (void)
 {
 	DBusConnection    *connection;
 	char            **job_class_paths;
+	char             *no_globs[] = { NULL };
 
 	/* Initialise the connection to Upstart */
 	connection = NIH_SHOULD (nih_dbus_connect (DBUS_ADDRESS_UPSTART, upstart_disconnected));
@@ -475,6 +476,16 @@ upstart_connect (void)
 		exit (1);
 	}
 
+	/* We don't need any events or job state changes, so ask Upstart
+	 * not to send them; older versions will send them anyway.
+	 */
+	if (upstart_subscribe_sync (NULL, upstart, no_globs, no_globs) < 0) {
+		NihError *err;
+
+		err = nih_error_get ();
+		nih_free (err);
+	}
+
 	/* Request a list of all current jobs */
 	if (upstart_get_all_jobs_sync (NULL, upstart, &job_class_paths) < 0) {
 		NihError *err;
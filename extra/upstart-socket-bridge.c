@@ -142,6 +142,7 @@ main (int   argc,
 	char **         args;
 	DBusConnection *connection;
 	char **         job_class_paths;
+	char *          no_globs[] = { NULL };
 	int             ret;
 
 	nih_main_init (argv[0]);
@@ -224,6 +225,16 @@ main (int   argc,
 		exit (1);
 	}
 
+	/* We don't need any events or job state changes, so ask Upstart
+	 * not to send them; older versions will send them anyway.
+	 */
+	if (upstart_subscribe_sync (NULL, upstart, no_globs, no_globs) < 0) {
+		NihError *err;
+
+		err = nih_error_get ();
+		nih_free (err);
+	}
+
 	/* Request a list of all current jobs */
 	if (upstart_get_all_jobs_sync (NULL, upstart, &job_class_paths) < 0) {
 		NihError *err;
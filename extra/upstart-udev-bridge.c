@@ -39,15 +39,35 @@
 #include <nih/error.h>
 
 #include <nih-dbus/dbus_connection.h>
+#include <nih-dbus/dbus_error.h>
 #include <nih-dbus/dbus_proxy.h>
+#include <nih-dbus/errors.h>
 
 #include "dbus/upstart.h"
 #include "com.ubuntu.Upstart.h"
 
 
+/**
+ * MAX_BATCH_EVENTS:
+ *
+ * Maximum number of udev events to read from the monitor before passing
+ * them on to Upstart in a single EmitEvents method call.
+ **/
+#define MAX_BATCH_EVENTS 256
+
+
 /* Prototypes for static functions */
 static void udev_monitor_watcher (struct udev_monitor *udev_monitor,
 				  NihIoWatch *watch, NihIoEvents events);
+static UpstartEmitEventsEventsElement *
+udev_device_event                (const void *parent,
+				  struct udev_device *udev_device);
+static void emit_events          (UpstartEmitEventsEventsElement **events);
+static void emit_event           (UpstartEmitEventsEventsElement *event);
+static void emit_events_reply    (UpstartEmitEventsEventsElement **events,
+				  NihDBusMessage *message);
+static void emit_events_error    (UpstartEmitEventsEventsElement **events,
+				  NihDBusMessage *message);
 static void upstart_disconnected (DBusConnection *connection);
 static void emit_event_error     (void *data, NihDBusMessage *message);
 
@@ -76,6 +96,14 @@ static NihDBusProxy *upstart = NULL;
  **/
 static int no_strip_udev_data = FALSE;
 
+/**
+ * use_emit_events:
+ *
+ * Set to FALSE once Upstart has been found not to support the EmitEvents
+ * method, after which each event is emitted with its own method call.
+ **/
+static int use_emit_events = TRUE;
+
 /**
  * options:
  *
@@ -99,6 +127,7 @@ main (int   argc,
 	DBusConnection *     connection;
 	struct udev *        udev;
 	struct udev_monitor *udev_monitor;
+	char *               no_globs[] = { NULL };
 	int                  ret;
 
 	nih_main_init (argv[0]);
@@ -140,6 +169,16 @@ main (int   argc,
 		exit (1);
 	}
 
+	/* We don't need any events or job state changes, so ask Upstart
+	 * not to send them; older versions will send them anyway.
+	 */
+	if (upstart_subscribe_sync (NULL, upstart, no_globs, no_globs) < 0) {
+		NihError *err;
+
+		err = nih_error_get ();
+		nih_free (err);
+	}
+
 	/* Initialise the connection to udev */
 	nih_assert (udev = udev_new ());
 	nih_assert (udev_monitor = udev_monitor_new_from_netlink (udev, "udev"));
@@ -184,28 +223,75 @@ main (int   argc,
 }
 
 
+/**
+ * udev_monitor_watcher:
+ * @udev_monitor: udev monitor,
+ * @watch: NihIoWatch for monitor socket,
+ * @events: events that occurred.
+ *
+ * Called when the udev monitor socket is readable.  During coldplug the
+ * kernel can queue a great many events at once, so rather than emit a
+ * single event per wakeup we drain up to MAX_BATCH_EVENTS of them from
+ * the (non-blocking) socket and pass them to Upstart together.
+ **/
 static void
 udev_monitor_watcher (struct udev_monitor *udev_monitor,
 		      NihIoWatch *         watch,
 		      NihIoEvents          events)
 {
-	struct udev_device *    udev_device;
+	UpstartEmitEventsEventsElement **batch;
+	size_t                           len = 0;
+
+	batch = NIH_MUST (nih_alloc (NULL, sizeof (UpstartEmitEventsEventsElement *)
+				     * (MAX_BATCH_EVENTS + 1)));
+
+	while (len < MAX_BATCH_EVENTS) {
+		struct udev_device *udev_device;
+
+		udev_device = udev_monitor_receive_device (udev_monitor);
+		if (! udev_device)
+			break;
+
+		batch[len] = udev_device_event (batch, udev_device);
+		if (batch[len])
+			len++;
+
+		udev_device_unref (udev_device);
+	}
+
+	batch[len] = NULL;
+
+	emit_events (batch);
+}
+
+/**
+ * udev_device_event:
+ * @parent: parent of returned structure,
+ * @udev_device: udev device.
+ *
+ * Construct the name and environment of the Upstart event for the udev
+ * event @udev_device.
+ *
+ * Returns: newly allocated structure, or NULL if @udev_device has no
+ * action.
+ **/
+static UpstartEmitEventsEventsElement *
+udev_device_event (const void *        parent,
+		   struct udev_device *udev_device)
+{
+	UpstartEmitEventsEventsElement *event;
 	nih_local char *        subsystem = NULL;
 	nih_local char *        action = NULL;
 	nih_local char *        kernel = NULL;
 	nih_local char *        devpath = NULL;
 	nih_local char *        devname = NULL;
-	nih_local char *        name = NULL;
-	nih_local char **       env = NULL;
+	char *                  name = NULL;
+	char **                 env = NULL;
 	const char *            value = NULL;
 	size_t                  env_len = 0;
-	DBusPendingCall *       pending_call;
 	char                 *(*copy_string)(const void *, const char *) = NULL;
 
-
-	udev_device = udev_monitor_receive_device (udev_monitor);
-	if (! udev_device)
-		return;
+	nih_assert (udev_device != NULL);
 
 	copy_string = no_strip_udev_data ? nih_strdup : make_safe_string;
 
@@ -226,57 +312,59 @@ udev_monitor_watcher (struct udev_monitor *udev_monitor,
 
 	/* Protect against the "impossible" */
 	if (! action)
-		goto out;
+		return NULL;
+
+	event = NIH_MUST (nih_new (parent, UpstartEmitEventsEventsElement));
 
 	if (! strcmp (action, "add")) {
-		name = NIH_MUST (nih_sprintf (NULL, "%s-device-added",
+		name = NIH_MUST (nih_sprintf (event, "%s-device-added",
 					      subsystem));
 	} else if (! strcmp (action, "change")) {
-		name = NIH_MUST (nih_sprintf (NULL, "%s-device-changed",
+		name = NIH_MUST (nih_sprintf (event, "%s-device-changed",
 					      subsystem));
 	} else if (! strcmp (action, "remove")) {
-		name = NIH_MUST (nih_sprintf (NULL, "%s-device-removed",
+		name = NIH_MUST (nih_sprintf (event, "%s-device-removed",
 					      subsystem));
 	} else {
-		name = NIH_MUST (nih_sprintf (NULL, "%s-device-%s",
+		name = NIH_MUST (nih_sprintf (event, "%s-device-%s",
 					      subsystem, action));
 	}
 
-	env = NIH_MUST (nih_str_array_new (NULL));
+	env = NIH_MUST (nih_str_array_new (event));
 
 	if (kernel) {
 		nih_local char *var = NULL;
 
 		var = NIH_MUST (nih_sprintf (NULL, "KERNEL=%s", kernel));
-		NIH_MUST (nih_str_array_addp (&env, NULL, &env_len, var));
+		NIH_MUST (nih_str_array_addp (&env, event, &env_len, var));
 	}
 
 	if (devpath) {
 		nih_local char *var = NULL;
 
 		var = NIH_MUST (nih_sprintf (NULL, "DEVPATH=%s", devpath));
-		NIH_MUST (nih_str_array_addp (&env, NULL, &env_len, var));
+		NIH_MUST (nih_str_array_addp (&env, event, &env_len, var));
 	}
 
 	if (devname) {
 		nih_local char *var = NULL;
 
 		var = NIH_MUST (nih_sprintf (NULL, "DEVNAME=%s", devname));
-		NIH_MUST (nih_str_array_addp (&env, NULL, &env_len, var));
+		NIH_MUST (nih_str_array_addp (&env, event, &env_len, var));
 	}
 
 	if (subsystem) {
 		nih_local char *var = NULL;
 
 		var = NIH_MUST (nih_sprintf (NULL, "SUBSYSTEM=%s", subsystem));
-		NIH_MUST (nih_str_array_addp (&env, NULL, &env_len, var));
+		NIH_MUST (nih_str_array_addp (&env, event, &env_len, var));
 	}
 
 	if (action) {
 		nih_local char *var = NULL;
 
 		var = NIH_MUST (nih_sprintf (NULL, "ACTION=%s", action));
-		NIH_MUST (nih_str_array_addp (&env, NULL, &env_len, var));
+		NIH_MUST (nih_str_array_addp (&env, event, &env_len, var));
 	}
 
 	for (struct udev_list_entry *list_entry = udev_device_get_properties_list_entry (udev_device);
@@ -300,23 +388,97 @@ udev_monitor_watcher (struct udev_monitor *udev_monitor,
 		udev_value = copy_string (NULL, udev_list_entry_get_value (list_entry));
 
 		var = NIH_MUST (nih_sprintf (NULL, "%s=%s", udev_name, udev_value));
-		NIH_MUST (nih_str_array_addp (&env, NULL, &env_len, var));
+		NIH_MUST (nih_str_array_addp (&env, event, &env_len, var));
 	}
 
 	nih_debug ("%s %s", name, devname ? devname : "");
 
+	event->item0 = name;
+	event->item1 = env;
+
+	return event;
+}
+
+/**
+ * emit_events:
+ * @events: NULL-terminated array of events.
+ *
+ * Emit each of @events in a single EmitEvents method call, or one at a
+ * time if Upstart doesn't support that, rejects one of them, or the
+ * method call can't be made; the latter is normally because the udev
+ * data of one of the events isn't valid UTF-8, and this way only that
+ * event is lost.
+ *
+ * @events is freed once the reply is received.
+ **/
+static void
+emit_events (UpstartEmitEventsEventsElement **events)
+{
+	DBusPendingCall *pending_call;
+
+	nih_assert (events != NULL);
+
+	if (! events[0]) {
+		nih_free (events);
+		return;
+	}
+
+	if (use_emit_events && events[1]) {
+		pending_call = upstart_emit_events (upstart, events,
+				(UpstartEmitEventsReply)emit_events_reply,
+				(NihDBusErrorHandler)emit_events_error, events,
+				NIH_DBUS_TIMEOUT_NEVER);
+		if (pending_call) {
+			dbus_pending_call_unref (pending_call);
+			return;
+		} else {
+			NihError *err;
+
+			err = nih_error_get ();
+			nih_debug ("%s", err->message);
+			nih_free (err);
+		}
+	}
+
+	for (UpstartEmitEventsEventsElement **event = events; *event; event++)
+		emit_event (*event);
+
+	nih_free (events);
+}
+
+/**
+ * emit_event:
+ * @event: event to emit.
+ *
+ * Emit @event with the EmitEvent method.
+ **/
+static void
+emit_event (UpstartEmitEventsEventsElement *event)
+{
+	DBusPendingCall *pending_call;
+
+	nih_assert (event != NULL);
+
 	pending_call = upstart_emit_event (upstart,
-			name, env, FALSE,
+			event->item0, event->item1, FALSE,
 			NULL, emit_event_error, NULL,
 			NIH_DBUS_TIMEOUT_NEVER);
 
 	if (! pending_call) {
 		NihError *err;
 		int saved = errno;
+		const char *subsystem = NULL;
 
 		err = nih_error_get ();
 		nih_warn ("%s", err->message);
 
+		for (char **e = event->item1; e && *e; e++) {
+			if (! strncmp (*e, "SUBSYSTEM=", 10)) {
+				subsystem = *e + 10;
+				break;
+			}
+		}
+
 		if (saved != ENOMEM && subsystem)
 			nih_warn ("Likely that udev '%s' event contains binary garbage", subsystem);
 
@@ -324,9 +486,67 @@ udev_monitor_watcher (struct udev_monitor *udev_monitor,
 	}
 
 	dbus_pending_call_unref (pending_call);
+}
+
+/**
+ * emit_events_reply:
+ * @events: events emitted,
+ * @message: D-Bus message (unused).
+ *
+ * Called when Upstart has queued @events, which are no longer needed.
+ **/
+static void
+emit_events_reply (UpstartEmitEventsEventsElement **events,
+		   NihDBusMessage                  *message)
+{
+	nih_free (events);
+}
+
+/**
+ * emit_events_error:
+ * @events: events emitted,
+ * @message: D-Bus message (unused).
+ *
+ * Called when Upstart could not queue @events.  If that's because it
+ * predates the EmitEvents method, stop using it and emit each of the
+ * events individually instead; if one of @events was invalid, emit them
+ * individually this time so that only that one is lost.
+ **/
+static void
+emit_events_error (UpstartEmitEventsEventsElement **events,
+		   NihDBusMessage                  *message)
+{
+	NihError *err;
+
+	err = nih_error_get ();
+	if ((err->number == NIH_DBUS_ERROR)
+	    && (! strcmp (((NihDBusError *)err)->name,
+			  DBUS_ERROR_UNKNOWN_METHOD))) {
+		nih_free (err);
+
+		use_emit_events = FALSE;
+
+		for (UpstartEmitEventsEventsElement **event = events;
+		     *event; event++)
+			emit_event (*event);
+	} else if ((err->number == NIH_DBUS_ERROR)
+		   && (! strcmp (((NihDBusError *)err)->name,
+				 DBUS_ERROR_INVALID_ARGS))) {
+		/* Upstart rejects the whole batch when any one event is
+		 * invalid; emit them one at a time so that only that
+		 * event is lost.
+		 */
+		nih_free (err);
+
+		for (UpstartEmitEventsEventsElement **event = events;
+		     *event; event++)
+			emit_event (*event);
+	} else {
+		nih_warn ("%s", err->message);
+		nih_free (err);
+	}
 
-out:
-	udev_device_unref (udev_device);
+	nih_free (events);
 }
 
 
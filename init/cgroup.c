@@ -0,0 +1,659 @@
+/* upstart
+ *
+ * cgroup.c - control group tracking of job processes
+ *
+ * Copyright © 2014 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/string.h>
+#include <nih/error.h>
+#include <nih/logging.h>
+
+#include "paths.h"
+#include "cgroup.h"
+
+
+/**
+ * CGROUP2_SUPER_MAGIC:
+ *
+ * Filesystem type of the unified control group hierarchy.
+ **/
+#ifndef CGROUP2_SUPER_MAGIC
+#define CGROUP2_SUPER_MAGIC 0x63677270
+#endif
+
+
+/* Prototypes for static functions */
+static int   cgroup_write (const char *path, const char *name,
+			   const char *value)
+	__attribute__ ((warn_unused_result));
+static pid_t cgroup_ppid  (pid_t pid)
+	__attribute__ ((warn_unused_result));
+
+
+/**
+ * cgroup_root:
+ *
+ * Directory in the unified control group hierarchy below which a control
+ * group is created for each job instance whose processes are tracked,
+ * or NULL if control groups are not used to track processes.
+ **/
+char *cgroup_root = NULL;
+
+/**
+ * cgroup_controllers:
+ *
+ * Controllers already enabled by cgroup_enable(), so that they are only
+ * written to the control files the first time a job needs them.
+ **/
+static char **cgroup_controllers = NULL;
+
+
+/**
+ * cgroup_init:
+ *
+ * Determines whether the unified (version 2) control group hierarchy is
+ * mounted and, if so, creates the directory for the control groups of
+ * jobs below the control group the init daemon itself is in and sets
+ * cgroup_root to it.
+ *
+ * Unless the init daemon is in the root control group, it moves itself
+ * into the CGROUP_INIT_DIR leaf alongside the directory so that
+ * controllers may later be enabled for jobs by cgroup_enable().
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+cgroup_init (void)
+{
+	struct statfs   sfs;
+	FILE           *f;
+	char            line[PATH_MAX];
+	char           *path = NULL;
+	char           *slash;
+	char           *root;
+
+	if (cgroup_root)
+		return 0;
+
+	if (statfs (CGROUP_MOUNT, &sfs) < 0)
+		nih_return_system_error (-1);
+
+	if (sfs.f_type != CGROUP2_SUPER_MAGIC)
+		nih_return_error (-1, ENOTSUP,
+				  _("Unified control group hierarchy not mounted"));
+
+	/* The entry for the unified hierarchy has hierarchy ID zero and
+	 * no controllers.
+	 */
+	f = fopen ("/proc/self/cgroup", "r");
+	if (! f)
+		nih_return_system_error (-1);
+
+	while (fgets (line, sizeof (line), f)) {
+		if (strncmp (line, "0::", 3))
+			continue;
+
+		path = line + 3;
+		path[strcspn (path, "\n")] = '\0';
+		break;
+	}
+
+	fclose (f);
+
+	if (! path)
+		nih_return_error (-1, ENOTSUP,
+				  _("Unified control group hierarchy not mounted"));
+
+	/* Having been re-executed, we're already in our own leaf. */
+	slash = strrchr (path, '/');
+	if (slash && (slash != path) && (! strcmp (slash + 1, CGROUP_INIT_DIR)))
+		*slash = '\0';
+
+	if (strcmp (path, "/")) {
+		nih_local char *leaf = NULL;
+
+		leaf = nih_sprintf (NULL, "%s%s/%s", CGROUP_MOUNT,
+				    path, CGROUP_INIT_DIR);
+		if (! leaf)
+			nih_return_no_memory_error (-1);
+
+		/* Failing this only prevents resource limits from being
+		 * applied, processes can still be tracked.
+		 */
+		if ((cgroup_create (leaf) < 0)
+		    || (cgroup_enter (leaf, getpid ()) < 0)) {
+			NihError *err;
+
+			err = nih_error_get ();
+			nih_warn ("%s: %s", _("Unable to move into control group"),
+				  err->message);
+			nih_free (err);
+		}
+	}
+
+	root = nih_sprintf (NULL, "%s%s/%s", CGROUP_MOUNT,
+			    strcmp (path, "/") ? path : "", CGROUP_DIR);
+	if (! root)
+		nih_return_no_memory_error (-1);
+
+	if (cgroup_create (root) < 0) {
+		nih_free (root);
+		return -1;
+	}
+
+	cgroup_root = root;
+	nih_debug ("Tracking job processes in %s", cgroup_root);
+
+	return 0;
+}
+
+/**
+ * cgroup_path:
+ * @parent: parent object for new string,
+ * @class: name of job class,
+ * @instance: name of job instance, may be NULL.
+ *
+ * Constructs the path of the control group for the instance @instance
+ * of the job class @class below cgroup_root.  Since job class names may
+ * contain slashes, they and any in @instance are replaced by dots.
+ *
+ * Should that control group still contain processes left behind by a
+ * previous instance, a number is appended to the path so that those
+ * processes are never mistaken for those of the new instance.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned string.  When all parents
+ * of the returned string are freed, the returned string will also be
+ * freed.
+ *
+ * Returns: newly allocated string or NULL if insufficient memory.
+ **/
+char *
+cgroup_path (const void *parent,
+	     const char *class,
+	     const char *instance)
+{
+	char *path;
+
+	nih_assert (cgroup_root != NULL);
+	nih_assert (class != NULL);
+
+	path = nih_sprintf (parent, "%s/%s", cgroup_root, class);
+	if (! path)
+		return NULL;
+
+	if (instance && *instance
+	    && (! nih_strcat_sprintf (&path, parent, "@%s", instance))) {
+		nih_free (path);
+		return NULL;
+	}
+
+	for (char *p = path + strlen (cgroup_root) + 1; *p; p++)
+		if (*p == '/')
+			*p = '.';
+
+	if (! cgroup_populated (path))
+		return path;
+
+	for (int i = 1; ; i++) {
+		char *unique;
+
+		unique = nih_sprintf (parent, "%s#%d", path, i);
+		if (! unique) {
+			nih_free (path);
+			return NULL;
+		}
+
+		if (! cgroup_populated (unique)) {
+			nih_free (path);
+			return unique;
+		}
+
+		nih_free (unique);
+	}
+}
+
+/**
+ * cgroup_create:
+ * @path: path of control group.
+ *
+ * Creates the control group @path, which may already exist.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+cgroup_create (const char *path)
+{
+	nih_assert (path != NULL);
+
+	if ((mkdir (path, 0755) < 0) && (errno != EEXIST))
+		nih_return_system_error (-1);
+
+	return 0;
+}
+
+/**
+ * cgroup_populated:
+ * @path: path of control group.
+ *
+ * Checks whether the control group @path exists and still contains any
+ * processes, such as those left behind by a previous instance of a job.
+ *
+ * Returns: TRUE if @path contains processes, FALSE otherwise.
+ **/
+int
+cgroup_populated (const char *path)
+{
+	char  procs[PATH_MAX];
+	FILE *f;
+	int   pid, populated;
+
+	nih_assert (path != NULL);
+
+	snprintf (procs, sizeof (procs), "%s/cgroup.procs", path);
+
+	f = fopen (procs, "r");
+	if (! f)
+		return FALSE;
+
+	populated = (fscanf (f, "%d", &pid) == 1);
+
+	fclose (f);
+
+	return populated;
+}
+
+/**
+ * cgroup_enter:
+ * @path: path of control group,
+ * @pid: process to move, or zero for the calling process.
+ *
+ * Moves the process @pid into the control group @path; processes it
+ * creates afterwards will also be in that control group, whatever they
+ * do, until moved out of it again.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+cgroup_enter (const char *path,
+	      pid_t       pid)
+{
+	nih_local char *procs = NULL;
+	char            buf[32];
+	int             fd, len;
+
+	nih_assert (path != NULL);
+
+	procs = nih_sprintf (NULL, "%s/cgroup.procs", path);
+	if (! procs)
+		nih_return_no_memory_error (-1);
+
+	fd = open (procs, O_WRONLY | O_CLOEXEC);
+	if (fd < 0)
+		nih_return_system_error (-1);
+
+	len = snprintf (buf, sizeof (buf), "%d\n", pid);
+
+	if (write (fd, buf, len) < 0) {
+		nih_error_raise_system ();
+		close (fd);
+		return -1;
+	}
+
+	close (fd);
+
+	return 0;
+}
+
+/**
+ * cgroup_write:
+ * @path: path of control group,
+ * @name: name of control file,
+ * @value: value to write.
+ *
+ * Writes @value to the control file @name of the control group @path.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+static int
+cgroup_write (const char *path,
+	      const char *name,
+	      const char *value)
+{
+	nih_local char *filename = NULL;
+	int             fd;
+
+	nih_assert (path != NULL);
+	nih_assert (name != NULL);
+	nih_assert (value != NULL);
+
+	filename = nih_sprintf (NULL, "%s/%s", path, name);
+	if (! filename)
+		nih_return_no_memory_error (-1);
+
+	fd = open (filename, O_WRONLY | O_CLOEXEC);
+	if (fd < 0)
+		nih_return_system_error (-1);
+
+	if (write (fd, value, strlen (value)) < 0) {
+		nih_error_raise_system ();
+		close (fd);
+		return -1;
+	}
+
+	close (fd);
+
+	return 0;
+}
+
+/**
+ * cgroup_enable:
+ * @controller: name of controller.
+ *
+ * Enables @controller for the control groups of jobs, which requires it
+ * to be enabled both in the control group the init daemon is in and in
+ * cgroup_root.  Controllers are only enabled once a job needs them,
+ * since they have a cost for every process below them, and are only
+ * written the first time.
+ *
+ * The kernel refuses to enable controllers in a control group that has
+ * processes of its own; cgroup_init() moves the init daemon out of the
+ * way, but if other processes share the control group it was started
+ * in, as they often do for a Session Init, resource limits cannot be
+ * applied unless it is started in a control group of its own.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+cgroup_enable (const char *controller)
+{
+	nih_local char *value = NULL;
+	nih_local char *parent = NULL;
+	char           *slash;
+
+	nih_assert (cgroup_root != NULL);
+	nih_assert (controller != NULL);
+
+	for (char **c = cgroup_controllers; c && *c; c++)
+		if (! strcmp (*c, controller))
+			return 0;
+
+	value = nih_sprintf (NULL, "+%s", controller);
+	if (! value)
+		nih_return_no_memory_error (-1);
+
+	parent = nih_strdup (NULL, cgroup_root);
+	if (! parent)
+		nih_return_no_memory_error (-1);
+
+	slash = strrchr (parent, '/');
+	nih_assert (slash != NULL);
+	*slash = '\0';
+
+	if (cgroup_write (parent, "cgroup.subtree_control", value) < 0)
+		return -1;
+
+	if (cgroup_write (cgroup_root, "cgroup.subtree_control", value) < 0)
+		return -1;
+
+	if (! cgroup_controllers) {
+		cgroup_controllers = nih_str_array_new (NULL);
+		if (! cgroup_controllers)
+			nih_return_no_memory_error (-1);
+	}
+
+	if (! nih_str_array_add (&cgroup_controllers, NULL, NULL, controller))
+		nih_return_no_memory_error (-1);
+
+	return 0;
+}
+
+/**
+ * cgroup_set:
+ * @path: path of control group,
+ * @name: name of control file,
+ * @format: format string for value.
+ *
+ * Sets the control file @name of the control group @path, such as one
+ * of its resource limits, to the value given by @format; the controller
+ * the file belongs to must have been enabled with cgroup_enable().
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+cgroup_set (const char *path,
+	    const char *name,
+	    const char *format,
+	    ...)
+{
+	nih_local char *value = NULL;
+	va_list         args;
+
+	nih_assert (path != NULL);
+	nih_assert (name != NULL);
+	nih_assert (format != NULL);
+
+	va_start (args, format);
+	value = nih_vsprintf (NULL, format, args);
+	va_end (args);
+
+	if (! value)
+		nih_return_no_memory_error (-1);
+
+	return cgroup_write (path, name, value);
+}
+
+/**
+ * cgroup_remove:
+ * @path: path of control group.
+ *
+ * Removes the control group @path if it no longer contains any
+ * processes; otherwise it is left behind, and the next instance of the
+ * job is given a different control group by cgroup_path() until the
+ * processes have gone.
+ **/
+void
+cgroup_remove (const char *path)
+{
+	nih_assert (path != NULL);
+
+	if ((rmdir (path) < 0) && (errno != ENOENT) && (errno != EBUSY))
+		nih_debug ("Failed to remove control group %s: %s",
+			   path, strerror (errno));
+}
+
+/**
+ * cgroup_ppid:
+ * @pid: process id.
+ *
+ * Returns: parent process id of @pid, or -1 if not known.
+ **/
+static pid_t
+cgroup_ppid (pid_t pid)
+{
+	char  filename[PATH_MAX];
+	char  buf[1024];
+	char *p;
+	FILE *f;
+	int   ppid;
+
+	nih_assert (pid > 0);
+
+	snprintf (filename, sizeof (filename), "/proc/%d/stat", pid);
+
+	f = fopen (filename, "r");
+	if (! f)
+		return -1;
+
+	if (! fgets (buf, sizeof (buf), f)) {
+		fclose (f);
+		return -1;
+	}
+
+	fclose (f);
+
+	/* The command name may contain spaces and parentheses, so look
+	 * for the state and parent after the last parenthesis.
+	 */
+	p = strrchr (buf, ')');
+	if ((! p) || (sscanf (p + 1, " %*c %d", &ppid) != 1))
+		return -1;
+
+	return ppid;
+}
+
+/**
+ * cgroup_main_pid:
+ * @path: path of control group,
+ * @exclude: process to ignore, or zero,
+ * @pid: pointer to store main process id in.
+ *
+ * Identifies the main process of a daemon in the control group @path
+ * once the process that was spawned has exited: it is the process whose
+ * parent is no longer in the control group, and so has been re-parented
+ * to the init daemon, while its own children still have it as their
+ * parent.  This holds however many times the daemon forked.
+ *
+ * @pid is set to the first such process found other than @exclude;
+ * there should only be one unless the daemon left others behind.
+ *
+ * Returns: number of processes found, or negative value on raised error.
+ **/
+int
+cgroup_main_pid (const char *path,
+		 pid_t       exclude,
+		 pid_t      *pid)
+{
+	nih_local char *procs = NULL;
+	FILE           *f;
+	int             found = 0, candidate;
+	pid_t           self;
+
+	nih_assert (path != NULL);
+	nih_assert (pid != NULL);
+
+	procs = nih_sprintf (NULL, "%s/cgroup.procs", path);
+	if (! procs)
+		nih_return_no_memory_error (-1);
+
+	f = fopen (procs, "r");
+	if (! f)
+		nih_return_system_error (-1);
+
+	self = getpid ();
+
+	while (fscanf (f, "%d", &candidate) == 1) {
+		if ((candidate <= 0) || (candidate == exclude))
+			continue;
+
+		if (cgroup_ppid (candidate) != self)
+			continue;
+
+		if (! found++)
+			*pid = candidate;
+	}
+
+	fclose (f);
+
+	return found;
+}
+
+/**
+ * cgroup_kill:
+ * @path: path of control group,
+ * @signal: signal to send.
+ *
+ * Sends @signal to every process in the control group @path.  SIGKILL
+ * is sent atomically by the kernel where it supports doing so, so that
+ * processes forked in the meantime cannot escape; otherwise each process
+ * listed in the control group is sent the signal in turn.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+cgroup_kill (const char *path,
+	     int         signal)
+{
+	nih_local char *procs = NULL;
+	FILE           *f;
+	int             pid, signalled = 0;
+
+	nih_assert (path != NULL);
+
+	if (signal == SIGKILL) {
+		nih_local char *kill_file = NULL;
+		int             fd;
+
+		kill_file = nih_sprintf (NULL, "%s/cgroup.kill", path);
+		if (! kill_file)
+			nih_return_no_memory_error (-1);
+
+		fd = open (kill_file, O_WRONLY | O_CLOEXEC);
+		if (fd >= 0) {
+			if (write (fd, "1", 1) < 0) {
+				nih_error_raise_system ();
+				close (fd);
+				return -1;
+			}
+
+			close (fd);
+			return 0;
+		}
+	}
+
+	procs = nih_sprintf (NULL, "%s/cgroup.procs", path);
+	if (! procs)
+		nih_return_no_memory_error (-1);
+
+	f = fopen (procs, "r");
+	if (! f)
+		nih_return_system_error (-1);
+
+	while (fscanf (f, "%d", &pid) == 1) {
+		if ((pid > 0) && (kill (pid, signal) == 0))
+			signalled++;
+	}
+
+	fclose (f);
+
+	if (! signalled) {
+		errno = ESRCH;
+		nih_return_system_error (-1);
+	}
+
+	return 0;
+}
@@ -0,0 +1,59 @@
+/* upstart
+ *
+ * Copyright © 2014 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef INIT_CGROUP_H
+#define INIT_CGROUP_H
+
+#include <sys/types.h>
+
+#include <nih/macros.h>
+
+
+NIH_BEGIN_EXTERN
+
+extern char *cgroup_root;
+
+
+int    cgroup_init     (void);
+
+char * cgroup_path     (const void *parent, const char *class,
+			const char *instance)
+	__attribute__ ((warn_unused_result));
+
+int    cgroup_create   (const char *path)
+	__attribute__ ((warn_unused_result));
+int    cgroup_populated (const char *path)
+	__attribute__ ((warn_unused_result));
+int    cgroup_enter    (const char *path, pid_t pid)
+	__attribute__ ((warn_unused_result));
+void   cgroup_remove   (const char *path);
+
+int    cgroup_enable   (const char *controller)
+	__attribute__ ((warn_unused_result));
+int    cgroup_set      (const char *path, const char *name,
+			const char *format, ...)
+	__attribute__ ((warn_unused_result, format (printf, 3, 4)));
+
+int    cgroup_main_pid (const char *path, pid_t exclude, pid_t *pid)
+	__attribute__ ((warn_unused_result));
+int    cgroup_kill     (const char *path, int signal)
+	__attribute__ ((warn_unused_result));
+
+NIH_END_EXTERN
+
+#endif /* INIT_CGROUP_H */
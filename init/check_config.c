@@ -0,0 +1,353 @@
+/* upstart
+ *
+ * check_config.c - offline checking of job configuration
+ *
+ * Copyright © 2014 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+
+#include <fnmatch.h>
+#include <string.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/string.h>
+#include <nih/list.h>
+#include <nih/hash.h>
+#include <nih/tree.h>
+#include <nih/logging.h>
+
+#include "events.h"
+#include "job_class.h"
+#include "event_operator.h"
+#include "check_config.h"
+
+
+/* Prototypes for static functions */
+static int         check_config_event     (CheckConfig *check,
+					   const char *name)
+	__attribute__ ((warn_unused_result));
+static int         check_config_job       (const char *name)
+	__attribute__ ((warn_unused_result));
+static int         check_config_condition (CheckConfig *check,
+					   JobClass *class,
+					   const char *condition,
+					   EventOperator *root,
+					   int *displayed);
+
+/* External definitions */
+extern int user_mode;
+
+
+/**
+ * check_config_new:
+ * @parent: parent object for new structure,
+ * @warn: if TRUE, every alternative of an "or" must be reachable,
+ * @ignored: NULL-terminated array of events to ignore, may be NULL.
+ *
+ * Builds the set of events emitted by the registered job classes, as
+ * declared by their emits stanzas, indexing plain names by hash so that
+ * checking a condition does not need to scan every job class.
+ *
+ * @ignored is not copied and must remain valid for the lifetime of the
+ * returned structure.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned structure.  When all parents
+ * of the returned structure are freed, the returned structure will also
+ * be freed.
+ *
+ * Returns: newly allocated CheckConfig structure or NULL if insufficient
+ * memory.
+ **/
+CheckConfig *
+check_config_new (const void   *parent,
+		  int           warn,
+		  char * const *ignored)
+{
+	CheckConfig *check;
+
+	job_class_init ();
+
+	check = nih_new (parent, CheckConfig);
+	if (! check)
+		return NULL;
+
+	check->warn = warn;
+	check->ignored = ignored;
+
+	check->events = nih_hash_string_new (check, 0);
+	if (! check->events)
+		goto error;
+
+	check->patterns = nih_str_array_new (check);
+	if (! check->patterns)
+		goto error;
+
+	NIH_HASH_FOREACH (job_classes, iter) {
+		JobClass *class = (JobClass *)iter;
+
+		for (char **e = class->emits; e && *e; e++) {
+			NihListEntry *entry;
+
+			if (strpbrk (*e, "*?[")) {
+				if (! nih_str_array_add (&check->patterns, check,
+							 NULL, *e))
+					goto error;
+				continue;
+			}
+
+			if (nih_hash_lookup (check->events, *e))
+				continue;
+
+			entry = nih_list_entry_new (check->events);
+			if (! entry)
+				goto error;
+
+			entry->str = nih_strdup (entry, *e);
+			if (! entry->str)
+				goto error;
+
+			nih_hash_add (check->events, &entry->entry);
+		}
+	}
+
+	return check;
+
+error:
+	nih_free (check);
+	return NULL;
+}
+
+/**
+ * check_config_event:
+ * @check: event graph,
+ * @name: name of event.
+ *
+ * Events are reachable when emitted by a job, emitted internally by init
+ * or explicitly ignored.
+ *
+ * Returns: TRUE if an event named @name can be emitted, FALSE otherwise.
+ **/
+static int
+check_config_event (CheckConfig *check,
+		    const char  *name)
+{
+	nih_assert (check != NULL);
+	nih_assert (name != NULL);
+
+	if (nih_hash_lookup (check->events, name))
+		return TRUE;
+
+	for (char **p = check->patterns; p && *p; p++)
+		if (! fnmatch (*p, name, 0))
+			return TRUE;
+
+	if ((! strcmp (name, STARTUP_EVENT))
+	    || (! strcmp (name, CTRLALTDEL_EVENT))
+	    || (! strcmp (name, KBDREQUEST_EVENT))
+	    || (! strcmp (name, PWRSTATUS_EVENT))
+	    || ((! strcmp (name, SESSION_END_EVENT)) && user_mode)
+	    || (! strcmp (name, JOB_STARTING_EVENT))
+	    || (! strcmp (name, JOB_STARTED_EVENT))
+	    || (! strcmp (name, JOB_STOPPING_EVENT))
+	    || (! strcmp (name, JOB_STOPPED_EVENT)))
+		return TRUE;
+
+	for (char * const *i = check->ignored; i && *i; i++)
+		if (! strcmp (*i, name))
+			return TRUE;
+
+	return FALSE;
+}
+
+/**
+ * check_config_job:
+ * @name: name of job.
+ *
+ * Names that reference a variable, such as an instance, cannot be
+ * checked and are assumed to be valid.
+ *
+ * Returns: TRUE if a job named @name is registered, FALSE otherwise.
+ **/
+static int
+check_config_job (const char *name)
+{
+	nih_assert (name != NULL);
+
+	if (name[0] == '$')
+		return TRUE;
+
+	return nih_hash_lookup (job_classes, name) ? TRUE : FALSE;
+}
+
+/**
+ * check_config_operator:
+ * @check: event graph,
+ * @oper: root of condition to check.
+ *
+ * Evaluates whether the condition rooted at @oper could ever become
+ * true: a match requires its event to be reachable and, for job events,
+ * the job to exist; an "and" requires both sides and an "or" requires
+ * either side, or both when @check->warn is TRUE.
+ *
+ * Returns: TRUE if the condition is reachable, FALSE otherwise.
+ **/
+int
+check_config_operator (CheckConfig   *check,
+		       EventOperator *oper)
+{
+	EventOperator *left, *right;
+	const char    *job;
+
+	nih_assert (check != NULL);
+	nih_assert (oper != NULL);
+
+	switch (oper->type) {
+	case EVENT_MATCH:
+		job = event_operator_job_name (oper);
+		if (job && (! check_config_job (job)))
+			return FALSE;
+
+		return check_config_event (check, oper->name);
+	case EVENT_AND:
+	case EVENT_OR:
+		left = (EventOperator *)oper->node.left;
+		right = (EventOperator *)oper->node.right;
+
+		nih_assert (left != NULL);
+		nih_assert (right != NULL);
+
+		if ((oper->type == EVENT_AND) || check->warn)
+			return (check_config_operator (check, left)
+				&& check_config_operator (check, right));
+
+		return (check_config_operator (check, left)
+			|| check_config_operator (check, right));
+	default:
+		nih_assert_not_reached ();
+	}
+}
+
+/**
+ * check_config_condition:
+ * @check: event graph,
+ * @class: job class,
+ * @condition: name of condition,
+ * @root: root of condition, may be NULL,
+ * @displayed: set to TRUE once the name of @class has been output.
+ *
+ * Checks the condition of @class rooted at @root and, when it is not
+ * reachable, outputs every event and job referenced by it that is not
+ * known in the same form as initctl check-config.
+ *
+ * Returns: TRUE if the condition is not reachable, FALSE otherwise.
+ **/
+static int
+check_config_condition (CheckConfig   *check,
+			JobClass      *class,
+			const char    *condition,
+			EventOperator *root,
+			int           *displayed)
+{
+	nih_assert (check != NULL);
+	nih_assert (class != NULL);
+	nih_assert (condition != NULL);
+	nih_assert (displayed != NULL);
+
+	if ((! root) || check_config_operator (check, root))
+		return FALSE;
+
+	if (! *displayed) {
+		nih_message ("%s", class->name);
+		*displayed = TRUE;
+	}
+
+	NIH_TREE_FOREACH_POST (&root->node, iter) {
+		EventOperator *oper = (EventOperator *)iter;
+		const char    *job;
+
+		if (oper->type != EVENT_MATCH)
+			continue;
+
+		if (! check_config_event (check, oper->name))
+			nih_message ("  %s: %s %s", condition,
+				     _("unknown event"), oper->name);
+
+		job = event_operator_job_name (oper);
+		if (job && (! check_config_job (job)))
+			nih_message ("  %s: %s %s", condition,
+				     _("unknown job"), job);
+	}
+
+	return TRUE;
+}
+
+/**
+ * check_config:
+ * @name: name of job to check, or NULL for all jobs,
+ * @warn: if TRUE, every alternative of an "or" must be reachable,
+ * @ignored: NULL-terminated array of events to ignore, may be NULL.
+ *
+ * Checks the start on and stop on conditions of the registered job
+ * classes against the events emitted by all of them, without needing a
+ * running init; the configuration should have been loaded by
+ * conf_reload().  The name of each job in error is output, followed by
+ * its unknown events and jobs.
+ *
+ * Returns: number of jobs in error, or negative value if @name is not a
+ * known job.
+ **/
+int
+check_config (const char   *name,
+	      int           warn,
+	      char * const *ignored)
+{
+	nih_local CheckConfig *check = NULL;
+	int                    errors = 0;
+
+	job_class_init ();
+
+	if (name && (! nih_hash_lookup (job_classes, name))) {
+		nih_error ("%s: %s", _("Invalid job class"), name);
+		return -1;
+	}
+
+	check = NIH_MUST (check_config_new (NULL, warn, ignored));
+
+	NIH_HASH_FOREACH (job_classes, iter) {
+		JobClass *class = (JobClass *)iter;
+		int       displayed = FALSE;
+		int       failed;
+
+		if (name && strcmp (class->name, name))
+			continue;
+
+		failed = check_config_condition (check, class, "start on",
+						 class->start_on, &displayed);
+		failed |= check_config_condition (check, class, "stop on",
+						  class->stop_on, &displayed);
+
+		if (failed)
+			errors++;
+	}
+
+	return errors;
+}
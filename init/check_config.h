@@ -0,0 +1,62 @@
+/* upstart
+ *
+ * Copyright © 2014 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef INIT_CHECK_CONFIG_H
+#define INIT_CHECK_CONFIG_H
+
+#include <nih/macros.h>
+#include <nih/hash.h>
+
+#include "event_operator.h"
+
+
+/**
+ * CheckConfig:
+ * @events: names of events emitted by some job, without globs,
+ * @patterns: names of events emitted by some job containing globs,
+ * @ignored: events that may be assumed to be emitted,
+ * @warn: if TRUE, every alternative of an "or" must be reachable.
+ *
+ * Event graph built from the emits stanzas of all registered job
+ * classes against which their start on and stop on conditions are
+ * checked.
+ **/
+typedef struct check_config {
+	NihHash       *events;
+	char         **patterns;
+	char * const  *ignored;
+	int            warn;
+} CheckConfig;
+
+
+NIH_BEGIN_EXTERN
+
+CheckConfig *check_config_new       (const void *parent, int warn,
+				     char * const *ignored)
+	__attribute__ ((warn_unused_result, malloc));
+
+int          check_config_operator  (CheckConfig *check, EventOperator *oper)
+	__attribute__ ((warn_unused_result));
+
+int          check_config           (const char *name, int warn,
+				     char * const *ignored)
+	__attribute__ ((warn_unused_result));
+
+NIH_END_EXTERN
+
+#endif /* INIT_CHECK_CONFIG_H */
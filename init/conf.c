@@ -30,6 +30,7 @@
 #include <errno.h>
 #include <libgen.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <nih/macros.h>
@@ -38,6 +39,7 @@
 #include <nih/hash.h>
 #include <nih/string.h>
 #include <nih/io.h>
+#include <nih/timer.h>
 #include <nih/file.h>
 #include <nih/watch.h>
 #include <nih/logging.h>
@@ -66,6 +68,11 @@ static void conf_create_modify_handler (ConfSource *source, NihWatch *watch,
 					struct stat *statbuf);
 static void conf_delete_handler        (ConfSource *source, NihWatch *watch,
 					const char *path);
+static void conf_queue_path            (ConfSource *source, const char *path);
+static void conf_reload_timeout        (void *data, NihTimer *timer);
+static void conf_create_modify_path    (ConfSource *source, const char *path,
+					struct stat *statbuf);
+static void conf_delete_path           (ConfSource *source, const char *path);
 static int  conf_file_visitor          (ConfSource *source,
 					const char *dirname, const char *path,
 					struct stat *statbuf)
@@ -121,6 +128,23 @@ const char *session_file = NULL;
  **/
 NihList *conf_sources = NULL;
 
+/**
+ * conf_reload_delay:
+ *
+ * Number of seconds without further inotify events to wait before
+ * reloading changed configuration files.  When zero, changed files are
+ * reloaded at the end of the main loop iteration that noticed them.
+ **/
+int conf_reload_delay = 0;
+
+/**
+ * conf_reload_timer:
+ *
+ * Timer that expires once no configuration files have changed for
+ * conf_reload_delay seconds; NULL when no quiet period is running.
+ **/
+static NihTimer *conf_reload_timer = NULL;
+
 extern json_object *json_conf_sources;
 
 /**
@@ -410,6 +434,12 @@ conf_source_new (const void     *parent,
 		return NULL;
 	}
 
+	source->pending = nih_hash_string_new (source, 0);
+	if (! source->pending) {
+		nih_free (source);
+		return NULL;
+	}
+
 	nih_alloc_set_destructor (source, nih_list_destroy);
 
 	nih_list_add (conf_sources, &source->entry);
@@ -891,22 +921,176 @@ error:
  * watch for the latter is on the parent and filtered to only return the
  * path that we're interested in.
  *
- * After checking that it was a regular file that was changed, we reload it;
- * we expect this to fail sometimes since the file may be only partially
- * written.
+ * After checking that it was a regular file that was changed, we queue it
+ * to be reloaded by conf_poll(); editors and package managers tend to
+ * generate several events for each file they write, and this way we only
+ * parse it once they've finished.
  **/
 static void
 conf_create_modify_handler (ConfSource  *source,
 			    NihWatch    *watch,
 			    const char  *path,
 			    struct stat *statbuf)
+{
+	nih_assert (source != NULL);
+	nih_assert (watch != NULL);
+	nih_assert (path != NULL);
+
+	/* note that symbolic links are ignored */
+	if (statbuf && ! S_ISREG (statbuf->st_mode))
+		return;
+
+	/* ignore non-config file changes */
+	if (! is_conf_file (path))
+		return;
+
+	conf_queue_path (source, path);
+}
+
+/**
+ * conf_delete_handler:
+ * @source: configuration source,
+ * @watch: NihWatch for source,
+ * @path: full path to deleted file.
+ *
+ * This function will be called whenever a file is removed or moved out
+ * of a directory that we're watching.  This works for both directory and
+ * file sources, since the watch for the latter is on the parent and
+ * filtered to only return the path that we're interested in.
+ *
+ * The path is queued to be handled by conf_poll(), which will notice
+ * that it no longer exists.
+ **/
+static void
+conf_delete_handler (ConfSource *source,
+		     NihWatch   *watch,
+		     const char *path)
+{
+	nih_assert (source != NULL);
+	nih_assert (watch != NULL);
+	nih_assert (path != NULL);
+
+	conf_queue_path (source, path);
+}
+
+/**
+ * conf_queue_path:
+ * @source: configuration source,
+ * @path: full path to changed file.
+ *
+ * Add @path to the set of paths in @source waiting to be reloaded, unless
+ * it's already there, and (re-)start the quiet period if
+ * conf_reload_delay is set.
+ **/
+static void
+conf_queue_path (ConfSource *source,
+		 const char *path)
+{
+	NihListEntry *entry;
+
+	nih_assert (source != NULL);
+	nih_assert (path != NULL);
+
+	if (! nih_hash_lookup (source->pending, path)) {
+		entry = NIH_MUST (nih_list_entry_new (source->pending));
+		entry->str = NIH_MUST (nih_strdup (entry, path));
+
+		nih_hash_add (source->pending, &entry->entry);
+	}
+
+	if (conf_reload_delay <= 0)
+		return;
+
+	if (conf_reload_timer) {
+		conf_reload_timer->due = time (NULL) + conf_reload_delay;
+	} else {
+		conf_reload_timer = NIH_MUST (nih_timer_add_timeout (
+				NULL, conf_reload_delay,
+				conf_reload_timeout, NULL));
+	}
+}
+
+/**
+ * conf_reload_timeout:
+ * @data: unused,
+ * @timer: timer that caused us to be called.
+ *
+ * Called once no configuration file has changed for conf_reload_delay
+ * seconds; ends the quiet period and reloads the queued paths.
+ **/
+static void
+conf_reload_timeout (void     *data,
+		     NihTimer *timer)
+{
+	nih_assert (timer != NULL);
+	nih_assert (timer == conf_reload_timer);
+
+	conf_reload_timer = NULL;
+
+	conf_poll ();
+}
+
+/**
+ * conf_poll:
+ *
+ * Reload every path queued by the inotify handlers of all configuration
+ * sources, each exactly once no matter how many events were received for
+ * it.  Paths that still exist are reloaded as created or modified files,
+ * those that don't are handled as deleted.
+ *
+ * This is called each time through the main loop; while a quiet period
+ * is running (see conf_reload_delay) it does nothing, and the paths are
+ * instead reloaded when that expires.
+ **/
+void
+conf_poll (void)
+{
+	if (! conf_sources)
+		return;
+
+	if (conf_reload_timer)
+		return;
+
+	NIH_LIST_FOREACH (conf_sources, iter) {
+		ConfSource *source = (ConfSource *)iter;
+
+		NIH_HASH_FOREACH_SAFE (source->pending, hiter) {
+			NihListEntry   *entry = (NihListEntry *)hiter;
+			nih_local char *path = NULL;
+			struct stat     statbuf;
+
+			path = NIH_MUST (nih_strdup (NULL, entry->str));
+			nih_free (entry);
+
+			if (stat (path, &statbuf) == 0) {
+				conf_create_modify_path (source, path, &statbuf);
+			} else {
+				conf_delete_path (source, path);
+			}
+		}
+	}
+}
+
+/**
+ * conf_create_modify_path:
+ * @source: configuration source,
+ * @path: full path to modified file,
+ * @statbuf: stat of @path.
+ *
+ * Reload the created or modified file @path, and for override files every
+ * configuration file that it applies to; we expect this to fail sometimes
+ * since the file may be only partially written.
+ **/
+static void
+conf_create_modify_path (ConfSource  *source,
+			 const char  *path,
+			 struct stat *statbuf)
 {
 	ConfFile *file = NULL;
 	char *config_path = NULL;
 	nih_local char *job_name = NULL;
 
 	nih_assert (source != NULL);
-	nih_assert (watch != NULL);
 	nih_assert (path != NULL);
 
 	/* note that symbolic links are ignored */
@@ -944,29 +1128,21 @@ conf_create_modify_handler (ConfSource  *source,
 }
 
 /**
- * conf_delete_handler:
+ * conf_delete_path:
  * @source: configuration source,
- * @watch: NihWatch for source,
  * @path: full path to deleted file.
  *
- * This function will be called whenever a file is removed or moved out
- * of a directory that we're watching.  This works for both directory and
- * file sources, since the watch for the latter is on the parent and
- * filtered to only return the path that we're interested in.
- *
  * We lookup the file in our hash table, and if we can find it, perform
  * the usual deletion of it.
  **/
 static void
-conf_delete_handler (ConfSource *source,
-		     NihWatch   *watch,
-		     const char *path)
+conf_delete_path (ConfSource *source,
+		  const char *path)
 {
 	ConfFile *file;
 	nih_local char *new_path = NULL;
 
 	nih_assert (source != NULL);
-	nih_assert (watch != NULL);
 	nih_assert (path != NULL);
 
 	/* Lookup the file in the source.  If we haven't parsed it, this
@@ -980,7 +1156,7 @@ conf_delete_handler (ConfSource *source,
 	 * false if passed a directory in this case.
 	 */
 	if (! file && ! is_conf_file_override (path)) {
-		if (! strcmp (watch->path, path)) {
+		if (source->watch && ! strcmp (source->watch->path, path)) {
 			nih_warn ("%s: %s", source->path,
 				  _("Configuration directory deleted"));
 			nih_unref (source->watch, source);
@@ -1004,7 +1180,7 @@ conf_delete_handler (ConfSource *source,
 	 */
 	nih_debug ("Reloading configuration for matching configs on deletion of override (%s)",
 		   path);
-	conf_create_modify_handler (source, watch, path, NULL);
+	conf_create_modify_path (source, path, NULL);
 }
 
 /**
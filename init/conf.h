@@ -53,7 +53,8 @@ typedef enum conf_source_type {
  * @type: type of source,
  * @watch: NihWatch structure for automatic change notification,
  * @flag: reload flag,
- * @files: hash table of files.
+ * @files: hash table of files,
+ * @pending: hash table of changed paths not yet reloaded.
  *
  * This structure represents a single source of configuration, which may be
  * a single file or a directory of files of various types, depending on
@@ -63,6 +64,11 @@ typedef enum conf_source_type {
  * automatically, however mandatory reloading is also supported; for this
  * the @flag member is toggled, and copied to all files reloaded;
  * any that are in the old state are deleted.
+ *
+ * Paths reported by inotify are not reloaded straight away, but placed
+ * in @pending (as NihListEntry structures holding the path) so that a
+ * burst of events for the same file only causes it to be parsed once;
+ * see conf_poll().
  **/
 typedef struct conf_source {
 	NihList             entry;
@@ -74,6 +80,7 @@ typedef struct conf_source {
 
 	int                 flag;
 	NihHash            *files;
+	NihHash            *pending;
 } ConfSource;
 
 /**
@@ -109,6 +116,7 @@ typedef struct conf_file {
 NIH_BEGIN_EXTERN
 
 extern NihList *conf_sources;
+extern int      conf_reload_delay;
 
 
 void        conf_init          (void);
@@ -124,6 +132,8 @@ void        conf_reload        (void);
 int         conf_source_reload (ConfSource *source)
 	__attribute__ ((warn_unused_result));
 
+void        conf_poll          (void);
+
 int         conf_file_destroy  (ConfFile *file);
 
 JobClass *  conf_select_job    (const char *name, const Session *session);
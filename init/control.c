@@ -26,6 +26,7 @@
 #include <dbus/dbus.h>
 
 #include <fcntl.h>
+#include <fnmatch.h>
 #include <stdio.h>
 #include <string.h>
 #include <unistd.h>
@@ -51,6 +52,7 @@
 #include "session.h"
 #include "job_class.h"
 #include "job.h"
+#include "process.h"
 #include "blocked.h"
 #include "conf.h"
 #include "control.h"
@@ -60,6 +62,7 @@
 #include "events.h"
 #include "paths.h"
 #include "xdg.h"
+#include "timeline.h"
 
 #include "com.ubuntu.Upstart.h"
 
@@ -75,6 +78,9 @@ static int   control_check_permission    (NihDBusMessage *message)
 	__attribute__ ((warn_unused_result));
 static void  control_session_file_create (void);
 static void  control_session_file_remove (void);
+static ControlGetAllJobStatusStatusElement *
+control_job_status_new (const void *parent, JobClass *class, Job *job)
+	__attribute__ ((warn_unused_result));
 
 /**
  * use_session_bus:
@@ -130,6 +136,14 @@ DBusConnection *control_bus = NULL;
  **/
 NihList *control_conns = NULL;
 
+/**
+ * control_subscriptions:
+ *
+ * List of ControlSubscription filters registered by private client
+ * connections.
+ **/
+NihList *control_subscriptions = NULL;
+
 /* External definitions */
 extern int      user_mode;
 extern int      disable_respawn;
@@ -146,6 +160,9 @@ control_init (void)
 	if (! control_conns)
 		control_conns = NIH_MUST (nih_list_new (NULL));
 
+	if (! control_subscriptions)
+		control_subscriptions = NIH_MUST (nih_list_new (NULL));
+
 	if (! control_server_address) {
 		if (user_mode) {
 			NIH_MUST (nih_strcat_sprintf (&control_server_address, NULL,
@@ -396,6 +413,14 @@ control_disconnected (DBusConnection *conn)
 		if (entry->data == conn)
 			nih_free (entry);
 	}
+
+	/* And any filters it registered */
+	NIH_LIST_FOREACH_SAFE (control_subscriptions, iter) {
+		ControlSubscription *subscription = (ControlSubscription *)iter;
+
+		if (subscription->conn == conn)
+			nih_free (subscription);
+	}
 }
 
 
@@ -602,6 +627,261 @@ control_get_all_jobs (void             *data,
 	return 0;
 }
 
+/**
+ * control_get_all_job_status:
+ * @data: not used,
+ * @message: D-Bus connection and message received,
+ * @status: pointer for array of status structures reply.
+ *
+ * Implements the GetAllJobStatus method of the com.ubuntu.Upstart
+ * interface.
+ *
+ * Called to obtain the class name, instance name, goal, state and running
+ * processes of every instance of every known job, which will be stored in
+ * @status; jobs with no instances are included once, as a stopped
+ * instance with an empty name.  This allows a client to list everything
+ * in a single round trip rather than querying each job and instance in
+ * turn.  If no jobs are registered, @status will point to an empty array.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+control_get_all_job_status (void                                   *data,
+			    NihDBusMessage                         *message,
+			    ControlGetAllJobStatusStatusElement  ***status)
+{
+	Session                              *session;
+	ControlGetAllJobStatusStatusElement **list;
+	size_t                                len;
+
+	nih_assert (message != NULL);
+	nih_assert (status != NULL);
+
+	job_class_init ();
+
+	/* Get the relevant session */
+	session = session_from_dbus (NULL, message);
+
+	/* Count the entries first so that the array is only allocated
+	 * once, however many jobs there are.
+	 */
+	len = 0;
+	NIH_HASH_FOREACH (job_classes, iter) {
+		JobClass *class = (JobClass *)iter;
+		size_t    instances = 0;
+
+		if ((class->session || (session && session->chroot))
+		    && (class->session != session))
+			continue;
+
+		NIH_HASH_FOREACH (class->instances, job_iter)
+			instances++;
+
+		len += instances ? instances : 1;
+	}
+
+	list = nih_alloc (message, sizeof (ControlGetAllJobStatusStatusElement *)
+			  * (len + 1));
+	if (! list)
+		nih_return_no_memory_error (-1);
+
+	len = 0;
+	list[len] = NULL;
+
+	NIH_HASH_FOREACH (job_classes, iter) {
+		JobClass *class = (JobClass *)iter;
+		int       found = FALSE;
+
+		if ((class->session || (session && session->chroot))
+		    && (class->session != session))
+			continue;
+
+		NIH_HASH_FOREACH (class->instances, job_iter) {
+			Job *job = (Job *)job_iter;
+
+			list[len] = control_job_status_new (list, class, job);
+			if (! list[len])
+				goto error;
+
+			list[++len] = NULL;
+			found = TRUE;
+		}
+
+		if (! found) {
+			list[len] = control_job_status_new (list, class, NULL);
+			if (! list[len])
+				goto error;
+
+			list[++len] = NULL;
+		}
+	}
+
+	*status = list;
+
+	return 0;
+
+error:
+	nih_error_raise_no_memory ();
+	nih_free (list);
+	return -1;
+}
+
+/**
+ * control_job_status_new:
+ * @parent: parent of new structure,
+ * @class: job class,
+ * @job: instance of @class, or NULL.
+ *
+ * Allocates and fills in a status structure for the GetAllJobStatus
+ * method describing @job, or a stopped instance of @class if @job is NULL.
+ * Processes are listed in the same order as the processes property of
+ * the instance, so the main process is always first when running.
+ *
+ * Returns: newly allocated structure or NULL if insufficient memory.
+ **/
+static ControlGetAllJobStatusStatusElement *
+control_job_status_new (const void *parent,
+			JobClass   *class,
+			Job        *job)
+{
+	ControlGetAllJobStatusStatusElement *elem;
+	size_t                               num_processes;
+
+	nih_assert (class != NULL);
+
+	elem = nih_new (parent, ControlGetAllJobStatusStatusElement);
+	if (! elem)
+		return NULL;
+
+	elem->item0 = nih_strdup (elem, class->name);
+	if (! elem->item0)
+		goto error;
+
+	elem->item1 = nih_strdup (elem, job ? job->name : "");
+	if (! elem->item1)
+		goto error;
+
+	elem->item2 = nih_strdup (elem, job_goal_name (job ? job->goal
+						       : JOB_STOP));
+	if (! elem->item2)
+		goto error;
+
+	elem->item3 = nih_strdup (elem, job_state_name (job ? job->state
+							: JOB_WAITING));
+	if (! elem->item3)
+		goto error;
+
+	num_processes = 0;
+	for (int i = 0; job && (i < PROCESS_LAST); i++)
+		if (job->pid[i] > 0)
+			num_processes++;
+
+	elem->item4 = nih_alloc (elem, (sizeof (ControlGetAllJobStatusStatusElementItem4Element *)
+					* (num_processes + 1)));
+	if (! elem->item4)
+		goto error;
+
+	num_processes = 0;
+	elem->item4[num_processes] = NULL;
+
+	for (int i = 0; job && (i < PROCESS_LAST); i++) {
+		ControlGetAllJobStatusStatusElementItem4Element *process;
+
+		if (job->pid[i] <= 0)
+			continue;
+
+		process = nih_new (elem->item4,
+				   ControlGetAllJobStatusStatusElementItem4Element);
+		if (! process)
+			goto error;
+
+		process->item0 = nih_strdup (process, process_name (i));
+		if (! process->item0)
+			goto error;
+
+		process->item1 = job->pid[i];
+
+		elem->item4[num_processes++] = process;
+		elem->item4[num_processes] = NULL;
+	}
+
+	return elem;
+
+error:
+	nih_free (elem);
+	return NULL;
+}
+
+
+/**
+ * control_get_timeline:
+ * @data: not used,
+ * @message: D-Bus connection and message received,
+ * @timeline: pointer for array of timeline entries reply.
+ *
+ * Implements the GetTimeline method of the com.ubuntu.Upstart
+ * interface.
+ *
+ * Called to obtain the recorded timeline of events and job state changes,
+ * which will be stored in @timeline in the order they happened.  Each
+ * entry gives the event name, job class and instance names (empty for
+ * events other than job events) and the time in microseconds on the
+ * monotonic clock.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+control_get_timeline (void                                 *data,
+		      NihDBusMessage                       *message,
+		      ControlGetTimelineTimelineElement  ***timeline)
+{
+	ControlGetTimelineTimelineElement **list;
+	size_t                              len;
+
+	nih_assert (message != NULL);
+	nih_assert (timeline != NULL);
+
+	timeline_init ();
+
+	list = nih_alloc (message, sizeof (ControlGetTimelineTimelineElement *)
+			  * (timeline_len + 1));
+	if (! list)
+		nih_return_no_memory_error (-1);
+
+	len = 0;
+	list[len] = NULL;
+
+	NIH_LIST_FOREACH (timeline, iter) {
+		TimelineEntry                     *entry = (TimelineEntry *)iter;
+		ControlGetTimelineTimelineElement *elem;
+
+		elem = nih_new (list, ControlGetTimelineTimelineElement);
+		if (! elem)
+			goto error;
+
+		elem->item0 = nih_strdup (elem, entry->name);
+		elem->item1 = nih_strdup (elem, entry->job ? entry->job : "");
+		elem->item2 = nih_strdup (elem, (entry->instance
+						 ? entry->instance : ""));
+		if ((! elem->item0) || (! elem->item1) || (! elem->item2))
+			goto error;
+
+		elem->item3 = entry->usec;
+
+		list[len++] = elem;
+		list[len] = NULL;
+	}
+
+	*timeline = list;
+
+	return 0;
+
+error:
+	nih_error_raise_no_memory ();
+	nih_free (list);
+	return -1;
+}
+
 
 int
 control_emit_event (void            *data,
@@ -714,6 +994,88 @@ control_emit_event_with_file (void            *data,
 	return 0;
 }
 
+/**
+ * control_emit_events:
+ * @data: not used,
+ * @message: D-Bus connection and message received,
+ * @events: array of event name and environment pairs.
+ *
+ * Implements the EmitEvents method of the com.ubuntu.Upstart interface.
+ *
+ * Called to emit each of @events, in order, as if EmitEvent had been
+ * called for each without waiting for completion; this allows bridges
+ * to pass on every event they've received in a single method call.
+ *
+ * The events are queued together: if any name or environment is not
+ * valid, the org.freedesktop.DBus.Error.InvalidArgs D-Bus error is
+ * returned and none of them are emitted.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+control_emit_events (void                                   *data,
+		     NihDBusMessage                         *message,
+		     ControlEmitEventsEventsElement * const *events)
+{
+	nih_local Event **queued = NULL;
+	Session          *session;
+	size_t            len;
+
+	nih_assert (message != NULL);
+	nih_assert (events != NULL);
+
+	if (! control_check_permission (message)) {
+		nih_dbus_error_raise_printf (
+			DBUS_INTERFACE_UPSTART ".Error.PermissionDenied",
+			_("You do not have permission to emit an event"));
+		return -1;
+	}
+
+	/* Verify that every name and environment is valid before any
+	 * event is queued.
+	 */
+	for (len = 0; events[len]; len++) {
+		if (! strlen (events[len]->item0)) {
+			nih_dbus_error_raise_printf (DBUS_ERROR_INVALID_ARGS,
+						     _("Name may not be empty string"));
+			return -1;
+		}
+
+		if (! environ_all_valid (events[len]->item1)) {
+			nih_dbus_error_raise_printf (DBUS_ERROR_INVALID_ARGS,
+						     _("Env must be KEY=VALUE pairs"));
+			return -1;
+		}
+	}
+
+	if (! len)
+		return 0;
+
+	queued = nih_alloc (NULL, sizeof (Event *) * len);
+	if (! queued)
+		nih_return_no_memory_error (-1);
+
+	/* Obtain the session */
+	session = session_from_dbus (NULL, message);
+
+	for (size_t i = 0; i < len; i++) {
+		queued[i] = event_new (NULL, events[i]->item0,
+				       events[i]->item1);
+		if (! queued[i]) {
+			nih_error_raise_no_memory ();
+
+			while (i--)
+				nih_free (queued[i]);
+
+			return -1;
+		}
+
+		queued[i]->session = session;
+	}
+
+	return 0;
+}
+
 
 /**
  * control_get_version:
@@ -744,6 +1106,34 @@ control_get_version (void *          data,
 	return 0;
 }
 
+/**
+ * control_get_events_skipped:
+ * @data: not used,
+ * @message: D-Bus connection and message received,
+ * @events_skipped: pointer for reply number.
+ *
+ * Implements the get method for the events_skipped property of the
+ * com.ubuntu.Upstart interface.
+ *
+ * Called to obtain the number of started and stopped events that were
+ * not constructed because nothing could observe them, which will be
+ * stored in @events_skipped.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+control_get_events_skipped (void *          data,
+			    NihDBusMessage *message,
+			    uint64_t *      events_skipped)
+{
+	nih_assert (message != NULL);
+	nih_assert (events_skipped != NULL);
+
+	*events_skipped = job_events_skipped;
+
+	return 0;
+}
+
 /**
  * control_get_log_priority:
  * @data: not used,
@@ -1229,11 +1619,246 @@ control_notify_event_emitted (Event *event)
 		NihListEntry   *entry = (NihListEntry *)iter;
 		DBusConnection *conn = (DBusConnection *)entry->data;
 
+		if (! control_conn_wants_event (conn, event->name))
+			continue;
+
 		NIH_ZERO (control_emit_event_emitted (conn, DBUS_PATH_UPSTART,
 							    event->name, event->env));
 	}
 }
 
+
+/**
+ * control_subscription_find:
+ * @conn: connection to look up.
+ *
+ * Returns: the filters registered for @conn, or NULL if it has none.
+ **/
+static ControlSubscription *
+control_subscription_find (DBusConnection *conn)
+{
+	nih_assert (conn != NULL);
+
+	if (! control_subscriptions)
+		return NULL;
+
+	NIH_LIST_FOREACH (control_subscriptions, iter) {
+		ControlSubscription *subscription = (ControlSubscription *)iter;
+
+		if (subscription->conn == conn)
+			return subscription;
+	}
+
+	return NULL;
+}
+
+/**
+ * control_match_any:
+ * @globs: NULL-terminated array of globs,
+ * @name: name to match.
+ *
+ * Returns: TRUE if @name matches any of @globs, FALSE otherwise.
+ **/
+static int
+control_match_any (char * const *globs,
+		   const char   *name)
+{
+	nih_assert (globs != NULL);
+	nih_assert (name != NULL);
+
+	for (char * const *glob = globs; *glob; glob++)
+		if (! fnmatch (*glob, name, 0))
+			return TRUE;
+
+	return FALSE;
+}
+
+/**
+ * control_subscribe:
+ * @data: not used,
+ * @message: D-Bus connection and message received,
+ * @events: event name globs,
+ * @jobs: job name globs.
+ *
+ * Implements the Subscribe method of the com.ubuntu.Upstart interface.
+ *
+ * Called by a client on its private connection to restrict the
+ * EventEmitted signals it receives to events whose names match one of
+ * @events, and the GoalChanged and StateChanged signals to instances of
+ * jobs whose names match one of @jobs; either may be empty to receive
+ * none of those signals.  Calling it again replaces the filters.
+ *
+ * Signals are broadcast on the D-Bus bus connection so filters cannot
+ * be applied there, the com.ubuntu.Upstart.Error.NotSupported D-Bus
+ * error is returned instead.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+control_subscribe (void           *data,
+		   NihDBusMessage *message,
+		   char * const   *events,
+		   char * const   *jobs)
+{
+	ControlSubscription *subscription;
+	char               **new_events;
+	char               **new_jobs;
+
+	nih_assert (message != NULL);
+	nih_assert (events != NULL);
+	nih_assert (jobs != NULL);
+
+	if (message->connection == control_bus) {
+		nih_dbus_error_raise_printf (
+			DBUS_INTERFACE_UPSTART ".Error.NotSupported",
+			_("Subscriptions are only supported on private connections"));
+		return -1;
+	}
+
+	subscription = control_subscription_find (message->connection);
+	if (! subscription) {
+		subscription = nih_new (NULL, ControlSubscription);
+		if (! subscription)
+			nih_return_no_memory_error (-1);
+
+		nih_list_init (&subscription->entry);
+		nih_alloc_set_destructor (subscription, nih_list_destroy);
+
+		subscription->conn = message->connection;
+		subscription->events = NULL;
+		subscription->jobs = NULL;
+	}
+
+	new_events = nih_str_array_copy (subscription, NULL, events);
+	new_jobs = new_events ? nih_str_array_copy (subscription, NULL, jobs) : NULL;
+	if (! new_jobs) {
+		if (NIH_LIST_EMPTY (&subscription->entry)) {
+			nih_free (subscription);
+		} else if (new_events) {
+			nih_free (new_events);
+		}
+
+		nih_return_no_memory_error (-1);
+	}
+
+	if (subscription->events)
+		nih_free (subscription->events);
+	if (subscription->jobs)
+		nih_free (subscription->jobs);
+
+	subscription->events = new_events;
+	subscription->jobs = new_jobs;
+
+	nih_list_add (control_subscriptions, &subscription->entry);
+
+	return 0;
+}
+
+/**
+ * control_unsubscribe:
+ * @data: not used,
+ * @message: D-Bus connection and message received.
+ *
+ * Implements the Unsubscribe method of the com.ubuntu.Upstart interface.
+ *
+ * Called by a client to remove any filters it registered with the
+ * Subscribe method, so that it receives every signal again.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+control_unsubscribe (void           *data,
+		     NihDBusMessage *message)
+{
+	ControlSubscription *subscription;
+
+	nih_assert (message != NULL);
+
+	subscription = control_subscription_find (message->connection);
+	if (subscription)
+		nih_free (subscription);
+
+	return 0;
+}
+
+/**
+ * control_conn_wants_event:
+ * @conn: connection to check,
+ * @name: name of event.
+ *
+ * Used before constructing an EventEmitted signal to skip connections
+ * that have not subscribed to @name.  Subscriptions are only possible on
+ * private connections, so the bus connection always wants every event.
+ *
+ * Returns: TRUE if the signal should be sent over @conn, FALSE otherwise.
+ **/
+int
+control_conn_wants_event (DBusConnection *conn,
+			  const char     *name)
+{
+	ControlSubscription *subscription;
+
+	nih_assert (conn != NULL);
+	nih_assert (name != NULL);
+
+	subscription = control_subscription_find (conn);
+	if (! subscription)
+		return TRUE;
+
+	return control_match_any (subscription->events, name);
+}
+
+/**
+ * control_conn_wants_job:
+ * @conn: connection to check,
+ * @name: name of job class.
+ *
+ * Used before constructing a GoalChanged or StateChanged signal to skip
+ * connections that have not subscribed to instances of @name.
+ *
+ * Returns: TRUE if the signal should be sent over @conn, FALSE otherwise.
+ **/
+int
+control_conn_wants_job (DBusConnection *conn,
+			const char     *name)
+{
+	ControlSubscription *subscription;
+
+	nih_assert (conn != NULL);
+	nih_assert (name != NULL);
+
+	subscription = control_subscription_find (conn);
+	if (! subscription)
+		return TRUE;
+
+	return control_match_any (subscription->jobs, name);
+}
+
+/**
+ * control_event_wanted:
+ * @name: name of event.
+ *
+ * Returns: TRUE if any connection would be sent the EventEmitted signal
+ * for an event named @name, FALSE otherwise.
+ **/
+int
+control_event_wanted (const char *name)
+{
+	nih_assert (name != NULL);
+
+	control_init ();
+
+	NIH_LIST_FOREACH (control_conns, iter) {
+		NihListEntry   *entry = (NihListEntry *)iter;
+		DBusConnection *conn = (DBusConnection *)entry->data;
+
+		if (control_conn_wants_event (conn, name))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
 /**
  * control_notify_restarted
  *
@@ -33,6 +33,8 @@
 #include "event.h"
 #include "quiesce.h"
 
+#include "com.ubuntu.Upstart.h"
+
 /**
  * USE_SESSION_BUS_ENV:
  *
@@ -45,6 +47,28 @@
 #define USE_SESSION_BUS_ENV "UPSTART_USE_SESSION_BUS"
 #endif
 
+/**
+ * ControlSubscription:
+ * @entry: list header,
+ * @conn: private connection the subscription belongs to,
+ * @events: NULL-terminated array of event name globs,
+ * @jobs: NULL-terminated array of job name globs.
+ *
+ * Filters registered by a client on its private connection with the
+ * Subscribe method; only signals for events whose names match one of
+ * @events, and for instances of jobs whose names match one of @jobs,
+ * are sent over @conn.
+ *
+ * Connections without a subscription receive every signal.
+ **/
+typedef struct control_subscription {
+	NihList         entry;
+	DBusConnection *conn;
+	char          **events;
+	char          **jobs;
+} ControlSubscription;
+
+
 /**
  * control_get_job:
  * 
@@ -92,6 +116,7 @@ extern DBusServer     *control_server;
 extern DBusConnection *control_bus;
 
 extern NihList        *control_conns;
+extern NihList        *control_subscriptions;
 
 
 void control_init                 (void);
@@ -114,6 +139,12 @@ int  control_get_job_by_name      (void *data, NihDBusMessage *message,
 int  control_get_all_jobs         (void *data, NihDBusMessage *message,
 				   char ***jobs)
 	__attribute__ ((warn_unused_result));
+int  control_get_all_job_status   (void *data, NihDBusMessage *message,
+				   ControlGetAllJobStatusStatusElement ***status)
+	__attribute__ ((warn_unused_result));
+int  control_get_timeline         (void *data, NihDBusMessage *message,
+				   ControlGetTimelineTimelineElement ***timeline)
+	__attribute__ ((warn_unused_result));
 
 int  control_emit_event           (void *data, NihDBusMessage *message,
 				   const char *name, char * const *env,
@@ -123,11 +154,18 @@ int  control_emit_event_with_file (void *data, NihDBusMessage *message,
 				   const char *name, char * const *env,
 				   int wait, int file)
 	__attribute__ ((warn_unused_result));
+int  control_emit_events          (void *data, NihDBusMessage *message,
+				   ControlEmitEventsEventsElement * const *events)
+	__attribute__ ((warn_unused_result));
 
 int  control_get_version          (void *data, NihDBusMessage *message,
 				   char **version)
 	__attribute__ ((warn_unused_result));
 
+int  control_get_events_skipped   (void *data, NihDBusMessage *message,
+				   uint64_t *events_skipped)
+	__attribute__ ((warn_unused_result));
+
 int  control_get_log_priority     (void *data, NihDBusMessage *message,
 				   char **log_priority)
 	__attribute__ ((warn_unused_result));
@@ -159,6 +197,19 @@ int  control_restart (void *data, NihDBusMessage *message)
 
 void control_notify_event_emitted (Event *event);
 
+int  control_subscribe            (void *data, NihDBusMessage *message,
+				   char * const *events, char * const *jobs)
+	__attribute__ ((warn_unused_result));
+int  control_unsubscribe          (void *data, NihDBusMessage *message)
+	__attribute__ ((warn_unused_result));
+
+int  control_conn_wants_event     (DBusConnection *conn, const char *name)
+	__attribute__ ((warn_unused_result));
+int  control_conn_wants_job       (DBusConnection *conn, const char *name)
+	__attribute__ ((warn_unused_result));
+int  control_event_wanted         (const char *name)
+	__attribute__ ((warn_unused_result));
+
 void control_notify_restarted (void);
 
 int control_notify_disk_writeable (void   *data,
@@ -0,0 +1,1309 @@
+/* upstart
+ *
+ * control_native.c - lightweight native control protocol
+ *
+ * Copyright © 2014 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <dbus/dbus.h>
+
+#include <errno.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/string.h>
+#include <nih/list.h>
+#include <nih/hash.h>
+#include <nih/io.h>
+#include <nih/logging.h>
+#include <nih/error.h>
+
+#include <nih-dbus/dbus_error.h>
+
+#include "dbus/upstart.h"
+
+#include "environ.h"
+#include "process.h"
+#include "job_class.h"
+#include "job.h"
+#include "event.h"
+#include "control_native.h"
+
+
+/* Prototypes for static functions */
+static void   control_native_accept  (void *data, NihIoWatch *watch,
+				      NihIoEvents events);
+static void   control_native_closed  (ControlNativeClient *client, NihIo *io);
+static void   control_native_error   (ControlNativeClient *client, NihIo *io);
+static void   control_native_handle  (ControlNativeClient *client,
+				      const ControlNativeHeader *header,
+				      const char *payload);
+static void   control_native_reply   (ControlNativeClient *client,
+				      uint32_t serial, ControlNativeType type,
+				      char * const *strings);
+static char **control_native_strings (const void *parent,
+				      const char *payload, size_t len)
+	__attribute__ ((warn_unused_result));
+static int    control_native_check_permission (ControlNativeClient *client)
+	__attribute__ ((warn_unused_result));
+static JobClass *control_native_class (const char *name)
+	__attribute__ ((warn_unused_result));
+static char  *control_native_instance (const void *parent, JobClass *class,
+				       char * const *env, char ***full_env)
+	__attribute__ ((warn_unused_result));
+static int    control_native_start   (ControlNativeClient *client,
+				      char * const *args, char ***reply)
+	__attribute__ ((warn_unused_result));
+static int    control_native_stop    (ControlNativeClient *client,
+				      char * const *args, char ***reply)
+	__attribute__ ((warn_unused_result));
+static int    control_native_status  (ControlNativeClient *client,
+				      char * const *args, char ***reply)
+	__attribute__ ((warn_unused_result));
+static int    control_native_emit    (ControlNativeClient *client,
+				      char * const *args, char ***reply)
+	__attribute__ ((warn_unused_result));
+static int    control_native_list    (ControlNativeClient *client,
+				      char * const *args, char ***reply)
+	__attribute__ ((warn_unused_result));
+static int    control_native_watch_jobs (ControlNativeClient *client,
+					 uint32_t serial, char * const *args,
+					 char ***reply)
+	__attribute__ ((warn_unused_result));
+static void   control_native_feed_init (void);
+static char **control_native_job_strings (const void *parent,
+					  uint64_t sequence, Job *job)
+	__attribute__ ((warn_unused_result));
+
+
+/**
+ * control_native_sock:
+ *
+ * Listening socket for native control protocol clients, or -1 if the
+ * server is not open.
+ **/
+int control_native_sock = -1;
+
+/**
+ * control_native_watch:
+ *
+ * Watch on control_native_sock accepting new clients.
+ **/
+static NihIoWatch *control_native_watch = NULL;
+
+/**
+ * control_native_watchers:
+ *
+ * List of clients following job changes, each sent a CHANGE message by
+ * control_native_job_changed().
+ **/
+NihList *control_native_watchers = NULL;
+
+/**
+ * control_native_history:
+ *
+ * List of the most recent job changes, oldest first, holding at most
+ * CONTROL_NATIVE_HISTORY entries.  This is NULL until the first client
+ * asks to follow changes, so changes are neither numbered nor retained
+ * while nobody is interested in them.
+ **/
+NihList *control_native_history = NULL;
+
+/**
+ * control_native_history_len:
+ *
+ * Number of entries in control_native_history.
+ **/
+static size_t control_native_history_len = 0;
+
+/**
+ * control_native_sequence:
+ *
+ * Sequence number of the most recent job change.
+ **/
+uint64_t control_native_sequence = 0;
+
+/**
+ * control_native_epoch:
+ *
+ * Time at which changes started to be numbered, sent to clients along
+ * with sequence numbers so that those from a previous instance of init
+ * are not mistaken for ours.
+ **/
+static time_t control_native_epoch = 0;
+
+/* External definitions */
+extern int user_mode;
+
+
+/**
+ * control_native_server_open:
+ *
+ * Open a listening socket for clients of the native control protocol on
+ * the abstract unix socket named by CONTROL_NATIVE_ADDRESS, and arrange
+ * for control_native_job_changed() to be called as jobs change.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+control_native_server_open (void)
+{
+	struct sockaddr_un  addr;
+	nih_local char     *name = NULL;
+	size_t              len;
+	int                 sock;
+
+	nih_assert (control_native_sock < 0);
+
+	if (user_mode) {
+		name = nih_sprintf (NULL, "%s-session/%d/%d",
+				    CONTROL_NATIVE_ADDRESS, getuid (), getpid ());
+	} else {
+		name = nih_strdup (NULL, CONTROL_NATIVE_ADDRESS);
+	}
+	if (! name)
+		nih_return_no_memory_error (-1);
+
+	/* Abstract socket names begin with a NUL byte */
+	len = strlen (name);
+	nih_assert (len < sizeof (addr.sun_path));
+
+	memset (&addr, 0, sizeof (addr));
+	addr.sun_family = AF_UNIX;
+	memcpy (addr.sun_path + 1, name, len);
+
+	sock = socket (AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+	if (sock < 0)
+		nih_return_system_error (-1);
+
+	if ((bind (sock, (struct sockaddr *)&addr,
+		   offsetof (struct sockaddr_un, sun_path) + 1 + len) < 0)
+	    || (listen (sock, SOMAXCONN) < 0)) {
+		nih_error_raise_system ();
+		close (sock);
+		return -1;
+	}
+
+	control_native_watch = nih_io_add_watch (NULL, sock, NIH_IO_READ,
+						 control_native_accept, NULL);
+	if (! control_native_watch) {
+		close (sock);
+		nih_return_no_memory_error (-1);
+	}
+
+	control_native_sock = sock;
+
+	job_changed_hook = control_native_job_changed;
+
+	return 0;
+}
+
+/**
+ * control_native_server_close:
+ *
+ * Close the listening socket opened by control_native_server_open();
+ * clients already connected are unaffected.
+ **/
+void
+control_native_server_close (void)
+{
+	if (control_native_sock < 0)
+		return;
+
+	nih_free (control_native_watch);
+	control_native_watch = NULL;
+
+	close (control_native_sock);
+	control_native_sock = -1;
+}
+
+/**
+ * control_native_accept:
+ * @data: not used,
+ * @watch: watch on listening socket,
+ * @events: events that occurred.
+ *
+ * Called when a client connects to the listening socket; obtains its
+ * credentials and sets up the connection to read requests from it.
+ **/
+static void
+control_native_accept (void        *data,
+		       NihIoWatch  *watch,
+		       NihIoEvents  events)
+{
+	struct ucred cred;
+	socklen_t    len;
+	int          fd;
+
+	nih_assert (watch != NULL);
+
+	fd = accept4 (watch->fd, NULL, NULL, SOCK_CLOEXEC);
+	if (fd < 0) {
+		if ((errno != EAGAIN) && (errno != EINTR))
+			nih_warn ("%s: %s", _("Unable to accept native control connection"),
+				  strerror (errno));
+		return;
+	}
+
+	len = sizeof (cred);
+	if (getsockopt (fd, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0) {
+		nih_warn ("%s: %s", _("Cannot establish peer credentials"),
+			  strerror (errno));
+		close (fd);
+		return;
+	}
+
+	if (! control_native_client_new (NULL, fd, cred.uid)) {
+		NihError *err;
+
+		err = nih_error_get ();
+		nih_warn ("%s: %s", _("Unable to accept native control connection"),
+			  err->message);
+		nih_free (err);
+
+		close (fd);
+	}
+}
+
+/**
+ * control_native_client_new:
+ * @parent: parent object for new client,
+ * @fd: connected socket,
+ * @uid: user id of the client.
+ *
+ * Allocates and returns a new ControlNativeClient structure reading
+ * requests from @fd, which is owned by the client from then on.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned client.  When all parents
+ * of the returned client are freed, the returned client will also be
+ * freed.
+ *
+ * Returns: newly allocated ControlNativeClient structure or NULL on
+ * raised error.
+ **/
+ControlNativeClient *
+control_native_client_new (const void *parent,
+			   int         fd,
+			   uid_t       uid)
+{
+	ControlNativeClient *client;
+
+	nih_assert (fd >= 0);
+
+	client = nih_new (parent, ControlNativeClient);
+	if (! client)
+		nih_return_no_memory_error (NULL);
+
+	nih_list_init (&client->entry);
+
+	client->uid = uid;
+	client->watch_serial = 0;
+	client->closing = FALSE;
+
+	client->io = nih_io_reopen (client, fd, NIH_IO_STREAM,
+				    (NihIoReader)control_native_reader,
+				    (NihIoCloseHandler)control_native_closed,
+				    (NihIoErrorHandler)control_native_error,
+				    client);
+	if (! client->io) {
+		nih_free (client);
+		return NULL;
+	}
+
+	nih_alloc_set_destructor (client, nih_list_destroy);
+
+	return client;
+}
+
+/**
+ * control_native_closed:
+ * @client: client that disconnected,
+ * @io: connection to client.
+ *
+ * Called when the client closes its end of the connection.
+ **/
+static void
+control_native_closed (ControlNativeClient *client,
+		       NihIo               *io)
+{
+	nih_assert (client != NULL);
+
+	nih_free (client);
+}
+
+/**
+ * control_native_error:
+ * @client: client whose connection failed,
+ * @io: connection to client.
+ *
+ * Called when an error occurs on the connection to the client.
+ **/
+static void
+control_native_error (ControlNativeClient *client,
+		      NihIo               *io)
+{
+	NihError *err;
+
+	nih_assert (client != NULL);
+
+	err = nih_error_get ();
+	nih_warn ("%s: %s", _("Error on native control connection"),
+		  err->message);
+	nih_free (err);
+
+	nih_free (client);
+}
+
+/**
+ * control_native_reader:
+ * @client: client that sent the requests,
+ * @io: connection to client,
+ * @buf: data received,
+ * @len: length of @buf.
+ *
+ * Called when data has been received from @client; each complete request
+ * in @buf is handled in turn and consumed, leaving any partial request
+ * in the buffer until the rest of it arrives.
+ **/
+void
+control_native_reader (ControlNativeClient *client,
+		       NihIo               *io,
+		       const char          *buf,
+		       size_t               len)
+{
+	ControlNativeHeader header;
+	size_t              used = 0;
+
+	nih_assert (client != NULL);
+	nih_assert (io != NULL);
+	nih_assert (buf != NULL);
+
+	while (len - used >= sizeof (header)) {
+		/* The buffer is not necessarily aligned */
+		memcpy (&header, buf + used, sizeof (header));
+
+		if (header.length > CONTROL_NATIVE_MAX_LENGTH) {
+			nih_warn (_("Disconnecting native control client "
+				    "that sent an oversized request"));
+			nih_free (client);
+			return;
+		}
+
+		if (len - used - sizeof (header) < header.length)
+			break;
+
+		control_native_handle (client, &header,
+				       buf + used + sizeof (header));
+
+		used += sizeof (header) + header.length;
+
+		if (client->closing)
+			break;
+	}
+
+	if (used)
+		nih_io_buffer_shrink (io->recv_buf, used);
+}
+
+/**
+ * control_native_handle:
+ * @client: client that sent the request,
+ * @header: request header,
+ * @payload: request payload of @header->length bytes.
+ *
+ * Performs the request and queues the reply to @client; errors are
+ * returned to the client using the same names as the equivalent D-Bus
+ * methods.
+ **/
+static void
+control_native_handle (ControlNativeClient       *client,
+		       const ControlNativeHeader *header,
+		       const char                *payload)
+{
+	nih_local char **args = NULL;
+	nih_local char **reply = NULL;
+	int              ret = -1;
+
+	nih_assert (client != NULL);
+	nih_assert (header != NULL);
+	nih_assert (payload != NULL);
+
+	args = control_native_strings (NULL, payload, header->length);
+	if (args) {
+		switch (header->type) {
+		case CONTROL_NATIVE_START:
+			ret = control_native_start (client, args, &reply);
+			break;
+		case CONTROL_NATIVE_STOP:
+			ret = control_native_stop (client, args, &reply);
+			break;
+		case CONTROL_NATIVE_STATUS:
+			ret = control_native_status (client, args, &reply);
+			break;
+		case CONTROL_NATIVE_EMIT:
+			ret = control_native_emit (client, args, &reply);
+			break;
+		case CONTROL_NATIVE_LIST:
+			ret = control_native_list (client, args, &reply);
+			break;
+		case CONTROL_NATIVE_WATCH:
+			ret = control_native_watch_jobs (client, header->serial,
+							 args, &reply);
+			break;
+		default:
+			nih_dbus_error_raise_printf (
+				DBUS_ERROR_UNKNOWN_METHOD,
+				_("Unknown request type: %u"),
+				(unsigned int)header->type);
+			break;
+		}
+	}
+
+	if (ret < 0) {
+		NihError *err;
+		char     *strings[3];
+
+		err = nih_error_get ();
+		if (err->number == NIH_DBUS_ERROR) {
+			strings[0] = ((NihDBusError *)err)->name;
+		} else if (err->number == ENOMEM) {
+			strings[0] = DBUS_ERROR_NO_MEMORY;
+		} else {
+			strings[0] = DBUS_ERROR_FAILED;
+		}
+		strings[1] = err->message;
+		strings[2] = NULL;
+
+		control_native_reply (client, header->serial,
+				      CONTROL_NATIVE_ERROR, strings);
+
+		nih_free (err);
+		return;
+	}
+
+	control_native_reply (client, header->serial, CONTROL_NATIVE_OK, reply);
+}
+
+/**
+ * control_native_reply:
+ * @client: client to reply to,
+ * @serial: serial of request,
+ * @type: reply type,
+ * @strings: NULL-terminated array of strings for payload, may be NULL.
+ *
+ * Queues a reply to @client.  Should that take the data queued for
+ * @client beyond CONTROL_NATIVE_MAX_QUEUED, the queue is discarded
+ * instead and the connection shut down so that it is closed from the
+ * main loop.
+ **/
+static void
+control_native_reply (ControlNativeClient *client,
+		      uint32_t             serial,
+		      ControlNativeType    type,
+		      char * const        *strings)
+{
+	ControlNativeHeader  header;
+	nih_local char      *payload = NULL;
+	size_t               len = 0;
+
+	nih_assert (client != NULL);
+
+	if (client->closing)
+		return;
+
+	for (char * const *s = strings; s && *s; s++)
+		len += strlen (*s) + 1;
+
+	if (client->io->send_buf->len + sizeof (header) + len
+	    > CONTROL_NATIVE_MAX_QUEUED) {
+		nih_warn (_("Disconnecting native control client "
+			    "that is not reading replies"));
+
+		client->closing = TRUE;
+		nih_io_buffer_shrink (client->io->send_buf,
+				      client->io->send_buf->len);
+		shutdown (client->io->watch->fd, SHUT_RDWR);
+		return;
+	}
+
+	payload = NIH_MUST (nih_alloc (NULL, len + 1));
+
+	len = 0;
+	for (char * const *s = strings; s && *s; s++) {
+		size_t slen = strlen (*s) + 1;
+
+		memcpy (payload + len, *s, slen);
+		len += slen;
+	}
+
+	header.length = len;
+	header.serial = serial;
+	header.type = type;
+
+	NIH_ZERO (nih_io_write (client->io, (const char *)&header,
+				sizeof (header)));
+	if (len)
+		NIH_ZERO (nih_io_write (client->io, payload, len));
+}
+
+/**
+ * control_native_strings:
+ * @parent: parent object for new array,
+ * @payload: request payload,
+ * @len: length of @payload.
+ *
+ * Splits @payload into its NUL-terminated strings.
+ *
+ * Returns: newly allocated NULL-terminated array of strings or NULL on
+ * raised error.
+ **/
+static char **
+control_native_strings (const void *parent,
+			const char *payload,
+			size_t      len)
+{
+	char   **strings;
+	size_t   count = 0;
+
+	nih_assert (payload != NULL);
+
+	if (len && payload[len - 1]) {
+		nih_dbus_error_raise_printf (DBUS_ERROR_INVALID_ARGS,
+					     _("Malformed request"));
+		return NULL;
+	}
+
+	strings = nih_str_array_new (parent);
+	if (! strings)
+		nih_return_no_memory_error (NULL);
+
+	for (const char *s = payload; s < payload + len; s += strlen (s) + 1) {
+		if (! nih_str_array_add (&strings, parent, &count, s)) {
+			nih_free (strings);
+			nih_return_no_memory_error (NULL);
+		}
+	}
+
+	return strings;
+}
+
+/**
+ * control_native_check_permission:
+ * @client: client making request.
+ *
+ * Determine if @client may modify jobs or emit events; only root and
+ * the user we are running as may do so.  Unlike the private D-Bus
+ * server, the native socket is abstract and has no filesystem
+ * permissions, so any local user may connect to it, including that of
+ * a Session Init.
+ *
+ * Returns: TRUE if permission is granted, FALSE with a raised error if
+ * not.
+ **/
+static int
+control_native_check_permission (ControlNativeClient *client)
+{
+	nih_assert (client != NULL);
+
+	if ((client->uid == getuid ()) || (! client->uid))
+		return TRUE;
+
+	nih_dbus_error_raise_printf (
+		DBUS_INTERFACE_UPSTART ".Error.PermissionDenied",
+		_("You do not have permission to perform this request"));
+
+	return FALSE;
+}
+
+/**
+ * control_native_class:
+ * @name: name of job.
+ *
+ * Native control clients are not part of any session, so only jobs
+ * outside of sessions may be found.
+ *
+ * Returns: registered job class named @name, or NULL with a raised
+ * error.
+ **/
+static JobClass *
+control_native_class (const char *name)
+{
+	JobClass *class;
+
+	if (! name || ! *name) {
+		nih_dbus_error_raise_printf (DBUS_ERROR_INVALID_ARGS,
+					     _("Job name required"));
+		return NULL;
+	}
+
+	class = job_class_get_registered (name, NULL);
+	if (! class) {
+		nih_dbus_error_raise_printf (
+			DBUS_INTERFACE_UPSTART ".Error.UnknownJob",
+			_("Unknown job: %s"), name);
+		return NULL;
+	}
+
+	return class;
+}
+
+/**
+ * control_native_instance:
+ * @parent: parent object for new name,
+ * @class: job class,
+ * @env: environment provided by client,
+ * @full_env: pointer to store full environment.
+ *
+ * Expands the instance name of @class using its environment combined
+ * with @env, as the Start and Stop methods do; the combined environment
+ * is stored in @full_env, with no parent, if that is not NULL.
+ *
+ * Returns: newly allocated instance name or NULL on raised error.
+ **/
+static char *
+control_native_instance (const void     *parent,
+			 JobClass       *class,
+			 char * const   *env,
+			 char         ***full_env)
+{
+	char   **new_env;
+	char    *name;
+	size_t   len;
+
+	nih_assert (class != NULL);
+	nih_assert (env != NULL);
+
+	if (! environ_all_valid (env)) {
+		nih_dbus_error_raise_printf (DBUS_ERROR_INVALID_ARGS,
+					     _("Env must be KEY=VALUE pairs"));
+		return NULL;
+	}
+
+	new_env = job_class_environment (NULL, class, &len);
+	if (! new_env)
+		nih_return_system_error (NULL);
+
+	if (! environ_append (&new_env, NULL, &len, TRUE, env)) {
+		nih_free (new_env);
+		nih_return_system_error (NULL);
+	}
+
+	name = environ_expand (parent, class->instance, new_env);
+	if (! name) {
+		NihError *error;
+
+		nih_free (new_env);
+
+		error = nih_error_get ();
+		if (error->number != ENOMEM) {
+			error = nih_error_steal ();
+			nih_dbus_error_raise (DBUS_ERROR_INVALID_ARGS,
+					      error->message);
+			nih_free (error);
+		}
+
+		return NULL;
+	}
+
+	if (full_env) {
+		*full_env = new_env;
+	} else {
+		nih_free (new_env);
+	}
+
+	return name;
+}
+
+/**
+ * control_native_start:
+ * @client: client making request,
+ * @args: job name and environment,
+ * @reply: pointer to store reply strings.
+ *
+ * Changes the goal of the instance selected by @args to start, creating
+ * it if necessary; the instance name is returned in @reply.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+static int
+control_native_start (ControlNativeClient   *client,
+		      char * const          *args,
+		      char                ***reply)
+{
+	JobClass        *class;
+	Job             *job;
+	nih_local char **start_env = NULL;
+	nih_local char  *name = NULL;
+
+	nih_assert (client != NULL);
+	nih_assert (args != NULL);
+	nih_assert (reply != NULL);
+
+	if (! control_native_check_permission (client))
+		return -1;
+
+	class = control_native_class (args[0]);
+	if (! class)
+		return -1;
+
+	name = control_native_instance (NULL, class, args + 1, &start_env);
+	if (! name)
+		return -1;
+
+	job = (Job *)nih_hash_lookup (class->instances, name);
+	if (! job) {
+		job = job_new (class, name);
+		if (! job)
+			nih_return_system_error (-1);
+	}
+
+	if (job->goal == JOB_START) {
+		nih_dbus_error_raise_printf (
+			DBUS_INTERFACE_UPSTART ".Error.AlreadyStarted",
+			_("Job is already running: %s"),
+			job_name (job));
+		return -1;
+	}
+
+	*reply = nih_str_array_new (NULL);
+	if (! *reply
+	    || ! nih_str_array_add (reply, NULL, NULL, job->name))
+		nih_return_no_memory_error (-1);
+
+	if (job->start_env)
+		nih_unref (job->start_env, job);
+
+	job->start_env = start_env;
+	nih_ref (job->start_env, job);
+
+	job_finished (job, FALSE);
+	job_change_goal (job, JOB_START);
+
+	return 0;
+}
+
+/**
+ * control_native_stop:
+ * @client: client making request,
+ * @args: job name and environment,
+ * @reply: pointer to store reply strings.
+ *
+ * Changes the goal of the instance selected by @args to stop.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+static int
+control_native_stop (ControlNativeClient   *client,
+		     char * const          *args,
+		     char                ***reply)
+{
+	JobClass        *class;
+	Job             *job;
+	nih_local char  *name = NULL;
+	char           **stop_env;
+
+	nih_assert (client != NULL);
+	nih_assert (args != NULL);
+	nih_assert (reply != NULL);
+
+	if (! control_native_check_permission (client))
+		return -1;
+
+	class = control_native_class (args[0]);
+	if (! class)
+		return -1;
+
+	name = control_native_instance (NULL, class, args + 1, NULL);
+	if (! name)
+		return -1;
+
+	job = (Job *)nih_hash_lookup (class->instances, name);
+	if (! job) {
+		nih_dbus_error_raise_printf (
+			DBUS_INTERFACE_UPSTART ".Error.UnknownInstance",
+			_("Unknown instance: %s"), name);
+		return -1;
+	}
+
+	if (job->goal == JOB_STOP) {
+		nih_dbus_error_raise_printf (
+			DBUS_INTERFACE_UPSTART ".Error.AlreadyStopped",
+			_("Job has already been stopped: %s"),
+			job_name (job));
+		return -1;
+	}
+
+	stop_env = nih_str_array_copy (job, NULL, args + 1);
+	if (! stop_env)
+		nih_return_system_error (-1);
+
+	if (job->stop_env)
+		nih_unref (job->stop_env, job);
+
+	job->stop_env = stop_env;
+
+	job_finished (job, FALSE);
+	job_change_goal (job, JOB_STOP);
+
+	return 0;
+}
+
+/**
+ * control_native_status:
+ * @client: client making request,
+ * @args: job name and optional instance name,
+ * @reply: pointer to store reply strings.
+ *
+ * Obtains the goal and state of the instance, followed by the name and
+ * pid of each of its running processes.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+static int
+control_native_status (ControlNativeClient   *client,
+		       char * const          *args,
+		       char                ***reply)
+{
+	JobClass        *class;
+	Job             *job;
+	const char      *instance;
+	nih_local char **strings = NULL;
+	size_t           len = 0;
+
+	nih_assert (client != NULL);
+	nih_assert (args != NULL);
+	nih_assert (reply != NULL);
+
+	class = control_native_class (args[0]);
+	if (! class)
+		return -1;
+
+	instance = args[1] ? args[1] : "";
+
+	job = (Job *)nih_hash_lookup (class->instances, instance);
+	if (! job) {
+		nih_dbus_error_raise_printf (
+			DBUS_INTERFACE_UPSTART ".Error.UnknownInstance",
+			_("Unknown instance: %s"), instance);
+		return -1;
+	}
+
+	strings = nih_str_array_new (NULL);
+	if (! strings)
+		nih_return_no_memory_error (-1);
+
+	if (! nih_str_array_add (&strings, NULL, &len, job_goal_name (job->goal))
+	    || ! nih_str_array_add (&strings, NULL, &len,
+				    job_state_name (job->state)))
+		nih_return_no_memory_error (-1);
+
+	for (int i = 0; i < PROCESS_LAST; i++) {
+		char pid[32];
+
+		if (job->pid[i] <= 0)
+			continue;
+
+		snprintf (pid, sizeof (pid), "%d", job->pid[i]);
+
+		if (! nih_str_array_add (&strings, NULL, &len, process_name (i))
+		    || ! nih_str_array_add (&strings, NULL, &len, pid))
+			nih_return_no_memory_error (-1);
+	}
+
+	*reply = strings;
+	strings = NULL;
+
+	return 0;
+}
+
+/**
+ * control_native_emit:
+ * @client: client making request,
+ * @args: event name and environment,
+ * @reply: pointer to store reply strings.
+ *
+ * Queues an event to be emitted, without waiting for it to finish.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+static int
+control_native_emit (ControlNativeClient   *client,
+		     char * const          *args,
+		     char                ***reply)
+{
+	char **env;
+
+	nih_assert (client != NULL);
+	nih_assert (args != NULL);
+	nih_assert (reply != NULL);
+
+	if (! control_native_check_permission (client))
+		return -1;
+
+	if (! args[0] || ! *args[0]) {
+		nih_dbus_error_raise_printf (DBUS_ERROR_INVALID_ARGS,
+					     _("Name may not be empty string"));
+		return -1;
+	}
+
+	if (! environ_all_valid (args + 1)) {
+		nih_dbus_error_raise_printf (DBUS_ERROR_INVALID_ARGS,
+					     _("Env must be KEY=VALUE pairs"));
+		return -1;
+	}
+
+	env = nih_str_array_copy (NULL, NULL, args + 1);
+	if (! env)
+		nih_return_no_memory_error (-1);
+
+	if (! event_new (NULL, args[0], env)) {
+		nih_free (env);
+		nih_return_no_memory_error (-1);
+	}
+
+	return 0;
+}
+
+/**
+ * control_native_list:
+ * @client: client making request,
+ * @args: not used,
+ * @reply: pointer to store reply strings.
+ *
+ * Obtains the job name, instance name, goal and state of every instance
+ * of every job outside of a session; jobs without any instances are
+ * listed once with an empty instance name.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+static int
+control_native_list (ControlNativeClient   *client,
+		     char * const          *args,
+		     char                ***reply)
+{
+	nih_local char **strings = NULL;
+	size_t           len = 0;
+
+	nih_assert (client != NULL);
+	nih_assert (reply != NULL);
+
+	job_class_init ();
+
+	strings = nih_str_array_new (NULL);
+	if (! strings)
+		nih_return_no_memory_error (-1);
+
+	NIH_HASH_FOREACH (job_classes, iter) {
+		JobClass *class = (JobClass *)iter;
+		int       found = FALSE;
+
+		if (class->session)
+			continue;
+
+		NIH_HASH_FOREACH (class->instances, job_iter) {
+			Job *job = (Job *)job_iter;
+
+			found = TRUE;
+
+			if (! nih_str_array_add (&strings, NULL, &len, class->name)
+			    || ! nih_str_array_add (&strings, NULL, &len, job->name)
+			    || ! nih_str_array_add (&strings, NULL, &len,
+						    job_goal_name (job->goal))
+			    || ! nih_str_array_add (&strings, NULL, &len,
+						    job_state_name (job->state)))
+				nih_return_no_memory_error (-1);
+		}
+
+		if (found)
+			continue;
+
+		if (! nih_str_array_add (&strings, NULL, &len, class->name)
+		    || ! nih_str_array_add (&strings, NULL, &len, "")
+		    || ! nih_str_array_add (&strings, NULL, &len,
+					    job_goal_name (JOB_STOP))
+		    || ! nih_str_array_add (&strings, NULL, &len,
+					    job_state_name (JOB_WAITING)))
+			nih_return_no_memory_error (-1);
+	}
+
+	*reply = strings;
+	strings = NULL;
+
+	return 0;
+}
+
+
+/**
+ * control_native_watch_jobs:
+ * @client: client making request,
+ * @serial: serial of request,
+ * @args: empty, or epoch and sequence number to resume from,
+ * @reply: pointer to store reply strings.
+ *
+ * Sends @client either the changes it missed since the sequence number
+ * in @args, or when it cannot resume from there, the current state of
+ * every instance of every job outside of a session; from then on @client
+ * is sent every change by control_native_job_changed().
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+static int
+control_native_watch_jobs (ControlNativeClient   *client,
+			   uint32_t               serial,
+			   char * const          *args,
+			   char                ***reply)
+{
+	nih_local char **strings = NULL;
+	char             epoch[32];
+	char             sequence[32];
+	uint64_t         from = 0;
+	int              resume = FALSE;
+
+	nih_assert (client != NULL);
+	nih_assert (args != NULL);
+	nih_assert (reply != NULL);
+
+	control_native_feed_init ();
+
+	snprintf (epoch, sizeof (epoch), "%lld",
+		  (long long)control_native_epoch);
+
+	if (args[0]) {
+		char *end;
+
+		if (! args[1] || args[2]) {
+			nih_dbus_error_raise_printf (
+				DBUS_ERROR_INVALID_ARGS,
+				_("Epoch and sequence number required"));
+			return -1;
+		}
+
+		errno = 0;
+		from = strtoull (args[1], &end, 10);
+		if (errno || (! *args[1]) || *end) {
+			nih_dbus_error_raise_printf (
+				DBUS_ERROR_INVALID_ARGS,
+				_("Invalid sequence number: %s"), args[1]);
+			return -1;
+		}
+
+		/* The client can only resume if it has seen no change that
+		 * we haven't, and we still have every change it has not.
+		 */
+		if ((! strcmp (args[0], epoch))
+		    && (from <= control_native_sequence)) {
+			ControlNativeChange *oldest;
+
+			oldest = (ControlNativeChange *)control_native_history->next;
+
+			resume = ((from == control_native_sequence)
+				  || (oldest->sequence <= from + 1));
+		}
+	}
+
+	if (resume) {
+		NIH_LIST_FOREACH (control_native_history, iter) {
+			ControlNativeChange *change = (ControlNativeChange *)iter;
+
+			if (change->sequence <= from)
+				continue;
+
+			control_native_reply (client, serial,
+					      CONTROL_NATIVE_CHANGE,
+					      change->strings);
+		}
+	} else {
+		job_class_init ();
+
+		NIH_HASH_FOREACH (job_classes, iter) {
+			JobClass *class = (JobClass *)iter;
+
+			if (class->session)
+				continue;
+
+			NIH_HASH_FOREACH (class->instances, job_iter) {
+				Job             *job = (Job *)job_iter;
+				nih_local char **job_strings = NULL;
+
+				job_strings = control_native_job_strings (
+					NULL, control_native_sequence, job);
+				if (! job_strings)
+					nih_return_no_memory_error (-1);
+
+				control_native_reply (client, serial,
+						      CONTROL_NATIVE_CHANGE,
+						      job_strings);
+			}
+		}
+	}
+
+	snprintf (sequence, sizeof (sequence), "%llu",
+		  (unsigned long long)control_native_sequence);
+
+	strings = nih_str_array_new (NULL);
+	if ((! strings)
+	    || (! nih_str_array_add (&strings, NULL, NULL, epoch))
+	    || (! nih_str_array_add (&strings, NULL, NULL, sequence))
+	    || (! nih_str_array_add (&strings, NULL, NULL,
+				     resume ? "resume" : "snapshot")))
+		nih_return_no_memory_error (-1);
+
+	client->watch_serial = serial;
+	nih_list_add (control_native_watchers, &client->entry);
+
+	*reply = strings;
+	strings = NULL;
+
+	return 0;
+}
+
+/**
+ * control_native_feed_init:
+ *
+ * Initialise the list of clients following job changes and the history
+ * of changes, which starts changes being numbered and retained.
+ **/
+static void
+control_native_feed_init (void)
+{
+	if (! control_native_watchers)
+		control_native_watchers = NIH_MUST (nih_list_new (NULL));
+
+	if (! control_native_history) {
+		control_native_history = NIH_MUST (nih_list_new (NULL));
+		control_native_history_len = 0;
+		control_native_epoch = time (NULL);
+	}
+}
+
+/**
+ * control_native_job_strings:
+ * @parent: parent object for new array,
+ * @sequence: sequence number,
+ * @job: job instance.
+ *
+ * Builds the payload of a CHANGE message describing the current state
+ * of @job.
+ *
+ * Returns: newly allocated NULL-terminated array of strings or NULL if
+ * insufficient memory.
+ **/
+static char **
+control_native_job_strings (const void *parent,
+			    uint64_t    sequence,
+			    Job        *job)
+{
+	char   **strings;
+	char     buf[32];
+	size_t   len = 0;
+
+	nih_assert (job != NULL);
+
+	strings = nih_str_array_new (parent);
+	if (! strings)
+		return NULL;
+
+	snprintf (buf, sizeof (buf), "%llu", (unsigned long long)sequence);
+
+	if ((! nih_str_array_add (&strings, parent, &len, buf))
+	    || (! nih_str_array_add (&strings, parent, &len, job->class->name))
+	    || (! nih_str_array_add (&strings, parent, &len, job->name))
+	    || (! nih_str_array_add (&strings, parent, &len,
+				     job_goal_name (job->goal)))
+	    || (! nih_str_array_add (&strings, parent, &len,
+				     job_state_name (job->state))))
+		goto error;
+
+	for (int i = 0; i < PROCESS_LAST; i++) {
+		if (job->pid[i] <= 0)
+			continue;
+
+		snprintf (buf, sizeof (buf), "%d", job->pid[i]);
+
+		if ((! nih_str_array_add (&strings, parent, &len,
+					  process_name (i)))
+		    || (! nih_str_array_add (&strings, parent, &len, buf)))
+			goto error;
+	}
+
+	return strings;
+
+error:
+	nih_free (strings);
+	return NULL;
+}
+
+/**
+ * control_native_job_changed:
+ * @job: job that changed.
+ *
+ * Called through job_changed_hook whenever the goal or state of @job
+ * changes once the server is open; once any client has asked to follow
+ * changes, the change is numbered, retained in the history and sent to
+ * every client following them.
+ **/
+void
+control_native_job_changed (Job *job)
+{
+	ControlNativeChange *change;
+
+	nih_assert (job != NULL);
+
+	if (! control_native_history)
+		return;
+
+	if (job->class->session)
+		return;
+
+	change = NIH_MUST (nih_new (NULL, ControlNativeChange));
+
+	nih_list_init (&change->entry);
+	nih_alloc_set_destructor (change, nih_list_destroy);
+
+	change->sequence = ++control_native_sequence;
+	change->strings = NIH_MUST (control_native_job_strings (
+					    change, change->sequence, job));
+
+	nih_list_add (control_native_history, &change->entry);
+
+	if (++control_native_history_len > CONTROL_NATIVE_HISTORY) {
+		nih_free (control_native_history->next);
+		control_native_history_len--;
+	}
+
+	NIH_LIST_FOREACH (control_native_watchers, iter) {
+		ControlNativeClient *client = (ControlNativeClient *)iter;
+
+		control_native_reply (client, client->watch_serial,
+				      CONTROL_NATIVE_CHANGE, change->strings);
+	}
+}
@@ -0,0 +1,206 @@
+/* upstart
+ *
+ * Copyright © 2014 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef INIT_CONTROL_NATIVE_H
+#define INIT_CONTROL_NATIVE_H
+
+#include <sys/types.h>
+
+#include <stdint.h>
+
+#include <nih/macros.h>
+#include <nih/list.h>
+#include <nih/io.h>
+
+#include "job.h"
+
+
+/**
+ * CONTROL_NATIVE_ADDRESS:
+ *
+ * Name of the abstract unix socket on which the native control protocol
+ * is served by the system init daemon; Session Inits append their uid
+ * and pid as they do for the D-Bus server address.
+ **/
+#ifndef CONTROL_NATIVE_ADDRESS
+#define CONTROL_NATIVE_ADDRESS "/com/ubuntu/upstart-native"
+#endif
+
+/**
+ * CONTROL_NATIVE_MAX_LENGTH:
+ *
+ * Largest payload accepted in a request; a client sending a larger one
+ * is disconnected since the stream can no longer be trusted.
+ **/
+#define CONTROL_NATIVE_MAX_LENGTH 65536
+
+/**
+ * CONTROL_NATIVE_MAX_QUEUED:
+ *
+ * Largest amount of data queued to be sent to a client; a client that
+ * does not read its replies and changes quickly enough to stay below it
+ * is disconnected, and may resume following changes after reconnecting.
+ **/
+#define CONTROL_NATIVE_MAX_QUEUED 4194304
+
+/**
+ * CONTROL_NATIVE_HISTORY:
+ *
+ * Number of job changes retained so that a client following changes may
+ * resume from where it left off after reconnecting.
+ **/
+#define CONTROL_NATIVE_HISTORY 1024
+
+
+/**
+ * ControlNativeType:
+ *
+ * Request and reply types of the native control protocol.
+ *
+ * Every message is a ControlNativeHeader followed by @length bytes of
+ * payload, which is a sequence of NUL-terminated strings; all integers
+ * are in host byte order since the socket is local.  Requests may be
+ * pipelined, replies are sent in the order the requests were received
+ * and carry the serial of the request they answer.
+ *
+ * Requests:
+ *  - START: job name followed by KEY=VALUE environment used to select
+ *    the instance, as for the Start method; replies once the goal has
+ *    been changed, without waiting for the job to start.
+ *  - STOP: as START, but changes the goal to stop.
+ *  - STATUS: job name and instance name (empty for singleton jobs);
+ *    replies with goal, state and then process name and pid pairs.
+ *  - EMIT: event name followed by KEY=VALUE environment; replies once
+ *    the event has been queued.
+ *  - LIST: no payload; replies with job name, instance name, goal and
+ *    state for every instance, jobs without instances having an empty
+ *    instance name.
+ *  - WATCH: no payload, or the epoch and sequence number last received
+ *    to resume from; follows changes to jobs, see below.
+ *
+ * Replies are OK, with the payload described above, or ERROR with an
+ * error name and message.
+ *
+ * After a WATCH request the client is sent CHANGE messages, carrying the
+ * serial of the request, with the sequence number, job name, instance
+ * name, goal, state and then process name and pid pairs of an instance.
+ * Unless the client is resuming, it is first sent one CHANGE for every
+ * existing instance, all with the current sequence number; when resuming
+ * it is sent those changes it missed instead.  Either way these are
+ * followed by the OK reply with the epoch, the current sequence number
+ * and "snapshot" or "resume", and from then on by a CHANGE for every
+ * later change of goal or state, numbered in sequence.  A client that
+ * cannot resume, because its epoch is from a different instance of init
+ * or it missed more than CONTROL_NATIVE_HISTORY changes, is sent the
+ * snapshot again.
+ **/
+typedef enum control_native_type {
+	CONTROL_NATIVE_OK,
+	CONTROL_NATIVE_ERROR,
+	CONTROL_NATIVE_START,
+	CONTROL_NATIVE_STOP,
+	CONTROL_NATIVE_STATUS,
+	CONTROL_NATIVE_EMIT,
+	CONTROL_NATIVE_LIST,
+	CONTROL_NATIVE_WATCH,
+	CONTROL_NATIVE_CHANGE,
+} ControlNativeType;
+
+/**
+ * ControlNativeHeader:
+ * @length: length of the payload following the header,
+ * @serial: serial chosen by the client, copied into the reply,
+ * @type: request or reply type.
+ *
+ * Header preceding every request and reply.
+ **/
+typedef struct control_native_header {
+	uint32_t length;
+	uint32_t serial;
+	uint32_t type;
+} ControlNativeHeader;
+
+/**
+ * ControlNativeClient:
+ * @entry: list header,
+ * @io: connection to the client,
+ * @uid: user id of the client,
+ * @watch_serial: serial of the WATCH request, if following changes,
+ * @closing: TRUE once the client is being disconnected.
+ *
+ * Each connected client of the native control protocol is represented
+ * by one of these structures, @uid being used for the same permission
+ * checks as control_check_permission().
+ *
+ * A client that lets more than CONTROL_NATIVE_MAX_QUEUED bytes queue
+ * up is marked as @closing and its connection shut down; it is sent
+ * nothing more, and is freed once the shutdown is noticed.
+ *
+ * Clients following job changes are placed in the
+ * control_native_watchers list.
+ **/
+typedef struct control_native_client {
+	NihList   entry;
+	NihIo    *io;
+	uid_t     uid;
+	uint32_t  watch_serial;
+	int       closing;
+} ControlNativeClient;
+
+/**
+ * ControlNativeChange:
+ * @entry: list header,
+ * @sequence: sequence number of change,
+ * @strings: payload of CHANGE message.
+ *
+ * Each change to a job sent to clients following changes is retained in
+ * the control_native_history list so that it may be sent again to those
+ * resuming.
+ **/
+typedef struct control_native_change {
+	NihList    entry;
+	uint64_t   sequence;
+	char     **strings;
+} ControlNativeChange;
+
+
+NIH_BEGIN_EXTERN
+
+extern int       control_native_sock;
+extern NihList  *control_native_watchers;
+extern NihList  *control_native_history;
+extern uint64_t  control_native_sequence;
+
+
+int                  control_native_server_open  (void)
+	__attribute__ ((warn_unused_result));
+void                 control_native_server_close (void);
+
+ControlNativeClient *control_native_client_new   (const void *parent,
+						  int fd, uid_t uid)
+	__attribute__ ((warn_unused_result));
+
+void                 control_native_reader       (ControlNativeClient *client,
+						  NihIo *io,
+						  const char *buf, size_t len);
+
+void                 control_native_job_changed  (Job *job);
+
+NIH_END_EXTERN
+
+#endif /* INIT_CONTROL_NATIVE_H */
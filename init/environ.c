@@ -24,21 +24,45 @@
 #endif /* HAVE_CONFIG_H */
 
 
+#include <sys/types.h>
+
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include <nih/macros.h>
 #include <nih/alloc.h>
 #include <nih/string.h>
+#include <nih/list.h>
+#include <nih/hash.h>
 #include <nih/logging.h>
 #include <nih/error.h>
 
 #include "environ.h"
+#include "intern.h"
 #include "errors.h"
 
 
+/**
+ * ENVIRON_EXPAND_COMPLEX:
+ *
+ * Returned by environ_expand_simple() when a string contains references
+ * that it can't expand.
+ **/
+#define ENVIRON_EXPAND_COMPLEX -2
+
+
 /* Prototypes for static functions */
+static const void *environ_key_key      (NihList *entry);
+static uint32_t    environ_key_hash     (const void *key);
+static int         environ_key_cmp      (const void *key1, const void *key2);
+static int         environ_table_index  (EnvironTable *table, size_t idx)
+	__attribute__ ((warn_unused_result));
+static EnvironKey *environ_table_lookup (EnvironTable *table,
+					 const char *key, size_t len);
+static ssize_t environ_expand_simple (char *out, const char *string,
+				      char * const *env);
 static char *environ_expand_until (char **str, const void *parent,
 				   size_t *len, size_t *pos, char * const *env,
 				   const char *until);
@@ -344,6 +368,11 @@ environ_set (char       ***env,
  * Lookup the environment variable named @key, which is @len characters long,
  * in the @env table given which contains entries of KEY=VALUE form.
  *
+ * Each key is part of its KEY=VALUE string, which is passed as it is to
+ * processes and over D-Bus, so keys of plain arrays are not interned and
+ * are compared by value; only the index of an EnvironTable uses interned
+ * keys.
+ *
  * Returns: pointer to entry in @env or NULL if not found.
  **/
 char * const *
@@ -450,6 +479,426 @@ environ_all_valid (char * const *env)
 }
 
 
+/**
+ * environ_key_key:
+ * @entry: hash table entry.
+ *
+ * Key function for the index of an EnvironTable.
+ *
+ * Returns: interned key of @entry.
+ **/
+static const void *
+environ_key_key (NihList *entry)
+{
+	nih_assert (entry != NULL);
+
+	return ((EnvironKey *)entry)->key;
+}
+
+/**
+ * environ_key_hash:
+ * @key: interned key.
+ *
+ * Hash function for the index of an EnvironTable; since keys are
+ * interned, the address alone identifies the key.
+ *
+ * Returns: hash value of @key.
+ **/
+static uint32_t
+environ_key_hash (const void *key)
+{
+	return (uint32_t)((uintptr_t)key >> 3) * 2654435761U;
+}
+
+/**
+ * environ_key_cmp:
+ * @key1: interned key,
+ * @key2: interned key.
+ *
+ * Comparison function for the index of an EnvironTable.
+ *
+ * Returns: zero if @key1 and @key2 are the same key.
+ **/
+static int
+environ_key_cmp (const void *key1,
+		 const void *key2)
+{
+	return key1 != key2;
+}
+
+/**
+ * environ_table_index:
+ * @table: environment table,
+ * @idx: index of entry in the array.
+ *
+ * Add the entry at @idx in the array of @table to its index.
+ *
+ * Returns: zero on success, negative value if insufficient memory.
+ **/
+static int
+environ_table_index (EnvironTable *table,
+		     size_t        idx)
+{
+	EnvironKey *key;
+	size_t      keylen;
+
+	nih_assert (table != NULL);
+	nih_assert (idx < table->len);
+
+	key = nih_new (table, EnvironKey);
+	if (! key)
+		return -1;
+
+	nih_list_init (&key->entry);
+	nih_alloc_set_destructor (key, nih_list_destroy);
+
+	keylen = strcspn (table->env[idx], "=");
+	key->key = intern_stringn (key, table->env[idx], keylen);
+	if (! key->key) {
+		nih_free (key);
+		return -1;
+	}
+
+	key->idx = idx;
+
+	/* Keep the first entry for a key, as environ_lookup() would */
+	if (nih_hash_lookup (table->keys, key->key)) {
+		nih_free (key);
+		return 0;
+	}
+
+	nih_hash_add (table->keys, &key->entry);
+
+	return 0;
+}
+
+/**
+ * environ_table_new:
+ * @parent: parent object for new array,
+ * @env: existing environment array to extend.
+ *
+ * Allocates and returns a new EnvironTable, used to build up an
+ * environment array with many entries.  Unlike environ_add() and
+ * friends, which search the array on every addition, the table keeps an
+ * index of the entries by key and grows the array geometrically so that
+ * constructing an environment is linear in the number of entries.
+ *
+ * If @env is not NULL it should be an environment array allocated with
+ * nih_alloc() whose strings are referenced by the array, as returned by
+ * environ_add(); additions extend that array in place.  Otherwise a new
+ * empty array is allocated and if @parent is not NULL, it should be a
+ * pointer to another object which will be used as a parent for that
+ * array.
+ *
+ * The table itself has no parent and should be freed with nih_free()
+ * once environ_table_finish() has been called; this does not free the
+ * array.
+ *
+ * Returns: newly allocated EnvironTable or NULL if insufficient memory.
+ **/
+EnvironTable *
+environ_table_new (const void *parent,
+		   char      **env)
+{
+	EnvironTable *table;
+
+	table = nih_new (NULL, EnvironTable);
+	if (! table)
+		return NULL;
+
+	table->keys = nih_hash_new (table, 0, environ_key_key,
+				    environ_key_hash, environ_key_cmp);
+	if (! table->keys)
+		goto error;
+
+	table->len = 0;
+
+	if (env) {
+		table->env = env;
+
+		while (table->env[table->len])
+			table->len++;
+
+		for (size_t i = 0; i < table->len; i++)
+			if (environ_table_index (table, i) < 0)
+				goto error;
+	} else {
+		table->env = nih_str_array_new (parent);
+		if (! table->env)
+			goto error;
+	}
+
+	table->size = table->len;
+
+	return table;
+
+error:
+	nih_free (table);
+	return NULL;
+}
+
+/**
+ * environ_table_lookup:
+ * @table: environment table,
+ * @key: key to lookup,
+ * @len: length of @key.
+ *
+ * Lookup the index entry for the environment variable named @key,
+ * which is @len characters long, in @table.
+ *
+ * Returns: index entry or NULL if not found.
+ **/
+static EnvironKey *
+environ_table_lookup (EnvironTable *table,
+		      const char   *key,
+		      size_t        len)
+{
+	const char *atom;
+
+	nih_assert (table != NULL);
+	nih_assert (key != NULL);
+
+	/* A key that has never been interned can't be in the table */
+	atom = intern_lookupn (key, len);
+	if (! atom)
+		return NULL;
+
+	return (EnvironKey *)nih_hash_lookup (table->keys, atom);
+}
+
+/**
+ * environ_table_add:
+ * @table: environment table,
+ * @replace: TRUE if existing entry should be replaced,
+ * @str: string to add.
+ *
+ * Add the new environment variable @str to @table, either replacing an
+ * existing entry or appending it to the end of the array, with the same
+ * semantics as environ_add().
+ *
+ * Returns: array of @table or NULL if insufficient memory.
+ **/
+char **
+environ_table_add (EnvironTable *table,
+		   int           replace,
+		   const char   *str)
+{
+	nih_local char  *new_str = NULL;
+	EnvironKey      *found;
+	size_t           key;
+
+	nih_assert (table != NULL);
+	nih_assert (str != NULL);
+
+	key = strcspn (str, "=");
+	if (str[key] == '=') {
+		new_str = nih_strdup (NULL, str);
+		if (! new_str)
+			return NULL;
+	} else {
+		const char *value;
+
+		value = getenv (str);
+		if (value) {
+			new_str = nih_sprintf (NULL, "%s=%s", str, value);
+			if (! new_str)
+				return NULL;
+		}
+	}
+
+	found = environ_table_lookup (table, str, key);
+	if (found && replace) {
+		size_t removed;
+
+		nih_unref (table->env[found->idx], table->env);
+
+		if (new_str) {
+			table->env[found->idx] = new_str;
+			nih_ref (new_str, table->env);
+
+			return table->env;
+		}
+
+		/* Removing an entry shifts those after it down, which is
+		 * rare enough that we just renumber the index.
+		 */
+		removed = found->idx;
+		nih_free (found);
+
+		memmove (&table->env[removed], &table->env[removed + 1],
+			 sizeof (char *) * (table->len - removed));
+		table->len--;
+
+		NIH_HASH_FOREACH (table->keys, iter) {
+			EnvironKey *entry = (EnvironKey *)iter;
+
+			if (entry->idx > removed)
+				entry->idx--;
+		}
+
+		return table->env;
+	} else if (found) {
+		return table->env;
+	}
+
+	if (! new_str)
+		return table->env;
+
+	/* Grow the array geometrically, keeping room for the terminator */
+	if (table->len == table->size) {
+		size_t   new_size;
+		char   **new_env;
+
+		new_size = table->size ? table->size * 2 : 8;
+		new_env = nih_realloc (table->env, NULL,
+				       sizeof (char *) * (new_size + 1));
+		if (! new_env)
+			return NULL;
+
+		table->env = new_env;
+		table->size = new_size;
+	}
+
+	table->env[table->len] = new_str;
+	table->env[table->len + 1] = NULL;
+	table->len++;
+
+	if (environ_table_index (table, table->len - 1) < 0) {
+		table->env[--table->len] = NULL;
+		return NULL;
+	}
+
+	nih_ref (new_str, table->env);
+
+	return table->env;
+}
+
+/**
+ * environ_table_append:
+ * @table: environment table,
+ * @replace: TRUE if existing entries should be replaced,
+ * @new_env: environment table to append to @table.
+ *
+ * Appends the entries in the environment array @new_env to @table,
+ * with the same semantics as environ_append().
+ *
+ * Returns: array of @table or NULL if insufficient memory.
+ **/
+char **
+environ_table_append (EnvironTable *table,
+		      int           replace,
+		      char * const *new_env)
+{
+	char * const *e;
+
+	nih_assert (table != NULL);
+
+	for (e = new_env; e && *e; e++)
+		if (! environ_table_add (table, replace, *e))
+			return NULL;
+
+	return table->env;
+}
+
+/**
+ * environ_table_set:
+ * @table: environment table,
+ * @replace: TRUE if existing entry should be replaced,
+ * @format: format string.
+ *
+ * Add the environment variable specified by the format string @format
+ * to @table, with the same semantics as environ_set().
+ *
+ * Returns: array of @table or NULL if insufficient memory.
+ **/
+char **
+environ_table_set (EnvironTable *table,
+		   int           replace,
+		   const char   *format,
+		   ...)
+{
+	nih_local char *str = NULL;
+	va_list         args;
+
+	nih_assert (table != NULL);
+	nih_assert (format != NULL);
+
+	va_start (args, format);
+	str = nih_vsprintf (NULL, format, args);
+	va_end (args);
+
+	if (! str)
+		return NULL;
+
+	return environ_table_add (table, replace, str);
+}
+
+/**
+ * environ_table_getn:
+ * @table: environment table,
+ * @key: key to lookup,
+ * @len: length of @key.
+ *
+ * Lookup the environment variable named @key, which is @len characters
+ * long, in @table and return a pointer to the value.
+ *
+ * Returns: string from @table or NULL if not found.
+ **/
+const char *
+environ_table_getn (EnvironTable *table,
+		    const char   *key,
+		    size_t        len)
+{
+	EnvironKey *found;
+
+	nih_assert (table != NULL);
+	nih_assert (key != NULL);
+
+	found = environ_table_lookup (table, key, len);
+	if ((! found) || (table->env[found->idx][len] != '='))
+		return NULL;
+
+	return table->env[found->idx] + len + 1;
+}
+
+/**
+ * environ_table_finish:
+ * @table: environment table,
+ * @len: pointer to variable to store array length.
+ *
+ * Trims the array of @table to its final size and returns it.  The
+ * table should be freed afterwards, and not used to add further entries.
+ *
+ * If @len is not NULL it will be updated to contain the array length.
+ *
+ * Returns: NULL-terminated environment array or NULL if insufficient
+ * memory.
+ **/
+char **
+environ_table_finish (EnvironTable *table,
+		      size_t       *len)
+{
+	nih_assert (table != NULL);
+
+	if (table->size > table->len) {
+		char **new_env;
+
+		new_env = nih_realloc (table->env, NULL,
+				       sizeof (char *) * (table->len + 1));
+		if (! new_env)
+			return NULL;
+
+		table->env = new_env;
+		table->size = table->len;
+	}
+
+	if (len)
+		*len = table->len;
+
+	return table->env;
+}
+
+
 /**
  * environ_expand:
  * @parent: parent object for new string,
@@ -487,11 +936,45 @@ environ_expand (const void   *parent,
 		const char   *string,
 		char * const *env)
 {
-	char   *str;
-	size_t  len, pos;
+	char    *str;
+	size_t   len, pos;
+	ssize_t  simple_len;
 
 	nih_assert (string != NULL);
 
+	/* Most strings we're asked to expand contain no references at
+	 * all, so there's nothing to do but copy them.
+	 */
+	if (! strchr (string, '$')) {
+		str = nih_strdup (parent, string);
+		if (! str)
+			nih_error_raise_system ();
+
+		return str;
+	}
+
+	/* Otherwise if the string only contains plain references, measure
+	 * the expansion and then write it into a single allocation of
+	 * the right size.
+	 */
+	simple_len = environ_expand_simple (NULL, string, env);
+	if (simple_len >= 0) {
+		str = nih_alloc (parent, simple_len + 1);
+		if (! str) {
+			nih_error_raise_system ();
+			return NULL;
+		}
+
+		environ_expand_simple (str, string, env);
+
+		return str;
+	} else if (simple_len != ENVIRON_EXPAND_COMPLEX) {
+		return NULL;
+	}
+
+	/* Operator expressions and nested references need the full
+	 * expander, which works in-place on a copy of the string.
+	 */
 	str = nih_strdup (parent, string);
 	if (! str) {
 		nih_error_raise_system ();
@@ -507,6 +990,111 @@ environ_expand (const void   *parent,
 	return str;
 }
 
+/**
+ * environ_expand_simple:
+ * @out: buffer to write expansion into,
+ * @string: string to expand,
+ * @env: NULL-terminated list of environment variables to use.
+ *
+ * Expand @string using the NULL-terminated list of KEY=VALUE strings
+ * in the given @env table, when @string contains only plain $KEY and
+ * ${KEY} references, ${} and lone dollar signs.
+ *
+ * If @out is NULL, nothing is written and only the length of the
+ * expansion is calculated; otherwise @out must be large enough to hold
+ * the expansion and its terminating NUL, as measured by an earlier call
+ * with the same arguments.
+ *
+ * Returns: length of expansion, ENVIRON_EXPAND_COMPLEX if @string
+ * contains a reference that needs environ_expand_until() or negative
+ * value on raised error.
+ **/
+static ssize_t
+environ_expand_simple (char         *out,
+		       const char   *string,
+		       char * const *env)
+{
+	const char *s;
+	size_t      len = 0;
+
+	nih_assert (string != NULL);
+
+	for (s = string; *s; ) {
+		const char *name, *value;
+		size_t      name_len, value_len;
+
+		if (*s != '$') {
+			if (out)
+				out[len] = *s;
+			len++;
+			s++;
+			continue;
+		}
+
+		if ((s[1] == '_')
+		    || ((s[1] >= 'A') && (s[1] <= 'Z'))
+		    || ((s[1] >= 'a') && (s[1] <= 'z'))) {
+			/* Simple reference */
+			name = s + 1;
+			name_len = 1;
+			while ((name[name_len] == '_')
+			       || ((name[name_len] >= 'A') && (name[name_len] <= 'Z'))
+			       || ((name[name_len] >= 'a') && (name[name_len] <= 'z'))
+			       || ((name[name_len] >= '0') && (name[name_len] <= '9')))
+				name_len++;
+
+			s = name + name_len;
+
+		} else if ((s[1] == '{') && (s[2] == '}')) {
+			/* Empty bracketed expression */
+			value = "$";
+			value_len = 1;
+			s += 3;
+			goto copy;
+
+		} else if (s[1] == '{') {
+			/* Bracketed reference, provided it contains no
+			 * nested reference or operator.
+			 */
+			name = s + 2;
+			name_len = strcspn (name, "$}:-+");
+			if (name[name_len] != '}')
+				return ENVIRON_EXPAND_COMPLEX;
+
+			s = name + name_len + 1;
+
+		} else {
+			/* Lone dollar sign */
+			if (out)
+				out[len] = '$';
+			len++;
+			s++;
+			continue;
+		}
+
+		value = environ_getn (env, name, name_len);
+		if (! value) {
+			nih_error_raise_printf (
+				ENVIRON_UNKNOWN_PARAM,
+				"%s: %.*s", _(ENVIRON_UNKNOWN_PARAM_STR),
+				(int)name_len, name);
+			return -1;
+		}
+
+		value_len = strlen (value);
+
+	copy:
+		if (out)
+			memcpy (out + len, value, value_len);
+		len += value_len;
+	}
+
+	if (out)
+		out[len] = '\0';
+
+	return len;
+}
+
 /**
  * environ_expand_until:
  * @str: string being expanded,
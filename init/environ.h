@@ -21,6 +21,41 @@
 #define INIT_ENVIRON_H
 
 #include <nih/macros.h>
+#include <nih/list.h>
+#include <nih/hash.h>
+
+
+/**
+ * EnvironKey:
+ * @entry: list header,
+ * @key: interned variable name,
+ * @idx: index of the variable in the table's array.
+ *
+ * Entry in the index of an EnvironTable.
+ **/
+typedef struct environ_key {
+	NihList  entry;
+	char    *key;
+	size_t   idx;
+} EnvironKey;
+
+/**
+ * EnvironTable:
+ * @env: NULL-terminated array of KEY=VALUE strings,
+ * @len: number of entries in @env,
+ * @size: number of entries @env has room for,
+ * @keys: index of entries in @env by key.
+ *
+ * This structure is used to build up environment arrays with a large
+ * number of entries without searching the array for each addition; the
+ * resulting @env is an ordinary environment array.
+ **/
+typedef struct environ_table {
+	char    **env;
+	size_t    len;
+	size_t    size;
+	NihHash  *keys;
+} EnvironTable;
 
 
 NIH_BEGIN_EXTERN
@@ -52,6 +87,25 @@ char *        environ_expand    (const void *parent, const char *string,
 				 char * const *env)
 	__attribute__ ((warn_unused_result));
 
+EnvironTable *environ_table_new    (const void *parent, char **env)
+	__attribute__ ((warn_unused_result, malloc));
+
+char **       environ_table_add    (EnvironTable *table, int replace,
+				    const char *str)
+	__attribute__ ((warn_unused_result));
+char **       environ_table_append (EnvironTable *table, int replace,
+				    char * const *new_env)
+	__attribute__ ((warn_unused_result));
+char **       environ_table_set    (EnvironTable *table, int replace,
+				    const char *format, ...)
+	__attribute__ ((warn_unused_result));
+
+const char *  environ_table_getn   (EnvironTable *table, const char *key,
+				    size_t len);
+
+char **       environ_table_finish (EnvironTable *table, size_t *len)
+	__attribute__ ((warn_unused_result));
+
 NIH_END_EXTERN
 
 #endif /* INIT_ENVIRON_H */
@@ -47,6 +47,10 @@ enum {
 	PARSE_ILLEGAL_NICE,
 	PARSE_ILLEGAL_OOM,
 	PARSE_ILLEGAL_LIMIT,
+	PARSE_ILLEGAL_WEIGHT,
+	PARSE_ILLEGAL_QUOTA,
+	PARSE_ILLEGAL_MEMORY,
+	PARSE_ILLEGAL_LIST,
 	PARSE_EXPECTED_EVENT,
 	PARSE_EXPECTED_OPERATOR,
 	PARSE_EXPECTED_VARIABLE,
@@ -74,6 +78,10 @@ enum {
 #define PARSE_ILLEGAL_OOM_STR		N_("Illegal oom adjustment, expected -16 to 15 or 'never'")
 #define PARSE_ILLEGAL_OOM_SCORE_STR	N_("Illegal oom score adjustment, expected -999 to 1000 or 'never'")
 #define PARSE_ILLEGAL_LIMIT_STR		N_("Illegal limit, expected 'unlimited' or integer")
+#define PARSE_ILLEGAL_WEIGHT_STR	N_("Illegal weight, expected 1 to 10000")
+#define PARSE_ILLEGAL_QUOTA_STR		N_("Illegal quota, expected percentage of a CPU")
+#define PARSE_ILLEGAL_LIST_STR		N_("Illegal list, expected numbers and ranges such as 0-3,8")
+#define PARSE_ILLEGAL_MEMORY_STR	N_("Illegal memory size, expected integer with optional K, M, G or T suffix")
 #define PARSE_EXPECTED_EVENT_STR	N_("Expected event")
 #define PARSE_EXPECTED_OPERATOR_STR	N_("Expected operator")
 #define PARSE_EXPECTED_VARIABLE_STR	N_("Expected variable name before value")
@@ -39,12 +39,15 @@
 #include "dbus/upstart.h"
 
 #include "environ.h"
+#include "intern.h"
+#include "events.h"
 #include "event.h"
 #include "job.h"
 #include "blocked.h"
 #include "control.h"
 #include "errors.h"
 #include "quiesce.h"
+#include "timeline.h"
 
 #include "com.ubuntu.Upstart.h"
 
@@ -147,7 +150,7 @@ event_new (const void  *parent,
 
 
 	/* Fill in the event details */
-	event->name = nih_strdup (event, name);
+	event->name = intern_string (event, name);
 	if (! event->name) {
 		nih_free (event);
 		return NULL;
@@ -204,6 +207,38 @@ event_unblock (Event *event)
 	event->blockers--;
 }
 
+/**
+ * event_observed:
+ * @name: name of event.
+ *
+ * Checks whether an event named @name would have any effect once
+ * emitted: whether an event operator of any job class or instance,
+ * including those quiesce() matches SESSION_END_EVENT against, waits
+ * for it, or whether any D-Bus connection would be sent the
+ * EventEmitted signal for it.
+ *
+ * Event operators watch their interned names, so this costs a single
+ * hash lookup and a scan of the D-Bus connections rather than a sweep
+ * of every job class.
+ *
+ * The signal is broadcast on the D-Bus system or session bus, where we
+ * cannot know whether anyone listens, so every event is observable for
+ * as long as we are connected to a bus; only an init without one, or
+ * whose private clients have all subscribed, skips any events.
+ *
+ * Returns: TRUE if an event named @name can be observed, FALSE otherwise.
+ **/
+int
+event_observed (const char *name)
+{
+	nih_assert (name != NULL);
+
+	if (intern_watched (name))
+		return TRUE;
+
+	return control_event_wanted (name);
+}
+
 
 /**
  * event_poll:
@@ -287,6 +322,15 @@ event_pending (Event *event)
 	nih_info (_("Handling %s event"), event->name);
 	event->progress = EVENT_HANDLING;
 
+	/* Job events are recorded by job_emit_event(), including those
+	 * it does not emit at all.
+	 */
+	if (strcmp (event->name, JOB_STARTING_EVENT)
+	    && strcmp (event->name, JOB_STARTED_EVENT)
+	    && strcmp (event->name, JOB_STOPPING_EVENT)
+	    && strcmp (event->name, JOB_STOPPED_EVENT))
+		timeline_record (event->name, NULL, NULL);
+
 	event_pending_handle_jobs (event);
 }
 
@@ -372,7 +416,8 @@ event_pending_handle_jobs (Event *event)
 		    && event_operator_handle (class->start_on, event, NULL)
 		    && class->start_on->value) {
 			nih_local char **env = NULL;
-			nih_local char  *name = NULL;
+			nih_local char  *expanded = NULL;
+			const char      *name;
 			size_t           len;
 			Job             *job;
 
@@ -385,20 +430,28 @@ event_pending_handle_jobs (Event *event)
 							      &env, NULL, &len,
 							      "UPSTART_EVENTS"));
 
-			/* Expand the instance name against the environment */
-			name = NIH_SHOULD (environ_expand (NULL,
-							   class->instance,
-							   env));
-			if (! name) {
-				NihError *err;
-
-				err = nih_error_get ();
-				nih_warn (_("Failed to obtain %s instance: %s"),
-					  class->name, err->message);
-				nih_free (err);
+			/* Expand the instance name against the environment;
+			 * most jobs are singletons whose instance name is
+			 * the empty string, so only expand when needed.
+			 */
+			if (strchr (class->instance, '$')) {
+				expanded = NIH_SHOULD (environ_expand (
+						NULL, class->instance, env));
+				if (! expanded) {
+					NihError *err;
+
+					err = nih_error_get ();
+					nih_warn (_("Failed to obtain %s instance: %s"),
+						  class->name, err->message);
+					nih_free (err);
+
+					event_operator_reset (class->start_on);
+					continue;
+				}
 
-				event_operator_reset (class->start_on);
-				continue;
+				name = expanded;
+			} else {
+				name = class->instance;
 			}
 
 			/* Locate the current instance or create a new one */
@@ -45,7 +45,7 @@ typedef enum event_progress {
  * Event:
  * @entry: list header,
  * @session: session the event is attached to,
- * @name: string name of the event,
+ * @name: string name of the event (interned),
  * @env: NULL-terminated array of environment variables,
  * @fd: open file descriptor associated with a particular
  *      socket-bridge socket (see socket-event(8)),
@@ -94,6 +94,9 @@ Event *event_new     (const void *parent, const char *name, char **env);
 void   event_block   (Event *event);
 void   event_unblock (Event *event);
 
+int    event_observed (const char *name)
+	__attribute__ ((warn_unused_result));
+
 void   event_poll    (void);
 
 json_object *event_serialise (const Event *event)
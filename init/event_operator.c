@@ -37,7 +37,9 @@
 #include <nih/logging.h>
 #include <nih/error.h>
 
+#include "events.h"
 #include "environ.h"
+#include "intern.h"
 #include "event.h"
 #include "event_operator.h"
 #include "blocked.h"
@@ -61,6 +63,11 @@
  * nih_free() to free @env and instead use nih_unref() or nih_discard() if
  * you no longer need to use it.
  *
+ * @name is interned with intern_string() so that it may be compared
+ * against the names of events by pointer, and watched with intern_watch()
+ * so that events nothing waits for can be recognised; it must never be
+ * freed or modified.
+ *
  * If @parent is not NULL, it should be a pointer to another object which
  * will be used as a parent for the returned operator.  When all parents
  * of the returned operator are freed, the returned operator will also be
@@ -91,12 +98,14 @@ event_operator_new (const void         *parent,
 	oper->value = FALSE;
 
 	if (oper->type == EVENT_MATCH) {
-		oper->name = nih_strdup (oper, name);
+		oper->name = intern_string (oper, name);
 		if (! oper->name) {
 			nih_free (oper);
 			return NULL;
 		}
 
+		intern_watch (oper->name);
+
 		oper->env = env;
 		if (oper->env)
 			nih_ref (oper->env, oper);
@@ -193,8 +202,8 @@ event_operator_copy (const void          *parent,
  * event_operator_destroy:
  * @oper: operator to be destroyed.
  *
- * Unblocks and unreferences the event referenced by @oper and unlinks it
- * from the event tree.
+ * Unblocks and unreferences the event referenced by @oper, stops watching
+ * its name and unlinks it from the event tree.
  *
  * Normally used or called from an nih_alloc() destructor so that the list
  * item is automatically removed from its containing list when freed.
@@ -209,6 +218,9 @@ event_operator_destroy (EventOperator *oper)
 	if (oper->event)
 		event_unblock (oper->event);
 
+	if (oper->type == EVENT_MATCH)
+		intern_unwatch (oper->name);
+
 	nih_tree_destroy (&oper->node);
 
 	return 0;
@@ -284,8 +296,10 @@ event_operator_match (EventOperator *oper,
 	nih_assert (oper->node.right == NULL);
 	nih_assert (event != NULL);
 
-	/* Names must match */
-	if (strcmp (oper->name, event->name))
+	/* Names must match; both are interned so equal names are the
+	 * same string.
+	 */
+	if (oper->name != event->name)
 		return FALSE;
 
 	/* Match operator environment variables against those from the event,
@@ -338,20 +352,25 @@ event_operator_match (EventOperator *oper,
 
 		/* Expand operator value against given environment before
 		 * matching; silently discard errors, since otherwise we'd
-		 * be excessively noisy on every event.
+		 * be excessively noisy on every event.  Values without
+		 * references, by far the most common, are used as-is.
 		 */
-		while (! (expoval = environ_expand (NULL, oval, env))) {
-			NihError *err;
-
-			err = nih_error_get ();
-			if (err->number != ENOMEM) {
+		if (strchr (oval, '$')) {
+			while (! (expoval = environ_expand (NULL, oval, env))) {
+				NihError *err;
+
+				err = nih_error_get ();
+				if (err->number != ENOMEM) {
+					nih_free (err);
+					return FALSE;
+				}
 				nih_free (err);
-				return FALSE;
 			}
-			nih_free (err);
+
+			oval = expoval;
 		}
 
-		ret = fnmatch (expoval, eval, 0);
+		ret = fnmatch (oval, eval, 0);
 
 		if (negate ? (! ret) : ret)
 			return FALSE;
@@ -491,7 +510,8 @@ event_operator_environment (EventOperator   *root,
 			    size_t          *len,
 			    const char      *key)
 {
-	nih_local char *evlist = NULL;
+	nih_local char         *evlist = NULL;
+	nih_local EnvironTable *table = NULL;
 
 	nih_assert (root != NULL);
 	nih_assert (env != NULL);
@@ -504,12 +524,15 @@ event_operator_environment (EventOperator   *root,
 			return NULL;
 	}
 
-	/* Always return an array, even if its zero length */
-	if (! *env) {
-		*env = nih_str_array_new (parent);
-		if (! *env)
-			return NULL;
-	}
+	/* Always return an array, even if its zero length; events
+	 * frequently carry many variables, so build it up through an
+	 * indexed table rather than searching it for each one.
+	 */
+	table = environ_table_new (parent, *env);
+	if (! table)
+		return NULL;
+
+	*env = table->env;
 
 	/* Iterate the operator tree, filtering out nodes with a non-TRUE
 	 * value and their children.  The rationale for this is that this
@@ -527,29 +550,39 @@ event_operator_environment (EventOperator   *root,
 		nih_assert (oper->event != NULL);
 
 		/* Add environment from the event */
-		if (! environ_append (env, parent, len, TRUE, oper->event->env))
-			return NULL;
+		if (! environ_table_append (table, TRUE, oper->event->env))
+			goto error;
 
 		/* Append the name of the event to the string we're building */
 		if (evlist) {
 			if (evlist[strlen (evlist) - 1] != '=') {
 				if (! nih_strcat_sprintf (&evlist, NULL, " %s",
 							  oper->event->name))
-					return NULL;
+					goto error;
 			} else {
 				if (! nih_strcat (&evlist, NULL,
 						  oper->event->name))
-					return NULL;
+					goto error;
 			}
 		}
 	}
 
 	/* Append the event list to the environment */
 	if (evlist)
-		if (! environ_add (env, parent, len, TRUE, evlist))
-			return NULL;
+		if (! environ_table_add (table, TRUE, evlist))
+			goto error;
+
+	if (! environ_table_finish (table, len))
+		goto error;
+
+	*env = table->env;
 
 	return *env;
+
+error:
+	*env = table->env;
+	*len = table->len;
+	return NULL;
 }
 
 /**
@@ -714,6 +747,38 @@ event_operator_reset (EventOperator *root)
 	}
 }
 
+/**
+ * event_operator_job_name:
+ * @oper: EVENT_MATCH operator.
+ *
+ * Determines the job named by a match for one of the job events, given
+ * either as the first positional argument or as JOB=name.
+ *
+ * Returns: name of job or NULL if @oper does not name one.
+ **/
+const char *
+event_operator_job_name (EventOperator *oper)
+{
+	nih_assert (oper != NULL);
+	nih_assert (oper->type == EVENT_MATCH);
+
+	if (strcmp (oper->name, JOB_STARTING_EVENT)
+	    && strcmp (oper->name, JOB_STARTED_EVENT)
+	    && strcmp (oper->name, JOB_STOPPING_EVENT)
+	    && strcmp (oper->name, JOB_STOPPED_EVENT))
+		return NULL;
+
+	for (size_t i = 0; oper->env && oper->env[i]; i++) {
+		if (! strncmp (oper->env[i], "JOB=", 4))
+			return oper->env[i] + 4;
+
+		if ((! i) && (! strchr (oper->env[i], '=')))
+			return oper->env[i];
+	}
+
+	return NULL;
+}
+
 /**
  * event_operator_collapse:
  *
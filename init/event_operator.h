@@ -43,7 +43,7 @@ typedef enum event_operator_type {
  * @node: tree node,
  * @type: operator type,
  * @value: operator value,
- * @name: name of event to match (EVENT_MATCH only),
+ * @name: interned name of event to match (EVENT_MATCH only),
  * @env: environment variables of event to match (EVENT_MATCH only),
  * @event: event matched (EVENT_MATCH only).
  *
@@ -108,6 +108,9 @@ void           event_operator_events      (EventOperator *root,
 
 void           event_operator_reset       (EventOperator *root);
 
+const char *   event_operator_job_name    (EventOperator *oper)
+	__attribute__ ((warn_unused_result));
+
 const char *
 event_operator_type_enum_to_str (EventOperatorType type)
 	__attribute__ ((warn_unused_result));
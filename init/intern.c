@@ -0,0 +1,303 @@
+/* upstart
+ *
+ * intern.c - shared, pointer-comparable strings
+ *
+ * Copyright © 2014 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+
+#include <string.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/string.h>
+#include <nih/list.h>
+#include <nih/hash.h>
+#include <nih/logging.h>
+
+#include "intern.h"
+
+
+/**
+ * INTERN_KEY_MAX:
+ *
+ * Length of the largest string intern_stringn() and intern_lookupn()
+ * will copy onto the stack to terminate it for the hash lookup; longer
+ * strings are copied onto the heap by intern_stringn(), and compared
+ * against every interned string by intern_lookupn().
+ **/
+#define INTERN_KEY_MAX 128
+
+
+/**
+ * interned_strings:
+ *
+ * This hash table holds the list of distinct interned strings, indexed
+ * by their value.  The table does not hold a reference to the strings
+ * themselves; each is freed, and its entry removed, once every object
+ * that interned it has been freed or has dropped its reference.
+ **/
+NihHash *interned_strings = NULL;
+
+
+/**
+ * intern_init:
+ *
+ * Initialise the interned strings hash table.
+ **/
+void
+intern_init (void)
+{
+	if (! interned_strings)
+		interned_strings = NIH_MUST (nih_hash_string_new (NULL, 0));
+}
+
+
+/**
+ * intern_string:
+ * @parent: parent object that will reference the string,
+ * @str: string to intern.
+ *
+ * Returns the single shared copy of the string @str, creating it if
+ * this is the first time the value has been interned.  Since all
+ * callers receive the same pointer for equal strings, two interned
+ * strings may be compared for equality by comparing the pointers.
+ *
+ * The returned string is referenced by @parent; when all parents of the
+ * string are freed, or have released it with nih_unref(), it is freed
+ * and removed from the table.  It must never be modified, and must never
+ * be freed with nih_free() since other objects may be sharing it.
+ *
+ * Returns: shared string or NULL if insufficient memory.
+ **/
+char *
+intern_string (const void *parent,
+	       const char *str)
+{
+	InternString *intern;
+	char         *copy;
+
+	nih_assert (str != NULL);
+
+	intern_init ();
+
+	intern = (InternString *)nih_hash_lookup (interned_strings, str);
+	if (intern) {
+		nih_ref (intern->str, parent);
+		return intern->str;
+	}
+
+	copy = nih_strdup (parent, str);
+	if (! copy)
+		return NULL;
+
+	intern = nih_new (copy, InternString);
+	if (! intern) {
+		nih_free (copy);
+		return NULL;
+	}
+
+	nih_list_init (&intern->entry);
+	nih_alloc_set_destructor (intern, nih_list_destroy);
+
+	intern->str = copy;
+	intern->watchers = 0;
+
+	nih_hash_add (interned_strings, &intern->entry);
+
+	return copy;
+}
+
+/**
+ * intern_stringn:
+ * @parent: parent object that will reference the string,
+ * @str: string to intern,
+ * @len: length of @str.
+ *
+ * Returns the single shared copy of the first @len bytes of @str,
+ * creating it if necessary, in the same manner as intern_string().
+ * This is normally used to intern the name part of a KEY=VALUE
+ * environment string.
+ *
+ * Returns: shared string or NULL if insufficient memory.
+ **/
+char *
+intern_stringn (const void *parent,
+		const char *str,
+		size_t      len)
+{
+	nih_local char *heap = NULL;
+	char            buf[INTERN_KEY_MAX + 1];
+
+	nih_assert (str != NULL);
+
+	if (len <= INTERN_KEY_MAX) {
+		memcpy (buf, str, len);
+		buf[len] = '\0';
+
+		return intern_string (parent, buf);
+	}
+
+	heap = nih_strndup (NULL, str, len);
+	if (! heap)
+		return NULL;
+
+	return intern_string (parent, heap);
+}
+
+
+/**
+ * intern_lookup:
+ * @str: string to look up.
+ *
+ * Looks up the shared copy of @str if it has already been interned,
+ * without creating it or adding a reference to it.  Since every holder
+ * of a value interns it, a NULL return means that nothing currently
+ * refers to the value.
+ *
+ * Returns: shared string or NULL if @str has not been interned.
+ **/
+char *
+intern_lookup (const char *str)
+{
+	InternString *intern;
+
+	nih_assert (str != NULL);
+
+	intern_init ();
+
+	intern = (InternString *)nih_hash_lookup (interned_strings, str);
+
+	return intern ? intern->str : NULL;
+}
+
+/**
+ * intern_lookupn:
+ * @str: string to look up,
+ * @len: length of @str.
+ *
+ * Looks up the shared copy of the first @len bytes of @str if it has
+ * already been interned, without creating it or adding a reference.
+ * Like intern_lookup(), this never allocates and so cannot fail.
+ *
+ * Returns: shared string or NULL if the value has not been interned.
+ **/
+char *
+intern_lookupn (const char *str,
+		size_t      len)
+{
+	char buf[INTERN_KEY_MAX + 1];
+
+	nih_assert (str != NULL);
+
+	if (len <= INTERN_KEY_MAX) {
+		memcpy (buf, str, len);
+		buf[len] = '\0';
+
+		return intern_lookup (buf);
+	}
+
+	intern_init ();
+
+	/* Values this long are rare enough that searching every interned
+	 * string is better than a heap copy that could fail.
+	 */
+	NIH_HASH_FOREACH (interned_strings, iter) {
+		InternString *intern = (InternString *)iter;
+
+		if ((! strncmp (intern->str, str, len))
+		    && (intern->str[len] == '\0'))
+			return intern->str;
+	}
+
+	return NULL;
+}
+
+
+/**
+ * intern_watch:
+ * @str: interned string.
+ *
+ * Records that a holder of the interned string @str is interested in
+ * the value, for example an event operator waiting for an event of that
+ * name.  Since interned strings already form an index of every value in
+ * use, this lets intern_watched() answer whether anything is interested
+ * in a value with a single lookup and without further allocation.
+ *
+ * Each call must be balanced by a call to intern_unwatch() before the
+ * holder drops its reference to @str.
+ **/
+void
+intern_watch (const char *str)
+{
+	InternString *intern;
+
+	nih_assert (str != NULL);
+
+	intern_init ();
+
+	intern = (InternString *)nih_hash_lookup (interned_strings, str);
+	nih_assert (intern != NULL);
+	nih_assert (intern->str == str);
+
+	intern->watchers++;
+}
+
+/**
+ * intern_unwatch:
+ * @str: interned string.
+ *
+ * Reverses a previous call to intern_watch() for @str.
+ **/
+void
+intern_unwatch (const char *str)
+{
+	InternString *intern;
+
+	nih_assert (str != NULL);
+
+	intern_init ();
+
+	intern = (InternString *)nih_hash_lookup (interned_strings, str);
+	if (intern && intern->watchers)
+		intern->watchers--;
+}
+
+/**
+ * intern_watched:
+ * @str: string to check.
+ *
+ * @str need not be interned.
+ *
+ * Returns: TRUE if any holder is watching the value @str, FALSE otherwise.
+ **/
+int
+intern_watched (const char *str)
+{
+	InternString *intern;
+
+	nih_assert (str != NULL);
+
+	intern_init ();
+
+	intern = (InternString *)nih_hash_lookup (interned_strings, str);
+
+	return (intern && intern->watchers) ? TRUE : FALSE;
+}
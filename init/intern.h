@@ -0,0 +1,69 @@
+/* upstart
+ *
+ * Copyright © 2014 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef INIT_INTERN_H
+#define INIT_INTERN_H
+
+#include <nih/macros.h>
+#include <nih/list.h>
+#include <nih/hash.h>
+
+
+/**
+ * InternString:
+ * @entry: list header,
+ * @str: the shared string,
+ * @watchers: number of holders watching the value, see intern_watch().
+ *
+ * Each entry in the interned strings table records one distinct string
+ * value.  The entry is allocated as a child of @str, which is itself
+ * referenced by every object that interned it, so the entry is removed
+ * from the table when the last of those objects is freed.
+ **/
+typedef struct intern_string {
+	NihList  entry;
+	char    *str;
+	size_t   watchers;
+} InternString;
+
+
+NIH_BEGIN_EXTERN
+
+extern NihHash *interned_strings;
+
+
+void   intern_init      (void);
+
+char * intern_string    (const void *parent, const char *str)
+	__attribute__ ((warn_unused_result));
+char * intern_stringn   (const void *parent, const char *str, size_t len)
+	__attribute__ ((warn_unused_result));
+
+char * intern_lookup    (const char *str)
+	__attribute__ ((warn_unused_result));
+char * intern_lookupn   (const char *str, size_t len)
+	__attribute__ ((warn_unused_result));
+
+void   intern_watch     (const char *str);
+void   intern_unwatch   (const char *str);
+int    intern_watched   (const char *str)
+	__attribute__ ((warn_unused_result));
+
+NIH_END_EXTERN
+
+#endif /* INIT_INTERN_H */
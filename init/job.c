@@ -54,6 +54,9 @@
 #include "event_operator.h"
 #include "blocked.h"
 #include "control.h"
+#include "timeline.h"
+#include "timer_wheel.h"
+#include "quiesce.h"
 #include "parse_job.h"
 #include "state.h"
 #include "apparmor.h"
@@ -86,13 +89,30 @@ job_trace_state_str_to_enum (const char *state)
 	__attribute__ ((warn_unused_result));
 
 static json_object *
-job_serialise_kill_timer (NihTimer *timer)
+job_serialise_timer (NihTimer *timer)
 	__attribute__ ((warn_unused_result));
 
 static NihTimer *
-job_deserialise_kill_timer (json_object *json)
+job_deserialise_timer (json_object *json)
 	__attribute__ ((warn_unused_result));
 
+/**
+ * job_events_skipped:
+ *
+ * Number of started and stopped events that job_emit_event() did not
+ * construct because nothing could observe them.
+ **/
+unsigned long job_events_skipped = 0;
+
+/**
+ * job_changed_hook:
+ *
+ * Function called whenever the goal or state of a job changes, set by
+ * control_native_server_open() so that the changes can be sent to its
+ * clients without linking the server into everything using jobs.
+ **/
+JobChangedHook job_changed_hook = NULL;
+
 /**
  * job_new:
  * @class: class of job,
@@ -169,6 +189,13 @@ job_new (JobClass   *class,
 	for (i = 0; i < PROCESS_LAST; i++)
 		job->pid[i] = 0;
 
+	job->pidfd = nih_alloc (job, sizeof (NihIoWatch *) * PROCESS_LAST);
+	if (! job->pidfd)
+		goto error;
+
+	for (i = 0; i < PROCESS_LAST; i++)
+		job->pidfd[i] = NULL;
+
 	/* Each job process needs its own log object to ensure sane
 	 * behaviour: consider a post-start that starts and ends
 	 * before the main process ends: it will be reaped (and its log
@@ -188,15 +215,26 @@ job_new (JobClass   *class,
 	job->kill_timer = NULL;
 	job->kill_process = PROCESS_INVALID;
 
+	job->notify = NULL;
+	job->ready_timer = NULL;
+	job->watchdog_timer = NULL;
+
 	job->failed = FALSE;
 	job->failed_process = PROCESS_INVALID;
 	job->exit_status = 0;
 
 	job->respawn_time = 0;
 	job->respawn_count = 0;
+	job->respawn_delay = 0;
+	job->respawn_timer = NULL;
+
+	memset (&job->stats, 0, sizeof (JobStats));
 
 	job->trace_forks = 0;
 	job->trace_state = TRACE_NONE;
+	job->cgroup = NULL;
+
+	job->snapshot = NULL;
 
 	nih_hash_add (class->instances, &job->entry);
 
@@ -286,11 +324,17 @@ job_change_goal (Job     *job,
 		NihListEntry   *entry = (NihListEntry *)iter;
 		DBusConnection *conn = (DBusConnection *)entry->data;
 
+		if (! control_conn_wants_job (conn, job->class->name))
+			continue;
+
 		NIH_ZERO (job_emit_goal_changed (
 				conn, job->path,
 				job_goal_name (job->goal)));
 	}
 
+	if (job_changed_hook)
+		job_changed_hook (job);
+
 
 	/* Normally whatever process or event is associated with the state
 	 * will finish naturally, so all we need do is change the goal and
@@ -306,8 +350,17 @@ job_change_goal (Job     *job,
 
 		break;
 	case JOB_STOP:
-		if (job->state == JOB_RUNNING)
+		if (job->state == JOB_RUNNING) {
 			job_change_state (job, job_next_state (job));
+		} else if (job->respawn_timer) {
+			/* A job waiting to be respawned should stop without
+			 * waiting out the delay; the timer is expired rather
+			 * than acted on here since we may be part way through
+			 * changing state.
+			 */
+			nih_unref (job->respawn_timer, job);
+			job_process_set_respawn_timer (job, 0);
+		}
 
 		break;
 	case JOB_RESPAWN:
@@ -348,16 +401,30 @@ job_change_state (Job      *job,
 
 		nih_assert (job->blocker == NULL);
 
+		/* A job being respawned after a delay waits in post-stop
+		 * until its timer moves it on.
+		 */
+		if ((job->state == JOB_POST_STOP) && (state == JOB_STARTING)
+		    && job->respawn_timer)
+			break;
+
 		nih_info (_("%s state changed from %s to %s"), job_name (job),
 			  job_state_name (job->state), job_state_name (state));
 
 		old_state = job->state;
 		job->state = state;
 
+		/* Readiness is only of interest while spawned */
+		if (old_state == JOB_SPAWNED)
+			job_process_notify_close (job);
+
 		NIH_LIST_FOREACH (control_conns, iter) {
 			NihListEntry   *entry = (NihListEntry *)iter;
 			DBusConnection *conn = (DBusConnection *)entry->data;
 
+			if (! control_conn_wants_job (conn, job->class->name))
+				continue;
+
 			NIH_ZERO (job_emit_state_changed (
 					conn, job->path,
 					job_state_name (job->state)));
@@ -395,6 +462,9 @@ job_change_state (Job      *job,
 			job->failed_process = PROCESS_INVALID;
 			job->exit_status = 0;
 
+			job->stats.starting_time = timeline_now ();
+			job->stats.spawned_time = 0;
+
 			job->blocker = job_emit_event (job);
 
 			break;
@@ -472,6 +542,10 @@ job_change_state (Job      *job,
 				/* Cancel the stop attempt */
 				job_finished (job, FALSE);
 			} else {
+				if (job->stats.spawned_time)
+					job->stats.ready_usec = (timeline_now ()
+						- job->stats.spawned_time);
+
 				job_emit_event (job);
 
 				/* If we're not a task, our goal is to be
@@ -536,6 +610,10 @@ job_change_state (Job      *job,
 			nih_assert ((old_state == JOB_POST_STOP)
 				    || (old_state == JOB_STARTING));
 
+			/* Report the final state before the instance goes */
+			if (job_changed_hook)
+				job_changed_hook (job);
+
 			job_emit_event (job);
 
 			job_finished (job, FALSE);
@@ -548,6 +626,9 @@ job_change_state (Job      *job,
 			nih_list_remove (&job->entry);
 			unused = job_class_reconsider (job->class);
 
+			/* Shutdown may be waiting for this instance */
+			quiesce_job_finished (job);
+
 			/* If the class is due to be deleted, free it
 			 * taking the job with it; otherwise free the
 			 * job.
@@ -576,6 +657,12 @@ job_change_state (Job      *job,
 
 			return;
 		}
+
+		/* Report the change once any process for the new state
+		 * has been spawned, so that its pid is included.
+		 */
+		if (job_changed_hook)
+			job_changed_hook (job);
 	}
 }
 
@@ -886,7 +973,12 @@ job_finished (Job *job,
  * that caused the failure and either an EXIT_STATUS or EXIT_SIGNAL
  * environment variable detailing it.
  *
- * Returns: new Event in the queue.
+ * The started and stopped events do not block the job, so when
+ * event_observed() shows that no job and no D-Bus connection could see
+ * them they are not constructed at all, and job_events_skipped is
+ * incremented instead.
+ *
+ * Returns: new Event in the queue or NULL if the event was skipped.
  **/
 Event *
 job_emit_event (Job *job)
@@ -921,6 +1013,13 @@ job_emit_event (Job *job)
 		nih_assert_not_reached ();
 	}
 
+	timeline_record (name, job->class->name, job->name);
+
+	if ((! block) && (! event_observed (name))) {
+		job_events_skipped++;
+		return NULL;
+	}
+
 	len = 0;
 	env = NIH_MUST (nih_str_array_new (NULL));
 
@@ -1492,13 +1591,18 @@ job_get_goal (Job             *job,
 	      NihDBusMessage  *message,
 	      char           **goal)
 {
+	JobSnapshot *snapshot;
+
 	nih_assert (job != NULL);
 	nih_assert (message != NULL);
 	nih_assert (goal != NULL);
 
-	*goal = nih_strdup (message, job_goal_name (job->goal));
-	if (! *goal)
-		nih_return_no_memory_error (-1);
+	snapshot = job_snapshot (job);
+	if (! snapshot)
+		return -1;
+
+	*goal = snapshot->goal_name;
+	nih_ref (*goal, message);
 
 	return 0;
 }
@@ -1522,13 +1626,18 @@ job_get_state (Job             *job,
 	      NihDBusMessage  *message,
 	      char           **state)
 {
+	JobSnapshot *snapshot;
+
 	nih_assert (job != NULL);
 	nih_assert (message != NULL);
 	nih_assert (state != NULL);
 
-	*state = nih_strdup (message, job_state_name (job->state));
-	if (! *state)
-		nih_return_no_memory_error (-1);
+	snapshot = job_snapshot (job);
+	if (! snapshot)
+		return -1;
+
+	*state = snapshot->state_name;
+	nih_ref (*state, message);
 
 	return 0;
 }
@@ -1553,57 +1662,191 @@ job_get_processes (Job *                  job,
 		   NihDBusMessage *       message,
 		   JobProcessesElement ***processes)
 {
-	size_t num_processes;
+	JobSnapshot *snapshot;
 
 	nih_assert (job != NULL);
 	nih_assert (message != NULL);
 	nih_assert (processes != NULL);
 
-	*processes = nih_alloc (message, sizeof (JobProcessesElement *) * 1);
-	if (! *processes)
+	snapshot = job_snapshot (job);
+	if (! snapshot)
+		return -1;
+
+	*processes = snapshot->processes;
+	nih_ref (*processes, message);
+
+	return 0;
+}
+
+/**
+ * job_get_stats:
+ * @job: job to obtain statistics of,
+ * @message: D-Bus connection and message received,
+ * @stats: pointer for reply array.
+ *
+ * Implements the GetStats method of the com.ubuntu.Upstart.Instance
+ * interface.
+ *
+ * Called to obtain the resource usage and start latencies of the given
+ * @job as an array of names and values, which will be stored in @stats.
+ * Times are in microseconds, the maximum resident set size in kilobytes
+ * and I/O in bytes.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+job_get_stats (Job *                      job,
+	       NihDBusMessage *           message,
+	       JobGetStatsStatsElement ***stats)
+{
+	nih_assert (job != NULL);
+	nih_assert (message != NULL);
+	nih_assert (stats != NULL);
+
+	const struct {
+		const char *name;
+		uint64_t    value;
+	} values[] = {
+		{ "cpu_usec",       job->stats.cpu_usec },
+		{ "max_rss_kb",     job->stats.max_rss_kb },
+		{ "io_read_bytes",  job->stats.io_read_bytes },
+		{ "io_write_bytes", job->stats.io_write_bytes },
+		{ "start_usec",     job->stats.start_usec },
+		{ "exec_usec",      job->stats.exec_usec },
+		{ "ready_usec",     job->stats.ready_usec },
+		{ "respawns",       job->class->respawns },
+		{ "watchdog_expiries", job->class->watchdog_expiries },
+	};
+	size_t num_values = sizeof (values) / sizeof (values[0]);
+
+	*stats = nih_alloc (message, sizeof (JobGetStatsStatsElement *)
+			    * (num_values + 1));
+	if (! *stats)
 		nih_return_no_memory_error (-1);
 
+	for (size_t i = 0; i < num_values; i++) {
+		JobGetStatsStatsElement *stat;
+
+		stat = nih_new (*stats, JobGetStatsStatsElement);
+		if (! stat)
+			goto error;
+
+		stat->item0 = nih_strdup (stat, values[i].name);
+		if (! stat->item0)
+			goto error;
+
+		stat->item1 = values[i].value;
+
+		(*stats)[i] = stat;
+	}
+
+	(*stats)[num_values] = NULL;
+
+	return 0;
+
+error:
+	nih_free (*stats);
+	*stats = NULL;
+
+	nih_return_no_memory_error (-1);
+}
+
+
+/**
+ * job_snapshot:
+ * @job: job to obtain property values of.
+ *
+ * Returns the cached values of the D-Bus properties of @job, building
+ * them again only if this is the first time they've been requested or
+ * the goal, state or process ids of @job have changed since; thus
+ * repeated property reads of an unchanged job need not allocate.
+ *
+ * Values are returned with the snapshot as their parent, callers should
+ * take their own reference with nih_ref() since the snapshot is freed
+ * when the job changes.
+ *
+ * Returns: snapshot of @job or NULL on raised error.
+ **/
+JobSnapshot *
+job_snapshot (Job *job)
+{
+	JobSnapshot *snapshot;
+	size_t       num_processes;
+
+	nih_assert (job != NULL);
+
+	snapshot = job->snapshot;
+	if (snapshot
+	    && (snapshot->goal == job->goal)
+	    && (snapshot->state == job->state)
+	    && (! memcmp (snapshot->pid, job->pid,
+			  sizeof (pid_t) * PROCESS_LAST)))
+		return snapshot;
+
+	snapshot = nih_new (job, JobSnapshot);
+	if (! snapshot)
+		nih_return_no_memory_error (NULL);
+
+	snapshot->goal = job->goal;
+	snapshot->state = job->state;
+	memcpy (snapshot->pid, job->pid, sizeof (pid_t) * PROCESS_LAST);
+
+	snapshot->goal_name = nih_strdup (snapshot, job_goal_name (job->goal));
+	if (! snapshot->goal_name)
+		goto error;
+
+	snapshot->state_name = nih_strdup (snapshot,
+					   job_state_name (job->state));
+	if (! snapshot->state_name)
+		goto error;
+
+	num_processes = 0;
+	for (int i = 0; i < PROCESS_LAST; i++)
+		if (job->pid[i] > 0)
+			num_processes++;
+
+	snapshot->processes = nih_alloc (snapshot,
+					 (sizeof (JobProcessesElement *)
+					  * (num_processes + 1)));
+	if (! snapshot->processes)
+		goto error;
+
 	num_processes = 0;
-	(*processes)[num_processes] = NULL;
+	snapshot->processes[num_processes] = NULL;
 
 	for (int i = 0; i < PROCESS_LAST; i++) {
-		JobProcessesElement * process;
-		JobProcessesElement **tmp;
+		JobProcessesElement *process;
 
 		if (job->pid[i] <= 0)
 			continue;
 
-		process = nih_new (*processes, JobProcessesElement);
-		if (! process) {
-			nih_error_raise_no_memory ();
-			nih_free (*processes);
-			return -1;
-		}
+		process = nih_new (snapshot->processes, JobProcessesElement);
+		if (! process)
+			goto error;
 
 		process->item0 = nih_strdup (process, process_name (i));
-		if (! process->item0) {
-			nih_error_raise_no_memory ();
-			nih_free (*processes);
-			return -1;
-		}
+		if (! process->item0)
+			goto error;
 
 		process->item1 = job->pid[i];
 
-		tmp = nih_realloc (*processes, message,
-				   (sizeof (JobProcessesElement *)
-				    * (num_processes + 2)));
-		if (! tmp) {
-			nih_error_raise_no_memory ();
-			nih_free (*processes);
-			return -1;
-		}
-
-		*processes = tmp;
-		(*processes)[num_processes++] = process;
-		(*processes)[num_processes] = NULL;
+		snapshot->processes[num_processes++] = process;
+		snapshot->processes[num_processes] = NULL;
 	}
 
-	return 0;
+	/* Values from the old snapshot still referenced by replies
+	 * survive until those are freed.
+	 */
+	if (job->snapshot)
+		nih_unref (job->snapshot, job);
+
+	job->snapshot = snapshot;
+
+	return snapshot;
+
+error:
+	nih_free (snapshot);
+	nih_return_no_memory_error (NULL);
 }
 
 /**
@@ -1626,6 +1869,8 @@ job_serialise (const Job *job)
 	json_object      *json_pid;
 	json_object      *json_fds;
 	json_object      *json_logs;
+	json_object      *json_stats;
+	const JobStats   *stats;
 
 	nih_assert (job);
 
@@ -1715,7 +1960,7 @@ job_serialise (const Job *job)
 	if (job->kill_timer) {
 		json_object *kill_timer;
 
-		kill_timer = job_serialise_kill_timer (job->kill_timer);
+		kill_timer = job_serialise_timer (job->kill_timer);
 
 		if (! kill_timer)
 			goto error;
@@ -1728,6 +1973,37 @@ job_serialise (const Job *job)
 				"kill_process", job->kill_process))
 		goto error;
 
+	/* conditionally encode notification socket, which is kept open
+	 * over the re-exec, and ready timer.
+	 */
+	if (job->notify) {
+		if (! state_set_json_int_var (json, "notify_fd",
+					      job->notify->fd))
+			goto error;
+	}
+
+	if (job->ready_timer) {
+		json_object *ready_timer;
+
+		ready_timer = job_serialise_timer (job->ready_timer);
+
+		if (! ready_timer)
+			goto error;
+
+		json_object_object_add (json, "ready_timer", ready_timer);
+	}
+
+	if (job->watchdog_timer) {
+		json_object *watchdog_timer;
+
+		watchdog_timer = job_serialise_timer (job->watchdog_timer);
+
+		if (! watchdog_timer)
+			goto error;
+
+		json_object_object_add (json, "watchdog_timer", watchdog_timer);
+	}
+
 	if (! state_set_json_int_var_from_obj (json, job, failed))
 		goto error;
 
@@ -1745,6 +2021,21 @@ job_serialise (const Job *job)
 	if (! state_set_json_int_var_from_obj (json, job, respawn_count))
 		goto error;
 
+	if (! state_set_json_int_var_from_obj (json, job, respawn_delay))
+		goto error;
+
+	/* conditionally encode respawn timer */
+	if (job->respawn_timer) {
+		json_object *respawn_timer;
+
+		respawn_timer = job_serialise_timer (job->respawn_timer);
+
+		if (! respawn_timer)
+			goto error;
+
+		json_object_object_add (json, "respawn_timer", respawn_timer);
+	}
+
 	if (! state_set_json_int_var_from_obj (json, job, trace_forks))
 		goto error;
 
@@ -1753,6 +2044,37 @@ job_serialise (const Job *job)
 				"trace_state", job->trace_state))
 		goto error;
 
+	if (! state_set_json_string_var_from_obj (json, job, cgroup))
+		goto error;
+
+	json_stats = json_object_new_object ();
+	if (! json_stats)
+		goto error;
+
+	json_object_object_add (json, "stats", json_stats);
+	stats = &job->stats;
+
+	if (! state_set_json_int_var_from_obj (json_stats, stats, cpu_usec))
+		goto error;
+
+	if (! state_set_json_int_var_from_obj (json_stats, stats, max_rss_kb))
+		goto error;
+
+	if (! state_set_json_int_var_from_obj (json_stats, stats, io_read_bytes))
+		goto error;
+
+	if (! state_set_json_int_var_from_obj (json_stats, stats, io_write_bytes))
+		goto error;
+
+	if (! state_set_json_int_var_from_obj (json_stats, stats, start_usec))
+		goto error;
+
+	if (! state_set_json_int_var_from_obj (json_stats, stats, exec_usec))
+		goto error;
+
+	if (! state_set_json_int_var_from_obj (json_stats, stats, ready_usec))
+		goto error;
+
 	json_logs = json_object_new_array ();
 
 	if (! json_logs)
@@ -1831,10 +2153,14 @@ job_deserialise (JobClass *parent, json_object *json)
 	nih_local char *name = NULL;
 	Job            *job = NULL;
 	json_object    *json_kill_timer;
+	json_object    *json_respawn_timer;
+	json_object    *json_ready_timer;
+	json_object    *json_watchdog_timer;
 	json_object    *blocker;
 	json_object    *json_fds;
 	json_object    *json_pid;
 	json_object    *json_logs;
+	json_object    *json_stats;
 	json_object    *json_stop_on = NULL;
 	size_t          len;
 	int             ret;
@@ -1970,7 +2296,7 @@ job_deserialise (JobClass *parent, json_object *json)
 		 *   to give their processes the full amount of time to
 		 *   end.
 		 */
-		nih_local NihTimer *kill_timer = job_deserialise_kill_timer (json_kill_timer);
+		nih_local NihTimer *kill_timer = job_deserialise_timer (json_kill_timer);
 		if (! kill_timer)
 			goto error;
 
@@ -1980,6 +2306,43 @@ job_deserialise (JobClass *parent, json_object *json)
 		job_process_adj_kill_timer (job, kill_timer->due);
 	}
 
+	if (json_object_object_get (json, "notify_fd")) {
+		int notify_fd = -1;
+
+		if (! state_get_json_int_var (json, "notify_fd", notify_fd))
+			goto error;
+
+		/* re-apply CLOEXEC flag to stop socket being leaked to
+		 * children.
+		 */
+		if (state_toggle_cloexec (notify_fd, TRUE) < 0)
+			goto error;
+
+		job_process_notify_watch (job, notify_fd);
+	}
+
+	json_ready_timer = json_object_object_get (json, "ready_timer");
+
+	if (json_ready_timer) {
+		nih_local NihTimer *ready_timer = job_deserialise_timer (json_ready_timer);
+		if (! ready_timer)
+			goto error;
+
+		job_process_set_ready_timer (job, ready_timer->timeout);
+		timer_wheel_adjust (job->ready_timer, ready_timer->due);
+	}
+
+	json_watchdog_timer = json_object_object_get (json, "watchdog_timer");
+
+	if (json_watchdog_timer) {
+		nih_local NihTimer *watchdog_timer = job_deserialise_timer (json_watchdog_timer);
+		if (! watchdog_timer)
+			goto error;
+
+		job_process_set_watchdog_timer (job, watchdog_timer->timeout);
+		timer_wheel_adjust (job->watchdog_timer, watchdog_timer->due);
+	}
+
 	if (! state_get_json_int_var_to_obj (json, job, failed))
 			goto error;
 
@@ -1997,6 +2360,25 @@ job_deserialise (JobClass *parent, json_object *json)
 	if (! state_get_json_int_var_to_obj (json, job, respawn_count))
 		goto error;
 
+	/* If we are missing this, we're probably importing from a
+	 * previous version that didn't support respawn delays.
+	 */
+	if (json_object_object_get (json, "respawn_delay")) {
+		if (! state_get_json_int_var_to_obj (json, job, respawn_delay))
+			goto error;
+	}
+
+	json_respawn_timer = json_object_object_get (json, "respawn_timer");
+
+	if (json_respawn_timer) {
+		nih_local NihTimer *respawn_timer = job_deserialise_timer (json_respawn_timer);
+		if (! respawn_timer)
+			goto error;
+
+		job_process_set_respawn_timer (job, respawn_timer->timeout);
+		timer_wheel_adjust (job->respawn_timer, respawn_timer->due);
+	}
+
 	json_fds = json_object_object_get (json, "fds");
 	if (! json_fds)
 		goto error;
@@ -2039,6 +2421,46 @@ job_deserialise (JobClass *parent, json_object *json)
 				"trace_state", job->trace_state))
 		goto error;
 
+	/* If we are missing this, we're probably importing from a
+	 * previous version that always traced processes with ptrace.
+	 */
+	if (json_object_object_get (json, "cgroup")) {
+		if (! state_get_json_string_var_to_obj (json, job, cgroup))
+			goto error;
+	}
+
+	/* Likewise, previous versions didn't collect statistics, which
+	 * are then counted from now on.
+	 */
+	json_stats = json_object_object_get (json, "stats");
+	if (json_stats) {
+		JobStats *stats = &job->stats;
+
+		if (! state_check_json_type (json_stats, object))
+			goto error;
+
+		if (! state_get_json_int_var_to_obj (json_stats, stats, cpu_usec))
+			goto error;
+
+		if (! state_get_json_int_var_to_obj (json_stats, stats, max_rss_kb))
+			goto error;
+
+		if (! state_get_json_int_var_to_obj (json_stats, stats, io_read_bytes))
+			goto error;
+
+		if (! state_get_json_int_var_to_obj (json_stats, stats, io_write_bytes))
+			goto error;
+
+		if (! state_get_json_int_var_to_obj (json_stats, stats, start_usec))
+			goto error;
+
+		if (! state_get_json_int_var_to_obj (json_stats, stats, exec_usec))
+			goto error;
+
+		if (! state_get_json_int_var_to_obj (json_stats, stats, ready_usec))
+			goto error;
+	}
+
 	json_logs = json_object_object_get (json, "log");
 
 	if (! json_logs)
@@ -2234,6 +2656,7 @@ job_trace_state_enum_to_str (TraceState state)
 	state_enum_to_str (TRACE_NEW, state);
 	state_enum_to_str (TRACE_NEW_CHILD, state);
 	state_enum_to_str (TRACE_NORMAL, state);
+	state_enum_to_str (TRACE_CGROUP, state);
 
 	return NULL;
 }
@@ -2254,12 +2677,13 @@ job_trace_state_str_to_enum (const char *state)
 	state_str_to_enum (TRACE_NEW, state);
 	state_str_to_enum (TRACE_NEW_CHILD, state);
 	state_str_to_enum (TRACE_NORMAL, state);
+	state_str_to_enum (TRACE_CGROUP, state);
 
 	return -1;
 }
 
 /**
- * job_serialise_kill_timer:
+ * job_serialise_timer:
  *
  * @timer: NihTimer to serialise.
  *
@@ -2268,7 +2692,7 @@ job_trace_state_str_to_enum (const char *state)
  * Returns: JSON-serialised NihTimer object, or NULL on error.
  **/
 static json_object *
-job_serialise_kill_timer (NihTimer *timer)
+job_serialise_timer (NihTimer *timer)
 {
 	json_object  *json;
 
@@ -2292,7 +2716,7 @@ error:
 }
 
 /**
- * job_deserialise_kill_timer:
+ * job_deserialise_timer:
  *
  * @json: JSON representation of NihTimer.
  *
@@ -2301,7 +2725,7 @@ error:
  * Returns: NihTimer on NULL on error.
  **/
 static NihTimer *
-job_deserialise_kill_timer (json_object *json)
+job_deserialise_timer (json_object *json)
 {
 	NihTimer *timer;
 
@@ -24,11 +24,13 @@
 
 #include <sys/types.h>
 
+#include <stdint.h>
 #include <time.h>
 
 #include <nih/macros.h>
 #include <nih/list.h>
 #include <nih/timer.h>
+#include <nih/io.h>
 
 #include <nih-dbus/dbus_message.h>
 
@@ -82,16 +84,74 @@ typedef enum job_state {
  *
  * We trace jobs to follow forks and detect execs in order to be able to
  * supervise daemon processes.  Unfortunately due to the "unique and arcane"
- * nature of ptrace(), we need to track some state.
+ * nature of ptrace(), we need to track some state.  Where the job's
+ * control group is used to follow the main process instead, the state
+ * is TRACE_CGROUP until the job has moved on from the spawned state.
  **/
 typedef enum trace_state {
 	TRACE_NONE,
 	TRACE_NEW,
 	TRACE_NEW_CHILD,
-	TRACE_NORMAL
+	TRACE_NORMAL,
+	TRACE_CGROUP
 } TraceState;
 
 
+/**
+ * JobStats:
+ * @cpu_usec: user and system CPU time of reaped processes,
+ * @max_rss_kb: largest maximum resident set size of a reaped process,
+ * @io_read_bytes: bytes read from block devices by reaped processes,
+ * @io_write_bytes: bytes written to block devices by reaped processes,
+ * @start_usec: time from starting until the main process was spawned,
+ * @exec_usec: time taken for the main process to be spawned and exec,
+ * @ready_usec: time from spawning the main process until running,
+ * @starting_time: monotonic time the job last entered starting,
+ * @spawned_time: monotonic time the main process was last spawned.
+ *
+ * Running totals of the resources used by the processes of a job since it
+ * was created, and the latencies of its most recent start; times are in
+ * microseconds.
+ **/
+typedef struct job_stats {
+	uint64_t cpu_usec;
+	uint64_t max_rss_kb;
+	uint64_t io_read_bytes;
+	uint64_t io_write_bytes;
+
+	uint64_t start_usec;
+	uint64_t exec_usec;
+	uint64_t ready_usec;
+
+	uint64_t starting_time;
+	uint64_t spawned_time;
+} JobStats;
+
+
+/**
+ * JobSnapshot:
+ * @goal: goal of job when taken,
+ * @state: state of job when taken,
+ * @pid: process ids of job when taken,
+ * @goal_name: value of the goal property,
+ * @state_name: value of the state property,
+ * @processes: value of the processes property.
+ *
+ * Cached values of the D-Bus properties of a job, shared by every reply
+ * until the goal, state or any process id of the job no longer match
+ * those the snapshot was taken with.
+ **/
+typedef struct job_snapshot {
+	JobGoal               goal;
+	JobState              state;
+	pid_t                 pid[PROCESS_LAST];
+
+	char                 *goal_name;
+	char                 *state_name;
+	JobProcessesElement **processes;
+} JobSnapshot;
+
+
 /**
  * Job:
  * @entry: list header,
@@ -108,18 +168,28 @@ typedef enum trace_state {
  *       JobClasses @start_on condition,
  * @num_fds: number of elements in @fds,
  * @pid: current process ids,
+ * @pidfd: watches on pidfds of current processes, see job_process_watch(),
  * @blocker: emitted event we're waiting to finish,
  * @blocking: list of events we're blocking from finishing,
  * @kill_timer: timer to kill process,
  * @kill_process: process @kill_timer will kill,
+ * @notify: watch on socket the main process notifies us on when ready,
+ * @ready_timer: timer to stop job if the main process is not ready in time,
+ * @watchdog_timer: timer to kill the main process if it stops notifying us
+ * that it is alive,
  * @failed: whether the last process ran failed,
  * @failed_process: the last process that failed,
  * @exit_status: exit status of the last failed process,
  * @respawn_time: time job was first respawned,
  * @respawn_count: number of respawns since @respawn_time,
- * @trace_forks: number of forks traced,
+ * @respawn_delay: delay before the last respawn, without jitter,
+ * @respawn_timer: timer to respawn job once its delay has passed,
+ * @stats: resource usage and start latencies,
+ * @trace_forks: number of forks traced or processes followed,
  * @trace_state: state of trace,
- * @log: pointer to array of log objects for handling job output.
+ * @cgroup: path of control group of main process, or NULL,
+ * @log: pointer to array of log objects for handling job output,
+ * @snapshot: cached D-Bus property values, see job_snapshot().
  *
  * This structure holds the state of an active job instance being tracked
  * by the init daemon, the configuration details of the job are available
@@ -144,27 +214,51 @@ typedef struct job {
 	size_t          num_fds;
 
 	pid_t          *pid;
+	NihIoWatch    **pidfd;
 	Event          *blocker;
 	NihList         blocking;
 
 	NihTimer       *kill_timer;
 	ProcessType     kill_process;
 
+	NihIoWatch     *notify;
+	NihTimer       *ready_timer;
+	NihTimer       *watchdog_timer;
+
 	int             failed;
 	ProcessType     failed_process;
 	int             exit_status;
 
 	time_t          respawn_time;
 	int             respawn_count;
+	time_t          respawn_delay;
+	NihTimer       *respawn_timer;
+
+	JobStats        stats;
 
 	int             trace_forks;
 	TraceState      trace_state;
+	char           *cgroup;
 	Log           **log;
+
+	JobSnapshot    *snapshot;
 } Job;
 
+/**
+ * JobChangedHook:
+ * @job: job that changed.
+ *
+ * Function called whenever the goal or state of @job changes.
+ **/
+typedef void (*JobChangedHook) (Job *job);
+
 
 NIH_BEGIN_EXTERN
 
+extern unsigned long  job_events_skipped;
+extern JobChangedHook job_changed_hook;
+
+
 Job *       job_new             (JobClass *class, const char *name)
 	__attribute__ ((warn_unused_result));
 void        job_register        (Job *job, DBusConnection *conn, int signal);
@@ -179,6 +273,9 @@ void        job_finished        (Job *job, int failed);
 
 Event      *job_emit_event      (Job *job);
 
+JobSnapshot *job_snapshot       (Job *job)
+	__attribute__ ((warn_unused_result));
+
 
 const char *job_name            (Job *job);
 
@@ -213,6 +310,10 @@ int         job_get_processes   (Job *job, NihDBusMessage *message,
 				 JobProcessesElement ***processes)
 	__attribute__ ((warn_unused_result));
 
+int         job_get_stats       (Job *job, NihDBusMessage *message,
+				 JobGetStatsStatsElement ***stats)
+	__attribute__ ((warn_unused_result));
+
 json_object *job_serialise (const Job *job);
 Job *job_deserialise (JobClass *parent, json_object *json);
 
@@ -69,6 +69,9 @@ extern char **environ;
 /* Prototypes for static functions */
 static void  job_class_add (JobClass *class);
 static int   job_class_remove (JobClass *class, const Session *session);
+static char ***job_class_condition_array (const void *parent,
+					  EventOperator *root)
+	__attribute__ ((warn_unused_result));
 
 /**
  * default_console:
@@ -359,11 +362,19 @@ job_class_new (const void *parent,
 	class->kill_timeout = JOB_DEFAULT_KILL_TIMEOUT;
 	class->kill_signal = SIGTERM;
 
+	class->ready_timeout = JOB_DEFAULT_READY_TIMEOUT;
+	class->watchdog_timeout = 0;
+
 	class->reload_signal = SIGHUP;
 
 	class->respawn = FALSE;
 	class->respawn_limit = JOB_DEFAULT_RESPAWN_LIMIT;
 	class->respawn_interval = JOB_DEFAULT_RESPAWN_INTERVAL;
+	class->respawn_delay_min = 0;
+	class->respawn_delay_max = 0;
+	class->respawn_stable = JOB_DEFAULT_RESPAWN_STABLE;
+	class->respawns = 0;
+	class->watchdog_expiries = 0;
 
 	class->normalexit = NULL;
 	class->normalexit_len = 0;
@@ -377,6 +388,16 @@ job_class_new (const void *parent,
 	for (i = 0; i < RLIMIT_NLIMITS; i++)
 		class->limits[i] = NULL;
 
+	class->cpu_weight = 0;
+	class->cpu_quota = 0;
+	class->memory_max = 0;
+	class->memory_high = 0;
+	class->io_weight = 0;
+
+	class->cpu_affinity = NULL;
+	class->numa_policy = NUMA_DEFAULT;
+	class->numa_nodes = NULL;
+
 	class->chroot = NULL;
 	class->chdir = NULL;
 
@@ -390,6 +411,8 @@ job_class_new (const void *parent,
 
 	class->apparmor_switch = NULL;
 
+	class->snapshot = NULL;
+
 	return class;
 
 error:
@@ -764,34 +787,37 @@ job_class_environment (const void *parent,
 		       JobClass   *class,
 		       size_t     *len)
 {
-	char  **env;
+	nih_local EnvironTable  *table = NULL;
+	char                   **env;
 
 	nih_assert (class != NULL);
 	nih_assert (job_environ);
 
-	env = nih_str_array_new (parent);
-	if (! env)
+	table = environ_table_new (parent, NULL);
+	if (! table)
 		return NULL;
-	if (len)
-		*len = 0;
 
 	/* Copy the set of environment variables, usually these just
 	 * pick up the values from init's own environment.
 	 */
-	if (! environ_append (&env, parent, len, TRUE, job_environ))
+	if (! environ_table_append (table, TRUE, job_environ))
 		goto error;
 
 	/* Copy the set of environment variables from the job configuration,
 	 * these often have values but also often don't and we want them to
 	 * override the builtins.
 	 */
-	if (! environ_append (&env, parent, len, TRUE, class->env))
+	if (! environ_table_append (table, TRUE, class->env))
+		goto error;
+
+	env = environ_table_finish (table, len);
+	if (! env)
 		goto error;
 
 	return env;
 
 error:
-	nih_free (env);
+	nih_free (table->env);
 	return NULL;
 }
 
@@ -1567,6 +1593,118 @@ job_class_get_version (JobClass        *class,
 }
 
 
+/**
+ * job_class_snapshot:
+ * @class: class to obtain property values of.
+ *
+ * Returns the structure caching the values of the costlier D-Bus
+ * properties of @class, allocating it the first time.  Since a class is
+ * never modified once registered, a new class being created when its
+ * configuration changes, the values need only be built once and are
+ * shared by every reply from then on.
+ *
+ * Values are returned with the snapshot as their parent, callers should
+ * take their own reference with nih_ref().
+ *
+ * Returns: snapshot of @class or NULL on raised error.
+ **/
+JobClassSnapshot *
+job_class_snapshot (JobClass *class)
+{
+	nih_assert (class != NULL);
+
+	if (class->snapshot)
+		return class->snapshot;
+
+	class->snapshot = nih_new (class, JobClassSnapshot);
+	if (! class->snapshot)
+		nih_return_no_memory_error (NULL);
+
+	class->snapshot->start_on = NULL;
+	class->snapshot->stop_on = NULL;
+	class->snapshot->emits = NULL;
+
+	return class->snapshot;
+}
+
+/**
+ * job_class_condition_array:
+ * @parent: parent object for new array,
+ * @root: event operator expression, may be NULL.
+ *
+ * Flattens the event tree @root into reverse polish form, as returned
+ * for the start_on and stop_on properties.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned array.  When all parents
+ * of the returned array are freed, the returned array will also be
+ * freed.
+ *
+ * Returns: newly allocated array or NULL on raised error.
+ **/
+static char ***
+job_class_condition_array (const void    *parent,
+			   EventOperator *root)
+{
+	char ***array;
+	size_t  len = 0;
+
+	array = nih_alloc (parent, sizeof (char ***));
+	if (! array)
+		nih_return_no_memory_error (NULL);
+
+	array[len] = NULL;
+
+	if (! root)
+		return array;
+
+	NIH_TREE_FOREACH_POST (&root->node, iter) {
+		EventOperator *oper = (EventOperator *)iter;
+		char        ***tmp;
+
+		tmp = nih_realloc (array, parent, sizeof (char ***) * (len + 2));
+		if (! tmp)
+			goto error;
+
+		array = tmp;
+
+		array[len] = nih_str_array_new (array);
+		if (! array[len])
+			goto error;
+
+		switch (oper->type) {
+		case EVENT_OR:
+			if (! nih_str_array_add (&array[len], array,
+						 NULL, "/OR"))
+				goto error;
+			break;
+		case EVENT_AND:
+			if (! nih_str_array_add (&array[len], array,
+						 NULL, "/AND"))
+				goto error;
+			break;
+		case EVENT_MATCH:
+			if (! nih_str_array_add (&array[len], array,
+						 NULL, oper->name))
+				goto error;
+			if (oper->env)
+				if (! nih_str_array_append (&array[len], array,
+							    NULL, oper->env))
+					goto error;
+			break;
+		}
+
+		array[++len] = NULL;
+	}
+
+	return array;
+
+error:
+	nih_free (array);
+	nih_return_no_memory_error (NULL);
+}
+
+
 /**
  * job_class_get_start_on:
  * @class: class to obtain events from,
@@ -1591,58 +1729,26 @@ job_class_get_start_on (JobClass *      class,
 			NihDBusMessage *message,
 			char ****       start_on)
 {
-	size_t len = 0;
+	JobClassSnapshot *snapshot;
 
 	nih_assert (class != NULL);
 	nih_assert (message != NULL);
 	nih_assert (start_on != NULL);
 
-	*start_on = nih_alloc (message, sizeof (char ***));
-	if (! *start_on)
-		nih_return_no_memory_error (-1);
-
-	len = 0;
-	(*start_on)[len] = NULL;
-
-	if (class->start_on) {
-		NIH_TREE_FOREACH_POST (&class->start_on->node, iter) {
-			EventOperator *oper = (EventOperator *)iter;
-
-			*start_on = nih_realloc (*start_on, message,
-						 sizeof (char ***) * (len + 2));
-			if (! *start_on)
-				nih_return_no_memory_error (-1);
-
-			(*start_on)[len] = nih_str_array_new (*start_on);
-			if (! (*start_on)[len])
-				nih_return_no_memory_error (-1);
-
-			switch (oper->type) {
-			case EVENT_OR:
-				if (! nih_str_array_add (&(*start_on)[len], *start_on,
-							 NULL, "/OR"))
-					nih_return_no_memory_error (-1);
-				break;
-			case EVENT_AND:
-				if (! nih_str_array_add (&(*start_on)[len], *start_on,
-							 NULL, "/AND"))
-					nih_return_no_memory_error (-1);
-				break;
-			case EVENT_MATCH:
-				if (! nih_str_array_add (&(*start_on)[len], *start_on,
-							 NULL, oper->name))
-					nih_return_no_memory_error (-1);
-				if (oper->env)
-					if (! nih_str_array_append (&(*start_on)[len], *start_on,
-								    NULL, oper->env))
-						nih_return_no_memory_error (-1);
-				break;
-			}
+	snapshot = job_class_snapshot (class);
+	if (! snapshot)
+		return -1;
 
-			(*start_on)[++len] = NULL;
-		}
+	if (! snapshot->start_on) {
+		snapshot->start_on = job_class_condition_array (snapshot,
+								class->start_on);
+		if (! snapshot->start_on)
+			return -1;
 	}
 
+	*start_on = snapshot->start_on;
+	nih_ref (*start_on, message);
+
 	return 0;
 }
 
@@ -1670,58 +1776,26 @@ job_class_get_stop_on (JobClass *      class,
 		       NihDBusMessage *message,
 		       char ****       stop_on)
 {
-	size_t len = 0;
+	JobClassSnapshot *snapshot;
 
 	nih_assert (class != NULL);
 	nih_assert (message != NULL);
 	nih_assert (stop_on != NULL);
 
-	*stop_on = nih_alloc (message, sizeof (char ***));
-	if (! *stop_on)
-		nih_return_no_memory_error (-1);
-
-	len = 0;
-	(*stop_on)[len] = NULL;
-
-	if (class->stop_on) {
-		NIH_TREE_FOREACH_POST (&class->stop_on->node, iter) {
-			EventOperator *oper = (EventOperator *)iter;
-
-			*stop_on = nih_realloc (*stop_on, message,
-						 sizeof (char ***) * (len + 2));
-			if (! *stop_on)
-				nih_return_no_memory_error (-1);
-
-			(*stop_on)[len] = nih_str_array_new (*stop_on);
-			if (! (*stop_on)[len])
-				nih_return_no_memory_error (-1);
-
-			switch (oper->type) {
-			case EVENT_OR:
-				if (! nih_str_array_add (&(*stop_on)[len], *stop_on,
-							 NULL, "/OR"))
-					nih_return_no_memory_error (-1);
-				break;
-			case EVENT_AND:
-				if (! nih_str_array_add (&(*stop_on)[len], *stop_on,
-							 NULL, "/AND"))
-					nih_return_no_memory_error (-1);
-				break;
-			case EVENT_MATCH:
-				if (! nih_str_array_add (&(*stop_on)[len], *stop_on,
-							 NULL, oper->name))
-					nih_return_no_memory_error (-1);
-				if (oper->env)
-					if (! nih_str_array_append (&(*stop_on)[len], *stop_on,
-								    NULL, oper->env))
-						nih_return_no_memory_error (-1);
-				break;
-			}
+	snapshot = job_class_snapshot (class);
+	if (! snapshot)
+		return -1;
 
-			(*stop_on)[++len] = NULL;
-		}
+	if (! snapshot->stop_on) {
+		snapshot->stop_on = job_class_condition_array (snapshot,
+								class->stop_on);
+		if (! snapshot->stop_on)
+			return -1;
 	}
 
+	*stop_on = snapshot->stop_on;
+	nih_ref (*stop_on, message);
+
 	return 0;
 }
 
@@ -1744,20 +1818,30 @@ job_class_get_emits (JobClass *      class,
 		     NihDBusMessage *message,
 		     char ***        emits)
 {
+	JobClassSnapshot *snapshot;
+
 	nih_assert (class != NULL);
 	nih_assert (message != NULL);
 	nih_assert (emits != NULL);
 
-	if (class->emits) {
-		*emits = nih_str_array_copy (message, NULL, class->emits);
-		if (! *emits)
-			nih_return_no_memory_error (-1);
-	} else {
-		*emits = nih_str_array_new (message);
-		if (! *emits)
+	snapshot = job_class_snapshot (class);
+	if (! snapshot)
+		return -1;
+
+	if (! snapshot->emits) {
+		if (class->emits) {
+			snapshot->emits = nih_str_array_copy (snapshot, NULL,
+							      class->emits);
+		} else {
+			snapshot->emits = nih_str_array_new (snapshot);
+		}
+		if (! snapshot->emits)
 			nih_return_no_memory_error (-1);
 	}
 
+	*emits = snapshot->emits;
+	nih_ref (*emits, message);
+
 	return 0;
 }
 
@@ -1990,6 +2074,12 @@ job_class_serialise (const JobClass *class)
 	if (! state_set_json_int_var_from_obj (json, class, kill_signal))
 		goto error;
 
+	if (! state_set_json_int_var_from_obj (json, class, ready_timeout))
+		goto error;
+
+	if (! state_set_json_int_var_from_obj (json, class, watchdog_timeout))
+		goto error;
+
 	if (! state_set_json_int_var_from_obj (json, class, reload_signal))
 		goto error;
 
@@ -2002,6 +2092,21 @@ job_class_serialise (const JobClass *class)
 	if (! state_set_json_int_var_from_obj (json, class, respawn_interval))
 		goto error;
 
+	if (! state_set_json_int_var_from_obj (json, class, respawn_delay_min))
+		goto error;
+
+	if (! state_set_json_int_var_from_obj (json, class, respawn_delay_max))
+		goto error;
+
+	if (! state_set_json_int_var_from_obj (json, class, respawn_stable))
+		goto error;
+
+	if (! state_set_json_int_var_from_obj (json, class, respawns))
+		goto error;
+
+	if (! state_set_json_int_var_from_obj (json, class, watchdog_expiries))
+		goto error;
+
 	json_normalexit = state_serialise_int_array (int, class->normalexit,
 					     class->normalexit_len);
 	if (! json_normalexit)
@@ -2028,6 +2133,32 @@ job_class_serialise (const JobClass *class)
 		goto error;
 	json_object_object_add (json, "limits", json_limits);
 
+	if (! state_set_json_int_var_from_obj (json, class, cpu_weight))
+		goto error;
+
+	if (! state_set_json_int_var_from_obj (json, class, cpu_quota))
+		goto error;
+
+	if (! state_set_json_int_var_from_obj (json, class, memory_max))
+		goto error;
+
+	if (! state_set_json_int_var_from_obj (json, class, memory_high))
+		goto error;
+
+	if (! state_set_json_int_var_from_obj (json, class, io_weight))
+		goto error;
+
+	if (! state_set_json_string_var_from_obj (json, class, cpu_affinity))
+		goto error;
+
+	if (! state_set_json_enum_var (json,
+				job_class_numa_policy_enum_to_str,
+				"numa_policy", class->numa_policy))
+		goto error;
+
+	if (! state_set_json_string_var_from_obj (json, class, numa_nodes))
+		goto error;
+
 	if (! state_set_json_string_var_from_obj (json, class, chroot))
 		goto error;
 
@@ -2293,6 +2424,22 @@ job_class_deserialise (json_object *json)
 	if (! state_get_json_int_var_to_obj (json, class, kill_signal))
 		goto error;
 
+	/* If we are missing this, we're probably importing from a
+	 * previous version that didn't support readiness notification.
+	 */
+	if (json_object_object_get (json, "ready_timeout")) {
+		if (! state_get_json_int_var_to_obj (json, class, ready_timeout))
+			goto error;
+	}
+
+	/* If we are missing this, we're probably importing from a
+	 * previous version that didn't support watchdogs.
+	 */
+	if (json_object_object_get (json, "watchdog_timeout")) {
+		if (! state_get_json_int_var_to_obj (json, class, watchdog_timeout))
+			goto error;
+	}
+
 	/* reload_signal is new in upstart 1.10+ */
 	if (json_object_object_get (json, "reload_signal")) {
 		if (! state_get_json_int_var_to_obj (json, class, reload_signal))
@@ -2308,6 +2455,34 @@ job_class_deserialise (json_object *json)
 	if (! state_get_json_int_var_to_obj (json, class, respawn_interval))
 		goto error;
 
+	/* If we are missing these, we're probably importing from a
+	 * previous version that didn't support respawn delays.
+	 */
+	if (json_object_object_get (json, "respawn_delay_min")) {
+		if (! state_get_json_int_var_to_obj (json, class, respawn_delay_min))
+			goto error;
+		if (! state_get_json_int_var_to_obj (json, class, respawn_delay_max))
+			goto error;
+		if (! state_get_json_int_var_to_obj (json, class, respawn_stable))
+			goto error;
+	}
+
+	/* If we are missing this, we're probably importing from a
+	 * previous version that didn't count respawns.
+	 */
+	if (json_object_object_get (json, "respawns")) {
+		if (! state_get_json_int_var_to_obj (json, class, respawns))
+			goto error;
+	}
+
+	/* If we are missing this, we're probably importing from a
+	 * previous version that didn't support watchdogs.
+	 */
+	if (json_object_object_get (json, "watchdog_expiries")) {
+		if (! state_get_json_int_var_to_obj (json, class, watchdog_expiries))
+			goto error;
+	}
+
 	if (! state_get_json_enum_var (json,
 				job_class_console_type_str_to_enum,
 				"console", class->console))
@@ -2322,6 +2497,36 @@ job_class_deserialise (json_object *json)
 	if (! state_get_json_int_var_to_obj (json, class, oom_score_adj))
 		goto error;
 
+	/* If we are missing these, we're probably importing from a
+	 * previous version that didn't support control group limits.
+	 */
+	if (json_object_object_get (json, "cpu_weight")) {
+		if (! state_get_json_int_var_to_obj (json, class, cpu_weight))
+			goto error;
+		if (! state_get_json_int_var_to_obj (json, class, cpu_quota))
+			goto error;
+		if (! state_get_json_int_var_to_obj (json, class, memory_max))
+			goto error;
+		if (! state_get_json_int_var_to_obj (json, class, memory_high))
+			goto error;
+		if (! state_get_json_int_var_to_obj (json, class, io_weight))
+			goto error;
+	}
+
+	/* If we are missing these, we're probably importing from a
+	 * previous version that didn't support CPU and NUMA placement.
+	 */
+	if (json_object_object_get (json, "numa_policy")) {
+		if (! state_get_json_string_var_to_obj (json, class, cpu_affinity))
+			goto error;
+		if (! state_get_json_enum_var (json,
+					job_class_numa_policy_str_to_enum,
+					"numa_policy", class->numa_policy))
+			goto error;
+		if (! state_get_json_string_var_to_obj (json, class, numa_nodes))
+			goto error;
+	}
+
 	if (! state_get_json_string_var_to_obj (json, class, chroot))
 		goto error;
 
@@ -2480,6 +2685,7 @@ job_class_expect_type_enum_to_str (ExpectType expect)
 	state_enum_to_str (EXPECT_STOP, expect);
 	state_enum_to_str (EXPECT_DAEMON, expect);
 	state_enum_to_str (EXPECT_FORK, expect);
+	state_enum_to_str (EXPECT_NOTIFY, expect);
 
 	return NULL;
 }
@@ -2502,6 +2708,7 @@ job_class_expect_type_str_to_enum (const char *expect)
 	state_str_to_enum (EXPECT_STOP, expect);
 	state_str_to_enum (EXPECT_DAEMON, expect);
 	state_str_to_enum (EXPECT_FORK, expect);
+	state_str_to_enum (EXPECT_NOTIFY, expect);
 
 	return -1;
 }
@@ -2550,11 +2757,58 @@ error:
 	return -1;
 }
 
+/**
+ * job_class_numa_policy_enum_to_str:
+ *
+ * @policy: NumaPolicy.
+ *
+ * Convert NumaPolicy to a string representation.
+ *
+ * Returns: string representation of @policy, or NULL if not known.
+ **/
+const char *
+job_class_numa_policy_enum_to_str (NumaPolicy policy)
+{
+	state_enum_to_str (NUMA_DEFAULT, policy);
+	state_enum_to_str (NUMA_BIND, policy);
+	state_enum_to_str (NUMA_PREFERRED, policy);
+	state_enum_to_str (NUMA_INTERLEAVE, policy);
+	state_enum_to_str (NUMA_LOCAL, policy);
+
+	return NULL;
+}
+
+/**
+ * job_class_numa_policy_str_to_enum:
+ *
+ * @policy: string NumaPolicy value.
+ *
+ * Convert @policy back into enum value.
+ *
+ * Returns: NumaPolicy representing @policy, or -1 if not known.
+ **/
+NumaPolicy
+job_class_numa_policy_str_to_enum (const char *policy)
+{
+	if (! policy)
+		goto error;
+
+	state_str_to_enum (NUMA_DEFAULT, policy);
+	state_str_to_enum (NUMA_BIND, policy);
+	state_str_to_enum (NUMA_PREFERRED, policy);
+	state_str_to_enum (NUMA_INTERLEAVE, policy);
+	state_str_to_enum (NUMA_LOCAL, policy);
+
+error:
+	return -1;
+}
+
 /**
  * job_class_prepare_reexec:
  *
  * Prepare for a re-exec by clearing the CLOEXEC bit on all log object
- * file descriptors associated with their parent jobs.
+ * file descriptors associated with their parent jobs, and on the sockets
+ * of jobs waiting to be notified that they are ready.
  **/
 void
 job_class_prepare_reexec (void)
@@ -2567,6 +2821,11 @@ job_class_prepare_reexec (void)
 		NIH_HASH_FOREACH (class->instances, job_iter) {
 			Job *job = (Job *)job_iter;
 
+			if (job->notify
+			    && (state_toggle_cloexec (job->notify->fd,
+						      FALSE) < 0))
+				goto error;
+
 			nih_assert (job->log);
 
 			for (int process = 0; process < PROCESS_LAST; process++) {
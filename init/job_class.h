@@ -25,6 +25,7 @@
 #include <sys/types.h>
 #include <sys/resource.h>
 
+#include <stdint.h>
 #include <time.h>
 
 #include <nih/macros.h>
@@ -44,12 +45,15 @@
  * This is used to determine what to expect to happen before moving the job
  * from the spawned state.  EXPECT_NONE means that we don't expect anything
  * so the job will move directly out of the spawned state without waiting.
+ * EXPECT_NOTIFY means that we wait for the main process to send READY=1
+ * to the socket named by NOTIFY_SOCKET in its environment.
  **/
 typedef enum expect_type {
 	EXPECT_NONE,
 	EXPECT_STOP,
 	EXPECT_DAEMON,
-	EXPECT_FORK
+	EXPECT_FORK,
+	EXPECT_NOTIFY
 } ExpectType;
 
 /**
@@ -70,6 +74,25 @@ typedef enum console_type {
 	CONSOLE_LOG
 } ConsoleType;
 
+/**
+ * NumaPolicy:
+ *
+ * This is used to identify where the memory of a job's processes should
+ * be allocated from on NUMA systems.  The options are:
+ * - NUMA_DEFAULT: the policy of the init daemon (this is the default),
+ * - NUMA_BIND: only from the nodes given,
+ * - NUMA_PREFERRED: from the first of the nodes given where possible,
+ * - NUMA_INTERLEAVE: interleaved across the nodes given,
+ * - NUMA_LOCAL: from the node of the CPU that allocates it.
+ **/
+typedef enum numa_policy {
+	NUMA_DEFAULT,
+	NUMA_BIND,
+	NUMA_PREFERRED,
+	NUMA_INTERLEAVE,
+	NUMA_LOCAL
+} NumaPolicy;
+
 
 /**
  * JOB_DEFAULT_KILL_TIMEOUT:
@@ -79,6 +102,14 @@ typedef enum console_type {
  **/
 #define JOB_DEFAULT_KILL_TIMEOUT 5
 
+/**
+ * JOB_DEFAULT_READY_TIMEOUT:
+ *
+ * The default length of time to wait for the main process of a job that
+ * expects to be notified to report that it is ready before stopping it.
+ **/
+#define JOB_DEFAULT_READY_TIMEOUT 90
+
 /**
  * JOB_DEFAULT_RESPAWN_LIMIT:
  *
@@ -94,6 +125,14 @@ typedef enum console_type {
  **/
 #define JOB_DEFAULT_RESPAWN_INTERVAL 5
 
+/**
+ * JOB_DEFAULT_RESPAWN_STABLE:
+ *
+ * The default number of seconds a respawned process must run for before
+ * its respawn delay is reset.
+ **/
+#define JOB_DEFAULT_RESPAWN_STABLE 60
+
 /**
  * JOB_DEFAULT_UMASK:
  *
@@ -115,6 +154,26 @@ typedef enum console_type {
  **/
 #define JOB_DEFAULT_OOM_SCORE_ADJ 0
 
+/**
+ * JOB_CPU_QUOTA_MAX:
+ *
+ * The largest CPU quota, as a percentage of a single CPU, that may be
+ * given to a job.
+ **/
+#define JOB_CPU_QUOTA_MAX 100000
+
+/**
+ * JOB_CLASS_CGROUP_LIMITED:
+ * @class: job class.
+ *
+ * Returns: TRUE if @class has any resource limits that are applied
+ * through its control group, FALSE otherwise.
+ **/
+#define JOB_CLASS_CGROUP_LIMITED(class) \
+	((class)->cpu_weight || (class)->cpu_quota \
+	 || (class)->memory_max || (class)->memory_high \
+	 || (class)->io_weight)
+
 /**
  * JOB_DEFAULT_ENVIRONMENT:
  *
@@ -127,6 +186,22 @@ typedef enum console_type {
 	"TERM"
 
 
+/**
+ * JobClassSnapshot:
+ * @start_on: value of the start_on property, or NULL if not yet built,
+ * @stop_on: value of the stop_on property, or NULL if not yet built,
+ * @emits: value of the emits property, or NULL if not yet built.
+ *
+ * Cached values of the D-Bus properties of a job class that are costly
+ * to build, see job_class_snapshot().
+ **/
+typedef struct job_class_snapshot {
+	char ***start_on;
+	char ***stop_on;
+	char  **emits;
+} JobClassSnapshot;
+
+
 /**
  * JobClass:
  * @entry: list header,
@@ -148,10 +223,21 @@ typedef enum console_type {
  * @task: start requests are not unblocked until instances have finished,
  * @kill_timeout: time to wait between sending TERM and KILL signals,
  * @kill_signal: first signal to send (usually SIGTERM),
+ * @ready_timeout: time to wait for the main process to notify us that it
+ * is ready, or zero to wait indefinitely,
+ * @watchdog_timeout: time within which the main process must notify us
+ * that it is still alive, or zero for no watchdog,
  * @reload_signal: reload signal to send (usually SIGHUP),
  * @respawn: instances should be restarted if main process fails,
  * @respawn_limit: number of respawns in @respawn_interval that we permit,
  * @respawn_interval: barrier for @respawn_limit,
+ * @respawn_delay_min: initial delay before respawning, or zero to respawn
+ * immediately subject to @respawn_limit,
+ * @respawn_delay_max: largest delay before respawning,
+ * @respawn_stable: time a process must run for to reset its respawn delay,
+ * @respawns: number of times instances have been respawned,
+ * @watchdog_expiries: number of times instances have been killed by the
+ * watchdog,
  * @normalexit: array of exit codes that prevent a respawn,
  * @normalexit_len: length of @normalexit array,
  * @console: how to arrange processes' stdin/out/err file descriptors,
@@ -159,6 +245,16 @@ typedef enum console_type {
  * @nice: process priority,
  * @oom_score_adj: OOM killer score adjustment,
  * @limits: resource limits indexed by resource,
+ * @cpu_weight: relative share of CPU time of the control group, or zero,
+ * @cpu_quota: percentage of a CPU the control group may use, or zero,
+ * @memory_max: memory usage in bytes above which the control group's
+ * processes are killed, or zero,
+ * @memory_high: memory usage in bytes above which the control group is
+ * throttled and reclaimed from, or zero,
+ * @io_weight: relative share of block I/O of the control group, or zero,
+ * @cpu_affinity: list of CPUs processes may run on, may contain variables,
+ * @numa_policy: NUMA memory policy of processes,
+ * @numa_nodes: list of NUMA nodes for @numa_policy, may contain variables,
  * @chroot: root directory of process (implies @chdir if not set),
  * @chdir: working directory of process,
  * @setuid: user name to drop to before starting process,
@@ -166,6 +262,7 @@ typedef enum console_type {
  * @deleted: whether job should be deleted when finished.
  * @usage: usage text - how to control job
  * @apparmor_switch: AppArmor profile to switch to before starting job
+ * @snapshot: cached D-Bus property values, see job_class_snapshot().
  *
  * This structure holds the configuration of a known task or service that
  * should be tracked by the init daemon; as tasks and services are
@@ -200,11 +297,19 @@ typedef struct job_class {
 	time_t          kill_timeout;
 	int             kill_signal;
 
+	time_t          ready_timeout;
+	time_t          watchdog_timeout;
+
 	int             reload_signal;
 
 	int             respawn;
 	int             respawn_limit;
 	time_t          respawn_interval;
+	time_t          respawn_delay_min;
+	time_t          respawn_delay_max;
+	time_t          respawn_stable;
+	uint64_t        respawns;
+	uint64_t        watchdog_expiries;
 
 	int            *normalexit;
 	size_t          normalexit_len;
@@ -215,6 +320,14 @@ typedef struct job_class {
 	int             nice;
 	int             oom_score_adj;
 	struct rlimit  *limits[RLIMIT_NLIMITS];
+	int             cpu_weight;
+	int             cpu_quota;
+	uint64_t        memory_max;
+	uint64_t        memory_high;
+	int             io_weight;
+	char           *cpu_affinity;
+	NumaPolicy      numa_policy;
+	char           *numa_nodes;
 	char           *chroot;
 	char           *chdir;
 	char           *setuid;
@@ -226,6 +339,8 @@ typedef struct job_class {
 	char           *usage;
 
 	char	       *apparmor_switch;
+
+	JobClassSnapshot *snapshot;
 } JobClass;
 
 
@@ -298,6 +413,9 @@ int         job_class_restart              (JobClass *class,
 					    char * const *env, int wait)
 	__attribute__ ((warn_unused_result));
 
+JobClassSnapshot *job_class_snapshot        (JobClass *class)
+	__attribute__ ((warn_unused_result));
+
 int         job_class_get_name             (JobClass *class,
 					    NihDBusMessage *message,
 					    char **name)
@@ -336,6 +454,14 @@ ConsoleType
 job_class_console_type_str_to_enum (const char *name)
 	__attribute__ ((warn_unused_result));
 
+const char *
+job_class_numa_policy_enum_to_str (NumaPolicy policy)
+	__attribute__ ((warn_unused_result));
+
+NumaPolicy
+job_class_numa_policy_str_to_enum (const char *policy)
+	__attribute__ ((warn_unused_result));
+
 const char *
 job_class_expect_type_enum_to_str (ExpectType expect)
 	__attribute__ ((warn_unused_result));
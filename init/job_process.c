@@ -30,12 +30,17 @@
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/ptrace.h>
+#include <sys/wait.h>
 #include <sys/resource.h>
+#include <sys/syscall.h>
 #include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 
 #include <time.h>
 #include <errno.h>
 #include <stdio.h>
+#include <inttypes.h>
 #include <limits.h>
 #include <signal.h>
 #include <stdlib.h>
@@ -68,6 +73,9 @@
 #include "control.h"
 #include "xdg.h"
 #include "apparmor.h"
+#include "cgroup.h"
+#include "timeline.h"
+#include "timer_wheel.h"
 
 
 /**
@@ -131,11 +139,43 @@ int disable_job_logging = 0;
  **/
 int no_inherit_env = FALSE;
 
+/**
+ * P_PIDFD:
+ *
+ * waitid() id type for a pidfd, for C libraries that do not yet
+ * define it.
+ **/
+#ifndef P_PIDFD
+#define P_PIDFD 3
+#endif
+
+/**
+ * use_pidfds:
+ *
+ * If TRUE, watch a pidfd for each process spawned so that its exit is
+ * handled as soon as the main loop wakes, directly for the job that owns
+ * it, rather than after searching every job for its process id.
+ **/
+int use_pidfds = FALSE;
+
+/**
+ * job_process_children:
+ *
+ * Resource usage of all reaped child processes when it was last
+ * accounted for, so that the usage of each can be found as it's reaped.
+ **/
+static struct rusage job_process_children;
+
 /* Prototypes for static functions */
 static void job_process_kill_timer      (Job *job, NihTimer *timer);
+static int  job_process_signal          (Job *job, ProcessType process,
+					 int signal)
+	__attribute__ ((warn_unused_result));
 static void job_process_terminated      (Job *job, ProcessType process,
 					 int status);
 static int  job_process_catch_runaway   (Job *job);
+static time_t job_process_backoff       (Job *job);
+static void job_process_respawn_timer   (Job *job, NihTimer *timer);
 static void job_process_stopped         (Job *job, ProcessType process);
 static void job_process_trace_new       (Job *job, ProcessType process);
 static void job_process_trace_new_child (Job *job, ProcessType process);
@@ -143,12 +183,45 @@ static void job_process_trace_signal    (Job *job, ProcessType process,
 					 int signum);
 static void job_process_trace_fork      (Job *job, ProcessType process);
 static void job_process_trace_exec      (Job *job, ProcessType process);
+static int  job_process_cgroup_follow   (Job *job, ProcessType process,
+					 pid_t pid);
+static int  job_process_cgroup_limits   (Job *job)
+	__attribute__ ((warn_unused_result));
+static char *job_process_expand_list    (const char *list)
+	__attribute__ ((warn_unused_result));
+static void job_process_unwatch         (Job *job, ProcessType process);
+static void job_process_usage           (struct rusage *usage);
+static void job_process_account         (Job *job,
+					 const struct rusage *usage);
+static void job_process_pidfd_ready     (Job *job, NihIoWatch *watch,
+					 NihIoEvents events);
+static char *job_process_notify_open    (const void *parent, Job *job)
+	__attribute__ ((warn_unused_result));
+static void job_process_notify_ready    (Job *job, NihIoWatch *watch,
+					 NihIoEvents events);
+static void job_process_ready_timer     (Job *job, NihTimer *timer);
+static void job_process_watchdog_timer  (Job *job, NihTimer *timer);
 
 extern char         *control_server_address;
 extern int           user_mode;
 extern int           session_end;
 extern time_t        quiesce_phase_time;
 
+/**
+ * job_process_init:
+ *
+ * Record the resource usage of child processes already reaped, so that
+ * the first process reaped is not credited with them; the kernel keeps
+ * this usage across a re-exec.  Must be called before any process is
+ * reaped.
+ **/
+void
+job_process_init (void)
+{
+	if (getrusage (RUSAGE_CHILDREN, &job_process_children) < 0)
+		memset (&job_process_children, 0, sizeof (struct rusage));
+}
+
 /**
  * job_process_run:
  * @job: job context for process to be run in,
@@ -193,6 +266,7 @@ job_process_run (Job         *job,
 	size_t           argc, envc;
 	int              fds[2] = { -1, -1 };
 	int              error = FALSE, trace = FALSE, shell = FALSE;
+	uint64_t         spawn_time;
 
 	nih_assert (job != NULL);
 
@@ -296,12 +370,82 @@ job_process_run (Job         *job,
 
 	/* If we're about to spawn the main job and we expect it to become
 	 * a daemon or fork before we can move out of spawned, we need to
-	 * set a trace on it.
+	 * follow it; we do so by placing it in a control group of its own
+	 * where we can, and otherwise we need to set a trace on it.  Jobs
+	 * with resource limits also need a control group of their own to
+	 * apply them to.
 	 */
-	if ((process == PROCESS_MAIN)
-	    && ((job->class->expect == EXPECT_DAEMON)
-		|| (job->class->expect == EXPECT_FORK)))
-		trace = TRUE;
+	if (process == PROCESS_MAIN) {
+		int follow = ((job->class->expect == EXPECT_DAEMON)
+			      || (job->class->expect == EXPECT_FORK));
+
+		if (cgroup_root && (! job->cgroup)
+		    && (follow || JOB_CLASS_CGROUP_LIMITED (job->class))) {
+			job->cgroup = NIH_MUST (cgroup_path (job,
+							     job->class->name,
+							     job->name));
+
+			if ((cgroup_create (job->cgroup) < 0)
+			    || (job_process_cgroup_limits (job) < 0)) {
+				NihError *err;
+
+				err = nih_error_get ();
+				nih_warn (_("Failed to create control group for %s: %s"),
+					  job_name (job), err->message);
+				nih_free (err);
+
+				cgroup_remove (job->cgroup);
+
+				nih_free (job->cgroup);
+				job->cgroup = NULL;
+			}
+		} else if (JOB_CLASS_CGROUP_LIMITED (job->class)
+			   && (! cgroup_root)) {
+			nih_warn (_("Control groups not available, "
+				    "resource limits of %s not applied"),
+				  job_name (job));
+		}
+
+		if (follow && (! job->cgroup))
+			trace = TRUE;
+
+		/* Jobs that notify us when they're ready, or that they're
+		 * still alive, are told where to by the environment.
+		 */
+		if ((job->class->expect == EXPECT_NOTIFY)
+		    || job->class->watchdog_timeout) {
+			nih_local char *address = NULL;
+
+			address = job_process_notify_open (NULL, job);
+			if (! address) {
+				NihError *err;
+
+				err = nih_error_get ();
+				nih_warn (_("Failed to create notification socket "
+					    "for %s: %s"),
+					  job_name (job), err->message);
+				nih_free (err);
+
+				if (shell) {
+					close (fds[0]);
+					close (fds[1]);
+				}
+
+				return -1;
+			}
+
+			NIH_MUST (environ_set (&env, NULL, &envc, TRUE,
+					       "NOTIFY_SOCKET=%s", address));
+
+			if (job->class->watchdog_timeout)
+				NIH_MUST (environ_set (&env, NULL, &envc, TRUE,
+						       "WATCHDOG_USEC=%" PRIu64,
+						       (uint64_t)job->class->watchdog_timeout
+						       * 1000000));
+		}
+	}
+
+	spawn_time = timeline_now ();
 
 	/* Spawn the process, repeat until fork() works */
 	while ((job->pid[process] = job_process_spawn (job, argv, env,
@@ -321,6 +465,9 @@ job_process_run (Job         *job,
 
 			job->pid[process] = 0;
 
+			if (process == PROCESS_MAIN)
+				job_process_notify_close (job);
+
 			/* Return non-temporary error condition */
 			nih_warn (_("Failed to spawn %s %s process: %s"),
 				  job_name (job), process_name (process),
@@ -338,8 +485,33 @@ job_process_run (Job         *job,
 	nih_info (_("%s %s process (%d)"),
 		  job_name (job), process_name (process), job->pid[process]);
 
+	job_process_watch (job, process);
+
+	/* Record how long it took to get from starting to spawning the
+	 * main process, and for that process to exec.
+	 */
+	if (process == PROCESS_MAIN) {
+		uint64_t now = timeline_now ();
+
+		if (job->stats.starting_time && spawn_time)
+			job->stats.start_usec = (spawn_time
+						 - job->stats.starting_time);
+		if (spawn_time)
+			job->stats.exec_usec = now - spawn_time;
+
+		job->stats.spawned_time = now;
+	}
+
 	job->trace_forks = 0;
-	job->trace_state = trace ? TRACE_NEW : TRACE_NONE;
+	if (trace) {
+		job->trace_state = TRACE_NEW;
+	} else if ((process == PROCESS_MAIN) && job->cgroup
+		   && ((job->class->expect == EXPECT_DAEMON)
+		       || (job->class->expect == EXPECT_FORK))) {
+		job->trace_state = TRACE_CGROUP;
+	} else {
+		job->trace_state = TRACE_NONE;
+	}
 
 	/* Feed the script to the child process */
 	if (shell) {
@@ -655,6 +827,16 @@ job_process_spawn (Job          *job,
 	 */
 	setsid ();
 
+	/* Join the job's control group before anything else is run, so that
+	 * every process the main process creates can be found later.
+	 */
+	if ((process == PROCESS_MAIN) && job->cgroup) {
+		if (cgroup_enter (job->cgroup, 0) < 0) {
+			job_process_error_abort (fds[1],
+						 JOB_PROCESS_ERROR_CGROUP, 0);
+		}
+	}
+
 	/* Set the process environment from the function parameters. */
 	environ = (char **)env;
 
@@ -773,6 +955,34 @@ job_process_spawn (Job          *job,
 			}
 		}
 
+		/* Restrict the process to the CPUs and NUMA nodes given, which
+		 * may reference the environment so that instances can be
+		 * spread across them.
+		 */
+		if (class->cpu_affinity) {
+			nih_local char *cpus = NULL;
+
+			cpus = job_process_expand_list (class->cpu_affinity);
+			if ((! cpus) || (system_set_affinity (cpus) < 0))
+				job_process_error_abort (fds[1],
+							 JOB_PROCESS_ERROR_AFFINITY, 0);
+		}
+
+		if (class->numa_policy != NUMA_DEFAULT) {
+			nih_local char *nodes = NULL;
+
+			if (class->numa_nodes) {
+				nodes = job_process_expand_list (class->numa_nodes);
+				if (! nodes)
+					job_process_error_abort (fds[1],
+								 JOB_PROCESS_ERROR_NUMA, 0);
+			}
+
+			if (system_set_mempolicy (class->numa_policy, nodes) < 0)
+				job_process_error_abort (fds[1],
+							 JOB_PROCESS_ERROR_NUMA, 0);
+		}
+
 		/* Handle changing a chroot session job prior to dealing with
 		 * the 'chroot' stanza.
 		 */
@@ -946,6 +1156,38 @@ job_process_spawn (Job          *job,
 }
 
 
+/**
+ * job_process_expand_list:
+ * @list: list of CPUs or NUMA nodes.
+ *
+ * Expands any variables in @list from the environment of the process
+ * being spawned.  Since this is called after forking, failures to
+ * expand are raised as EINVAL so that they can be passed back to the
+ * parent.
+ *
+ * Returns: newly allocated string or NULL on raised error.
+ **/
+static char *
+job_process_expand_list (const char *list)
+{
+	char *expanded;
+
+	nih_assert (list != NULL);
+
+	expanded = NIH_SHOULD (environ_expand (NULL, list, environ));
+	if (! expanded) {
+		NihError *err;
+
+		err = nih_error_get ();
+		nih_free (err);
+
+		errno = EINVAL;
+		nih_error_raise_system ();
+	}
+
+	return expanded;
+}
+
 /**
  * job_process_error_abort:
  * @fd: writing end of pipe,
@@ -1125,6 +1367,21 @@ job_process_error_read (int fd)
 				  err, _("unable to set trace: %s"),
 				  strerror (err->errnum)));
 		break;
+	case JOB_PROCESS_ERROR_CGROUP:
+		err->error.message = NIH_MUST (nih_sprintf (
+				  err, _("unable to join control group: %s"),
+				  strerror (err->errnum)));
+		break;
+	case JOB_PROCESS_ERROR_AFFINITY:
+		err->error.message = NIH_MUST (nih_sprintf (
+				  err, _("unable to set CPU affinity: %s"),
+				  strerror (err->errnum)));
+		break;
+	case JOB_PROCESS_ERROR_NUMA:
+		err->error.message = NIH_MUST (nih_sprintf (
+				  err, _("unable to set NUMA policy: %s"),
+				  strerror (err->errnum)));
+		break;
 	case JOB_PROCESS_ERROR_EXEC:
 		err->error.message = NIH_MUST (nih_sprintf (
 				  err, _("unable to execute: %s"),
@@ -1238,14 +1495,20 @@ job_process_kill (Job         *job,
 {
 	nih_assert (job != NULL);
 	nih_assert (job->pid[process] > 0);
-	nih_assert (job->kill_timer == NULL);
+
+	/* The process may already be being killed by its watchdog */
+	if (job->kill_timer) {
+		nih_assert (job->kill_process == process);
+		return;
+	}
+
 	nih_assert (job->kill_process == PROCESS_INVALID);
 
 	nih_info (_("Sending %s signal to %s %s process (%d)"),
 		  nih_signal_to_name (job->class->kill_signal),
 		  job_name (job), process_name (process), job->pid[process]);
 
-	if (system_kill (job->pid[process], job->class->kill_signal) < 0) {
+	if (job_process_signal (job, process, job->class->kill_signal) < 0) {
 		NihError *err;
 
 		err = nih_error_get ();
@@ -1262,6 +1525,48 @@ job_process_kill (Job         *job,
 	job_process_set_kill_timer (job, process, job->class->kill_timeout);
 }
 
+/**
+ * job_process_signal:
+ * @job: job to signal process of,
+ * @process: process to be signalled,
+ * @signal: signal to send.
+ *
+ * Sends @signal to @process of @job, and its process group.  When the
+ * main process is followed by its control group, every process in that
+ * control group is sent @signal instead so that none are left behind,
+ * falling back to the process group if that fails.  When @process is
+ * watched through a pidfd, that is used to make sure its process id has
+ * not been reused.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+static int
+job_process_signal (Job         *job,
+		    ProcessType  process,
+		    int          signal)
+{
+	nih_assert (job != NULL);
+	nih_assert (job->pid[process] > 0);
+
+	if ((process == PROCESS_MAIN) && job->cgroup) {
+		NihError *err;
+
+		if (cgroup_kill (job->cgroup, signal) == 0)
+			return 0;
+
+		err = nih_error_get ();
+		nih_debug ("Failed to signal control group %s: %s",
+			   job->cgroup, err->message);
+		nih_free (err);
+	}
+
+	if (job->pidfd[process])
+		return system_pidfd_kill (job->pidfd[process]->fd,
+					  job->pid[process], signal);
+
+	return system_kill (job->pid[process], signal);
+}
+
 /**
  * job_process_jobs_running:
  *
@@ -1334,7 +1639,7 @@ job_process_set_kill_timer (Job          *job,
 	nih_assert (timeout);
 
 	job->kill_process = process;
-	job->kill_timer = NIH_MUST (nih_timer_add_timeout (
+	job->kill_timer = NIH_MUST (timer_wheel_add (
 			  job, timeout,
 			  (NihTimerCb)job_process_kill_timer, job));
 }
@@ -1354,7 +1659,7 @@ job_process_adj_kill_timer (Job *job, time_t due)
 	nih_assert (job->kill_timer);
 	nih_assert (due);
 
-	job->kill_timer->due = due;
+	timer_wheel_adjust (job->kill_timer, due);
 }
 
 /**
@@ -1387,7 +1692,7 @@ job_process_kill_timer (Job      *job,
 		  "KILL",
 		  job_name (job), process_name (process), job->pid[process]);
 
-	if (system_kill (job->pid[process], SIGKILL) < 0) {
+	if (job_process_signal (job, process, SIGKILL) < 0) {
 		NihError *err;
 
 		err = nih_error_get ();
@@ -1421,13 +1726,24 @@ job_process_handler (void           *data,
 		     NihChildEvents  event,
 		     int             status)
 {
-	Job         *job;
-	ProcessType  process;
-	NihLogLevel  priority;
-	const char  *sig;
+	Job           *job;
+	ProcessType    process;
+	NihLogLevel    priority;
+	const char    *sig;
+	struct rusage  usage;
+	int            reaped;
 
 	nih_assert (pid > 0);
 
+	/* Work out the resources used by a process that has been reaped
+	 * before anything else is, whether or not it belongs to a job.
+	 */
+	reaped = ((event == NIH_CHILD_EXITED)
+		  || (event == NIH_CHILD_KILLED)
+		  || (event == NIH_CHILD_DUMPED));
+	if (reaped)
+		job_process_usage (&usage);
+
 	/* Find the job that an event ocurred for, and identify which of the
 	 * job's process it was.  If we don't know about it, then we simply
 	 * ignore the event.
@@ -1436,6 +1752,9 @@ job_process_handler (void           *data,
 	if (! job)
 		return;
 
+	if (reaped)
+		job_process_account (job, &usage);
+
 	/* Check the job's normal exit clauses to see whether this is a failure
 	 * worth warning about.
 	 */
@@ -1460,6 +1779,12 @@ job_process_handler (void           *data,
 		} else {
 			nih_info (_("%s %s process (%d) exited normally"),
 				  job_name (job), process_name (process), pid);
+
+			/* Processes followed by their control group are
+			 * expected to exit leaving their child behind.
+			 */
+			if (job_process_cgroup_follow (job, process, pid))
+				break;
 		}
 
 		job_process_terminated (job, process, status);
@@ -1556,6 +1881,568 @@ job_process_handler (void           *data,
 }
 
 
+/**
+ * job_process_watch:
+ * @job: job that spawned process,
+ * @process: specific process.
+ *
+ * Opens a pidfd for @process of @job and adds it to the main loop when
+ * use_pidfds is TRUE, so that job_process_pidfd_ready() reaps it when it
+ * exits.  Should that not be possible, the process is left to the
+ * SIGCHLD handler as usual.
+ **/
+void
+job_process_watch (Job         *job,
+		   ProcessType  process)
+{
+	NihIoWatch *watch;
+	int         fd;
+
+	nih_assert (job != NULL);
+	nih_assert (job->pid[process] > 0);
+	nih_assert (job->pidfd[process] == NULL);
+
+	if (! use_pidfds)
+		return;
+
+	fd = system_pidfd_open (job->pid[process]);
+	if (fd < 0) {
+		NihError *err;
+
+		err = nih_error_get ();
+		nih_debug ("Failed to open pidfd for %s %s process (%d): %s",
+			   job_name (job), process_name (process),
+			   job->pid[process], err->message);
+		nih_free (err);
+
+		return;
+	}
+
+	watch = nih_io_add_watch (job, fd, NIH_IO_READ,
+				  (NihIoWatcher)job_process_pidfd_ready, job);
+	if (! watch) {
+		nih_free (nih_error_get ());
+		close (fd);
+		return;
+	}
+
+	job->pidfd[process] = watch;
+}
+
+/**
+ * job_process_unwatch:
+ * @job: job that spawned process,
+ * @process: specific process.
+ *
+ * Removes the watch on the pidfd for @process of @job, if any, and
+ * closes it.
+ **/
+static void
+job_process_unwatch (Job         *job,
+		     ProcessType  process)
+{
+	nih_assert (job != NULL);
+
+	if (! job->pidfd[process])
+		return;
+
+	close (job->pidfd[process]->fd);
+	nih_free (job->pidfd[process]);
+	job->pidfd[process] = NULL;
+}
+
+/**
+ * job_process_pidfd_ready:
+ * @job: job that spawned process,
+ * @watch: watch on pidfd of process,
+ * @events: events that occurred.
+ *
+ * This callback is called by the main loop when the pidfd of a process of
+ * @job becomes readable because the process has terminated; it reaps the
+ * process and handles its termination with job_process_handler() without
+ * waiting for SIGCHLD.  Exits of many processes are therefore all handled
+ * in the same iteration of the main loop.
+ *
+ * Stops and ptrace events are not reported through a pidfd and continue
+ * to be handled by the SIGCHLD handler, which may also reap the process
+ * first, in which case this does nothing.
+ **/
+static void
+job_process_pidfd_ready (Job         *job,
+			 NihIoWatch  *watch,
+			 NihIoEvents  events)
+{
+	ProcessType    process;
+	NihChildEvents event;
+	siginfo_t      info;
+	struct rusage  usage;
+
+	nih_assert (job != NULL);
+	nih_assert (watch != NULL);
+
+	for (process = 0; process < PROCESS_LAST; process++)
+		if (job->pidfd[process] == watch)
+			break;
+
+	nih_assert (process < PROCESS_LAST);
+
+	/* The system call, unlike the C library function, also returns the
+	 * resource usage of the process reaped.
+	 */
+	memset (&info, 0, sizeof (info));
+	memset (&usage, 0, sizeof (usage));
+	if (syscall (SYS_waitid, P_PIDFD, watch->fd, &info,
+		     WEXITED | WNOHANG, &usage) < 0) {
+		/* Already reaped elsewhere, so it can't be ours */
+		if (errno == ECHILD)
+			job_process_unwatch (job, process);
+
+		return;
+	}
+
+	switch (info.si_code) {
+	case CLD_EXITED:
+		event = NIH_CHILD_EXITED;
+		break;
+	case CLD_KILLED:
+		event = NIH_CHILD_KILLED;
+		break;
+	case CLD_DUMPED:
+		event = NIH_CHILD_DUMPED;
+		break;
+	default:
+		return;
+	}
+
+	if (info.si_pid != job->pid[process])
+		return;
+
+	/* Account for the exact usage, leaving nothing more for the
+	 * handler to find.
+	 */
+	job_process_account (job, &usage);
+	job_process_usage (&usage);
+
+	job_process_handler (NULL, info.si_pid, event, info.si_status);
+}
+
+
+/**
+ * job_process_notify_open:
+ * @parent: parent object for new string,
+ * @job: job to be notified.
+ *
+ * Creates a datagram socket on which the main process of @job may notify
+ * us that it is ready or still alive, binding it to a unique address in
+ * the abstract namespace chosen by the kernel, and watches it together
+ * with timers for the class's ready and watchdog timeouts.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned string.  When all parents
+ * of the returned string are freed, the returned string will also be
+ * freed.
+ *
+ * Returns: newly allocated address of socket in the form expected in
+ * NOTIFY_SOCKET, or NULL on raised error.
+ **/
+static char *
+job_process_notify_open (const void *parent,
+			 Job        *job)
+{
+	struct sockaddr_un addr;
+	socklen_t          addrlen;
+	int                sock, opt = 1;
+	char              *address;
+
+	nih_assert (job != NULL);
+	nih_assert (job->notify == NULL);
+
+	sock = socket (AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+	if (sock < 0)
+		nih_return_system_error (NULL);
+
+	/* Binding just the family asks the kernel for a unique abstract
+	 * address, which we then need to look up.
+	 */
+	memset (&addr, 0, sizeof (addr));
+	addr.sun_family = AF_UNIX;
+
+	if ((setsockopt (sock, SOL_SOCKET, SO_PASSCRED,
+			 &opt, sizeof (opt)) < 0)
+	    || (bind (sock, (struct sockaddr *)&addr,
+		      sizeof (sa_family_t)) < 0))
+		goto error;
+
+	addrlen = sizeof (addr);
+	if (getsockname (sock, (struct sockaddr *)&addr, &addrlen) < 0)
+		goto error;
+
+	address = NIH_MUST (nih_sprintf (parent, "@%.*s",
+					 (int)(addrlen - sizeof (sa_family_t) - 1),
+					 addr.sun_path + 1));
+
+	job_process_notify_watch (job, sock);
+
+	if ((job->class->expect == EXPECT_NOTIFY) && job->class->ready_timeout)
+		job_process_set_ready_timer (job, job->class->ready_timeout);
+
+	if (job->class->watchdog_timeout)
+		job_process_set_watchdog_timer (job,
+						job->class->watchdog_timeout);
+
+	return address;
+
+error:
+	nih_error_raise_system ();
+	close (sock);
+	return NULL;
+}
+
+/**
+ * job_process_notify_watch:
+ * @job: job to be notified,
+ * @fd: socket to watch.
+ *
+ * Adds @fd to the main loop so that job_process_notify_ready() receives
+ * the notifications sent to it by the main process of @job.
+ **/
+void
+job_process_notify_watch (Job *job,
+			  int  fd)
+{
+	nih_assert (job != NULL);
+	nih_assert (job->notify == NULL);
+	nih_assert (fd >= 0);
+
+	job->notify = NIH_MUST (nih_io_add_watch (
+			  job, fd, NIH_IO_READ,
+			  (NihIoWatcher)job_process_notify_ready, job));
+}
+
+/**
+ * job_process_notify_close:
+ * @job: job being notified.
+ *
+ * Cancels the ready timer of @job, if any; called once the job has moved
+ * on from the spawned state and again once its main process has gone.
+ * Unless the main process is still being supervised by a watchdog, the
+ * notification socket is closed and the watchdog timer cancelled too.
+ **/
+void
+job_process_notify_close (Job *job)
+{
+	nih_assert (job != NULL);
+
+	if (job->ready_timer) {
+		nih_unref (job->ready_timer, job);
+		job->ready_timer = NULL;
+	}
+
+	if (job->class->watchdog_timeout && (job->pid[PROCESS_MAIN] > 0))
+		return;
+
+	if (job->notify) {
+		close (job->notify->fd);
+		nih_free (job->notify);
+		job->notify = NULL;
+	}
+
+	if (job->watchdog_timer) {
+		nih_unref (job->watchdog_timer, job);
+		job->watchdog_timer = NULL;
+	}
+}
+
+/**
+ * job_process_notify_ready:
+ * @job: job being notified,
+ * @watch: watch on notification socket,
+ * @events: events that occurred.
+ *
+ * This callback is called by the main loop when notifications have been
+ * sent to the socket of @job.  Each is a set of newline-separated
+ * assignments compatible with sd_notify(3); once the main process sends
+ * READY=1 it has finished initialising, so we move the job out of the
+ * spawned state, and whenever it sends WATCHDOG=1 it is still alive, so
+ * we restart its watchdog timer.  Other assignments, and notifications
+ * from any other process, are ignored.
+ **/
+static void
+job_process_notify_ready (Job         *job,
+			  NihIoWatch  *watch,
+			  NihIoEvents  events)
+{
+	char buf[4096];
+	int  ready = FALSE;
+	union {
+		struct cmsghdr cmsg;
+		char           buf[CMSG_SPACE (sizeof (struct ucred))];
+	} control;
+
+	nih_assert (job != NULL);
+	nih_assert (watch != NULL);
+	nih_assert (job->notify == watch);
+
+	for (;;) {
+		struct iovec    iov;
+		struct msghdr   msg;
+		struct cmsghdr *cmsg;
+		struct ucred   *cred = NULL;
+		ssize_t         len;
+		char           *line, *ptr;
+
+		iov.iov_base = buf;
+		iov.iov_len = sizeof (buf) - 1;
+
+		memset (&msg, 0, sizeof (msg));
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = &control;
+		msg.msg_controllen = sizeof (control);
+
+		len = recvmsg (watch->fd, &msg, MSG_DONTWAIT | MSG_TRUNC);
+		if (len < 0) {
+			if (errno == EINTR)
+				continue;
+
+			break;
+		}
+
+		for (cmsg = CMSG_FIRSTHDR (&msg); cmsg;
+		     cmsg = CMSG_NXTHDR (&msg, cmsg))
+			if ((cmsg->cmsg_level == SOL_SOCKET)
+			    && (cmsg->cmsg_type == SCM_CREDENTIALS))
+				cred = (struct ucred *)CMSG_DATA (cmsg);
+
+		if ((! cred) || (cred->pid != job->pid[PROCESS_MAIN])) {
+			nih_debug ("Ignored notification for %s from %d",
+				   job_name (job), cred ? cred->pid : -1);
+			continue;
+		}
+
+		if ((size_t)len >= sizeof (buf))
+			len = sizeof (buf) - 1;
+		buf[len] = '\0';
+
+		for (line = strtok_r (buf, "\n", &ptr); line;
+		     line = strtok_r (NULL, "\n", &ptr))
+			if (! strcmp (line, "READY=1")) {
+				ready = TRUE;
+			} else if ((! strcmp (line, "WATCHDOG=1"))
+				   && job->watchdog_timer) {
+				NihTimer *timer = job->watchdog_timer;
+
+				timer->timeout = job->class->watchdog_timeout;
+				timer_wheel_adjust (timer, (timer_wheel_now ()
+							    + timer->timeout));
+			}
+	}
+
+	if (ready && (job->state == JOB_SPAWNED)) {
+		nih_info (_("%s %s process (%d) is ready"),
+			  job_name (job), process_name (PROCESS_MAIN),
+			  job->pid[PROCESS_MAIN]);
+
+		job_change_state (job, job_next_state (job));
+	}
+}
+
+/**
+ * job_process_set_ready_timer:
+ * @job: job to set ready timer for,
+ * @timeout: timeout to apply for timer.
+ *
+ * Set ready timer for @job with timeout @timeout; should the main process
+ * not have notified us that it is ready by the time it expires, the job
+ * is stopped.
+ **/
+void
+job_process_set_ready_timer (Job    *job,
+			     time_t  timeout)
+{
+	nih_assert (job != NULL);
+	nih_assert (job->ready_timer == NULL);
+
+	job->ready_timer = NIH_MUST (timer_wheel_add (
+			  job, timeout,
+			  (NihTimerCb)job_process_ready_timer, job));
+}
+
+/**
+ * job_process_ready_timer:
+ * @job: job waiting to be notified,
+ * @timer: timer that caused us to be called.
+ *
+ * This callback is called if the main process of @job has not notified
+ * us that it is ready within the class's ready timeout; the job is marked
+ * as failed and stopped, which kills the process.
+ **/
+static void
+job_process_ready_timer (Job      *job,
+			 NihTimer *timer)
+{
+	nih_assert (job != NULL);
+	nih_assert (timer != NULL);
+	nih_assert (job->ready_timer == timer);
+
+	job->ready_timer = NULL;
+
+	if (job->state != JOB_SPAWNED)
+		return;
+
+	nih_warn (_("%s %s process (%d) not ready after %ld seconds, stopping"),
+		  job_name (job), process_name (PROCESS_MAIN),
+		  job->pid[PROCESS_MAIN], (long)job->class->ready_timeout);
+
+	job_failed (job, PROCESS_MAIN, -1);
+	job_change_goal (job, JOB_STOP);
+	job_change_state (job, job_next_state (job));
+}
+
+/**
+ * job_process_set_watchdog_timer:
+ * @job: job to set watchdog timer for,
+ * @timeout: timeout to apply for timer.
+ *
+ * Set watchdog timer for @job with timeout @timeout; should the main
+ * process not have notified us that it is still alive by the time it
+ * expires, the process is killed.
+ **/
+void
+job_process_set_watchdog_timer (Job    *job,
+				time_t  timeout)
+{
+	nih_assert (job != NULL);
+	nih_assert (job->watchdog_timer == NULL);
+
+	job->watchdog_timer = NIH_MUST (timer_wheel_add (
+			  job, timeout,
+			  (NihTimerCb)job_process_watchdog_timer, job));
+}
+
+/**
+ * job_process_watchdog_timer:
+ * @job: job being supervised,
+ * @timer: timer that caused us to be called.
+ *
+ * This callback is called if the main process of @job has not notified
+ * us that it is still alive within the class's watchdog timeout, so is
+ * presumed to have hung.  We send it the ABRT signal, so that it leaves
+ * a core behind, following up with the KILL signal after the class's
+ * kill timeout should that not be enough.  Its termination is then
+ * handled as a failure like any other, respawning the job if it should
+ * be.
+ **/
+static void
+job_process_watchdog_timer (Job      *job,
+			    NihTimer *timer)
+{
+	nih_assert (job != NULL);
+	nih_assert (timer != NULL);
+	nih_assert (job->watchdog_timer == timer);
+
+	job->watchdog_timer = NULL;
+
+	/* Nothing to do if the process has gone, or is already being
+	 * stopped.
+	 */
+	if ((job->pid[PROCESS_MAIN] <= 0) || (job->goal != JOB_START)
+	    || ((job->state != JOB_SPAWNED)
+		&& (job->state != JOB_POST_START)
+		&& (job->state != JOB_RUNNING)))
+		return;
+
+	nih_warn (_("%s %s process (%d) watchdog timeout, killing"),
+		  job_name (job), process_name (PROCESS_MAIN),
+		  job->pid[PROCESS_MAIN]);
+
+	job->class->watchdog_expiries++;
+
+	if (job_process_signal (job, PROCESS_MAIN, SIGABRT) < 0) {
+		NihError *err;
+
+		err = nih_error_get ();
+		if (err->number != ESRCH)
+			nih_warn (_("Failed to send %s signal to %s %s process (%d): %s"),
+				  "ABRT",
+				  job_name (job), process_name (PROCESS_MAIN),
+				  job->pid[PROCESS_MAIN], err->message);
+		nih_free (err);
+
+		return;
+	}
+
+	if (! job->kill_timer)
+		job_process_set_kill_timer (job, PROCESS_MAIN,
+					    job->class->kill_timeout);
+}
+
+
+/**
+ * job_process_usage:
+ * @usage: resource usage to fill in.
+ *
+ * Fills @usage with the resources used by child processes reaped since
+ * this was last called; called whenever a process is reaped, this is the
+ * usage of that process.  The kernel only keeps the largest maximum
+ * resident set size of any child, so that is only set when the process
+ * reaped exceeded all before it.
+ **/
+static void
+job_process_usage (struct rusage *usage)
+{
+	struct rusage now;
+
+	nih_assert (usage != NULL);
+
+	memset (usage, 0, sizeof (struct rusage));
+
+	if (getrusage (RUSAGE_CHILDREN, &now) < 0)
+		return;
+
+	timersub (&now.ru_utime, &job_process_children.ru_utime,
+		  &usage->ru_utime);
+	timersub (&now.ru_stime, &job_process_children.ru_stime,
+		  &usage->ru_stime);
+
+	usage->ru_inblock = now.ru_inblock - job_process_children.ru_inblock;
+	usage->ru_oublock = now.ru_oublock - job_process_children.ru_oublock;
+
+	if (now.ru_maxrss > job_process_children.ru_maxrss)
+		usage->ru_maxrss = now.ru_maxrss;
+
+	job_process_children = now;
+}
+
+/**
+ * job_process_account:
+ * @job: job that owned process,
+ * @usage: resources used by process.
+ *
+ * Adds the resources used by a reaped process of @job given in @usage
+ * to the running totals of @job.
+ **/
+static void
+job_process_account (Job                 *job,
+		     const struct rusage *usage)
+{
+	nih_assert (job != NULL);
+	nih_assert (usage != NULL);
+
+	job->stats.cpu_usec += ((uint64_t)usage->ru_utime.tv_sec * 1000000
+				+ usage->ru_utime.tv_usec
+				+ (uint64_t)usage->ru_stime.tv_sec * 1000000
+				+ usage->ru_stime.tv_usec);
+
+	if ((uint64_t)usage->ru_maxrss > job->stats.max_rss_kb)
+		job->stats.max_rss_kb = usage->ru_maxrss;
+
+	/* Block I/O is counted in 512-byte units */
+	job->stats.io_read_bytes += (uint64_t)usage->ru_inblock * 512;
+	job->stats.io_write_bytes += (uint64_t)usage->ru_oublock * 512;
+}
+
+
 /**
  * job_process_terminated:
  * @job: job that changed,
@@ -1647,17 +2534,30 @@ job_process_terminated (Job         *job,
 			 * the job isn't running away first though.
 			 */
 			if (failed && job->class->respawn && ! disable_respawn) {
-				if (job_process_catch_runaway (job)) {
+				if ((! job->class->respawn_delay_min)
+				    && job_process_catch_runaway (job)) {
 					nih_warn (_("%s respawning too fast, stopped"),
 						  job_name (job));
 
 					failed = FALSE;
 					job_failed (job, PROCESS_INVALID, 0);
 				} else {
-					nih_warn (_("%s %s process ended, respawning"),
-						  job_name (job),
-						  process_name (process));
+					if (job->class->respawn_delay_min) {
+						time_t delay;
+
+						delay = job_process_backoff (job);
+						nih_warn (_("%s %s process ended, "
+							    "respawning in %ld seconds"),
+							  job_name (job),
+							  process_name (process),
+							  (long)delay);
+					} else {
+						nih_warn (_("%s %s process ended, respawning"),
+							  job_name (job),
+							  process_name (process));
+					}
 					failed = FALSE;
+					job->class->respawns++;
 
 					/* If we're not going to change the
 					 * state because there's a post-start
@@ -1803,8 +2703,23 @@ job_process_terminated (Job         *job,
 	endutxent();
 
 	/* Clear the process pid field */
+	job_process_unwatch (job, process);
 	job->pid[process] = 0;
 
+	/* Remove the control group once the main process has gone, unless
+	 * it left processes behind in which case it's reused next time.
+	 */
+	if ((process == PROCESS_MAIN) && job->cgroup) {
+		cgroup_remove (job->cgroup);
+
+		nih_free (job->cgroup);
+		job->cgroup = NULL;
+	}
+
+	/* Nothing is left to notify us once the main process has gone */
+	if (process == PROCESS_MAIN)
+		job_process_notify_close (job);
+
 
 	/* Mark the job as failed */
 	if (failed)
@@ -1867,6 +2782,103 @@ job_process_catch_runaway (Job *job)
 }
 
 
+/**
+ * job_process_backoff:
+ * @job: job being respawned.
+ *
+ * This function is called instead of job_process_catch_runaway() when
+ * the main process of a job with a respawn delay fails, and sets a timer
+ * so that the job is only respawned once the delay has passed.
+ *
+ * The delay starts at the class's minimum and doubles each time the
+ * process fails again, up to its maximum, so that a job in a crash loop
+ * costs a bounded amount of CPU without being stopped; once a process
+ * has run for the stable period, it starts again from the minimum.  Up
+ * to a quarter of the delay is added again at random so that jobs which
+ * failed together are not all respawned together.
+ *
+ * Returns: delay in seconds.
+ **/
+static time_t
+job_process_backoff (Job *job)
+{
+	JobClass *class;
+	time_t    delay;
+
+	nih_assert (job != NULL);
+	nih_assert (job->respawn_timer == NULL);
+
+	class = job->class;
+	nih_assert (class->respawn_delay_min > 0);
+
+	if (job->stats.spawned_time
+	    && ((timeline_now () - job->stats.spawned_time)
+		>= (uint64_t)class->respawn_stable * 1000000))
+		job->respawn_delay = 0;
+
+	if (! job->respawn_delay) {
+		delay = class->respawn_delay_min;
+	} else if (job->respawn_delay > class->respawn_delay_max / 2) {
+		delay = class->respawn_delay_max;
+	} else {
+		delay = job->respawn_delay * 2;
+	}
+
+	job->respawn_delay = delay;
+
+	delay += random () % (delay / 4 + 1);
+
+	job_process_set_respawn_timer (job, delay);
+
+	return delay;
+}
+
+/**
+ * job_process_set_respawn_timer:
+ * @job: job to set respawn timer for,
+ * @timeout: timeout to apply for timer.
+ *
+ * Set respawn timer for @job with timeout @timeout; until it expires the
+ * job will not leave the post-stop state to be started again.
+ **/
+void
+job_process_set_respawn_timer (Job    *job,
+			       time_t  timeout)
+{
+	nih_assert (job);
+
+	job->respawn_timer = NIH_MUST (timer_wheel_add (
+			  job, timeout,
+			  (NihTimerCb)job_process_respawn_timer, job));
+}
+
+/**
+ * job_process_respawn_timer:
+ * @job: job to respawn,
+ * @timer: timer that caused us to be called.
+ *
+ * This callback is called once the respawn delay of @job has passed.  If
+ * the job has reached the post-stop state and has no post-stop process
+ * still running, it is moved on to be started again (or to waiting, if
+ * it has since been stopped); otherwise it will move on as normal once
+ * it gets there.
+ **/
+static void
+job_process_respawn_timer (Job      *job,
+			   NihTimer *timer)
+{
+	nih_assert (job != NULL);
+	nih_assert (timer != NULL);
+	nih_assert (job->respawn_timer == timer);
+
+	job->respawn_timer = NULL;
+
+	if ((job->state == JOB_POST_STOP)
+	    && (job->pid[PROCESS_POST_STOP] <= 0))
+		job_change_state (job, job_next_state (job));
+}
+
+
 /**
  * job_process_stopped:
  * @job: job that changed,
@@ -1900,6 +2912,162 @@ job_process_stopped (Job         *job,
 }
 
 
+/**
+ * job_process_cgroup_follow:
+ * @job: job that changed,
+ * @process: specific process,
+ * @pid: process that exited.
+ *
+ * This function is called whenever a @process attached to @job exits
+ * normally; when the main process is being followed by its control group
+ * we expect it to have forked, and the child to have been re-parented
+ * to us, so we look for that child in the control group and supervise
+ * it instead.
+ *
+ * By the time we reap @pid any number of forks may already have
+ * happened, so rather than count them we look at the process found: a
+ * forking job is ready once the spawned process has left a child, while
+ * a daemon is only ready once the process found has been detached into
+ * a session of its own by an intermediate child, as the second fork of
+ * a daemon is.  Otherwise that intermediate child is followed in turn
+ * when it exits, after which the job is ready whatever it left behind.
+ *
+ * Processes are only followed while the job is spawned; once it has
+ * moved on, the main process exiting is its termination even if it
+ * left other processes behind.
+ *
+ * Returns: TRUE if @job has a new main process, FALSE if @pid should
+ * be treated as having terminated.
+ **/
+static int
+job_process_cgroup_follow (Job         *job,
+			   ProcessType  process,
+			   pid_t        pid)
+{
+	pid_t child = 0;
+	pid_t sid;
+	int   found;
+	int   ready;
+
+	nih_assert (job != NULL);
+
+	if ((process != PROCESS_MAIN) || (job->state != JOB_SPAWNED)
+	    || (job->trace_state != TRACE_CGROUP) || (! job->cgroup))
+		return FALSE;
+
+	found = cgroup_main_pid (job->cgroup, pid, &child);
+	if (found < 0) {
+		NihError *err;
+
+		err = nih_error_get ();
+		nih_warn (_("Failed to find new process in control group "
+			    "for %s %s process (%d): %s"),
+			  job_name (job), process_name (process), pid,
+			  err->message);
+		nih_free (err);
+
+		return FALSE;
+	} else if (! found) {
+		return FALSE;
+	} else if (found > 1) {
+		nih_warn (_("%s %s process (%d) left %d processes, "
+			    "following (%d)"),
+			  job_name (job), process_name (process), pid,
+			  found, child);
+	}
+
+	nih_info (_("%s %s process (%d) became new process (%d)"),
+		  job_name (job), process_name (process), pid, child);
+
+	job_process_unwatch (job, process);
+	job->pid[process] = child;
+	job_process_watch (job, process);
+
+	/* The spawned process leads its own session, so a daemon's
+	 * intermediate child is either in that session or, once it has
+	 * called setsid(), leads another.
+	 */
+	sid = getsid (child);
+	ready = ((job->class->expect == EXPECT_FORK)
+		 || (job->trace_forks > 0)
+		 || (sid < 0)
+		 || ((sid != child) && (sid != pid)));
+
+	job->trace_forks++;
+	if (ready) {
+		job->trace_state = TRACE_NONE;
+		job_change_state (job, job_next_state (job));
+	}
+
+	return TRUE;
+}
+
+/**
+ * job_process_cgroup_limits:
+ * @job: job with control group.
+ *
+ * Applies the resource limits of the class of @job to its control group,
+ * enabling the controllers they belong to as needed; this is done before
+ * any process enters the control group so they are in effect from the
+ * start.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+static int
+job_process_cgroup_limits (Job *job)
+{
+	JobClass *class;
+
+	nih_assert (job != NULL);
+	nih_assert (job->cgroup != NULL);
+
+	class = job->class;
+
+	if (class->cpu_weight || class->cpu_quota) {
+		if (cgroup_enable ("cpu") < 0)
+			return -1;
+
+		if (class->cpu_weight
+		    && (cgroup_set (job->cgroup, "cpu.weight", "%d",
+				    class->cpu_weight) < 0))
+			return -1;
+
+		/* The quota is given as a percentage of a CPU, which we
+		 * apply over the kernel's default period of 100ms.
+		 */
+		if (class->cpu_quota
+		    && (cgroup_set (job->cgroup, "cpu.max", "%d 100000",
+				    class->cpu_quota * 1000) < 0))
+			return -1;
+	}
+
+	if (class->memory_max || class->memory_high) {
+		if (cgroup_enable ("memory") < 0)
+			return -1;
+
+		if (class->memory_max
+		    && (cgroup_set (job->cgroup, "memory.max", "%" PRIu64,
+				    class->memory_max) < 0))
+			return -1;
+
+		if (class->memory_high
+		    && (cgroup_set (job->cgroup, "memory.high", "%" PRIu64,
+				    class->memory_high) < 0))
+			return -1;
+	}
+
+	if (class->io_weight) {
+		if (cgroup_enable ("io") < 0)
+			return -1;
+
+		if (cgroup_set (job->cgroup, "io.weight", "default %d",
+				class->io_weight) < 0)
+			return -1;
+	}
+
+	return 0;
+}
+
 /**
  * job_process_trace_new:
  * @job: job that changed,
@@ -2082,7 +3250,9 @@ job_process_trace_fork (Job         *job,
 	/* Update the process we're supervising which is about to get SIGSTOP
 	 * so set the trace options to capture it.
 	 */
+	job_process_unwatch (job, process);
 	job->pid[process] = (pid_t)data;
+	job_process_watch (job, process);
 	job->trace_state = TRACE_NEW_CHILD;
 
 	/* We may have already had the wait notification for the new child
@@ -95,7 +95,10 @@ typedef enum job_process_error_type {
 	JOB_PROCESS_ERROR_ALLOC,
 	JOB_PROCESS_ERROR_INITGROUPS,
 	JOB_PROCESS_ERROR_GETGRGID,
-	JOB_PROCESS_ERROR_SECURITY
+	JOB_PROCESS_ERROR_SECURITY,
+	JOB_PROCESS_ERROR_CGROUP,
+	JOB_PROCESS_ERROR_AFFINITY,
+	JOB_PROCESS_ERROR_NUMA
 } JobProcessErrorType;
 
 /**
@@ -127,6 +130,8 @@ typedef struct job_process_error {
 
 NIH_BEGIN_EXTERN
 
+void   job_process_init    (void);
+
 int    job_process_run     (Job *job, ProcessType process);
 
 pid_t  job_process_spawn   (Job *job, char * const argv[],
@@ -139,6 +144,8 @@ void   job_process_kill    (Job *job, ProcessType process);
 void   job_process_handler (void *ptr, pid_t pid,
 			    NihChildEvents event, int status);
 
+void   job_process_watch   (Job *job, ProcessType process);
+
 Job   *job_process_find     (pid_t pid, ProcessType *process);
 
 char  *job_process_log_path (Job *job, int user_job)
@@ -149,6 +156,12 @@ void   job_process_set_kill_timer (Job          *job,
 			    time_t        timeout);
 
 void   job_process_adj_kill_timer  (Job *job, time_t due);
+void   job_process_set_respawn_timer (Job *job, time_t timeout);
+void   job_process_set_ready_timer (Job *job, time_t timeout);
+void   job_process_set_watchdog_timer (Job *job, time_t timeout);
+
+void   job_process_notify_watch (Job *job, int fd);
+void   job_process_notify_close (Job *job);
 
 int    job_process_jobs_running (void);
 
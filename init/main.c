@@ -50,6 +50,7 @@
 
 #include <nih/macros.h>
 #include <nih/alloc.h>
+#include <nih/string.h>
 #include <nih/list.h>
 #include <nih/timer.h>
 #include <nih/signal.h>
@@ -63,12 +64,16 @@
 #include "events.h"
 #include "system.h"
 #include "job_class.h"
+#include "job.h"
 #include "job_process.h"
 #include "event.h"
 #include "conf.h"
 #include "control.h"
+#include "control_native.h"
 #include "state.h"
 #include "xdg.h"
+#include "check_config.h"
+#include "cgroup.h"
 
 
 /* Prototypes for static functions */
@@ -87,8 +92,10 @@ static void usr1_handler    (void *data, NihSignal *signal);
 
 static void handle_confdir      (void);
 static void handle_logdir       (void);
+static void add_conf_sources    (void);
 static int  console_type_setter (NihOption *option, const char *arg);
 static int  conf_dir_setter     (NihOption *option, const char *arg);
+static int  ignored_events_setter (NihOption *option, const char *arg);
 
 
 /**
@@ -128,10 +135,50 @@ static int disable_startup_event = FALSE;
  **/
 static int disable_dbus = FALSE;
 
+/**
+ * disable_cgroups:
+ *
+ * If TRUE, follow the processes of jobs that fork with ptrace rather
+ * than with control groups.
+ **/
+static int disable_cgroups = FALSE;
+
+/**
+ * disable_pidfds:
+ *
+ * If TRUE, handle the exit of job processes only through SIGCHLD rather
+ * than watching a pidfd for each.
+ **/
+static int disable_pidfds = FALSE;
+
+/**
+ * check_config_only:
+ *
+ * If TRUE, load the job configuration, check the conditions of every job
+ * can be satisfied and exit rather than running as a daemon.
+ **/
+static int check_config_only = FALSE;
+
+/**
+ * check_config_warn:
+ *
+ * If TRUE, every alternative of an "or" must be satisfiable when
+ * checking the job configuration.
+ **/
+static int check_config_warn = FALSE;
+
+/**
+ * check_config_ignored:
+ *
+ * Events to assume are emitted when checking the job configuration.
+ **/
+static char **check_config_ignored = NULL;
+
 extern int          no_inherit_env;
 extern int          user_mode;
 extern int          disable_sessions;
 extern int          disable_job_logging;
+extern int          use_pidfds;
 extern int          use_session_bus;
 extern int          default_console;
 extern int          write_state_file;
@@ -146,15 +193,33 @@ extern int          debug_stanza_enabled;
  * Command-line options we accept.
  **/
 static NihOption options[] = {
+	{ 0, "check-config", N_("check job configuration can be satisfied and exit"),
+		NULL, NULL, &check_config_only, NULL },
+
+	{ 0, "check-config-ignore", N_("ignore specified list of events (comma-separated) when checking job configuration"),
+		NULL, "EVENT_LIST", NULL, ignored_events_setter },
+
+	{ 0, "check-config-warn", N_("require every alternative of a condition to be satisfiable when checking job configuration"),
+		NULL, NULL, &check_config_warn, NULL },
+
 	{ 0, "confdir", N_("specify alternative directory to load configuration files from"),
 		NULL, "DIR", NULL, conf_dir_setter },
 
+	{ 0, "conf-reload-delay", N_("wait until configuration files have been unchanged for SECONDS before reloading them"),
+		NULL, "SECONDS", &conf_reload_delay, nih_option_int },
+
 	{ 0, "default-console", N_("default value for console stanza"),
 		NULL, "VALUE", NULL, console_type_setter },
 
+	{ 0, "no-cgroups", N_("do not use control groups to follow job processes"),
+		NULL, NULL, &disable_cgroups, NULL },
+
 	{ 0, "no-dbus", N_("do not connect to a D-Bus bus"),
 		NULL, NULL, &disable_dbus, NULL },
 
+	{ 0, "no-pidfds", N_("do not use pidfds to supervise job processes"),
+		NULL, NULL, &disable_pidfds, NULL },
+
 	{ 0, "no-inherit-env", N_("jobs will not inherit environment of init"),
 		NULL, NULL, &no_inherit_env , NULL },
 
@@ -226,6 +291,17 @@ main (int   argc,
 	handle_confdir ();
 	handle_logdir ();
 
+	if (check_config_only) {
+		add_conf_sources ();
+		job_class_environment_init ();
+		conf_reload ();
+
+		ret = check_config (args[0], check_config_warn,
+				    check_config_ignored);
+
+		exit (ret ? 1 : 0);
+	}
+
 	if (disable_job_logging)
 		nih_debug ("Job logging disabled");
 
@@ -484,14 +560,27 @@ main (int   argc,
 #endif /* DEBUG */
 
 
-	/* Watch children for events */
+	/* Watch children for events, accounting only for usage from
+	 * now on.
+	 */
+	job_process_init ();
 	NIH_MUST (nih_child_add_watch (NULL, -1, NIH_CHILD_ALL,
 				       job_process_handler, NULL));
 
+	/* Reload changed configuration files each time through the main
+	 * loop, before processing events that might refer to them.
+	 */
+	NIH_MUST (nih_main_loop_add_func (NULL, (NihMainLoopCb)conf_poll,
+					  NULL));
+
 	/* Process the event queue each time through the main loop */
 	NIH_MUST (nih_main_loop_add_func (NULL, (NihMainLoopCb)event_poll,
 					  NULL));
 
+	/* Stop the next jobs during shutdown once others have finished */
+	NIH_MUST (nih_main_loop_add_func (NULL, (NihMainLoopCb)quiesce_poll,
+					  NULL));
+
 
 	/* Adjust our OOM priority to the default, which will be inherited
 	 * by all jobs.
@@ -567,37 +656,7 @@ main (int   argc,
 	}
 
 	/* Read configuration */
-	if (! user_mode) {
-		char   *conf_dir;
-		int     len = 0;
-
-		nih_assert (conf_dirs[0]);
-
-		/* Count entries */
-		for (char **d = conf_dirs; d && *d; d++, len++)
-			;
-
-		nih_assert (len);
-
-		/* Use last value specified */
-		conf_dir = conf_dirs[len-1];
-
-		NIH_MUST (conf_source_new (NULL, CONFFILE, CONF_FILE));
-
-		nih_debug ("Using configuration directory %s", conf_dir);
-		NIH_MUST (conf_source_new (NULL, conf_dir, CONF_JOB_DIR));
-	} else {
-		nih_local char **dirs = NULL;
-
-		dirs = NIH_MUST (get_user_upstart_dirs ());
-
-		for (char **d = conf_dirs[0] ? conf_dirs : dirs; d && *d; d++) {
-			nih_debug ("Using configuration directory %s", *d);
-			NIH_MUST (conf_source_new (NULL, *d, CONF_JOB_DIR));
-		}
-	}
-
-	nih_free (conf_dirs);
+	add_conf_sources ();
 
 	job_class_environment_init ();
 
@@ -617,6 +676,16 @@ main (int   argc,
 			}
 			nih_free (err);
 		}
+
+		/* And for clients of the native control protocol */
+		if (control_native_server_open () < 0) {
+			NihError *err;
+
+			err = nih_error_get ();
+			nih_warn ("%s: %s", _("Unable to listen for native control connections"),
+				  err->message);
+			nih_free (err);
+		}
 	}
 
 	/* Open connection to the appropriate D-Bus bus; we normally expect this to
@@ -712,6 +781,55 @@ main (int   argc,
 	}
 #endif
 
+	/* Follow the processes of jobs that fork using control groups
+	 * where we can, falling back to ptrace otherwise.
+	 */
+	if (! disable_cgroups) {
+		if (cgroup_init () < 0) {
+			NihError *err;
+
+			err = nih_error_get ();
+			nih_debug ("%s: %s", _("Unable to use control groups"),
+				   err->message);
+			nih_free (err);
+		}
+	} else {
+		nih_debug ("Control groups disabled");
+	}
+
+	/* Supervise job processes through pidfds where the kernel supports
+	 * them, including those inherited over a re-exec.
+	 */
+	if (! disable_pidfds) {
+		int fd;
+
+		fd = system_pidfd_open (getpid ());
+		if (fd < 0) {
+			NihError *err;
+
+			err = nih_error_get ();
+			nih_debug ("%s: %s", _("Unable to use pidfds"),
+				   err->message);
+			nih_free (err);
+		} else {
+			close (fd);
+			use_pidfds = TRUE;
+
+			NIH_HASH_FOREACH (job_classes, iter) {
+				JobClass *class = (JobClass *)iter;
+
+				NIH_HASH_FOREACH (class->instances, job_iter) {
+					Job *job = (Job *)job_iter;
+
+					for (int i = 0; i < PROCESS_LAST; i++)
+						if ((job->pid[i] > 0)
+						    && (! job->pidfd[i]))
+							job_process_watch (job, i);
+				}
+			}
+		}
+	}
+
 	/* Run through the loop at least once to deal with signals that were
 	 * delivered to the previous process while the mask was set or to
 	 * process the startup event we emitted.
@@ -1089,6 +1207,76 @@ console_type_setter (NihOption *option, const char *arg)
 	 return 0;
 }
 
+/**
+ * add_conf_sources:
+ *
+ * Add the sources of job configuration for the directories given on the
+ * command-line, or the default ones.
+ **/
+static void
+add_conf_sources (void)
+{
+	nih_assert (conf_dirs);
+
+	if (! user_mode) {
+		char   *conf_dir;
+		int     len = 0;
+
+		nih_assert (conf_dirs[0]);
+
+		/* Count entries */
+		for (char **d = conf_dirs; d && *d; d++, len++)
+			;
+
+		nih_assert (len);
+
+		/* Use last value specified */
+		conf_dir = conf_dirs[len-1];
+
+		NIH_MUST (conf_source_new (NULL, CONFFILE, CONF_FILE));
+
+		nih_debug ("Using configuration directory %s", conf_dir);
+		NIH_MUST (conf_source_new (NULL, conf_dir, CONF_JOB_DIR));
+	} else {
+		nih_local char **dirs = NULL;
+
+		dirs = NIH_MUST (get_user_upstart_dirs ());
+
+		for (char **d = conf_dirs[0] ? conf_dirs : dirs; d && *d; d++) {
+			nih_debug ("Using configuration directory %s", *d);
+			NIH_MUST (conf_source_new (NULL, *d, CONF_JOB_DIR));
+		}
+	}
+
+	nih_free (conf_dirs);
+	conf_dirs = NULL;
+}
+
+/**
+ * NihOption setter function to handle the list of events to ignore when
+ * checking job configuration.
+ *
+ * Returns: 0 on success.
+ **/
+static int
+ignored_events_setter (NihOption *option, const char *arg)
+{
+	nih_local char **events = NULL;
+
+	nih_assert (option);
+	nih_assert (arg);
+
+	events = NIH_MUST (nih_str_split (NULL, arg, ",", TRUE));
+
+	if (! check_config_ignored)
+		check_config_ignored = NIH_MUST (nih_str_array_new (NULL));
+
+	NIH_MUST (nih_str_array_append (&check_config_ignored, NULL, NULL,
+					events));
+
+	return 0;
+}
+
 /**  
  * NihOption setter function to handle selection of configuration file
  * directories.
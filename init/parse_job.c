@@ -29,6 +29,7 @@
 
 #include <errno.h>
 #include <limits.h>
+#include <sched.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -46,6 +47,7 @@
 #include "parse_job.h"
 #include "errors.h"
 #include "apparmor.h"
+#include "system.h"
 
 
 /* Prototypes for static functions */
@@ -91,6 +93,19 @@ static int            parse_on_operand  (JobClass *class,
 static int            parse_on_collect  (JobClass *class,
 					 NihList *stack, EventOperator **root)
 	__attribute__ ((warn_unused_result));
+static int            parse_weight      (const char *file, size_t len,
+					 size_t *pos, size_t *lineno,
+					 int *weight)
+	__attribute__ ((warn_unused_result));
+static int            parse_memory      (const char *file, size_t len,
+					 size_t *pos, size_t *lineno,
+					 uint64_t *bytes)
+	__attribute__ ((warn_unused_result));
+static int            parse_list        (JobClass *class,
+					 const char *file, size_t len,
+					 size_t *pos, size_t *lineno,
+					 char **list)
+	__attribute__ ((warn_unused_result));
 
 static int stanza_instance    (JobClass *class, NihConfigStanza *stanza,
 			       const char *file, size_t len,
@@ -176,6 +191,16 @@ static int stanza_reload      (JobClass *class, NihConfigStanza *stanza,
 			       size_t *pos, size_t *lineno)
 	__attribute__ ((warn_unused_result));
 
+static int stanza_ready       (JobClass *class, NihConfigStanza *stanza,
+			       const char *file, size_t len,
+			       size_t *pos, size_t *lineno)
+	__attribute__ ((warn_unused_result));
+
+static int stanza_watchdog    (JobClass *class, NihConfigStanza *stanza,
+			       const char *file, size_t len,
+			       size_t *pos, size_t *lineno)
+	__attribute__ ((warn_unused_result));
+
 static int stanza_apparmor    (JobClass *class, NihConfigStanza *stanza,
 			       const char *file, size_t len,
 			       size_t *pos, size_t *lineno)
@@ -211,6 +236,38 @@ static int stanza_limit       (JobClass *class, NihConfigStanza *stanza,
 			       const char *file, size_t len,
 			       size_t *pos, size_t *lineno)
 	__attribute__ ((warn_unused_result));
+static int stanza_cpu_weight  (JobClass *class, NihConfigStanza *stanza,
+			       const char *file, size_t len,
+			       size_t *pos, size_t *lineno)
+	__attribute__ ((warn_unused_result));
+static int stanza_cpu_quota   (JobClass *class, NihConfigStanza *stanza,
+			       const char *file, size_t len,
+			       size_t *pos, size_t *lineno)
+	__attribute__ ((warn_unused_result));
+static int stanza_memory_max  (JobClass *class, NihConfigStanza *stanza,
+			       const char *file, size_t len,
+			       size_t *pos, size_t *lineno)
+	__attribute__ ((warn_unused_result));
+static int stanza_memory_high (JobClass *class, NihConfigStanza *stanza,
+			       const char *file, size_t len,
+			       size_t *pos, size_t *lineno)
+	__attribute__ ((warn_unused_result));
+static int stanza_io_weight   (JobClass *class, NihConfigStanza *stanza,
+			       const char *file, size_t len,
+			       size_t *pos, size_t *lineno)
+	__attribute__ ((warn_unused_result));
+static int stanza_cpu_affinity (JobClass *class, NihConfigStanza *stanza,
+			       const char *file, size_t len,
+			       size_t *pos, size_t *lineno)
+	__attribute__ ((warn_unused_result));
+static int stanza_numa_policy (JobClass *class, NihConfigStanza *stanza,
+			       const char *file, size_t len,
+			       size_t *pos, size_t *lineno)
+	__attribute__ ((warn_unused_result));
+static int stanza_numa_nodes  (JobClass *class, NihConfigStanza *stanza,
+			       const char *file, size_t len,
+			       size_t *pos, size_t *lineno)
+	__attribute__ ((warn_unused_result));
 static int stanza_chroot      (JobClass *class, NihConfigStanza *stanza,
 			       const char *file, size_t len,
 			       size_t *pos, size_t *lineno)
@@ -273,6 +330,8 @@ static NihConfigStanza stanzas[] = {
 	{ "task",        (NihConfigHandler)stanza_task        },
 	{ "kill",        (NihConfigHandler)stanza_kill        },
 	{ "reload",      (NihConfigHandler)stanza_reload      },
+	{ "ready",       (NihConfigHandler)stanza_ready       },
+	{ "watchdog",    (NihConfigHandler)stanza_watchdog    },
 	{ "respawn",     (NihConfigHandler)stanza_respawn     },
 	{ "normal",      (NihConfigHandler)stanza_normal      },
 	{ "console",     (NihConfigHandler)stanza_console     },
@@ -280,6 +339,14 @@ static NihConfigStanza stanzas[] = {
 	{ "nice",        (NihConfigHandler)stanza_nice        },
 	{ "oom",         (NihConfigHandler)stanza_oom         },
 	{ "limit",       (NihConfigHandler)stanza_limit       },
+	{ "cpu-weight",  (NihConfigHandler)stanza_cpu_weight  },
+	{ "cpu-quota",   (NihConfigHandler)stanza_cpu_quota   },
+	{ "memory-max",  (NihConfigHandler)stanza_memory_max  },
+	{ "memory-high", (NihConfigHandler)stanza_memory_high },
+	{ "io-weight",   (NihConfigHandler)stanza_io_weight   },
+	{ "cpu-affinity", (NihConfigHandler)stanza_cpu_affinity },
+	{ "numa-policy", (NihConfigHandler)stanza_numa_policy },
+	{ "numa-nodes",  (NihConfigHandler)stanza_numa_nodes  },
 	{ "chroot",      (NihConfigHandler)stanza_chroot      },
 	{ "chdir",       (NihConfigHandler)stanza_chdir       },
 	{ "setuid",      (NihConfigHandler)stanza_setuid      },
@@ -1135,6 +1202,221 @@ stanza_manual (JobClass           *class,
 	return 0;
 }
 
+/**
+ * parse_weight:
+ * @file: file or string to parse,
+ * @len: length of @file,
+ * @pos: offset within @file,
+ * @lineno: line number,
+ * @weight: pointer to store weight in.
+ *
+ * Parses a single argument from @file containing the relative weight of
+ * a control group for one of its controllers, which the kernel requires
+ * to be between 1 and 10000.
+ *
+ * Returns: zero on success, negative value on error.
+ **/
+static int
+parse_weight (const char *file,
+	      size_t      len,
+	      size_t     *pos,
+	      size_t     *lineno,
+	      int        *weight)
+{
+	nih_local char *arg = NULL;
+	char           *endptr;
+	size_t          a_pos, a_lineno;
+	long            value;
+	int             ret = -1;
+
+	nih_assert (file != NULL);
+	nih_assert (pos != NULL);
+	nih_assert (weight != NULL);
+
+	a_pos = *pos;
+	a_lineno = (lineno ? *lineno : 1);
+
+	arg = nih_config_next_arg (NULL, file, len, &a_pos, &a_lineno);
+	if (! arg)
+		goto finish;
+
+	errno = 0;
+	value = strtol (arg, &endptr, 10);
+	if (errno || *endptr || (value < 1) || (value > 10000))
+		nih_return_error (-1, PARSE_ILLEGAL_WEIGHT,
+				  _(PARSE_ILLEGAL_WEIGHT_STR));
+
+	*weight = (int)value;
+
+	ret = nih_config_skip_comment (file, len, &a_pos, &a_lineno);
+
+finish:
+	*pos = a_pos;
+	if (lineno)
+		*lineno = a_lineno;
+
+	return ret;
+}
+
+/**
+ * parse_memory:
+ * @file: file or string to parse,
+ * @len: length of @file,
+ * @pos: offset within @file,
+ * @lineno: line number,
+ * @bytes: pointer to store size in.
+ *
+ * Parses a single argument from @file containing a non-zero amount of
+ * memory in bytes, which may be followed by a K, M, G or T suffix to
+ * multiply it by the appropriate power of 1024.
+ *
+ * Returns: zero on success, negative value on error.
+ **/
+static int
+parse_memory (const char *file,
+	      size_t      len,
+	      size_t     *pos,
+	      size_t     *lineno,
+	      uint64_t   *bytes)
+{
+	nih_local char     *arg = NULL;
+	char               *endptr;
+	size_t              a_pos, a_lineno;
+	unsigned long long  value;
+	int                 shift = 0;
+	int                 ret = -1;
+
+	nih_assert (file != NULL);
+	nih_assert (pos != NULL);
+	nih_assert (bytes != NULL);
+
+	a_pos = *pos;
+	a_lineno = (lineno ? *lineno : 1);
+
+	arg = nih_config_next_arg (NULL, file, len, &a_pos, &a_lineno);
+	if (! arg)
+		goto finish;
+
+	if (*arg == '-')
+		nih_return_error (-1, PARSE_ILLEGAL_MEMORY,
+				  _(PARSE_ILLEGAL_MEMORY_STR));
+
+	errno = 0;
+	value = strtoull (arg, &endptr, 10);
+	if (errno || (endptr == arg))
+		nih_return_error (-1, PARSE_ILLEGAL_MEMORY,
+				  _(PARSE_ILLEGAL_MEMORY_STR));
+
+	switch (*endptr) {
+	case 'T':
+	case 't':
+		shift += 10;
+		/* fall through */
+	case 'G':
+	case 'g':
+		shift += 10;
+		/* fall through */
+	case 'M':
+	case 'm':
+		shift += 10;
+		/* fall through */
+	case 'K':
+	case 'k':
+		shift += 10;
+		endptr++;
+		/* fall through */
+	case '\0':
+		break;
+	}
+
+	if (*endptr || (! value) || (value > (UINT64_MAX >> shift)))
+		nih_return_error (-1, PARSE_ILLEGAL_MEMORY,
+				  _(PARSE_ILLEGAL_MEMORY_STR));
+
+	*bytes = (uint64_t)value << shift;
+
+	ret = nih_config_skip_comment (file, len, &a_pos, &a_lineno);
+
+finish:
+	*pos = a_pos;
+	if (lineno)
+		*lineno = a_lineno;
+
+	return ret;
+}
+
+/**
+ * parse_list:
+ * @class: job class being parsed,
+ * @file: file or string to parse,
+ * @len: length of @file,
+ * @pos: offset within @file,
+ * @lineno: line number,
+ * @list: pointer to store list in.
+ *
+ * Parses a single argument from @file containing a list of CPUs or NUMA
+ * nodes, such as "0-3,8", replacing any previous list in @list.  Lists
+ * that reference variables are only checked once expanded, when the
+ * process is spawned; others are checked now.
+ *
+ * Returns: zero on success, negative value on error.
+ **/
+static int
+parse_list (JobClass    *class,
+	    const char  *file,
+	    size_t       len,
+	    size_t      *pos,
+	    size_t      *lineno,
+	    char       **list)
+{
+	char   *arg;
+	size_t  a_pos, a_lineno;
+
+	nih_assert (class != NULL);
+	nih_assert (file != NULL);
+	nih_assert (pos != NULL);
+	nih_assert (list != NULL);
+
+	a_pos = *pos;
+	a_lineno = (lineno ? *lineno : 1);
+
+	arg = nih_config_next_arg (class, file, len, &a_pos, &a_lineno);
+	if (! arg) {
+		*pos = a_pos;
+		if (lineno)
+			*lineno = a_lineno;
+
+		return -1;
+	}
+
+	/* Both CPU and NUMA node numbers are limited to CPU_SETSIZE. */
+	if (! strchr (arg, '$')) {
+		unsigned long mask[CPU_SETSIZE / (sizeof (unsigned long) * CHAR_BIT)];
+
+		if (system_parse_list (arg, mask, CPU_SETSIZE) < 0) {
+			NihError *err;
+
+			err = nih_error_get ();
+			nih_free (err);
+			nih_free (arg);
+
+			nih_return_error (-1, PARSE_ILLEGAL_LIST,
+					  _(PARSE_ILLEGAL_LIST_STR));
+		}
+	}
+
+	if (*list)
+		nih_unref (*list, class);
+
+	*list = arg;
+
+	*pos = a_pos;
+	if (lineno)
+		*lineno = a_lineno;
+
+	return nih_config_skip_comment (file, len, pos, lineno);
+}
+
 /**
  * stanza_instance:
  * @class: job class being parsed,
@@ -1798,6 +2080,8 @@ stanza_expect (JobClass        *class,
 		class->expect = EXPECT_DAEMON;
 	} else if (! strcmp (arg, "fork")) {
 		class->expect = EXPECT_FORK;
+	} else if (! strcmp (arg, "notify")) {
+		class->expect = EXPECT_NOTIFY;
 	} else if (! strcmp (arg, "none")) {
 		class->expect = EXPECT_NONE;
 	} else {
@@ -2037,7 +2321,7 @@ finish:
 
 
 /**
- * stanza_apparmor:
+ * stanza_ready:
  * @class: job class being parsed,
  * @stanza: stanza found,
  * @file: file or string to parse,
@@ -2045,23 +2329,23 @@ finish:
  * @pos: offset within @file,
  * @lineno: line number.
  *
- * Parse an apparmor stanza from @file, extracting a second-level stanza that
+ * Parse a ready stanza from @file, extracting a second-level stanza that
  * states which value to set from its argument.
  *
  * Returns: zero on success, negative value on error.
  **/
 static int
-stanza_apparmor (JobClass        *class,
-		 NihConfigStanza *stanza,
-		 const char      *file,
-		 size_t           len,
-		 size_t          *pos,
-		 size_t          *lineno)
+stanza_ready (JobClass        *class,
+	      NihConfigStanza *stanza,
+	      const char      *file,
+	      size_t           len,
+	      size_t          *pos,
+	      size_t          *lineno)
 {
 	size_t          a_pos, a_lineno;
 	int             ret = -1;
+	char           *endptr;
 	nih_local char *arg = NULL;
-	Process        *process;
 
 	nih_assert (class != NULL);
 	nih_assert (stanza != NULL);
@@ -2076,54 +2360,24 @@ stanza_apparmor (JobClass        *class,
 	if (! arg)
 		goto finish;
 
-	if (! strcmp (arg, "load")) {
-		nih_local char *aaarg = NULL;
-
-		/* Update error position to the load value */
-		*pos = a_pos;
-		if (lineno)
-			*lineno = a_lineno;
-
-		aaarg = nih_config_next_arg (NULL, file, len,
-					     &a_pos, &a_lineno);
-
-		if (! aaarg)
-			goto finish;
-
-		/* Allocate a new Process structure if we need to */
-		if (! class->process[PROCESS_SECURITY]) {
-			class->process[PROCESS_SECURITY] = process_new (class->process);
-			if (! class->process[PROCESS_SECURITY])
-				nih_return_system_error (-1);
-		}
-
-		process = class->process[PROCESS_SECURITY];
-
-		if (process->command)
-			nih_unref (process->command, process);
-
-		process->script = FALSE;
-		process->command = nih_sprintf (process, "%s %s %s",
-						APPARMOR_PARSER,
-						APPARMOR_PARSER_OPTS,
-						aaarg);
-
-		if (! process->command)
-			nih_return_system_error (-1);
+	if (! strcmp (arg, "timeout")) {
+		nih_local char *timearg = NULL;
 
-	} else if (! strcmp (arg, "switch")) {
-		/* Update error position to the switch value */
+		/* Update error position to the timeout value */
 		*pos = a_pos;
 		if (lineno)
 			*lineno = a_lineno;
 
-		class->apparmor_switch = nih_config_next_arg (class, file,
-							      len, &a_pos,
-							      &a_lineno);
-
-		if (! class->apparmor_switch)
+		timearg = nih_config_next_arg (NULL, file, len,
+					       &a_pos, &a_lineno);
+		if (! timearg)
 			goto finish;
 
+		errno = 0;
+		class->ready_timeout = strtol (timearg, &endptr, 10);
+		if (errno || *endptr || (class->ready_timeout < 0))
+			nih_return_error (-1, PARSE_ILLEGAL_INTERVAL,
+					  _(PARSE_ILLEGAL_INTERVAL_STR));
 	} else {
 		nih_return_error (-1, NIH_CONFIG_UNKNOWN_STANZA,
 				  _(NIH_CONFIG_UNKNOWN_STANZA_STR));
@@ -2139,8 +2393,9 @@ finish:
 	return ret;
 }
 
+
 /**
- * stanza_respawn:
+ * stanza_watchdog:
  * @class: job class being parsed,
  * @stanza: stanza found,
  * @file: file or string to parse,
@@ -2148,21 +2403,22 @@ finish:
  * @pos: offset within @file,
  * @lineno: line number.
  *
- * Parse a daemon stanza from @file.  This either has no arguments, in
- * which case it sets the respawn flag for the job, or it has the "limit"
- * argument and sets the respawn rate limit.
+ * Parse a watchdog stanza from @file, extracting a single argument
+ * containing the interval within which the main process must notify us
+ * that it is still alive.
  *
  * Returns: zero on success, negative value on error.
  **/
 static int
-stanza_respawn (JobClass        *class,
-		NihConfigStanza *stanza,
-		const char      *file,
-		size_t           len,
-		size_t          *pos,
-		size_t          *lineno)
+stanza_watchdog (JobClass        *class,
+		 NihConfigStanza *stanza,
+		 const char      *file,
+		 size_t           len,
+		 size_t          *pos,
+		 size_t          *lineno)
 {
 	nih_local char *arg = NULL;
+	char           *endptr;
 	size_t          a_pos, a_lineno;
 	int             ret = -1;
 
@@ -2171,26 +2427,187 @@ stanza_respawn (JobClass        *class,
 	nih_assert (file != NULL);
 	nih_assert (pos != NULL);
 
-	/* Deal with the no-argument form first */
-	if (! nih_config_has_token (file, len, pos, lineno)) {
-		class->respawn = TRUE;
-
-		return nih_config_skip_comment (file, len, pos, lineno);
-	}
-
-
-	/* Take the next argument, a sub-stanza keyword. */
 	a_pos = *pos;
 	a_lineno = (lineno ? *lineno : 1);
 
-	arg = nih_config_next_token (NULL, file, len, &a_pos, &a_lineno,
-				     NIH_CONFIG_CNLWS, FALSE);
+	arg = nih_config_next_arg (NULL, file, len, &a_pos, &a_lineno);
 	if (! arg)
 		goto finish;
 
-	if (! strcmp (arg, "limit")) {
-		nih_local char *limitarg = NULL;
-		char           *endptr;
+	errno = 0;
+	class->watchdog_timeout = strtol (arg, &endptr, 10);
+	if (errno || *endptr || (class->watchdog_timeout < 0))
+		nih_return_error (-1, PARSE_ILLEGAL_INTERVAL,
+				  _(PARSE_ILLEGAL_INTERVAL_STR));
+
+	ret = nih_config_skip_comment (file, len, &a_pos, &a_lineno);
+
+finish:
+	*pos = a_pos;
+	if (lineno)
+		*lineno = a_lineno;
+
+	return ret;
+}
+
+
+/**
+ * stanza_apparmor:
+ * @class: job class being parsed,
+ * @stanza: stanza found,
+ * @file: file or string to parse,
+ * @len: length of @file,
+ * @pos: offset within @file,
+ * @lineno: line number.
+ *
+ * Parse an apparmor stanza from @file, extracting a second-level stanza that
+ * states which value to set from its argument.
+ *
+ * Returns: zero on success, negative value on error.
+ **/
+static int
+stanza_apparmor (JobClass        *class,
+		 NihConfigStanza *stanza,
+		 const char      *file,
+		 size_t           len,
+		 size_t          *pos,
+		 size_t          *lineno)
+{
+	size_t          a_pos, a_lineno;
+	int             ret = -1;
+	nih_local char *arg = NULL;
+	Process        *process;
+
+	nih_assert (class != NULL);
+	nih_assert (stanza != NULL);
+	nih_assert (file != NULL);
+	nih_assert (pos != NULL);
+
+	a_pos = *pos;
+	a_lineno = (lineno ? *lineno : 1);
+
+	arg = nih_config_next_token (NULL, file, len, &a_pos, &a_lineno,
+				     NIH_CONFIG_CNLWS, FALSE);
+	if (! arg)
+		goto finish;
+
+	if (! strcmp (arg, "load")) {
+		nih_local char *aaarg = NULL;
+
+		/* Update error position to the load value */
+		*pos = a_pos;
+		if (lineno)
+			*lineno = a_lineno;
+
+		aaarg = nih_config_next_arg (NULL, file, len,
+					     &a_pos, &a_lineno);
+
+		if (! aaarg)
+			goto finish;
+
+		/* Allocate a new Process structure if we need to */
+		if (! class->process[PROCESS_SECURITY]) {
+			class->process[PROCESS_SECURITY] = process_new (class->process);
+			if (! class->process[PROCESS_SECURITY])
+				nih_return_system_error (-1);
+		}
+
+		process = class->process[PROCESS_SECURITY];
+
+		if (process->command)
+			nih_unref (process->command, process);
+
+		process->script = FALSE;
+		process->command = nih_sprintf (process, "%s %s %s",
+						APPARMOR_PARSER,
+						APPARMOR_PARSER_OPTS,
+						aaarg);
+
+		if (! process->command)
+			nih_return_system_error (-1);
+
+	} else if (! strcmp (arg, "switch")) {
+		/* Update error position to the switch value */
+		*pos = a_pos;
+		if (lineno)
+			*lineno = a_lineno;
+
+		class->apparmor_switch = nih_config_next_arg (class, file,
+							      len, &a_pos,
+							      &a_lineno);
+
+		if (! class->apparmor_switch)
+			goto finish;
+
+	} else {
+		nih_return_error (-1, NIH_CONFIG_UNKNOWN_STANZA,
+				  _(NIH_CONFIG_UNKNOWN_STANZA_STR));
+	}
+
+	ret = nih_config_skip_comment (file, len, &a_pos, &a_lineno);
+
+finish:
+	*pos = a_pos;
+	if (lineno)
+		*lineno = a_lineno;
+
+	return ret;
+}
+
+/**
+ * stanza_respawn:
+ * @class: job class being parsed,
+ * @stanza: stanza found,
+ * @file: file or string to parse,
+ * @len: length of @file,
+ * @pos: offset within @file,
+ * @lineno: line number.
+ *
+ * Parse a daemon stanza from @file.  This either has no arguments, in
+ * which case it sets the respawn flag for the job, or it has the "limit"
+ * argument and sets the respawn rate limit, the "delay" argument and sets
+ * the bounds of the delay before respawning, or the "stable" argument and
+ * sets how long a process must run for that delay to be reset.
+ *
+ * Returns: zero on success, negative value on error.
+ **/
+static int
+stanza_respawn (JobClass        *class,
+		NihConfigStanza *stanza,
+		const char      *file,
+		size_t           len,
+		size_t          *pos,
+		size_t          *lineno)
+{
+	nih_local char *arg = NULL;
+	size_t          a_pos, a_lineno;
+	int             ret = -1;
+
+	nih_assert (class != NULL);
+	nih_assert (stanza != NULL);
+	nih_assert (file != NULL);
+	nih_assert (pos != NULL);
+
+	/* Deal with the no-argument form first */
+	if (! nih_config_has_token (file, len, pos, lineno)) {
+		class->respawn = TRUE;
+
+		return nih_config_skip_comment (file, len, pos, lineno);
+	}
+
+
+	/* Take the next argument, a sub-stanza keyword. */
+	a_pos = *pos;
+	a_lineno = (lineno ? *lineno : 1);
+
+	arg = nih_config_next_token (NULL, file, len, &a_pos, &a_lineno,
+				     NIH_CONFIG_CNLWS, FALSE);
+	if (! arg)
+		goto finish;
+
+	if (! strcmp (arg, "limit")) {
+		nih_local char *limitarg = NULL;
+		char           *endptr;
 
 		/* Update error position to the limit value */
 		*pos = a_pos;
@@ -2235,6 +2652,72 @@ stanza_respawn (JobClass        *class,
 
 		ret = nih_config_skip_comment (file, len, &a_pos, &a_lineno);
 
+	} else if (! strcmp (arg, "delay")) {
+		nih_local char *minarg = NULL;
+		nih_local char *maxarg = NULL;
+		char           *endptr;
+
+		/* Update error position to the minimum delay */
+		*pos = a_pos;
+		if (lineno)
+			*lineno = a_lineno;
+
+		/* Parse the minimum delay */
+		minarg = nih_config_next_arg (NULL, file, len,
+					      &a_pos, &a_lineno);
+		if (! minarg)
+			goto finish;
+
+		errno = 0;
+		class->respawn_delay_min = strtol (minarg, &endptr, 10);
+		if (errno || *endptr || (class->respawn_delay_min < 1))
+			nih_return_error (-1, PARSE_ILLEGAL_INTERVAL,
+					  _(PARSE_ILLEGAL_INTERVAL_STR));
+
+		/* Update error position to the maximum delay */
+		*pos = a_pos;
+		if (lineno)
+			*lineno = a_lineno;
+
+		/* Parse the maximum delay, which may not be less than
+		 * the minimum.
+		 */
+		maxarg = nih_config_next_arg (NULL, file, len,
+					      &a_pos, &a_lineno);
+		if (! maxarg)
+			goto finish;
+
+		errno = 0;
+		class->respawn_delay_max = strtol (maxarg, &endptr, 10);
+		if (errno || *endptr
+		    || (class->respawn_delay_max < class->respawn_delay_min))
+			nih_return_error (-1, PARSE_ILLEGAL_INTERVAL,
+					  _(PARSE_ILLEGAL_INTERVAL_STR));
+
+		ret = nih_config_skip_comment (file, len, &a_pos, &a_lineno);
+
+	} else if (! strcmp (arg, "stable")) {
+		nih_local char *stablearg = NULL;
+		char           *endptr;
+
+		/* Update error position to the stable period */
+		*pos = a_pos;
+		if (lineno)
+			*lineno = a_lineno;
+
+		stablearg = nih_config_next_arg (NULL, file, len,
+						 &a_pos, &a_lineno);
+		if (! stablearg)
+			goto finish;
+
+		errno = 0;
+		class->respawn_stable = strtol (stablearg, &endptr, 10);
+		if (errno || *endptr || (class->respawn_stable < 0))
+			nih_return_error (-1, PARSE_ILLEGAL_INTERVAL,
+					  _(PARSE_ILLEGAL_INTERVAL_STR));
+
+		ret = nih_config_skip_comment (file, len, &a_pos, &a_lineno);
+
 	} else {
 		nih_return_error (-1, NIH_CONFIG_UNKNOWN_STANZA,
 				  _(NIH_CONFIG_UNKNOWN_STANZA_STR));
@@ -2727,6 +3210,315 @@ finish:
 	return ret;
 }
 
+/**
+ * stanza_cpu_weight:
+ * @class: job class being parsed,
+ * @stanza: stanza found,
+ * @file: file or string to parse,
+ * @len: length of @file,
+ * @pos: offset within @file,
+ * @lineno: line number.
+ *
+ * Parse a cpu-weight stanza from @file, extracting a single argument
+ * containing the relative share of CPU time of the job's control group.
+ *
+ * Returns: zero on success, negative value on error.
+ **/
+static int
+stanza_cpu_weight (JobClass        *class,
+                  NihConfigStanza *stanza,
+                  const char      *file,
+                  size_t           len,
+                  size_t          *pos,
+                  size_t          *lineno)
+{
+	nih_assert (class != NULL);
+	nih_assert (stanza != NULL);
+	nih_assert (file != NULL);
+	nih_assert (pos != NULL);
+
+	return parse_weight (file, len, pos, lineno, &class->cpu_weight);
+}
+
+/**
+ * stanza_cpu_quota:
+ * @class: job class being parsed,
+ * @stanza: stanza found,
+ * @file: file or string to parse,
+ * @len: length of @file,
+ * @pos: offset within @file,
+ * @lineno: line number.
+ *
+ * Parse a cpu-quota stanza from @file, extracting a single argument
+ * containing the percentage of a single CPU that the job's control group
+ * may use, optionally followed by a percent sign; values over 100 allow
+ * more than one CPU to be used.
+ *
+ * Returns: zero on success, negative value on error.
+ **/
+static int
+stanza_cpu_quota (JobClass        *class,
+                 NihConfigStanza *stanza,
+                 const char      *file,
+                 size_t           len,
+                 size_t          *pos,
+                 size_t          *lineno)
+{
+	nih_local char *arg = NULL;
+	char           *endptr;
+	size_t          a_pos, a_lineno;
+	long            value;
+	int             ret = -1;
+
+	nih_assert (class != NULL);
+	nih_assert (stanza != NULL);
+	nih_assert (file != NULL);
+	nih_assert (pos != NULL);
+
+	a_pos = *pos;
+	a_lineno = (lineno ? *lineno : 1);
+
+	arg = nih_config_next_arg (NULL, file, len, &a_pos, &a_lineno);
+	if (! arg)
+		goto finish;
+
+	errno = 0;
+	value = strtol (arg, &endptr, 10);
+	if (*endptr == '%')
+		endptr++;
+
+	if (errno || *endptr || (endptr == arg)
+	    || (value < 1) || (value > JOB_CPU_QUOTA_MAX))
+		nih_return_error (-1, PARSE_ILLEGAL_QUOTA,
+				  _(PARSE_ILLEGAL_QUOTA_STR));
+
+	class->cpu_quota = (int)value;
+
+	ret = nih_config_skip_comment (file, len, &a_pos, &a_lineno);
+
+finish:
+	*pos = a_pos;
+	if (lineno)
+		*lineno = a_lineno;
+
+	return ret;
+}
+
+/**
+ * stanza_memory_max:
+ * @class: job class being parsed,
+ * @stanza: stanza found,
+ * @file: file or string to parse,
+ * @len: length of @file,
+ * @pos: offset within @file,
+ * @lineno: line number.
+ *
+ * Parse a memory-max stanza from @file, extracting a single argument
+ * containing the memory usage of the job's control group above which its
+ * processes are killed.
+ *
+ * Returns: zero on success, negative value on error.
+ **/
+static int
+stanza_memory_max (JobClass        *class,
+                  NihConfigStanza *stanza,
+                  const char      *file,
+                  size_t           len,
+                  size_t          *pos,
+                  size_t          *lineno)
+{
+	nih_assert (class != NULL);
+	nih_assert (stanza != NULL);
+	nih_assert (file != NULL);
+	nih_assert (pos != NULL);
+
+	return parse_memory (file, len, pos, lineno, &class->memory_max);
+}
+
+/**
+ * stanza_memory_high:
+ * @class: job class being parsed,
+ * @stanza: stanza found,
+ * @file: file or string to parse,
+ * @len: length of @file,
+ * @pos: offset within @file,
+ * @lineno: line number.
+ *
+ * Parse a memory-high stanza from @file, extracting a single argument
+ * containing the memory usage of the job's control group above which its
+ * processes are throttled and memory reclaimed from them.
+ *
+ * Returns: zero on success, negative value on error.
+ **/
+static int
+stanza_memory_high (JobClass        *class,
+                   NihConfigStanza *stanza,
+                   const char      *file,
+                   size_t           len,
+                   size_t          *pos,
+                   size_t          *lineno)
+{
+	nih_assert (class != NULL);
+	nih_assert (stanza != NULL);
+	nih_assert (file != NULL);
+	nih_assert (pos != NULL);
+
+	return parse_memory (file, len, pos, lineno, &class->memory_high);
+}
+
+/**
+ * stanza_io_weight:
+ * @class: job class being parsed,
+ * @stanza: stanza found,
+ * @file: file or string to parse,
+ * @len: length of @file,
+ * @pos: offset within @file,
+ * @lineno: line number.
+ *
+ * Parse an io-weight stanza from @file, extracting a single argument
+ * containing the relative share of block I/O of the job's control group.
+ *
+ * Returns: zero on success, negative value on error.
+ **/
+static int
+stanza_io_weight (JobClass        *class,
+                 NihConfigStanza *stanza,
+                 const char      *file,
+                 size_t           len,
+                 size_t          *pos,
+                 size_t          *lineno)
+{
+	nih_assert (class != NULL);
+	nih_assert (stanza != NULL);
+	nih_assert (file != NULL);
+	nih_assert (pos != NULL);
+
+	return parse_weight (file, len, pos, lineno, &class->io_weight);
+}
+
+/**
+ * stanza_cpu_affinity:
+ * @class: job class being parsed,
+ * @stanza: stanza found,
+ * @file: file or string to parse,
+ * @len: length of @file,
+ * @pos: offset within @file,
+ * @lineno: line number.
+ *
+ * Parse a cpu-affinity stanza from @file, extracting a single argument
+ * containing the list of CPUs the job's processes may run on.
+ *
+ * Returns: zero on success, negative value on error.
+ **/
+static int
+stanza_cpu_affinity (JobClass        *class,
+                    NihConfigStanza *stanza,
+                    const char      *file,
+                    size_t           len,
+                    size_t          *pos,
+                    size_t          *lineno)
+{
+	nih_assert (class != NULL);
+	nih_assert (stanza != NULL);
+	nih_assert (file != NULL);
+	nih_assert (pos != NULL);
+
+	return parse_list (class, file, len, pos, lineno, &class->cpu_affinity);
+}
+
+/**
+ * stanza_numa_policy:
+ * @class: job class being parsed,
+ * @stanza: stanza found,
+ * @file: file or string to parse,
+ * @len: length of @file,
+ * @pos: offset within @file,
+ * @lineno: line number.
+ *
+ * Parse a numa-policy stanza from @file, extracting a single argument
+ * containing the policy for allocating the memory of the job's processes.
+ *
+ * Returns: zero on success, negative value on error.
+ **/
+static int
+stanza_numa_policy (JobClass        *class,
+                   NihConfigStanza *stanza,
+                   const char      *file,
+                   size_t           len,
+                   size_t          *pos,
+                   size_t          *lineno)
+{
+	nih_local char *arg = NULL;
+	size_t          a_pos, a_lineno;
+	int             ret = -1;
+
+	nih_assert (class != NULL);
+	nih_assert (stanza != NULL);
+	nih_assert (file != NULL);
+	nih_assert (pos != NULL);
+
+	a_pos = *pos;
+	a_lineno = (lineno ? *lineno : 1);
+
+	arg = nih_config_next_arg (NULL, file, len, &a_pos, &a_lineno);
+	if (! arg)
+		goto finish;
+
+	if (! strcmp (arg, "default")) {
+		class->numa_policy = NUMA_DEFAULT;
+	} else if (! strcmp (arg, "bind")) {
+		class->numa_policy = NUMA_BIND;
+	} else if (! strcmp (arg, "preferred")) {
+		class->numa_policy = NUMA_PREFERRED;
+	} else if (! strcmp (arg, "interleave")) {
+		class->numa_policy = NUMA_INTERLEAVE;
+	} else if (! strcmp (arg, "local")) {
+		class->numa_policy = NUMA_LOCAL;
+	} else {
+		nih_return_error (-1, NIH_CONFIG_UNKNOWN_STANZA,
+				  _(NIH_CONFIG_UNKNOWN_STANZA_STR));
+	}
+
+	ret = nih_config_skip_comment (file, len, &a_pos, &a_lineno);
+
+finish:
+	*pos = a_pos;
+	if (lineno)
+		*lineno = a_lineno;
+
+	return ret;
+}
+
+/**
+ * stanza_numa_nodes:
+ * @class: job class being parsed,
+ * @stanza: stanza found,
+ * @file: file or string to parse,
+ * @len: length of @file,
+ * @pos: offset within @file,
+ * @lineno: line number.
+ *
+ * Parse a numa-nodes stanza from @file, extracting a single argument
+ * containing the list of NUMA nodes the numa-policy stanza applies to.
+ *
+ * Returns: zero on success, negative value on error.
+ **/
+static int
+stanza_numa_nodes (JobClass        *class,
+                  NihConfigStanza *stanza,
+                  const char      *file,
+                  size_t           len,
+                  size_t          *pos,
+                  size_t          *lineno)
+{
+	nih_assert (class != NULL);
+	nih_assert (stanza != NULL);
+	nih_assert (file != NULL);
+	nih_assert (pos != NULL);
+
+	return parse_list (class, file, len, pos, lineno, &class->numa_nodes);
+}
+
 /**
  * stanza_chroot:
  * @class: job class being parsed,
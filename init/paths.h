@@ -55,6 +55,38 @@
 #endif
 
 
+/**
+ * CGROUP_MOUNT:
+ *
+ * Mount point of the unified (version 2) control group hierarchy.
+ **/
+#ifndef CGROUP_MOUNT
+#define CGROUP_MOUNT "/sys/fs/cgroup"
+#endif
+
+/**
+ * CGROUP_DIR:
+ *
+ * Directory below the control group of the init daemon in which the
+ * control groups of jobs are created.
+ **/
+#ifndef CGROUP_DIR
+#define CGROUP_DIR "upstart"
+#endif
+
+/**
+ * CGROUP_INIT_DIR:
+ *
+ * Leaf control group alongside CGROUP_DIR that the init daemon moves
+ * itself into when it is not in the root control group, since the
+ * control group above CGROUP_DIR may only enable controllers for its
+ * children once it has no processes of its own.
+ **/
+#ifndef CGROUP_INIT_DIR
+#define CGROUP_INIT_DIR "init"
+#endif
+
+
 /**
  * CONFFILE:
  *
@@ -28,9 +28,15 @@
 #include "environ.h"
 #include "conf.h"
 #include "job_process.h"
+#include "event_operator.h"
 #include "control.h"
 
+#include <string.h>
+
 #include <nih/main.h>
+#include <nih/alloc.h>
+#include <nih/string.h>
+#include <nih/hash.h>
 
 /**
  * quiesce_requester:
@@ -84,8 +90,41 @@ static time_t quiesce_start_time = 0;
  **/
 static int session_end_jobs = FALSE;
 
-static int quiesce_event_match (Event *event)
+/**
+ * quiesce_jobs:
+ *
+ * Shutdown plan; hash of QuiesceJob structures for the job classes that
+ * are to be stopped and those they depend on, indexed by class name.
+ **/
+static NihHash *quiesce_jobs = NULL;
+
+/**
+ * quiesce_timer:
+ *
+ * Timer for the end of the current phase.
+ **/
+static NihTimer *quiesce_timer = NULL;
+
+/**
+ * quiesce_changed:
+ *
+ * TRUE if a job instance has finished since quiesce_poll() last ran.
+ **/
+static int quiesce_changed = FALSE;
+
+static int         quiesce_event_match   (Event *event)
+	__attribute__ ((warn_unused_result));
+static QuiesceJob *quiesce_job_get       (const char *name);
+static void        quiesce_plan          (void);
+static int         quiesce_class_running (JobClass *class)
+	__attribute__ ((warn_unused_result));
+static int         quiesce_job_blocked   (JobClass *class)
 	__attribute__ ((warn_unused_result));
+static void        quiesce_stop_wave     (void);
+static void        quiesce_kill          (void);
+static void        quiesce_set_timer     (time_t timeout);
+static void        quiesce_timeout       (void *data, NihTimer *timer);
+static void        quiesce_report        (void);
 
 /* External definitions */
 extern int disable_respawn;
@@ -168,97 +207,395 @@ quiesce (QuiesceRequester requester)
 			 * However, already-running jobs *can* be stopped
 			 * at this time since by definition they do not
 			 * care about the session end event and may just
-			 * as well die now to avoid slowing the shutdown.
+			 * as well die now to avoid slowing the shutdown;
+			 * only those are in the plan for this phase.
 			 */
-			job_process_stop_all ();
+			quiesce_plan ();
+			quiesce_set_timer (QUIESCE_DEFAULT_JOB_RUNTIME);
 		} else {
 			nih_debug ("Skipping wait phase");
 			quiesce_phase = QUIESCE_PHASE_KILL;
 		}
 	}
 
-	if (quiesce_phase == QUIESCE_PHASE_KILL) {
-		/* We'll attempt to wait for this long, but system
-		 * policy may prevent it such that we just get killed
-		 * and job processes reparented to PID 1.
-		 */
-		max_kill_timeout = job_class_max_kill_timeout ();
+	if (quiesce_phase == QUIESCE_PHASE_KILL)
+		quiesce_kill ();
 
-		job_process_stop_all ();
-	}
+	/* Rather than checking every second whether jobs have finished,
+	 * stop them from the main loop and again each time one finishes.
+	 */
+	quiesce_changed = TRUE;
+	nih_main_loop_interrupt ();
+}
 
-	/* Check every second to see if all jobs have finished. If so,
-	 * we can exit early.
+/**
+ * quiesce_kill:
+ *
+ * Begin the kill phase, in which every job is stopped.
+ **/
+static void
+quiesce_kill (void)
+{
+	quiesce_phase = QUIESCE_PHASE_KILL;
+	quiesce_phase_time = time (NULL);
+
+	/* We'll attempt to wait for this long for every wave of jobs to
+	 * stop, but system policy may prevent it such that we just get
+	 * killed and job processes reparented to PID 1.
 	 */
-	NIH_MUST (nih_timer_add_periodic (NULL, 1,
-				(NihTimerCb)quiesce_wait_callback, NULL));
+	max_kill_timeout = job_class_max_kill_timeout ();
+
+	quiesce_plan ();
+	quiesce_set_timer (max_kill_timeout);
+
+	quiesce_changed = TRUE;
 }
 
 /**
- * quiesce_wait_callback:
+ * quiesce_poll:
  *
- * @data: not used,
- * @timer: timer that caused us to be called.
+ * Called from the main loop once a job instance has finished during
+ * shutdown, or when shutdown begins.  Moves on to the kill phase once
+ * no job processes remain in the wait phase, and finalises shutdown
+ * once none remain in the kill phase; otherwise stops the next wave of
+ * jobs.
+ **/
+void
+quiesce_poll (void)
+{
+	if (! quiesce_changed)
+		return;
+
+	quiesce_changed = FALSE;
+
+	if ((quiesce_phase == QUIESCE_PHASE_WAIT)
+	    && (! job_process_jobs_running ()))
+		quiesce_kill ();
+
+	if ((quiesce_phase == QUIESCE_PHASE_KILL)
+	    && (! job_process_jobs_running ())) {
+		/* Note that we might skip the kill phase for the session
+		 * requestor if no jobs are actually running at this point.
+		 */
+		quiesce_complete ();
+		return;
+	}
+
+	if ((quiesce_phase == QUIESCE_PHASE_WAIT)
+	    || (quiesce_phase == QUIESCE_PHASE_KILL))
+		quiesce_stop_wave ();
+}
+
+/**
+ * quiesce_job_finished:
+ * @job: job instance that has finished.
  *
- * Callback used to check if all jobs have finished and if so
- * finalise Session Init shutdown.
+ * Called once @job has reached the waiting state and been removed from
+ * the instances of its class, but before it is freed, to record the end
+ * of its class's stop and arrange for quiesce_poll() to stop any jobs
+ * that were waiting for it.
  **/
 void
-quiesce_wait_callback (void *data, NihTimer *timer)
+quiesce_job_finished (Job *job)
 {
-	time_t now;
+	QuiesceJob *qjob;
 
-	nih_assert (timer);
-	nih_assert (quiesce_phase_time);
-	nih_assert (quiesce_requester != QUIESCE_REQUESTER_INVALID);
+	nih_assert (job != NULL);
 
-	now = time (NULL);
+	if ((quiesce_phase != QUIESCE_PHASE_WAIT)
+	    && (quiesce_phase != QUIESCE_PHASE_KILL))
+		return;
 
-	if (quiesce_phase == QUIESCE_PHASE_KILL) {
-		nih_assert (max_kill_timeout);
+	qjob = (quiesce_jobs
+		? (QuiesceJob *)nih_hash_lookup (quiesce_jobs, job->class->name)
+		: NULL);
+	if (qjob && qjob->stop_time && (! quiesce_class_running (job->class)))
+		qjob->end_time = time (NULL);
 
-		if ((now - quiesce_phase_time) > max_kill_timeout)
-			goto timed_out;
+	quiesce_changed = TRUE;
+	nih_main_loop_interrupt ();
+}
 
-	} else if (quiesce_phase == QUIESCE_PHASE_WAIT) {
-		int  timed_out = 0;
+/**
+ * quiesce_job_get:
+ * @name: name of job class.
+ *
+ * Returns: entry of the shutdown plan for the job class named @name,
+ * created if necessary.
+ **/
+static QuiesceJob *
+quiesce_job_get (const char *name)
+{
+	QuiesceJob *qjob;
 
-		timed_out = ((now - quiesce_phase_time) >= QUIESCE_DEFAULT_JOB_RUNTIME);
+	nih_assert (name != NULL);
+	nih_assert (quiesce_jobs != NULL);
 
-		if (timed_out
-			|| (session_end_jobs && ! job_process_jobs_running ())
-			|| ! job_process_jobs_running ()) {
+	qjob = (QuiesceJob *)nih_hash_lookup (quiesce_jobs, name);
+	if (qjob)
+		return qjob;
 
-			quiesce_phase = QUIESCE_PHASE_KILL;
+	qjob = NIH_MUST (nih_new (quiesce_jobs, QuiesceJob));
+
+	nih_list_init (&qjob->entry);
+	nih_alloc_set_destructor (qjob, nih_list_destroy);
+
+	qjob->name = NIH_MUST (nih_strdup (qjob, name));
+	qjob->dependents = NIH_MUST (nih_str_array_new (qjob));
+	qjob->stop = FALSE;
+	qjob->stop_time = 0;
+	qjob->end_time = 0;
+
+	nih_hash_add (quiesce_jobs, &qjob->entry);
+
+	return qjob;
+}
+
+/**
+ * quiesce_plan:
+ *
+ * Adds every job class with running instances to the shutdown plan to
+ * be stopped in the current phase, recording it as a dependent of each
+ * job named by the job events in its start on and stop on conditions,
+ * such as "start on started foo" or "stop on stopping foo".
+ **/
+static void
+quiesce_plan (void)
+{
+	job_class_init ();
+
+	if (! quiesce_jobs)
+		quiesce_jobs = NIH_MUST (nih_hash_string_new (NULL, 0));
+
+	NIH_HASH_FOREACH (job_classes, iter) {
+		JobClass      *class = (JobClass *)iter;
+		QuiesceJob    *qjob;
+		EventOperator *roots[2];
+
+		if (! quiesce_class_running (class))
+			continue;
+
+		qjob = quiesce_job_get (class->name);
+		qjob->stop = TRUE;
+
+		roots[0] = class->start_on;
+		roots[1] = class->stop_on;
+
+		for (int i = 0; i < 2; i++) {
+			if (! roots[i])
+				continue;
+
+			NIH_TREE_FOREACH_POST (&roots[i]->node, oper_iter) {
+				EventOperator *oper = (EventOperator *)oper_iter;
+				QuiesceJob    *dep;
+				const char    *name;
+				char         **p;
+
+				if (oper->type != EVENT_MATCH)
+					continue;
 
-			/* reset for new phase */
-			quiesce_phase_time = time (NULL);
+				name = event_operator_job_name (oper);
+				if ((! name) || (name[0] == '$')
+				    || (! strcmp (name, class->name)))
+					continue;
 
-			max_kill_timeout = job_class_max_kill_timeout ();
+				dep = quiesce_job_get (name);
 
-			job_process_stop_all ();
+				for (p = dep->dependents; p && *p; p++)
+					if (! strcmp (*p, class->name))
+						break;
+
+				if (! (p && *p))
+					NIH_MUST (nih_str_array_add (&dep->dependents,
+								     dep, NULL,
+								     class->name));
+			}
 		}
-	} else {
-		nih_assert_not_reached ();
+	}
+}
+
+/**
+ * quiesce_class_running:
+ * @class: job class.
+ *
+ * Returns: TRUE if @class has any instances, FALSE otherwise.
+ **/
+static int
+quiesce_class_running (JobClass *class)
+{
+	nih_assert (class != NULL);
+
+	NIH_HASH_FOREACH (class->instances, iter)
+		return TRUE;
+
+	return FALSE;
+}
+
+/**
+ * quiesce_job_blocked:
+ * @class: job class.
+ *
+ * Returns: TRUE if instances of @class must not be stopped yet since a
+ * job depending on it is still running, FALSE otherwise.
+ **/
+static int
+quiesce_job_blocked (JobClass *class)
+{
+	QuiesceJob *qjob;
+
+	nih_assert (class != NULL);
+
+	qjob = (QuiesceJob *)nih_hash_lookup (quiesce_jobs, class->name);
+	if (! qjob)
+		return FALSE;
+
+	for (char **p = qjob->dependents; p && *p; p++) {
+		JobClass *dependent;
+
+		dependent = (JobClass *)nih_hash_lookup (job_classes, *p);
+		if (dependent && quiesce_class_running (dependent))
+			return TRUE;
 	}
 
-	if (! job_process_jobs_running ())
-		goto out;
+	return FALSE;
+}
 
-	return;
+/**
+ * quiesce_stop_wave:
+ *
+ * Requests every instance in the shutdown plan for the current phase
+ * that no running job depends on to stop, so that all such independent
+ * jobs stop together.  Instances of job classes that started during the
+ * kill phase are also stopped, but in no particular order.
+ *
+ * Should no job have been requested to stop, none be stopping and some
+ * be held back, their dependencies must be circular and every job in
+ * the plan is stopped, in either phase.
+ **/
+static void
+quiesce_stop_wave (void)
+{
+	int stopped = 0;
+	int stopping = 0;
+	int blocked = 0;
+
+	nih_assert (quiesce_jobs != NULL);
+
+	job_class_init ();
 
-timed_out:
-	quiesce_show_slow_jobs ();
+	NIH_HASH_FOREACH_SAFE (job_classes, iter) {
+		JobClass   *class = (JobClass *)iter;
+		QuiesceJob *qjob;
 
-out:
-	/* Note that we might skip the kill phase for the session
-	 * requestor if no jobs are actually running at this point.
+		if (! quiesce_class_running (class))
+			continue;
+
+		qjob = (QuiesceJob *)nih_hash_lookup (quiesce_jobs, class->name);
+		if ((! qjob) && (quiesce_phase == QUIESCE_PHASE_KILL)) {
+			qjob = quiesce_job_get (class->name);
+			qjob->stop = TRUE;
+		}
+
+		if ((! qjob) || (! qjob->stop))
+			continue;
+
+		NIH_HASH_FOREACH_SAFE (class->instances, job_iter) {
+			Job *job = (Job *)job_iter;
+
+			if (job->goal == JOB_STOP) {
+				stopping++;
+				continue;
+			}
+
+			if (quiesce_job_blocked (class)) {
+				blocked++;
+				continue;
+			}
+
+			if (! qjob->stop_time)
+				qjob->stop_time = time (NULL);
+
+			stopped++;
+
+			/* Request job instance stops */
+			job_change_goal (job, JOB_STOP);
+		}
+	}
+
+	if (stopped || stopping || (! blocked))
+		return;
+
+	/* Only jobs in the plan for the current phase are stopped, so
+	 * that jobs started by SESSION_END_EVENT during the wait phase
+	 * are still waited for.
 	 */
-	quiesce_phase = QUIESCE_PHASE_CLEANUP;
-	quiesce_finalise ();
+	nih_debug ("Stopping jobs with circular dependencies");
+
+	NIH_HASH_FOREACH_SAFE (job_classes, iter) {
+		JobClass   *class = (JobClass *)iter;
+		QuiesceJob *qjob;
 
-	/* Deregister */
-	nih_free (timer);
+		qjob = (QuiesceJob *)nih_hash_lookup (quiesce_jobs, class->name);
+		if ((! qjob) || (! qjob->stop))
+			continue;
+
+		NIH_HASH_FOREACH_SAFE (class->instances, job_iter) {
+			Job *job = (Job *)job_iter;
+
+			if (job->goal == JOB_STOP)
+				continue;
+
+			if (! qjob->stop_time)
+				qjob->stop_time = time (NULL);
+
+			job_change_goal (job, JOB_STOP);
+		}
+	}
+}
+
+/**
+ * quiesce_set_timer:
+ * @timeout: seconds until the current phase ends.
+ *
+ * Replaces the timer for the end of the current phase.
+ **/
+static void
+quiesce_set_timer (time_t timeout)
+{
+	if (quiesce_timer)
+		nih_free (quiesce_timer);
+
+	quiesce_timer = NIH_MUST (nih_timer_add_timeout (NULL, timeout,
+				(NihTimerCb)quiesce_timeout, NULL));
+}
+
+/**
+ * quiesce_timeout:
+ *
+ * @data: not used,
+ * @timer: timer that caused us to be called.
+ *
+ * Callback used at the end of the wait phase to stop all jobs, and at
+ * the end of the kill phase to finalise Session Init shutdown even
+ * though some jobs have not finished.
+ **/
+static void
+quiesce_timeout (void *data, NihTimer *timer)
+{
+	nih_assert (timer);
+	nih_assert (timer == quiesce_timer);
+	nih_assert (quiesce_phase_time);
+	nih_assert (quiesce_requester != QUIESCE_REQUESTER_INVALID);
+
+	quiesce_timer = NULL;
+
+	if (quiesce_phase == QUIESCE_PHASE_WAIT) {
+		quiesce_kill ();
+		quiesce_poll ();
+	} else if (quiesce_phase == QUIESCE_PHASE_KILL) {
+		quiesce_show_slow_jobs ();
+		quiesce_complete ();
+	}
 }
 
 /**
@@ -274,20 +611,56 @@ quiesce_show_slow_jobs (void)
 	NIH_HASH_FOREACH (job_classes, iter) {
 		JobClass *class = (JobClass *)iter;
 
-		/* Note that instances get killed in a random order */
 		NIH_HASH_FOREACH (class->instances, job_iter) {
 			const char  *name;
 			Job         *job;
-		       
+
 			job = (Job *)job_iter;
 
 			name = job_name (job);
 
-			nih_warn ("job %s failed to stop", name);
+			/* Jobs not yet requested to stop were held back
+			 * by the jobs depending on them.
+			 */
+			if (job->goal != JOB_STOP) {
+				nih_warn ("job %s waiting for dependent jobs to stop",
+					  name);
+			} else {
+				nih_warn ("job %s failed to stop", name);
+			}
 		}
 	}
 }
 
+/**
+ * quiesce_report:
+ *
+ * List jobs that delayed shutdown, being the time from their being
+ * requested to stop until their last instance finished; jobs waiting
+ * for them were held back for that long.
+ **/
+static void
+quiesce_report (void)
+{
+	if (! quiesce_jobs)
+		return;
+
+	NIH_HASH_FOREACH (quiesce_jobs, iter) {
+		QuiesceJob *qjob = (QuiesceJob *)iter;
+		time_t      diff;
+
+		if ((! qjob->stop_time) || (! qjob->end_time))
+			continue;
+
+		diff = qjob->end_time - qjob->stop_time;
+		if (diff < 1)
+			continue;
+
+		nih_info (_("Job %s delayed shutdown by %d second%s"),
+			  qjob->name, (int)diff, diff == 1 ? "" : "s");
+	}
+}
+
 
 /**
  * quiesce_finalise:
@@ -308,6 +681,13 @@ quiesce_finalise (void)
 
 	finalising = TRUE;
 
+	if (quiesce_timer) {
+		nih_free (quiesce_timer);
+		quiesce_timer = NULL;
+	}
+
+	quiesce_report ();
+
 	diff = time (NULL) - quiesce_start_time;
 
 	nih_info (_("Quiesce %s sequence took %s%d second%s"),
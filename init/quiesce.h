@@ -20,8 +20,14 @@
 #ifndef INIT_QUIESCE_H
 #define INIT_QUIESCE_H
 
+#include <time.h>
+
+#include <nih/macros.h>
+#include <nih/list.h>
 #include <nih/timer.h>
 
+#include "job.h"
+
 /**
  * QUIESCE_DEFAULT_JOB_RUNTIME:
  *
@@ -64,10 +70,35 @@ typedef enum quiesce_phase {
 	QUIESCE_PHASE_CLEANUP,
 } QuiescePhase;
 
+/**
+ * QuiesceJob:
+ * @entry: hash list entry,
+ * @name: name of job class,
+ * @dependents: names of job classes whose start on or stop on condition
+ * references this one,
+ * @stop: TRUE if instances are to be stopped in the current phase,
+ * @stop_time: time instances were first requested to stop, or zero,
+ * @end_time: time the last instance finished, or zero.
+ *
+ * Entry of the shutdown plan.  Instances of a job class are only
+ * requested to stop once no job depending on it is still running, so
+ * that jobs stop in the reverse order to that in which they started
+ * with independent jobs stopping together.
+ **/
+typedef struct quiesce_job {
+	NihList   entry;
+	char     *name;
+	char    **dependents;
+	int       stop;
+	time_t    stop_time;
+	time_t    end_time;
+} QuiesceJob;
+
 NIH_BEGIN_EXTERN
 
 void    quiesce                (QuiesceRequester requester);
-void    quiesce_wait_callback  (void *data, NihTimer *timer);
+void    quiesce_poll           (void);
+void    quiesce_job_finished   (Job *job);
 void    quiesce_show_slow_jobs (void);
 void    quiesce_finalise       (void);
 void    quiesce_complete       (void);
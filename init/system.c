@@ -27,9 +27,15 @@
 #include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/mount.h>
+#include <sys/syscall.h>
 
+#include <ctype.h>
+#include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <sched.h>
 #include <signal.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <termios.h>
@@ -45,6 +51,48 @@
 #include "job_class.h"
 
 
+/**
+ * __NR_pidfd_open, __NR_pidfd_send_signal:
+ *
+ * System call numbers, which are the same on every architecture, for
+ * C libraries that do not yet define them.
+ **/
+#ifndef __NR_pidfd_send_signal
+#define __NR_pidfd_send_signal 424
+#endif
+#ifndef __NR_pidfd_open
+#define __NR_pidfd_open 434
+#endif
+
+/**
+ * MPOL_DEFAULT, MPOL_PREFERRED, MPOL_BIND, MPOL_INTERLEAVE, MPOL_LOCAL:
+ *
+ * Memory policy modes from the kernel's mempolicy.h, which is not part
+ * of the C library.
+ **/
+#ifndef MPOL_DEFAULT
+#define MPOL_DEFAULT    0
+#define MPOL_PREFERRED  1
+#define MPOL_BIND       2
+#define MPOL_INTERLEAVE 3
+#define MPOL_LOCAL      4
+#endif
+
+/**
+ * SYSTEM_LONG_BITS:
+ *
+ * Number of bits in each word of a bitmask.
+ **/
+#define SYSTEM_LONG_BITS (sizeof (unsigned long) * CHAR_BIT)
+
+/**
+ * SYSTEM_NUMA_NODES:
+ *
+ * Number of NUMA nodes that may be given in a memory policy.
+ **/
+#define SYSTEM_NUMA_NODES 1024
+
+
 /**
  * system_kill:
  * @pid: process id of process,
@@ -71,6 +119,62 @@ system_kill (pid_t pid,
 	return 0;
 }
 
+/**
+ * system_pidfd_open:
+ * @pid: process id of process.
+ *
+ * Obtains a file descriptor referring to the process @pid, which becomes
+ * readable when it terminates and, unlike @pid, can never refer to any
+ * other process.  The descriptor is closed on exec.
+ *
+ * Returns: file descriptor on success, negative value on raised error.
+ **/
+int
+system_pidfd_open (pid_t pid)
+{
+	int fd;
+
+	nih_assert (pid > 0);
+
+	fd = syscall (__NR_pidfd_open, pid, 0);
+	if (fd < 0)
+		nih_return_system_error (-1);
+
+	if (fcntl (fd, F_SETFD, FD_CLOEXEC) < 0) {
+		nih_error_raise_system ();
+		close (fd);
+		return -1;
+	}
+
+	return fd;
+}
+
+/**
+ * system_pidfd_kill:
+ * @pidfd: file descriptor referring to @pid,
+ * @pid: process id of process,
+ * @signal: signal to send.
+ *
+ * Sends @signal to the process group of @pid as system_kill() does, but
+ * only once @pidfd has confirmed that @pid is still the process it was
+ * opened for and has not been reaped and its id reused.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+system_pidfd_kill (int   pidfd,
+		   pid_t pid,
+		   int   signal)
+{
+	nih_assert (pidfd >= 0);
+	nih_assert (pid > 0);
+
+	if (syscall (__NR_pidfd_send_signal, pidfd, 0, NULL, 0) < 0)
+		nih_return_system_error (-1);
+
+	return system_kill (pid, signal);
+}
+
 
 /**
  * system_setup_console:
@@ -269,3 +373,158 @@ system_check_file (const char *path, mode_t type, dev_t dev)
 
 	return 0;
 }
+
+/**
+ * system_parse_list:
+ * @list: list of numbers,
+ * @mask: bitmask to fill in,
+ * @size: number of bits in @mask.
+ *
+ * Parses @list, a comma-separated list of numbers and inclusive ranges
+ * of numbers in the form the kernel uses for CPU and NUMA node lists,
+ * such as "0-3,8", setting the corresponding bits of @mask and clearing
+ * all others.  @size must be a multiple of the number of bits in a long.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+system_parse_list (const char    *list,
+		   unsigned long *mask,
+		   size_t         size)
+{
+	const char *p;
+
+	nih_assert (list != NULL);
+	nih_assert (mask != NULL);
+	nih_assert (size % SYSTEM_LONG_BITS == 0);
+
+	memset (mask, 0, size / CHAR_BIT);
+
+	p = list;
+	for (;;) {
+		char          *endptr;
+		unsigned long  first, last;
+
+		if (! isdigit ((unsigned char)*p))
+			goto error;
+
+		errno = 0;
+		first = last = strtoul (p, &endptr, 10);
+
+		if (*endptr == '-') {
+			p = endptr + 1;
+			if (! isdigit ((unsigned char)*p))
+				goto error;
+
+			last = strtoul (p, &endptr, 10);
+		}
+
+		if (errno || (last < first) || (last >= size))
+			goto error;
+
+		for (unsigned long i = first; i <= last; i++)
+			mask[i / SYSTEM_LONG_BITS] |= 1UL << (i % SYSTEM_LONG_BITS);
+
+		p = endptr;
+		if (*p != ',')
+			break;
+
+		p++;
+	}
+
+	if (*p)
+		goto error;
+
+	return 0;
+
+error:
+	errno = EINVAL;
+	nih_return_system_error (-1);
+}
+
+/**
+ * system_set_affinity:
+ * @cpus: list of CPUs.
+ *
+ * Restricts the calling process, and any it creates afterwards, to run
+ * only on the CPUs in @cpus, given as for system_parse_list().
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+system_set_affinity (const char *cpus)
+{
+	unsigned long mask[CPU_SETSIZE / SYSTEM_LONG_BITS];
+	cpu_set_t     set;
+
+	nih_assert (cpus != NULL);
+
+	if (system_parse_list (cpus, mask, CPU_SETSIZE) < 0)
+		return -1;
+
+	CPU_ZERO (&set);
+	for (size_t i = 0; i < CPU_SETSIZE; i++)
+		if (mask[i / SYSTEM_LONG_BITS] & (1UL << (i % SYSTEM_LONG_BITS)))
+			CPU_SET (i, &set);
+
+	if (sched_setaffinity (0, sizeof (set), &set) < 0)
+		nih_return_system_error (-1);
+
+	return 0;
+}
+
+/**
+ * system_set_mempolicy:
+ * @policy: NUMA memory policy,
+ * @nodes: list of NUMA nodes, may be NULL.
+ *
+ * Sets the memory policy of the calling process, which is inherited by
+ * any it creates afterwards, to @policy over the NUMA nodes in @nodes,
+ * given as for system_parse_list().  @nodes is required for NUMA_BIND
+ * and NUMA_INTERLEAVE, optional for NUMA_PREFERRED (allocating locally
+ * when not given) and ignored otherwise.
+ *
+ * Returns: zero on success, negative value on raised error.
+ **/
+int
+system_set_mempolicy (NumaPolicy  policy,
+		      const char *nodes)
+{
+	unsigned long  mask[SYSTEM_NUMA_NODES / SYSTEM_LONG_BITS];
+	unsigned long *maskp = NULL;
+	unsigned long  maxnode = 0;
+	int            mode;
+
+	switch (policy) {
+	case NUMA_DEFAULT:
+		mode = MPOL_DEFAULT;
+		break;
+	case NUMA_BIND:
+		mode = MPOL_BIND;
+		break;
+	case NUMA_PREFERRED:
+		mode = MPOL_PREFERRED;
+		break;
+	case NUMA_INTERLEAVE:
+		mode = MPOL_INTERLEAVE;
+		break;
+	case NUMA_LOCAL:
+		mode = MPOL_LOCAL;
+		break;
+	default:
+		nih_assert_not_reached ();
+	}
+
+	if (nodes && (mode != MPOL_DEFAULT) && (mode != MPOL_LOCAL)) {
+		if (system_parse_list (nodes, mask, SYSTEM_NUMA_NODES) < 0)
+			return -1;
+
+		maskp = mask;
+		maxnode = SYSTEM_NUMA_NODES + 1;
+	}
+
+	if (syscall (SYS_set_mempolicy, mode, maskp, maxnode) < 0)
+		nih_return_system_error (-1);
+
+	return 0;
+}
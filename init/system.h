@@ -32,6 +32,11 @@ NIH_BEGIN_EXTERN
 int system_kill          (pid_t pid, int signal)
 	__attribute__ ((warn_unused_result));
 
+int system_pidfd_open    (pid_t pid)
+	__attribute__ ((warn_unused_result));
+int system_pidfd_kill    (int pidfd, pid_t pid, int signal)
+	__attribute__ ((warn_unused_result));
+
 int system_setup_console (ConsoleType type, int reset)
 	__attribute__ ((warn_unused_result));
 
@@ -44,6 +49,15 @@ void system_mknod        (const char *path, mode_t mode, dev_t dev);
 int  system_check_file   (const char *path, mode_t type, dev_t dev)
 	__attribute__ ((warn_unused_result));
 
+int  system_parse_list    (const char *list, unsigned long *mask,
+			  size_t size)
+	__attribute__ ((warn_unused_result));
+
+int  system_set_affinity  (const char *cpus)
+	__attribute__ ((warn_unused_result));
+int  system_set_mempolicy (NumaPolicy policy, const char *nodes)
+	__attribute__ ((warn_unused_result));
+
 NIH_END_EXTERN
 
 #endif /* INIT_SYSTEM_H */
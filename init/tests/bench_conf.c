@@ -0,0 +1,143 @@
+/* upstart
+ *
+ * bench_conf.c - measure the cost of loading a large job directory
+ *
+ * Copyright © 2014 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/main.h>
+#include <nih/logging.h>
+#include <nih/error.h>
+
+#include "job_class.h"
+#include "conf.h"
+
+
+/**
+ * MANY_JOB_CLASSES:
+ *
+ * Number of job configuration files to generate when measuring the
+ * cost of loading a large job directory.
+ **/
+#define MANY_JOB_CLASSES 2000
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	ConfSource      *source;
+	FILE            *f;
+	char             dirname[PATH_MAX], filename[PATH_MAX];
+	struct timespec  start, end;
+	struct rusage    before, after;
+	int              ret, i;
+
+	nih_main_init (argv[0]);
+	nih_log_set_priority (NIH_LOG_FATAL);
+
+	/* run in legacy (pre-session support) mode, as the tests do */
+	setenv ("UPSTART_NO_SESSIONS", "1", 1);
+
+	snprintf (dirname, sizeof (dirname), "%s/%s.XXXXXX",
+		  getenv ("TMPDIR") ? getenv ("TMPDIR") : "/tmp",
+		  program_name);
+	if (! mkdtemp (dirname)) {
+		nih_fatal ("%s: %s", dirname, strerror (errno));
+		exit (1);
+	}
+
+	/* Generate job configuration files much like those found on a
+	 * real system, each with a description, environment, start and
+	 * stop conditions naming common events and other jobs, and a
+	 * main process.
+	 */
+	for (i = 0; i < MANY_JOB_CLASSES; i++) {
+		sprintf (filename, "%s/job%d.conf", dirname, i);
+
+		f = fopen (filename, "w");
+		if (! f) {
+			nih_fatal ("%s: %s", filename, strerror (errno));
+			exit (1);
+		}
+
+		fprintf (f, "description \"job %d\"\n", i);
+		fprintf (f, "env FOO=%d\n", i);
+		fprintf (f, "env BAR=wibble\n");
+		fprintf (f, "export FOO\n");
+		fprintf (f, "start on (filesystem and net-device-up IFACE!=lo)"
+			 " or started job%d\n", i ? i - 1 : 0);
+		fprintf (f, "stop on runlevel [!2345] or stopping job%d\n",
+			 i ? i - 1 : 0);
+		fprintf (f, "respawn\n");
+		fprintf (f, "exec /sbin/daemon --instance %d\n", i);
+		fclose (f);
+	}
+
+	source = NIH_MUST (conf_source_new (NULL, dirname, CONF_JOB_DIR));
+
+	/* Measure the time taken to parse the directory and the growth in
+	 * resident set size, so that changes to the per-class allocation
+	 * overhead can be compared.
+	 */
+	getrusage (RUSAGE_SELF, &before);
+	clock_gettime (CLOCK_MONOTONIC, &start);
+
+	ret = conf_source_reload (source);
+
+	clock_gettime (CLOCK_MONOTONIC, &end);
+	getrusage (RUSAGE_SELF, &after);
+
+	if (ret < 0) {
+		NihError *err;
+
+		err = nih_error_get ();
+		nih_fatal ("%s: %s", dirname, err->message);
+		exit (1);
+	}
+
+	printf ("loaded %d job classes in %.3fs, maxrss grew by %ldkB\n",
+		MANY_JOB_CLASSES,
+		(double)(end.tv_sec - start.tv_sec)
+		+ (double)(end.tv_nsec - start.tv_nsec) / 1000000000.0,
+		after.ru_maxrss - before.ru_maxrss);
+
+	nih_free (source);
+
+	for (i = 0; i < MANY_JOB_CLASSES; i++) {
+		sprintf (filename, "%s/job%d.conf", dirname, i);
+		unlink (filename);
+	}
+
+	rmdir (dirname);
+
+	return 0;
+}
@@ -0,0 +1,98 @@
+/* upstart
+ *
+ * bench_environ.c - measure the rate of environment expansion
+ *
+ * Copyright © 2014 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/main.h>
+#include <nih/logging.h>
+
+#include "environ.h"
+
+
+/**
+ * EXPAND_ROUNDS:
+ *
+ * Number of times each string is expanded.
+ **/
+#define EXPAND_ROUNDS 100000
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	struct timespec  start, end;
+	char            *env[8], *str;
+	const char      *strings[] = {
+		"",
+		"tty1",
+		"$TTY",
+		"${JOB}-${INSTANCE}",
+		"/var/run/$JOB/$INSTANCE.pid",
+		"${IFACE:-lo}",
+		NULL
+	};
+	double           elapsed;
+	int              i, j;
+
+	nih_main_init (argv[0]);
+
+	/* Expand the kinds of string found in instance names and event
+	 * matches of real job definitions, which between them take each
+	 * path through environ_expand(), against the environment of a
+	 * typical event.
+	 */
+	env[0] = "UPSTART_EVENTS=net-device-up";
+	env[1] = "JOB=network-interface";
+	env[2] = "INSTANCE=eth0";
+	env[3] = "IFACE=eth0";
+	env[4] = "LOGICAL=eth0";
+	env[5] = "ADDRFAM=inet";
+	env[6] = "TTY=tty2";
+	env[7] = NULL;
+
+	clock_gettime (CLOCK_MONOTONIC, &start);
+
+	for (i = 0; i < EXPAND_ROUNDS; i++) {
+		for (j = 0; strings[j]; j++) {
+			str = environ_expand (NULL, strings[j], env);
+			if (! str) {
+				nih_fatal ("%s: %s", strings[j],
+					   "expansion failed");
+				exit (1);
+			}
+
+			nih_free (str);
+		}
+	}
+
+	clock_gettime (CLOCK_MONOTONIC, &end);
+
+	elapsed = (double)(end.tv_sec - start.tv_sec)
+		+ (double)(end.tv_nsec - start.tv_nsec) / 1000000000.0;
+
+	printf ("%.0f expansions/sec\n", (i * j) / elapsed);
+
+	return 0;
+}
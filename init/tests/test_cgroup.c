@@ -0,0 +1,477 @@
+/* upstart
+ *
+ * test_cgroup.c - test suite for init/cgroup.c
+ *
+ * Copyright © 2014 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <nih/test.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <errno.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/string.h>
+#include <nih/error.h>
+
+#include "cgroup.h"
+
+
+/**
+ * write_procs:
+ * @dirname: directory standing in for a control group,
+ * @pids: zero-terminated array of process ids.
+ *
+ * Writes @pids to the cgroup.procs file of @dirname as the kernel
+ * would list them.
+ **/
+static void
+write_procs (const char  *dirname,
+	     const pid_t *pids)
+{
+	char  filename[PATH_MAX];
+	FILE *f;
+
+	strcpy (filename, dirname);
+	strcat (filename, "/cgroup.procs");
+
+	f = fopen (filename, "w");
+	for (; *pids; pids++)
+		fprintf (f, "%d\n", *pids);
+	fclose (f);
+}
+
+/**
+ * remove_procs:
+ * @dirname: directory standing in for a control group.
+ *
+ * Removes @dirname and its cgroup.procs file.
+ **/
+static void
+remove_procs (const char *dirname)
+{
+	char filename[PATH_MAX];
+
+	strcpy (filename, dirname);
+	strcat (filename, "/cgroup.procs");
+	unlink (filename);
+
+	rmdir (dirname);
+}
+
+
+void
+test_path (void)
+{
+	char  root[PATH_MAX];
+	char  dirname[PATH_MAX];
+	char  expected[PATH_MAX];
+	pid_t pids[2];
+	char *path;
+
+	TEST_FUNCTION ("cgroup_path");
+	cgroup_root = "/sys/fs/cgroup/upstart";
+
+
+	/* Check that the control group of a job without an instance name
+	 * is named after its class.
+	 */
+	TEST_FEATURE ("without instance");
+	TEST_ALLOC_FAIL {
+		path = cgroup_path (NULL, "foo", "");
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (path, NULL);
+			continue;
+		}
+
+		TEST_EQ_STR (path, "/sys/fs/cgroup/upstart/foo");
+		nih_free (path);
+	}
+
+
+	/* Check that the instance name follows the class name. */
+	TEST_FEATURE ("with instance");
+	TEST_ALLOC_FAIL {
+		path = cgroup_path (NULL, "foo", "bar");
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (path, NULL);
+			continue;
+		}
+
+		TEST_EQ_STR (path, "/sys/fs/cgroup/upstart/foo@bar");
+		nih_free (path);
+	}
+
+
+	/* Check that slashes in the class and instance names are replaced
+	 * so that every job has a control group directly below the root.
+	 */
+	TEST_FEATURE ("with slashes");
+	path = cgroup_path (NULL, "foo/bar", "/dev/sda");
+
+	TEST_EQ_STR (path, "/sys/fs/cgroup/upstart/foo.bar@.dev.sda");
+	nih_free (path);
+
+
+	/* Check that when the control group still contains processes left
+	 * behind by a previous instance, a different control group is
+	 * used so that they are never taken for those of the new one; and
+	 * that the original is used again once they have gone.
+	 */
+	TEST_FEATURE ("with processes left behind");
+	TEST_FILENAME (root);
+	mkdir (root, 0755);
+	cgroup_root = root;
+
+	strcpy (dirname, root);
+	strcat (dirname, "/foo");
+	mkdir (dirname, 0755);
+
+	pids[0] = getpid ();
+	pids[1] = 0;
+	write_procs (dirname, pids);
+
+	path = cgroup_path (NULL, "foo", "");
+
+	strcpy (expected, dirname);
+	strcat (expected, "#1");
+	TEST_EQ_STR (path, expected);
+	nih_free (path);
+
+	remove_procs (dirname);
+
+	path = cgroup_path (NULL, "foo", "");
+
+	TEST_EQ_STR (path, dirname);
+	nih_free (path);
+
+	rmdir (root);
+
+	cgroup_root = NULL;
+}
+
+
+void
+test_enter (void)
+{
+	char      dirname[PATH_MAX], filename[PATH_MAX];
+	pid_t     pids[] = { 0 };
+	NihError *err;
+	FILE     *f;
+	int       ret;
+
+	TEST_FUNCTION ("cgroup_enter");
+	TEST_FILENAME (dirname);
+	mkdir (dirname, 0755);
+	write_procs (dirname, pids);
+
+	strcpy (filename, dirname);
+	strcat (filename, "/cgroup.procs");
+
+
+	/* Check that the process id is written to the cgroup.procs file,
+	 * which moves it into the control group.
+	 */
+	TEST_FEATURE ("with process");
+	ret = cgroup_enter (dirname, 1234);
+
+	TEST_EQ (ret, 0);
+
+	f = fopen (filename, "r");
+	TEST_FILE_EQ (f, "1234\n");
+	TEST_FILE_END (f);
+	fclose (f);
+
+
+	/* Check that an error is raised if the control group does not
+	 * exist.
+	 */
+	TEST_FEATURE ("with missing control group");
+	remove_procs (dirname);
+
+	ret = cgroup_enter (dirname, 1234);
+
+	TEST_LT (ret, 0);
+	err = nih_error_get ();
+	TEST_EQ (err->number, ENOENT);
+	nih_free (err);
+}
+
+
+void
+test_enable (void)
+{
+	char  dirname[PATH_MAX], root[PATH_MAX];
+	char  parent_file[PATH_MAX], root_file[PATH_MAX];
+	FILE *f;
+	int   ret;
+
+	TEST_FUNCTION ("cgroup_enable");
+	TEST_FILENAME (dirname);
+	mkdir (dirname, 0755);
+
+	strcpy (root, dirname);
+	strcat (root, "/upstart");
+	mkdir (root, 0755);
+
+	strcpy (parent_file, dirname);
+	strcat (parent_file, "/cgroup.subtree_control");
+	fclose (fopen (parent_file, "w"));
+
+	strcpy (root_file, root);
+	strcat (root_file, "/cgroup.subtree_control");
+	fclose (fopen (root_file, "w"));
+
+	cgroup_root = root;
+
+
+	/* Check that the controller is enabled both in the control group
+	 * above cgroup_root and in cgroup_root itself.
+	 */
+	TEST_FEATURE ("with controller");
+	ret = cgroup_enable ("memory");
+
+	TEST_EQ (ret, 0);
+
+	f = fopen (parent_file, "r");
+	TEST_FILE_EQ (f, "+memory");
+	TEST_FILE_END (f);
+	fclose (f);
+
+	f = fopen (root_file, "r");
+	TEST_FILE_EQ (f, "+memory");
+	TEST_FILE_END (f);
+	fclose (f);
+
+
+	/* Check that a controller already enabled is not written again
+	 * each time another job needs it.
+	 */
+	TEST_FEATURE ("with controller already enabled");
+	fclose (fopen (parent_file, "w"));
+	fclose (fopen (root_file, "w"));
+
+	ret = cgroup_enable ("memory");
+
+	TEST_EQ (ret, 0);
+
+	f = fopen (parent_file, "r");
+	TEST_FILE_END (f);
+	fclose (f);
+
+	f = fopen (root_file, "r");
+	TEST_FILE_END (f);
+	fclose (f);
+
+	cgroup_root = NULL;
+
+	unlink (root_file);
+	rmdir (root);
+	unlink (parent_file);
+	rmdir (dirname);
+}
+
+
+void
+test_set (void)
+{
+	char      dirname[PATH_MAX], filename[PATH_MAX];
+	NihError *err;
+	FILE     *f;
+	int       ret;
+
+	TEST_FUNCTION ("cgroup_set");
+	TEST_FILENAME (dirname);
+	mkdir (dirname, 0755);
+
+	strcpy (filename, dirname);
+	strcat (filename, "/cpu.max");
+	fclose (fopen (filename, "w"));
+
+
+	/* Check that the formatted value is written to the named control
+	 * file of the control group.
+	 */
+	TEST_FEATURE ("with control file");
+	ret = cgroup_set (dirname, "cpu.max", "%d 100000", 50000);
+
+	TEST_EQ (ret, 0);
+
+	f = fopen (filename, "r");
+	TEST_FILE_EQ (f, "50000 100000");
+	TEST_FILE_END (f);
+	fclose (f);
+
+
+	/* Check that an error is raised if the control file does not
+	 * exist, as when its controller is not enabled.
+	 */
+	TEST_FEATURE ("with missing control file");
+	ret = cgroup_set (dirname, "memory.max", "%d", 1024);
+
+	TEST_LT (ret, 0);
+	err = nih_error_get ();
+	TEST_EQ (err->number, ENOENT);
+	nih_free (err);
+
+	unlink (filename);
+	rmdir (dirname);
+}
+
+
+void
+test_main_pid (void)
+{
+	char  dirname[PATH_MAX];
+	pid_t pids[3], child, pid;
+	int   ret;
+
+	TEST_FUNCTION ("cgroup_main_pid");
+	TEST_FILENAME (dirname);
+	mkdir (dirname, 0755);
+
+	TEST_CHILD (child) {
+		pause ();
+	}
+
+
+	/* Check that only a process whose parent is ourselves is found,
+	 * as a daemon re-parented to us would be, and not processes whose
+	 * parent is also in the control group.
+	 */
+	TEST_FEATURE ("with re-parented process");
+	pids[0] = getpid ();
+	pids[1] = child;
+	pids[2] = 0;
+	write_procs (dirname, pids);
+
+	pid = 0;
+	ret = cgroup_main_pid (dirname, 0, &pid);
+
+	TEST_EQ (ret, 1);
+	TEST_EQ (pid, child);
+
+
+	/* Check that the excluded process is not found. */
+	TEST_FEATURE ("with excluded process");
+	pid = 0;
+	ret = cgroup_main_pid (dirname, child, &pid);
+
+	TEST_EQ (ret, 0);
+	TEST_EQ (pid, 0);
+
+	kill (child, SIGTERM);
+	waitpid (child, NULL, 0);
+	remove_procs (dirname);
+}
+
+
+void
+test_kill (void)
+{
+	char      dirname[PATH_MAX];
+	pid_t     pids[2], child;
+	NihError *err;
+	int       ret, status;
+
+	TEST_FUNCTION ("cgroup_kill");
+	TEST_FILENAME (dirname);
+	mkdir (dirname, 0755);
+
+
+	/* Check that every process in the control group is sent the
+	 * signal.
+	 */
+	TEST_FEATURE ("with process");
+	TEST_CHILD (child) {
+		pause ();
+	}
+
+	pids[0] = child;
+	pids[1] = 0;
+	write_procs (dirname, pids);
+
+	ret = cgroup_kill (dirname, SIGTERM);
+
+	TEST_EQ (ret, 0);
+
+	waitpid (child, &status, 0);
+	TEST_TRUE (WIFSIGNALED (status));
+	TEST_EQ (WTERMSIG (status), SIGTERM);
+
+
+	/* Check that SIGKILL is sent to each process in turn when the
+	 * kernel cannot kill the control group itself.
+	 */
+	TEST_FEATURE ("with SIGKILL");
+	TEST_CHILD (child) {
+		pause ();
+	}
+
+	pids[0] = child;
+	write_procs (dirname, pids);
+
+	ret = cgroup_kill (dirname, SIGKILL);
+
+	TEST_EQ (ret, 0);
+
+	waitpid (child, &status, 0);
+	TEST_TRUE (WIFSIGNALED (status));
+	TEST_EQ (WTERMSIG (status), SIGKILL);
+
+
+	/* Check that ESRCH is raised when there are no processes in the
+	 * control group.
+	 */
+	TEST_FEATURE ("with empty control group");
+	pids[0] = 0;
+	write_procs (dirname, pids);
+
+	ret = cgroup_kill (dirname, SIGTERM);
+
+	TEST_LT (ret, 0);
+	err = nih_error_get ();
+	TEST_EQ (err->number, ESRCH);
+	nih_free (err);
+
+	remove_procs (dirname);
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	test_path ();
+	test_enter ();
+	test_enable ();
+	test_set ();
+	test_main_pid ();
+	test_kill ();
+
+	return 0;
+}
@@ -0,0 +1,299 @@
+/* upstart
+ *
+ * test_check_config.c - test suite for init/check_config.c
+ *
+ * Copyright © 2014 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <nih/test.h>
+
+#include <sys/stat.h>
+
+#include <stdio.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/string.h>
+#include <nih/hash.h>
+#include <nih/tree.h>
+#include <nih/main.h>
+#include <nih/logging.h>
+
+#include "job_class.h"
+#include "events.h"
+#include "event_operator.h"
+#include "conf.h"
+#include "check_config.h"
+
+
+/**
+ * match_new:
+ * @parent: parent object,
+ * @name: name of event,
+ * @arg: first argument, may be NULL.
+ *
+ * Returns: new EVENT_MATCH operator.
+ **/
+static EventOperator *
+match_new (const void *parent,
+	   const char *name,
+	   const char *arg)
+{
+	EventOperator *oper;
+
+	oper = event_operator_new (parent, EVENT_MATCH, name, NULL);
+
+	if (arg) {
+		oper->env = nih_str_array_new (oper);
+		NIH_MUST (nih_str_array_add (&oper->env, oper, NULL, arg));
+	}
+
+	return oper;
+}
+
+/**
+ * binary_new:
+ * @parent: parent object,
+ * @type: EVENT_AND or EVENT_OR,
+ * @left: left operand,
+ * @right: right operand.
+ *
+ * Returns: new operator combining @left and @right.
+ **/
+static EventOperator *
+binary_new (const void        *parent,
+	    EventOperatorType  type,
+	    EventOperator     *left,
+	    EventOperator     *right)
+{
+	EventOperator *oper;
+
+	oper = event_operator_new (parent, type, NULL, NULL);
+	nih_tree_add (&oper->node, &left->node, NIH_TREE_LEFT);
+	nih_tree_add (&oper->node, &right->node, NIH_TREE_RIGHT);
+
+	return oper;
+}
+
+
+void
+test_operator (void)
+{
+	JobClass      *class;
+	CheckConfig   *check;
+	EventOperator *oper;
+	char          *ignored[] = { "wibble", NULL };
+
+	TEST_FUNCTION ("check_config_operator");
+	job_class_init ();
+
+	class = job_class_new (NULL, "foo", NULL);
+	class->emits = nih_str_array_new (class);
+	NIH_MUST (nih_str_array_add (&class->emits, class, NULL, "peach"));
+	NIH_MUST (nih_str_array_add (&class->emits, class, NULL, "fruit-*"));
+	nih_hash_add (job_classes, &class->entry);
+
+	check = check_config_new (NULL, FALSE, ignored);
+
+
+	/* Check that events emitted by a job, matching a glob in emits,
+	 * emitted by init or ignored are reachable while others are not.
+	 */
+	TEST_FEATURE ("with event");
+	oper = match_new (NULL, "peach", NULL);
+	TEST_TRUE (check_config_operator (check, oper));
+	nih_free (oper);
+
+	oper = match_new (NULL, "fruit-apple", NULL);
+	TEST_TRUE (check_config_operator (check, oper));
+	nih_free (oper);
+
+	oper = match_new (NULL, STARTUP_EVENT, NULL);
+	TEST_TRUE (check_config_operator (check, oper));
+	nih_free (oper);
+
+	oper = match_new (NULL, "wibble", NULL);
+	TEST_TRUE (check_config_operator (check, oper));
+	nih_free (oper);
+
+	oper = match_new (NULL, "plum", NULL);
+	TEST_FALSE (check_config_operator (check, oper));
+	nih_free (oper);
+
+
+	/* Check that job events are only reachable for known jobs, named
+	 * either positionally or with JOB=, or through a variable.
+	 */
+	TEST_FEATURE ("with job event");
+	oper = match_new (NULL, "started", "foo");
+	TEST_TRUE (check_config_operator (check, oper));
+	nih_free (oper);
+
+	oper = match_new (NULL, "stopping", "JOB=foo");
+	TEST_TRUE (check_config_operator (check, oper));
+	nih_free (oper);
+
+	oper = match_new (NULL, "started", "$JOB");
+	TEST_TRUE (check_config_operator (check, oper));
+	nih_free (oper);
+
+	oper = match_new (NULL, "starting", "grape");
+	TEST_FALSE (check_config_operator (check, oper));
+	nih_free (oper);
+
+
+	/* Check that "and" needs both sides and "or" either, unless
+	 * warnings are requested when "or" also needs both.
+	 */
+	TEST_FEATURE ("with operators");
+	oper = binary_new (NULL, EVENT_AND,
+			   match_new (NULL, "peach", NULL),
+			   match_new (NULL, "plum", NULL));
+	TEST_FALSE (check_config_operator (check, oper));
+	nih_free (oper);
+
+	oper = binary_new (NULL, EVENT_OR,
+			   match_new (NULL, "peach", NULL),
+			   match_new (NULL, "plum", NULL));
+	TEST_TRUE (check_config_operator (check, oper));
+
+	check->warn = TRUE;
+	TEST_FALSE (check_config_operator (check, oper));
+	nih_free (oper);
+
+	nih_free (check);
+	nih_free (class);
+}
+
+
+void
+test_check_config (void)
+{
+	ConfSource *source;
+	FILE       *f, *output;
+	char        dirname[PATH_MAX], filename[PATH_MAX];
+	int         ret;
+
+	TEST_FUNCTION ("check_config");
+	program_name = "test";
+	nih_log_set_priority (NIH_LOG_MESSAGE);
+
+	output = tmpfile ();
+
+	TEST_FILENAME (dirname);
+	mkdir (dirname, 0755);
+
+	strcpy (filename, dirname);
+	strcat (filename, "/foo.conf");
+
+	f = fopen (filename, "w");
+	fprintf (f, "start on starting grape\n");
+	fprintf (f, "stop on peach\n");
+	fclose (f);
+
+	strcpy (filename, dirname);
+	strcat (filename, "/bar.conf");
+
+	f = fopen (filename, "w");
+	fprintf (f, "start on started foo\n");
+	fprintf (f, "emits fruit\n");
+	fclose (f);
+
+	source = conf_source_new (NULL, dirname, CONF_JOB_DIR);
+	assert0 (conf_source_reload (source));
+
+
+	/* Check that a job directory loaded without a running init is
+	 * checked, only the jobs in error being output with the events
+	 * and jobs they reference that are not known.
+	 */
+	TEST_FEATURE ("with errors");
+	TEST_DIVERT_STDOUT (output) {
+		ret = check_config (NULL, FALSE, NULL);
+	}
+	rewind (output);
+
+	TEST_EQ (ret, 1);
+
+	TEST_FILE_EQ (output, "foo\n");
+	TEST_FILE_EQ (output, "  start on: unknown job grape\n");
+	TEST_FILE_EQ (output, "  stop on: unknown event peach\n");
+	TEST_FILE_END (output);
+	TEST_FILE_RESET (output);
+
+
+	/* Check that events may be ignored, and a single job checked. */
+	TEST_FEATURE ("with single job and ignored events");
+	{
+		char *ignored[] = { "peach", NULL };
+
+		TEST_DIVERT_STDOUT (output) {
+			ret = check_config ("foo", FALSE, ignored);
+		}
+		rewind (output);
+
+		TEST_EQ (ret, 1);
+		TEST_FILE_EQ (output, "foo\n");
+		TEST_FILE_EQ (output, "  start on: unknown job grape\n");
+		TEST_FILE_END (output);
+		TEST_FILE_RESET (output);
+	}
+
+
+	/* Check that an unknown job name is an error. */
+	TEST_FEATURE ("with unknown job");
+	TEST_DIVERT_STDERR (output) {
+		ret = check_config ("wibble", FALSE, NULL);
+	}
+	rewind (output);
+
+	TEST_LT (ret, 0);
+	TEST_FILE_EQ (output, "test: Invalid job class: wibble\n");
+	TEST_FILE_END (output);
+	TEST_FILE_RESET (output);
+
+	nih_free (source);
+
+	strcpy (filename, dirname);
+	strcat (filename, "/foo.conf");
+	unlink (filename);
+
+	strcpy (filename, dirname);
+	strcat (filename, "/bar.conf");
+	unlink (filename);
+
+	rmdir (dirname);
+
+	fclose (output);
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	/* run tests in legacy (pre-session support) mode */
+	setenv ("UPSTART_NO_SESSIONS", "1", 1);
+
+	test_operator ();
+	test_check_config ();
+
+	return 0;
+}
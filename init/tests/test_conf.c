@@ -37,6 +37,7 @@
 #include <nih/list.h>
 #include <nih/hash.h>
 #include <nih/io.h>
+#include <nih/timer.h>
 #include <nih/watch.h>
 #include <nih/main.h>
 #include <nih/logging.h>
@@ -58,6 +59,14 @@
  **/
 #define JOB_STOP_ATTEMPTS 10
 
+/**
+ * MANY_JOB_CLASSES:
+ *
+ * Number of job configuration files to generate when loading a large
+ * job directory.
+ **/
+#define MANY_JOB_CLASSES 2000
+
 void
 test_source_new (void)
 {
@@ -85,6 +94,7 @@ test_source_new (void)
 		TEST_EQ_P (source->watch, NULL);
 		TEST_EQ (source->flag, FALSE);
 		TEST_NE_P (source->files, NULL);
+		TEST_HASH_EMPTY (source->pending);
 
 		nih_free (source);
 	}
@@ -298,6 +308,7 @@ test_source_reload_job_dir (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	file = (ConfFile *)nih_hash_lookup (source->files, filename);
 
@@ -344,6 +355,7 @@ test_source_reload_job_dir (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	TEST_FREE (old_file);
 
@@ -399,6 +411,7 @@ test_source_reload_job_dir (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	TEST_FREE (old_file);
 
@@ -444,6 +457,7 @@ test_source_reload_job_dir (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	TEST_FREE (old_file);
 	TEST_FREE (old_job);
@@ -477,6 +491,7 @@ test_source_reload_job_dir (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	job = (JobClass *)nih_hash_lookup (job_classes, "frodo/bar");
 	TEST_NE_P (job, NULL);
@@ -501,6 +516,7 @@ test_source_reload_job_dir (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	file = (ConfFile *)nih_hash_lookup (source->files, filename);
 
@@ -555,6 +571,7 @@ test_source_reload_job_dir (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	TEST_FREE (old_file);
 
@@ -607,6 +624,7 @@ test_source_reload_job_dir (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	TEST_FREE (old_file);
 
@@ -649,6 +667,7 @@ test_source_reload_job_dir (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	job = (JobClass *)nih_hash_lookup (job_classes, "frodo/bar");
 	TEST_NE_P (job, NULL);
@@ -670,6 +689,7 @@ test_source_reload_job_dir (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	file = (ConfFile *)nih_hash_lookup (source->files, filename);
 	TEST_EQ_P (file, NULL);
@@ -714,6 +734,7 @@ test_source_reload_job_dir (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	file = (ConfFile *)nih_hash_lookup (source->files, filename);
 	TEST_EQ_P (file, NULL);
@@ -748,6 +769,7 @@ test_source_reload_job_dir (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	old_file = (ConfFile *)nih_hash_lookup (source->files, filename);
 	TEST_FREE_TAG (old_file);
@@ -766,6 +788,7 @@ test_source_reload_job_dir (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	TEST_FREE (old_file);
 
@@ -1002,6 +1025,7 @@ test_source_reload_job_dir (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	TEST_EQ_P (source->watch, NULL);
 
@@ -1047,6 +1071,7 @@ test_source_reload_job_dir (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	TEST_HASH_EMPTY (source->files);
 	TEST_HASH_EMPTY (job_classes);
@@ -1085,6 +1110,7 @@ test_source_reload_job_dir (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	TEST_HASH_EMPTY (source->files);
 	TEST_HASH_EMPTY (job_classes);
@@ -1760,6 +1786,7 @@ test_source_reload_conf_dir (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	file = (ConfFile *)nih_hash_lookup (source->files, filename);
 
@@ -1791,6 +1818,7 @@ test_source_reload_conf_dir (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	TEST_FREE (old_file);
 
@@ -1822,6 +1850,7 @@ test_source_reload_conf_dir (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	TEST_FREE (old_file);
 
@@ -1848,6 +1877,7 @@ test_source_reload_conf_dir (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	old_file = (ConfFile *)nih_hash_lookup (source->files, filename);
 	TEST_FREE_TAG (old_file);
@@ -1865,6 +1895,7 @@ test_source_reload_conf_dir (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	TEST_FREE (old_file);
 
@@ -1892,6 +1923,7 @@ test_source_reload_conf_dir (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	old_file = (ConfFile *)nih_hash_lookup (source->files, filename);
 
@@ -1908,6 +1940,7 @@ test_source_reload_conf_dir (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	TEST_FREE (old_file);
 
@@ -2041,6 +2074,7 @@ test_source_reload_conf_dir (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	TEST_EQ_P (source->watch, NULL);
 
@@ -3834,6 +3868,7 @@ test_source_reload_file (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	file = (ConfFile *)nih_hash_lookup (source->files, filename);
 
@@ -3858,6 +3893,7 @@ test_source_reload_file (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	file = (ConfFile *)nih_hash_lookup (source->files, filename);
 
@@ -3885,6 +3921,7 @@ test_source_reload_file (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	TEST_FREE (old_file);
 
@@ -3924,6 +3961,7 @@ test_source_reload_file (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	TEST_FREE (old_file);
 
@@ -3955,6 +3993,7 @@ test_source_reload_file (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	TEST_FREE (old_file);
 
@@ -3981,6 +4020,7 @@ test_source_reload_file (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	file = (ConfFile *)nih_hash_lookup (source->files, filename);
 
@@ -4008,6 +4048,7 @@ test_source_reload_file (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	file = (ConfFile *)nih_hash_lookup (source->files, filename);
 
@@ -4032,6 +4073,7 @@ test_source_reload_file (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	file = (ConfFile *)nih_hash_lookup (source->files, filename);
 
@@ -4064,6 +4106,7 @@ test_source_reload_file (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	TEST_FREE (old_file);
 
@@ -4090,6 +4133,7 @@ test_source_reload_file (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	old_file = (ConfFile *)nih_hash_lookup (source->files, filename);
 	TEST_FREE_TAG (old_file);
@@ -4105,6 +4149,7 @@ test_source_reload_file (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	TEST_FREE (old_file);
 
@@ -4267,6 +4312,7 @@ test_source_reload_file (void)
 
 	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
 	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+	conf_poll ();
 
 	TEST_EQ_P (source->watch, NULL);
 
@@ -4943,6 +4989,226 @@ test_source_reload (void)
 }
 
 
+void
+test_source_reload_many (void)
+{
+	ConfSource      *source;
+	JobClass        *job;
+	FILE            *f;
+	char             dirname[PATH_MAX], filename[PATH_MAX];
+	char             name[32];
+	int              ret, i;
+
+	/* Check that a job directory containing a large number of job
+	 * configuration files can be loaded, that every class is
+	 * registered with its event trees intact.  The time and memory
+	 * taken to do so are measured by bench_conf instead.
+	 */
+	TEST_FUNCTION_FEATURE ("conf_source_reload",
+			       "with many job configuration files");
+	nih_log_set_priority (NIH_LOG_FATAL);
+
+	TEST_FILENAME (dirname);
+	mkdir (dirname, 0755);
+
+	for (i = 0; i < MANY_JOB_CLASSES; i++) {
+		sprintf (filename, "%s/job%d.conf", dirname, i);
+
+		f = fopen (filename, "w");
+		fprintf (f, "description \"job %d\"\n", i);
+		fprintf (f, "env FOO=%d\n", i);
+		fprintf (f, "env BAR=wibble\n");
+		fprintf (f, "export FOO\n");
+		fprintf (f, "start on (filesystem and net-device-up IFACE!=lo)"
+			 " or started job%d\n", i ? i - 1 : 0);
+		fprintf (f, "stop on runlevel [!2345] or stopping job%d\n",
+			 i ? i - 1 : 0);
+		fprintf (f, "respawn\n");
+		fprintf (f, "exec /sbin/daemon --instance %d\n", i);
+		fclose (f);
+	}
+
+	source = conf_source_new (NULL, dirname, CONF_JOB_DIR);
+
+	ret = conf_source_reload (source);
+
+	TEST_EQ (ret, 0);
+
+	for (i = 0; i < MANY_JOB_CLASSES; i++) {
+		sprintf (name, "job%d", i);
+
+		job = (JobClass *)nih_hash_lookup (job_classes, name);
+		TEST_NE_P (job, NULL);
+		TEST_NE_P (job->start_on, NULL);
+		TEST_EQ (job->start_on->type, EVENT_OR);
+		TEST_NE_P (job->stop_on, NULL);
+		TEST_EQ (job->stop_on->type, EVENT_OR);
+	}
+
+	nih_free (source);
+
+	job = (JobClass *)nih_hash_lookup (job_classes, "job0");
+	TEST_EQ_P (job, NULL);
+
+	for (i = 0; i < MANY_JOB_CLASSES; i++) {
+		sprintf (filename, "%s/job%d.conf", dirname, i);
+		assert0 (unlink (filename));
+	}
+
+	assert0 (rmdir (dirname));
+}
+
+
+void
+test_poll (void)
+{
+	ConfSource *source;
+	ConfFile   *file;
+	JobClass   *job;
+	FILE       *f;
+	int         ret, fd, nfds, i;
+	size_t      pending;
+	char        dirname[PATH_MAX], filename[PATH_MAX];
+	fd_set      readfds, writefds, exceptfds;
+
+	TEST_FUNCTION ("conf_poll");
+	program_name = "test";
+	nih_log_set_priority (NIH_LOG_FATAL);
+
+	/* Make sure that we have inotify before performing some tests... */
+	if ((fd = inotify_init ()) < 0) {
+		printf ("SKIP: inotify not available\n");
+		return;
+	}
+	close (fd);
+
+	TEST_FILENAME (dirname);
+	mkdir (dirname, 0755);
+
+	strcpy (filename, dirname);
+	strcat (filename, "/foo.conf");
+
+
+	/* Check that a file written several times over before the events
+	 * are handled is only queued once, isn't loaded until conf_poll()
+	 * is called, and is then loaded with its final contents.
+	 */
+	TEST_FEATURE ("with file written several times");
+	source = conf_source_new (NULL, dirname, CONF_JOB_DIR);
+	ret = conf_source_reload (source);
+
+	TEST_EQ (ret, 0);
+
+	for (i = 0; i < 5; i++) {
+		f = fopen (filename, "w");
+		fprintf (f, "exec /sbin/daemon --pass %d\n", i);
+		fclose (f);
+	}
+
+	nfds = 0;
+	FD_ZERO (&readfds);
+	FD_ZERO (&writefds);
+	FD_ZERO (&exceptfds);
+
+	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
+	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+
+	TEST_EQ_P (nih_hash_lookup (source->files, filename), NULL);
+	TEST_EQ_P (nih_hash_lookup (job_classes, "foo"), NULL);
+
+	pending = 0;
+	NIH_HASH_FOREACH (source->pending, iter) {
+		NihListEntry *entry = (NihListEntry *)iter;
+
+		TEST_EQ_STR (entry->str, filename);
+		pending++;
+	}
+	TEST_EQ (pending, 1);
+
+	conf_poll ();
+
+	TEST_HASH_EMPTY (source->pending);
+
+	file = (ConfFile *)nih_hash_lookup (source->files, filename);
+	TEST_NE_P (file, NULL);
+
+	job = (JobClass *)nih_hash_lookup (job_classes, "foo");
+	TEST_EQ_P (file->job, job);
+	TEST_NE_P (job->process[PROCESS_MAIN], NULL);
+	TEST_EQ_STR (job->process[PROCESS_MAIN]->command,
+		     "/sbin/daemon --pass 4");
+
+
+	/* Check that a file modified and then deleted before the events
+	 * are handled is simply removed by conf_poll(), rather than being
+	 * parsed first.
+	 */
+	TEST_FEATURE ("with file modified then deleted");
+	f = fopen (filename, "w");
+	fprintf (f, "exec /sbin/daemon --pass 5\n");
+	fclose (f);
+
+	unlink (filename);
+
+	nfds = 0;
+	FD_ZERO (&readfds);
+	FD_ZERO (&writefds);
+	FD_ZERO (&exceptfds);
+
+	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
+	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+
+	TEST_EQ_P (nih_hash_lookup (source->files, filename), file);
+
+	conf_poll ();
+
+	TEST_HASH_EMPTY (source->pending);
+	TEST_EQ_P (nih_hash_lookup (source->files, filename), NULL);
+	TEST_EQ_P (nih_hash_lookup (job_classes, "foo"), NULL);
+
+
+	/* Check that with a reload delay set, conf_poll() leaves the queued
+	 * file alone until the quiet period has expired.
+	 */
+	TEST_FEATURE ("with reload delay");
+	conf_reload_delay = 1;
+
+	f = fopen (filename, "w");
+	fprintf (f, "exec /sbin/daemon --pass 6\n");
+	fclose (f);
+
+	nfds = 0;
+	FD_ZERO (&readfds);
+	FD_ZERO (&writefds);
+	FD_ZERO (&exceptfds);
+
+	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
+	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+
+	conf_poll ();
+
+	TEST_HASH_NOT_EMPTY (source->pending);
+	TEST_EQ_P (nih_hash_lookup (source->files, filename), NULL);
+
+	sleep (2);
+	nih_timer_poll ();
+
+	TEST_HASH_EMPTY (source->pending);
+
+	job = (JobClass *)nih_hash_lookup (job_classes, "foo");
+	TEST_NE_P (job, NULL);
+	TEST_EQ_STR (job->process[PROCESS_MAIN]->command,
+		     "/sbin/daemon --pass 6");
+
+	conf_reload_delay = 0;
+
+	nih_free (source);
+
+	unlink (filename);
+	rmdir (dirname);
+}
+
+
 void
 test_file_destroy (void)
 {
@@ -5114,6 +5380,8 @@ main (int   argc,
 	test_source_reload_conf_dir ();
 	test_source_reload_file ();
 	test_source_reload ();
+	test_source_reload_many ();
+	test_poll ();
 	test_override ();
 	test_file_destroy ();
 	test_select_job ();
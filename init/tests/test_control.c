@@ -60,6 +60,7 @@
 #include "conf.h"
 #include "control.h"
 #include "errors.h"
+#include "timeline.h"
 
 #include "test_util_common.h"
 
@@ -1200,6 +1201,207 @@ test_get_all_jobs (void)
 	}
 }
 
+void
+test_get_all_job_status (void)
+{
+	NihDBusMessage                       *message = NULL;
+	JobClass                             *class1, *class2;
+	Job                                  *job;
+	NihError                             *error;
+	ControlGetAllJobStatusStatusElement **status;
+	int                                   ret;
+
+	TEST_FUNCTION ("control_get_all_job_status");
+	nih_error_init ();
+	job_class_init ();
+
+
+	/* Check that a job with no instances is returned as a single
+	 * stopped entry with an empty instance name, while a job with a
+	 * running instance is returned with its goal, state and processes,
+	 * all in an array allocated as a child of the message structure.
+	 */
+	TEST_FEATURE ("with registered jobs");
+	class1 = job_class_new (NULL, "frodo", NULL);
+	nih_hash_add (job_classes, &class1->entry);
+
+	class2 = job_class_new (NULL, "bilbo", NULL);
+	nih_hash_add (job_classes, &class2->entry);
+
+	job = job_new (class2, "foo");
+	job->goal = JOB_START;
+	job->state = JOB_RUNNING;
+	job->pid[PROCESS_MAIN] = 1000;
+	job->pid[PROCESS_POST_START] = 1001;
+
+	TEST_ALLOC_FAIL {
+		ControlGetAllJobStatusStatusElement *stopped = NULL;
+		ControlGetAllJobStatusStatusElement *running = NULL;
+
+		TEST_ALLOC_SAFE {
+			message = nih_new (NULL, NihDBusMessage);
+			message->connection = NULL;
+			message->message = NULL;
+		}
+
+		ret = control_get_all_job_status (NULL, message, &status);
+
+		if (test_alloc_failed) {
+			TEST_LT (ret, 0);
+
+			error = nih_error_get ();
+			TEST_EQ (error->number, ENOMEM);
+			nih_free (error);
+
+			nih_free (message);
+
+			continue;
+		}
+
+		TEST_EQ (ret, 0);
+
+		TEST_ALLOC_PARENT (status, message);
+		TEST_ALLOC_SIZE (status, sizeof (ControlGetAllJobStatusStatusElement *) * 3);
+		TEST_EQ_P (status[2], NULL);
+
+		for (int i = 0; i < 2; i++) {
+			TEST_ALLOC_PARENT (status[i], status);
+
+			if (! strcmp (status[i]->item0, "frodo"))
+				stopped = status[i];
+			if (! strcmp (status[i]->item0, "bilbo"))
+				running = status[i];
+		}
+
+		TEST_NE_P (stopped, NULL);
+		TEST_EQ_STR (stopped->item1, "");
+		TEST_EQ_STR (stopped->item2, "stop");
+		TEST_EQ_STR (stopped->item3, "waiting");
+		TEST_EQ_P (stopped->item4[0], NULL);
+
+		TEST_NE_P (running, NULL);
+		TEST_EQ_STR (running->item1, "foo");
+		TEST_EQ_STR (running->item2, "start");
+		TEST_EQ_STR (running->item3, "running");
+		TEST_EQ_STR (running->item4[0]->item0, "main");
+		TEST_EQ (running->item4[0]->item1, 1000);
+		TEST_EQ_STR (running->item4[1]->item0, "post-start");
+		TEST_EQ (running->item4[1]->item1, 1001);
+		TEST_EQ_P (running->item4[2], NULL);
+
+		nih_free (message);
+	}
+
+	nih_free (class2);
+	nih_free (class1);
+
+
+	/* Check that when no jobs are registered, an empty array is
+	 * returned instead of an error.
+	 */
+	TEST_FEATURE ("with no registered jobs");
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			message = nih_new (NULL, NihDBusMessage);
+			message->connection = NULL;
+			message->message = NULL;
+		}
+
+		ret = control_get_all_job_status (NULL, message, &status);
+
+		if (test_alloc_failed) {
+			TEST_LT (ret, 0);
+
+			error = nih_error_get ();
+			TEST_EQ (error->number, ENOMEM);
+			nih_free (error);
+
+			nih_free (message);
+
+			continue;
+		}
+
+		TEST_EQ (ret, 0);
+
+		TEST_ALLOC_PARENT (status, message);
+		TEST_ALLOC_SIZE (status, sizeof (ControlGetAllJobStatusStatusElement *) * 1);
+		TEST_EQ_P (status[0], NULL);
+
+		nih_free (message);
+	}
+}
+
+void
+test_get_timeline (void)
+{
+	NihDBusMessage                     *message = NULL;
+	NihError                           *error;
+	ControlGetTimelineTimelineElement **timeline_entries;
+	int                                 ret;
+
+	TEST_FUNCTION ("control_get_timeline");
+	nih_error_init ();
+
+	if (timeline) {
+		nih_free (timeline);
+		timeline = NULL;
+		timeline_len = 0;
+	}
+
+	timeline_record ("startup", NULL, NULL);
+	timeline_record ("starting", "frodo", "foo");
+
+
+	/* Check that the recorded timeline is returned in order, with
+	 * empty job and instance names for events other than job events,
+	 * in an array allocated as a child of the message structure.
+	 */
+	TEST_FEATURE ("with recorded timeline");
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			message = nih_new (NULL, NihDBusMessage);
+			message->connection = NULL;
+			message->message = NULL;
+		}
+
+		ret = control_get_timeline (NULL, message, &timeline_entries);
+
+		if (test_alloc_failed) {
+			TEST_LT (ret, 0);
+
+			error = nih_error_get ();
+			TEST_EQ (error->number, ENOMEM);
+			nih_free (error);
+
+			nih_free (message);
+
+			continue;
+		}
+
+		TEST_EQ (ret, 0);
+
+		TEST_ALLOC_PARENT (timeline_entries, message);
+		TEST_ALLOC_SIZE (timeline_entries, sizeof (ControlGetTimelineTimelineElement *) * 3);
+
+		TEST_EQ_STR (timeline_entries[0]->item0, "startup");
+		TEST_EQ_STR (timeline_entries[0]->item1, "");
+		TEST_EQ_STR (timeline_entries[0]->item2, "");
+
+		TEST_EQ_STR (timeline_entries[1]->item0, "starting");
+		TEST_EQ_STR (timeline_entries[1]->item1, "frodo");
+		TEST_EQ_STR (timeline_entries[1]->item2, "foo");
+		TEST_GE (timeline_entries[1]->item3, timeline_entries[0]->item3);
+
+		TEST_EQ_P (timeline_entries[2], NULL);
+
+		nih_free (message);
+	}
+
+	nih_free (timeline);
+	timeline = NULL;
+	timeline_len = 0;
+}
+
 void
 test_emit_event (void)
 {
@@ -1626,6 +1828,316 @@ test_emit_event (void)
 }
 
 
+void
+test_emit_events (void)
+{
+	NihDBusMessage                  *message = NULL;
+	ControlEmitEventsEventsElement **elements;
+	Event                           *event;
+	NihError                        *error;
+	NihDBusError                    *dbus_error;
+	int                              ret;
+
+	TEST_FUNCTION ("control_emit_events");
+	nih_error_init ();
+	event_init ();
+
+
+	/* Check that each of the events is added to the event queue, in
+	 * order, with its environment; and that none are added if there
+	 * is insufficient memory for any of them.
+	 */
+	TEST_FEATURE ("with multiple events");
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			message = nih_new (NULL, NihDBusMessage);
+			message->connection = NULL;
+			message->message = NULL;
+
+			elements = nih_alloc (message, sizeof (ControlEmitEventsEventsElement *) * 3);
+
+			elements[0] = nih_new (elements, ControlEmitEventsEventsElement);
+			elements[0]->item0 = "block-device-added";
+			elements[0]->item1 = nih_str_array_new (elements[0]);
+			NIH_MUST (nih_str_array_add (&elements[0]->item1, elements[0],
+						     NULL, "KERNEL=sda"));
+
+			elements[1] = nih_new (elements, ControlEmitEventsEventsElement);
+			elements[1]->item0 = "net-device-added";
+			elements[1]->item1 = nih_str_array_new (elements[1]);
+
+			elements[2] = NULL;
+		}
+
+		ret = control_emit_events (NULL, message, elements);
+
+		if (test_alloc_failed) {
+			TEST_LT (ret, 0);
+
+			error = nih_error_get ();
+			TEST_EQ (error->number, ENOMEM);
+			nih_free (error);
+
+			TEST_LIST_EMPTY (events);
+
+			nih_free (message);
+			continue;
+		}
+
+		TEST_EQ (ret, 0);
+
+		event = (Event *)events->next;
+		TEST_ALLOC_SIZE (event, sizeof (Event));
+		TEST_EQ_STR (event->name, "block-device-added");
+		TEST_EQ_STR (event->env[0], "KERNEL=sda");
+		TEST_EQ_P (event->env[1], NULL);
+		TEST_LIST_EMPTY (&event->blocking);
+
+		event = (Event *)event->entry.next;
+		TEST_ALLOC_SIZE (event, sizeof (Event));
+		TEST_EQ_STR (event->name, "net-device-added");
+		TEST_EQ_P (event->env[0], NULL);
+		TEST_LIST_EMPTY (&event->blocking);
+
+		TEST_EQ_P (event->entry.next, events);
+
+		nih_free (message);
+
+		event_poll ();
+
+		TEST_LIST_EMPTY (events);
+	}
+
+
+	/* Check that if any of the events has an invalid environment, the
+	 * InvalidArgs error is returned and none of them are queued.
+	 */
+	TEST_FEATURE ("with invalid environment");
+	message = nih_new (NULL, NihDBusMessage);
+	message->connection = NULL;
+	message->message = NULL;
+
+	elements = nih_alloc (message, sizeof (ControlEmitEventsEventsElement *) * 3);
+
+	elements[0] = nih_new (elements, ControlEmitEventsEventsElement);
+	elements[0]->item0 = "test";
+	elements[0]->item1 = nih_str_array_new (elements[0]);
+
+	elements[1] = nih_new (elements, ControlEmitEventsEventsElement);
+	elements[1]->item0 = "test";
+	elements[1]->item1 = nih_str_array_new (elements[1]);
+	NIH_MUST (nih_str_array_add (&elements[1]->item1, elements[1],
+				     NULL, "FOO BAR"));
+
+	elements[2] = NULL;
+
+	ret = control_emit_events (NULL, message, elements);
+
+	TEST_LT (ret, 0);
+
+	dbus_error = (NihDBusError *)nih_error_get ();
+	TEST_ALLOC_SIZE (dbus_error, sizeof (NihDBusError));
+	TEST_EQ (dbus_error->number, NIH_DBUS_ERROR);
+	TEST_EQ_STR (dbus_error->name, DBUS_ERROR_INVALID_ARGS);
+	nih_free (dbus_error);
+
+	TEST_LIST_EMPTY (events);
+
+	nih_free (message);
+
+
+	/* Check that if any of the events has an empty name, the
+	 * InvalidArgs error is returned and none of them are queued.
+	 */
+	TEST_FEATURE ("with empty name");
+	message = nih_new (NULL, NihDBusMessage);
+	message->connection = NULL;
+	message->message = NULL;
+
+	elements = nih_alloc (message, sizeof (ControlEmitEventsEventsElement *) * 2);
+
+	elements[0] = nih_new (elements, ControlEmitEventsEventsElement);
+	elements[0]->item0 = "";
+	elements[0]->item1 = nih_str_array_new (elements[0]);
+
+	elements[1] = NULL;
+
+	ret = control_emit_events (NULL, message, elements);
+
+	TEST_LT (ret, 0);
+
+	dbus_error = (NihDBusError *)nih_error_get ();
+	TEST_ALLOC_SIZE (dbus_error, sizeof (NihDBusError));
+	TEST_EQ (dbus_error->number, NIH_DBUS_ERROR);
+	TEST_EQ_STR (dbus_error->name, DBUS_ERROR_INVALID_ARGS);
+	nih_free (dbus_error);
+
+	TEST_LIST_EMPTY (events);
+
+	nih_free (message);
+}
+
+
+void
+test_subscribe (void)
+{
+	NihDBusMessage      *message = NULL;
+	ControlSubscription *subscription;
+	DBusConnection      *conn, *other_conn;
+	NihError            *error;
+	char               **event_globs;
+	char               **job_globs;
+	char                 conn_data, other_conn_data;
+	int                  ret;
+
+	TEST_FUNCTION ("control_subscribe");
+	nih_error_init ();
+	control_init ();
+
+	/* The connections are only compared, never used */
+	conn = (DBusConnection *)&conn_data;
+	other_conn = (DBusConnection *)&other_conn_data;
+
+
+	/* Check that a connection without a subscription is sent every
+	 * signal.
+	 */
+	TEST_FEATURE ("without subscription");
+	TEST_TRUE (control_conn_wants_event (conn, "startup"));
+	TEST_TRUE (control_conn_wants_job (conn, "foo"));
+
+
+	/* Check that subscribing registers filters for the connection,
+	 * copying the globs, and that only matching names are then
+	 * wanted by it while other connections are unaffected.
+	 */
+	TEST_FEATURE ("with new subscription");
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			message = nih_new (NULL, NihDBusMessage);
+			message->connection = conn;
+			message->message = NULL;
+
+			event_globs = nih_str_array_new (message);
+			NIH_MUST (nih_str_array_add (&event_globs, message,
+						     NULL, "*-device-added"));
+
+			job_globs = nih_str_array_new (message);
+			NIH_MUST (nih_str_array_add (&job_globs, message,
+						     NULL, "foo"));
+			NIH_MUST (nih_str_array_add (&job_globs, message,
+						     NULL, "ba?"));
+		}
+
+		ret = control_subscribe (NULL, message, event_globs, job_globs);
+
+		if (test_alloc_failed) {
+			TEST_LT (ret, 0);
+
+			error = nih_error_get ();
+			TEST_EQ (error->number, ENOMEM);
+			nih_free (error);
+
+			TEST_LIST_EMPTY (control_subscriptions);
+
+			nih_free (message);
+			continue;
+		}
+
+		TEST_EQ (ret, 0);
+
+		TEST_LIST_NOT_EMPTY (control_subscriptions);
+
+		subscription = (ControlSubscription *)control_subscriptions->next;
+		TEST_ALLOC_SIZE (subscription, sizeof (ControlSubscription));
+		TEST_EQ_P (subscription->conn, conn);
+		TEST_ALLOC_PARENT (subscription->events, subscription);
+		TEST_EQ_STR (subscription->events[0], "*-device-added");
+		TEST_EQ_P (subscription->events[1], NULL);
+		TEST_ALLOC_PARENT (subscription->jobs, subscription);
+		TEST_EQ_STR (subscription->jobs[0], "foo");
+		TEST_EQ_STR (subscription->jobs[1], "ba?");
+		TEST_EQ_P (subscription->jobs[2], NULL);
+
+		nih_free (message);
+
+		TEST_TRUE (control_conn_wants_event (conn, "block-device-added"));
+		TEST_FALSE (control_conn_wants_event (conn, "startup"));
+		TEST_TRUE (control_conn_wants_job (conn, "foo"));
+		TEST_TRUE (control_conn_wants_job (conn, "bar"));
+		TEST_FALSE (control_conn_wants_job (conn, "frodo"));
+
+		TEST_TRUE (control_conn_wants_event (other_conn, "startup"));
+		TEST_TRUE (control_conn_wants_job (other_conn, "frodo"));
+
+		nih_free (subscription);
+	}
+
+
+	/* Check that subscribing again replaces the existing filters,
+	 * and that empty arrays mean no signals of that kind are wanted.
+	 */
+	TEST_FEATURE ("with existing subscription");
+	message = nih_new (NULL, NihDBusMessage);
+	message->connection = conn;
+	message->message = NULL;
+
+	event_globs = nih_str_array_new (message);
+	NIH_MUST (nih_str_array_add (&event_globs, message, NULL, "startup"));
+
+	job_globs = nih_str_array_new (message);
+
+	ret = control_subscribe (NULL, message, event_globs, job_globs);
+	TEST_EQ (ret, 0);
+
+	event_globs[0] = "runlevel";
+
+	ret = control_subscribe (NULL, message, event_globs, job_globs);
+	TEST_EQ (ret, 0);
+
+	subscription = (ControlSubscription *)control_subscriptions->next;
+	TEST_EQ_P (subscription->entry.next, control_subscriptions);
+
+	TEST_TRUE (control_conn_wants_event (conn, "runlevel"));
+	TEST_FALSE (control_conn_wants_event (conn, "startup"));
+	TEST_FALSE (control_conn_wants_job (conn, "foo"));
+
+
+	/* Check that unsubscribing removes the filters, so every signal
+	 * is sent again.
+	 */
+	TEST_FEATURE ("with unsubscribe");
+	TEST_FREE_TAG (subscription);
+
+	ret = control_unsubscribe (NULL, message);
+	TEST_EQ (ret, 0);
+
+	TEST_FREE (subscription);
+	TEST_LIST_EMPTY (control_subscriptions);
+
+	TEST_TRUE (control_conn_wants_event (conn, "startup"));
+	TEST_TRUE (control_conn_wants_job (conn, "foo"));
+
+
+	/* Check that the filters are discarded when the connection is
+	 * lost.
+	 */
+	TEST_FEATURE ("with disconnected connection");
+	ret = control_subscribe (NULL, message, event_globs, job_globs);
+	TEST_EQ (ret, 0);
+
+	subscription = (ControlSubscription *)control_subscriptions->next;
+	TEST_FREE_TAG (subscription);
+
+	control_disconnected (conn);
+
+	TEST_FREE (subscription);
+	TEST_LIST_EMPTY (control_subscriptions);
+
+	nih_free (message);
+}
+
+
 void
 test_get_version (void)
 {
@@ -1673,6 +2185,38 @@ test_get_version (void)
 }
 
 
+void
+test_get_events_skipped (void)
+{
+	NihDBusMessage *message = NULL;
+	uint64_t        events_skipped;
+	int             ret;
+
+	/* Check that the function returns the number of started and
+	 * stopped events that were skipped.
+	 */
+	TEST_FUNCTION ("control_get_events_skipped");
+	nih_error_init ();
+	job_class_init ();
+
+	job_events_skipped = 42;
+
+	message = nih_new (NULL, NihDBusMessage);
+	message->connection = NULL;
+	message->message = NULL;
+
+	events_skipped = 0;
+	ret = control_get_events_skipped (NULL, message, &events_skipped);
+
+	TEST_EQ (ret, 0);
+	TEST_EQ (events_skipped, 42);
+
+	nih_free (message);
+
+	job_events_skipped = 0;
+}
+
+
 void
 test_get_log_priority (void)
 {
@@ -2716,10 +3260,15 @@ main (int   argc,
 
 	test_get_job_by_name ();
 	test_get_all_jobs ();
+	test_get_all_job_status ();
+	test_get_timeline ();
 
 	test_emit_event ();
+	test_emit_events ();
+	test_subscribe ();
 
 	test_get_version ();
+	test_get_events_skipped ();
 
 	test_get_log_priority ();
 	test_set_log_priority ();
@@ -0,0 +1,565 @@
+/* upstart
+ *
+ * test_control_native.c - test suite for init/control_native.c
+ *
+ * Copyright © 2014 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <nih/test.h>
+
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#include <dbus/dbus.h>
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/list.h>
+#include <nih/hash.h>
+#include <nih/io.h>
+
+#include "dbus/upstart.h"
+
+#include "job_class.h"
+#include "job.h"
+#include "event.h"
+#include "control_native.h"
+
+
+/**
+ * push_request:
+ * @io: connection to push request into,
+ * @serial: serial of request,
+ * @type: type of request,
+ * @...: NULL-terminated list of payload strings.
+ *
+ * Appends a request to the receive buffer of @io, as if the client had
+ * sent it.
+ **/
+static void
+push_request (NihIo    *io,
+	      uint32_t  serial,
+	      uint32_t  type,
+	      ...)
+{
+	ControlNativeHeader  header;
+	char                 payload[1024];
+	const char          *str;
+	va_list              args;
+
+	header.length = 0;
+	header.serial = serial;
+	header.type = type;
+
+	va_start (args, type);
+	while ((str = va_arg (args, const char *)) != NULL) {
+		memcpy (payload + header.length, str, strlen (str) + 1);
+		header.length += strlen (str) + 1;
+	}
+	va_end (args);
+
+	assert0 (nih_io_buffer_push (io->recv_buf, (const char *)&header,
+				     sizeof (header)));
+	assert0 (nih_io_buffer_push (io->recv_buf, payload, header.length));
+}
+
+/**
+ * pop_reply:
+ * @io: connection to pop reply from,
+ * @header: header to fill in,
+ * @payload: buffer for payload of at least 1024 bytes.
+ *
+ * Removes the first reply from the send buffer of @io.
+ **/
+static void
+pop_reply (NihIo               *io,
+	   ControlNativeHeader *header,
+	   char                *payload)
+{
+	TEST_GE (io->send_buf->len, sizeof (ControlNativeHeader));
+	memcpy (header, io->send_buf->buf, sizeof (ControlNativeHeader));
+
+	TEST_LT (header->length, 1024);
+	TEST_GE (io->send_buf->len, sizeof (ControlNativeHeader) + header->length);
+	memcpy (payload, io->send_buf->buf + sizeof (ControlNativeHeader),
+		header->length);
+
+	nih_io_buffer_shrink (io->send_buf,
+			      sizeof (ControlNativeHeader) + header->length);
+}
+
+
+void
+test_client_new (void)
+{
+	ControlNativeClient *client;
+	int                  fds[2];
+
+	/* Check that a client is allocated with a connection reading
+	 * from the socket given.
+	 */
+	TEST_FUNCTION ("control_native_client_new");
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			assert0 (socketpair (AF_UNIX, SOCK_STREAM, 0, fds));
+		}
+
+		client = control_native_client_new (NULL, fds[0], getuid ());
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (client, NULL);
+			nih_free (nih_error_get ());
+
+			close (fds[0]);
+			close (fds[1]);
+			continue;
+		}
+
+		TEST_ALLOC_SIZE (client, sizeof (ControlNativeClient));
+		TEST_EQ (client->uid, getuid ());
+		TEST_ALLOC_PARENT (client->io, client);
+		TEST_EQ (client->io->watch->fd, fds[0]);
+
+		nih_free (client);
+		close (fds[1]);
+	}
+}
+
+
+void
+test_reader (void)
+{
+	ControlNativeClient *client;
+	ControlNativeHeader  header;
+	JobClass            *class;
+	Job                 *job;
+	Event               *event;
+	char                 payload[1024];
+	int                  fds[2];
+
+	TEST_FUNCTION ("control_native_reader");
+	job_class_init ();
+	event_init ();
+
+	assert0 (socketpair (AF_UNIX, SOCK_STREAM, 0, fds));
+	client = control_native_client_new (NULL, fds[0], getuid ());
+
+	class = job_class_new (NULL, "test", NULL);
+	nih_hash_add (job_classes, &class->entry);
+
+
+	/* Check that a start request changes the goal of a new instance
+	 * of the job and replies with its name.
+	 */
+	TEST_FEATURE ("with start request");
+	push_request (client->io, 1, CONTROL_NATIVE_START, "test", NULL);
+
+	control_native_reader (client, client->io, client->io->recv_buf->buf,
+			       client->io->recv_buf->len);
+
+	TEST_EQ (client->io->recv_buf->len, 0);
+
+	job = (Job *)nih_hash_lookup (class->instances, "");
+	TEST_NE_P (job, NULL);
+	TEST_EQ (job->goal, JOB_START);
+
+	pop_reply (client->io, &header, payload);
+	TEST_EQ (header.serial, 1);
+	TEST_EQ (header.type, CONTROL_NATIVE_OK);
+	TEST_EQ (header.length, 1);
+	TEST_EQ_STR (payload, "");
+
+	TEST_EQ (client->io->send_buf->len, 0);
+
+
+	/* Check that pipelined requests are all handled, and replied to
+	 * in order, while a partial request is left in the buffer.
+	 */
+	TEST_FEATURE ("with pipelined requests");
+	push_request (client->io, 2, CONTROL_NATIVE_STATUS, "test", "", NULL);
+	push_request (client->io, 3, CONTROL_NATIVE_START, "test", NULL);
+	push_request (client->io, 4, CONTROL_NATIVE_LIST, NULL);
+	assert0 (nih_io_buffer_push (client->io->recv_buf, "\0\0", 2));
+
+	control_native_reader (client, client->io, client->io->recv_buf->buf,
+			       client->io->recv_buf->len);
+
+	TEST_EQ (client->io->recv_buf->len, 2);
+	nih_io_buffer_shrink (client->io->recv_buf, 2);
+
+	pop_reply (client->io, &header, payload);
+	TEST_EQ (header.serial, 2);
+	TEST_EQ (header.type, CONTROL_NATIVE_OK);
+	TEST_EQ_STR (payload, job_goal_name (job->goal));
+	TEST_EQ_STR (payload + strlen (payload) + 1,
+		     job_state_name (job->state));
+
+	pop_reply (client->io, &header, payload);
+	TEST_EQ (header.serial, 3);
+	TEST_EQ (header.type, CONTROL_NATIVE_ERROR);
+	TEST_EQ_STR (payload, DBUS_INTERFACE_UPSTART ".Error.AlreadyStarted");
+
+	pop_reply (client->io, &header, payload);
+	TEST_EQ (header.serial, 4);
+	TEST_EQ (header.type, CONTROL_NATIVE_OK);
+	TEST_EQ_STR (payload, "test");
+
+	TEST_EQ (client->io->send_buf->len, 0);
+
+
+	/* Check that a stop request changes the goal of the instance. */
+	TEST_FEATURE ("with stop request");
+	push_request (client->io, 5, CONTROL_NATIVE_STOP, "test", NULL);
+
+	control_native_reader (client, client->io, client->io->recv_buf->buf,
+			       client->io->recv_buf->len);
+
+	TEST_EQ (job->goal, JOB_STOP);
+
+	pop_reply (client->io, &header, payload);
+	TEST_EQ (header.serial, 5);
+	TEST_EQ (header.type, CONTROL_NATIVE_OK);
+	TEST_EQ (header.length, 0);
+
+
+	/* Check that an emit request queues the event with its
+	 * environment.
+	 */
+	TEST_FEATURE ("with emit request");
+	push_request (client->io, 6, CONTROL_NATIVE_EMIT,
+		      "wibble", "FOO=BAR", NULL);
+
+	control_native_reader (client, client->io, client->io->recv_buf->buf,
+			       client->io->recv_buf->len);
+
+	pop_reply (client->io, &header, payload);
+	TEST_EQ (header.serial, 6);
+	TEST_EQ (header.type, CONTROL_NATIVE_OK);
+
+	event = NULL;
+	NIH_LIST_FOREACH (events, iter) {
+		Event *e = (Event *)iter;
+
+		if (! strcmp (e->name, "wibble"))
+			event = e;
+	}
+	TEST_NE_P (event, NULL);
+	TEST_EQ_STR (event->env[0], "FOO=BAR");
+	TEST_EQ_P (event->env[1], NULL);
+	nih_free (event);
+
+
+	/* Check that errors are returned with the D-Bus error name. */
+	TEST_FEATURE ("with unknown job");
+	push_request (client->io, 7, CONTROL_NATIVE_START, "wibble", NULL);
+
+	control_native_reader (client, client->io, client->io->recv_buf->buf,
+			       client->io->recv_buf->len);
+
+	pop_reply (client->io, &header, payload);
+	TEST_EQ (header.serial, 7);
+	TEST_EQ (header.type, CONTROL_NATIVE_ERROR);
+	TEST_EQ_STR (payload, DBUS_INTERFACE_UPSTART ".Error.UnknownJob");
+
+
+	/* Check that an unknown request type is an error. */
+	TEST_FEATURE ("with unknown request");
+	push_request (client->io, 8, 9999, NULL);
+
+	control_native_reader (client, client->io, client->io->recv_buf->buf,
+			       client->io->recv_buf->len);
+
+	pop_reply (client->io, &header, payload);
+	TEST_EQ (header.serial, 8);
+	TEST_EQ (header.type, CONTROL_NATIVE_ERROR);
+	TEST_EQ_STR (payload, DBUS_ERROR_UNKNOWN_METHOD);
+
+
+	/* Check that a client running as another user, who is not
+	 * root, is not permitted to make changes.
+	 */
+	TEST_FEATURE ("with other user");
+	client->uid = getuid () + 1;
+
+	push_request (client->io, 9, CONTROL_NATIVE_EMIT, "wibble", NULL);
+
+	control_native_reader (client, client->io, client->io->recv_buf->buf,
+			       client->io->recv_buf->len);
+
+	pop_reply (client->io, &header, payload);
+	TEST_EQ (header.serial, 9);
+	TEST_EQ (header.type, CONTROL_NATIVE_ERROR);
+	TEST_EQ_STR (payload, DBUS_INTERFACE_UPSTART ".Error.PermissionDenied");
+
+	client->uid = getuid ();
+
+
+	/* Check that a client sending an oversized request is
+	 * disconnected.
+	 */
+	TEST_FEATURE ("with oversized request");
+	header.length = CONTROL_NATIVE_MAX_LENGTH + 1;
+	header.serial = 10;
+	header.type = CONTROL_NATIVE_LIST;
+	assert0 (nih_io_buffer_push (client->io->recv_buf,
+				     (const char *)&header, sizeof (header)));
+
+	TEST_FREE_TAG (client);
+
+	control_native_reader (client, client->io, client->io->recv_buf->buf,
+			       client->io->recv_buf->len);
+
+	TEST_FREE (client);
+
+	nih_free (class);
+	close (fds[1]);
+}
+
+void
+test_watch (void)
+{
+	ControlNativeClient *client;
+	ControlNativeHeader  header;
+	JobClass            *class;
+	Job                 *job;
+	char                 payload[1024];
+	char                 epoch[32];
+	char                *str;
+	char                *filler;
+	int                  fds[2];
+	FILE                *output;
+
+	TEST_FUNCTION ("control_native_job_changed");
+	output = tmpfile ();
+	job_class_init ();
+
+	assert0 (socketpair (AF_UNIX, SOCK_STREAM, 0, fds));
+	client = control_native_client_new (NULL, fds[0], getuid ());
+
+	class = job_class_new (NULL, "test", NULL);
+	nih_hash_add (job_classes, &class->entry);
+
+	job = job_new (class, "");
+	job->goal = JOB_START;
+	job->state = JOB_RUNNING;
+	job->pid[PROCESS_MAIN] = 1000;
+
+
+	/* Check that changes are not numbered before any client has
+	 * asked to follow them.
+	 */
+	TEST_FEATURE ("without watching clients");
+	control_native_job_changed (job);
+
+	TEST_EQ_P (control_native_history, NULL);
+	TEST_EQ (control_native_sequence, 0);
+
+
+	/* Check that a watch request is sent the current state of every
+	 * instance, followed by the reply with the epoch and sequence
+	 * number.
+	 */
+	TEST_FEATURE ("with watch request");
+	push_request (client->io, 1, CONTROL_NATIVE_WATCH, NULL);
+
+	control_native_reader (client, client->io, client->io->recv_buf->buf,
+			       client->io->recv_buf->len);
+
+	pop_reply (client->io, &header, payload);
+	TEST_EQ (header.serial, 1);
+	TEST_EQ (header.type, CONTROL_NATIVE_CHANGE);
+
+	str = payload;
+	TEST_EQ_STR (str, "0");
+	str += strlen (str) + 1;
+	TEST_EQ_STR (str, "test");
+	str += strlen (str) + 1;
+	TEST_EQ_STR (str, "");
+	str += strlen (str) + 1;
+	TEST_EQ_STR (str, "start");
+	str += strlen (str) + 1;
+	TEST_EQ_STR (str, "running");
+	str += strlen (str) + 1;
+	TEST_EQ_STR (str, "main");
+	str += strlen (str) + 1;
+	TEST_EQ_STR (str, "1000");
+
+	pop_reply (client->io, &header, payload);
+	TEST_EQ (header.serial, 1);
+	TEST_EQ (header.type, CONTROL_NATIVE_OK);
+
+	strcpy (epoch, payload);
+	str = payload + strlen (payload) + 1;
+	TEST_EQ_STR (str, "0");
+	str += strlen (str) + 1;
+	TEST_EQ_STR (str, "snapshot");
+
+	TEST_EQ (client->io->send_buf->len, 0);
+	TEST_LIST_NOT_EMPTY (&client->entry);
+
+
+	/* Check that a change is numbered and sent to the client with the
+	 * serial of its watch request.
+	 */
+	TEST_FEATURE ("with change");
+	job->goal = JOB_STOP;
+	job->state = JOB_STOPPING;
+
+	control_native_job_changed (job);
+
+	TEST_EQ (control_native_sequence, 1);
+
+	pop_reply (client->io, &header, payload);
+	TEST_EQ (header.serial, 1);
+	TEST_EQ (header.type, CONTROL_NATIVE_CHANGE);
+
+	str = payload;
+	TEST_EQ_STR (str, "1");
+	str += strlen (str) + 1;
+	TEST_EQ_STR (str, "test");
+	str += strlen (str) + 1;
+	str += strlen (str) + 1;
+	TEST_EQ_STR (str, "stop");
+	str += strlen (str) + 1;
+	TEST_EQ_STR (str, "stopping");
+
+	TEST_EQ (client->io->send_buf->len, 0);
+
+
+	/* Check that a client that disconnected stops being sent changes,
+	 * and that a new client resuming from the sequence number it
+	 * last received is sent only the changes it missed.
+	 */
+	TEST_FEATURE ("with resumed watch");
+	nih_free (client);
+	close (fds[1]);
+
+	job->state = JOB_KILLED;
+	control_native_job_changed (job);
+
+	TEST_LIST_EMPTY (control_native_watchers);
+
+	assert0 (socketpair (AF_UNIX, SOCK_STREAM, 0, fds));
+	client = control_native_client_new (NULL, fds[0], getuid ());
+
+	push_request (client->io, 2, CONTROL_NATIVE_WATCH, epoch, "1", NULL);
+
+	control_native_reader (client, client->io, client->io->recv_buf->buf,
+			       client->io->recv_buf->len);
+
+	pop_reply (client->io, &header, payload);
+	TEST_EQ (header.serial, 2);
+	TEST_EQ (header.type, CONTROL_NATIVE_CHANGE);
+	TEST_EQ_STR (payload, "2");
+
+	pop_reply (client->io, &header, payload);
+	TEST_EQ (header.serial, 2);
+	TEST_EQ (header.type, CONTROL_NATIVE_OK);
+	TEST_EQ_STR (payload, epoch);
+	str = payload + strlen (payload) + 1;
+	TEST_EQ_STR (str, "2");
+	str += strlen (str) + 1;
+	TEST_EQ_STR (str, "resume");
+
+	TEST_EQ (client->io->send_buf->len, 0);
+
+
+	/* Check that a client resuming with the epoch of a different
+	 * instance of init is sent the snapshot instead.
+	 */
+	TEST_FEATURE ("with different epoch");
+	push_request (client->io, 3, CONTROL_NATIVE_WATCH, "1", "1", NULL);
+
+	control_native_reader (client, client->io, client->io->recv_buf->buf,
+			       client->io->recv_buf->len);
+
+	pop_reply (client->io, &header, payload);
+	TEST_EQ (header.serial, 3);
+	TEST_EQ (header.type, CONTROL_NATIVE_CHANGE);
+	TEST_EQ_STR (payload, "2");
+	TEST_EQ_STR (payload + 2, "test");
+
+	pop_reply (client->io, &header, payload);
+	TEST_EQ (header.serial, 3);
+	TEST_EQ (header.type, CONTROL_NATIVE_OK);
+	str = payload + strlen (payload) + 1;
+	str += strlen (str) + 1;
+	TEST_EQ_STR (str, "snapshot");
+
+
+	/* Check that a malformed sequence number is an error. */
+	TEST_FEATURE ("with invalid sequence number");
+	push_request (client->io, 4, CONTROL_NATIVE_WATCH, epoch, "foo", NULL);
+
+	control_native_reader (client, client->io, client->io->recv_buf->buf,
+			       client->io->recv_buf->len);
+
+	pop_reply (client->io, &header, payload);
+	TEST_EQ (header.serial, 4);
+	TEST_EQ (header.type, CONTROL_NATIVE_ERROR);
+	TEST_EQ_STR (payload, DBUS_ERROR_INVALID_ARGS);
+
+
+	/* Check that a client that has let too much data queue up is sent
+	 * nothing more, its queue being discarded, and that its connection
+	 * is shut down so that it will be closed.
+	 */
+	TEST_FEATURE ("with client not reading changes");
+	filler = nih_alloc (NULL, CONTROL_NATIVE_MAX_QUEUED);
+	memset (filler, 0, CONTROL_NATIVE_MAX_QUEUED);
+	assert0 (nih_io_buffer_push (client->io->send_buf, filler,
+				     CONTROL_NATIVE_MAX_QUEUED));
+	nih_free (filler);
+
+	job->state = JOB_POST_STOP;
+
+	TEST_DIVERT_STDERR (output) {
+		control_native_job_changed (job);
+	}
+	rewind (output);
+
+	TEST_EQ (control_native_sequence, 3);
+	TEST_TRUE (client->closing);
+	TEST_EQ (client->io->send_buf->len, 0);
+
+	TEST_EQ (read (fds[1], payload, sizeof (payload)), 0);
+
+	nih_free (client);
+	close (fds[1]);
+
+	nih_free (class);
+	fclose (output);
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	/* run tests in legacy (pre-session support) mode */
+	setenv ("UPSTART_NO_SESSIONS", "1", 1);
+
+	test_client_new ();
+	test_reader ();
+	test_watch ();
+
+	return 0;
+}
@@ -2038,6 +2038,184 @@ test_expand (void)
 }
 
 
+void
+test_expand_realistic (void)
+{
+	char       *env[8], *str;
+	const char *strings[] = {
+		"",
+		"tty1",
+		"$TTY",
+		"${JOB}-${INSTANCE}",
+		"/var/run/$JOB/$INSTANCE.pid",
+		"${IFACE:-lo}",
+		NULL
+	};
+	const char *expected[] = {
+		"",
+		"tty1",
+		"tty2",
+		"network-interface-eth0",
+		"/var/run/network-interface/eth0.pid",
+		"eth0",
+		NULL
+	};
+	int         j;
+
+	/* Check that the kinds of string found in instance names and
+	 * event matches of real job definitions are expanded correctly by
+	 * each path through environ_expand().  The rate they are expanded
+	 * at is measured by bench_environ.
+	 */
+	TEST_FUNCTION_FEATURE ("environ_expand", "with realistic strings");
+	env[0] = "UPSTART_EVENTS=net-device-up";
+	env[1] = "JOB=network-interface";
+	env[2] = "INSTANCE=eth0";
+	env[3] = "IFACE=eth0";
+	env[4] = "LOGICAL=eth0";
+	env[5] = "ADDRFAM=inet";
+	env[6] = "TTY=tty2";
+	env[7] = NULL;
+
+	for (j = 0; strings[j]; j++) {
+		str = environ_expand (NULL, strings[j], env);
+
+		TEST_NE_P (str, NULL);
+		TEST_EQ_STR (str, expected[j]);
+
+		nih_free (str);
+	}
+}
+
+
+void
+test_table_add (void)
+{
+	EnvironTable  *table;
+	char         **env;
+	size_t         len;
+
+	TEST_FUNCTION ("environ_table_add");
+
+	/* Check that entries added to a new table are appended to its
+	 * array in order, and that the array is trimmed to size and
+	 * referenced by the parent when finished.
+	 */
+	TEST_FEATURE ("with new table");
+	TEST_ALLOC_FAIL {
+		env = NULL;
+		table = environ_table_new (NULL, NULL);
+
+		if (test_alloc_failed && (! table))
+			continue;
+
+		if ((! environ_table_add (table, TRUE, "FOO=BAR"))
+		    || (! environ_table_add (table, TRUE, "BAR=BAZ"))
+		    || (! environ_table_add (table, TRUE, "FRODO=BAGGINS"))
+		    || (! (env = environ_table_finish (table, &len)))) {
+			TEST_TRUE (test_alloc_failed);
+
+			nih_free (table->env);
+			nih_free (table);
+			continue;
+		}
+
+		nih_free (table);
+
+		TEST_EQ (len, 3);
+		TEST_ALLOC_SIZE (env, sizeof (char *) * 4);
+		TEST_ALLOC_PARENT (env[0], env);
+		TEST_EQ_STR (env[0], "FOO=BAR");
+		TEST_EQ_STR (env[1], "BAR=BAZ");
+		TEST_EQ_STR (env[2], "FRODO=BAGGINS");
+		TEST_EQ_P (env[3], NULL);
+
+		nih_free (env);
+	}
+
+
+	/* Check that an existing entry is replaced in place when replace
+	 * is TRUE, and left alone when it is FALSE.
+	 */
+	TEST_FEATURE ("with existing variable");
+	table = environ_table_new (NULL, NULL);
+	assert (environ_table_add (table, TRUE, "FOO=BAR"));
+	assert (environ_table_add (table, TRUE, "BAR=BAZ"));
+
+	TEST_NE_P (environ_table_add (table, FALSE, "FOO=WIBBLE"), NULL);
+	TEST_EQ_STR (environ_table_getn (table, "FOO", 3), "BAR");
+
+	TEST_NE_P (environ_table_add (table, TRUE, "FOO=WIBBLE"), NULL);
+	TEST_EQ_STR (environ_table_getn (table, "FOO", 3), "WIBBLE");
+
+	env = environ_table_finish (table, &len);
+	nih_free (table);
+
+	TEST_EQ (len, 2);
+	TEST_EQ_STR (env[0], "FOO=WIBBLE");
+	TEST_EQ_STR (env[1], "BAR=BAZ");
+	TEST_EQ_P (env[2], NULL);
+
+	nih_free (env);
+
+
+	/* Check that replacing an entry with a variable that isn't set in
+	 * init's environment removes it from the array, and that the
+	 * entries after it can still be found.
+	 */
+	TEST_FEATURE ("with unset variable");
+	unsetenv ("BAR");
+
+	table = environ_table_new (NULL, NULL);
+	assert (environ_table_add (table, TRUE, "FOO=BAR"));
+	assert (environ_table_add (table, TRUE, "BAR=BAZ"));
+	assert (environ_table_add (table, TRUE, "FRODO=BAGGINS"));
+
+	TEST_NE_P (environ_table_add (table, TRUE, "BAR"), NULL);
+	TEST_EQ_P (environ_table_getn (table, "BAR", 3), NULL);
+	TEST_EQ_STR (environ_table_getn (table, "FRODO", 5), "BAGGINS");
+
+	TEST_NE_P (environ_table_add (table, TRUE, "FRODO=BILBO"), NULL);
+
+	env = environ_table_finish (table, &len);
+	nih_free (table);
+
+	TEST_EQ (len, 2);
+	TEST_EQ_STR (env[0], "FOO=BAR");
+	TEST_EQ_STR (env[1], "FRODO=BILBO");
+	TEST_EQ_P (env[2], NULL);
+
+	nih_free (env);
+
+
+	/* Check that a table can extend an existing array, replacing the
+	 * entries that are already there.
+	 */
+	TEST_FEATURE ("with existing array");
+	len = 0;
+	env = nih_str_array_new (NULL);
+	assert (nih_str_array_add (&env, NULL, &len, "FOO=BAR"));
+	assert (nih_str_array_add (&env, NULL, &len, "BAR=BAZ"));
+
+	table = environ_table_new (NULL, env);
+	TEST_EQ (table->len, 2);
+
+	TEST_NE_P (environ_table_set (table, TRUE, "BAR=%d", 42), NULL);
+	TEST_NE_P (environ_table_add (table, TRUE, "WIBBLE=WOBBLE"), NULL);
+
+	env = environ_table_finish (table, &len);
+	nih_free (table);
+
+	TEST_EQ (len, 3);
+	TEST_EQ_STR (env[0], "FOO=BAR");
+	TEST_EQ_STR (env[1], "BAR=42");
+	TEST_EQ_STR (env[2], "WIBBLE=WOBBLE");
+	TEST_EQ_P (env[3], NULL);
+
+	nih_free (env);
+}
+
+
 int
 main (int   argc,
       char *argv[])
@@ -2054,6 +2232,8 @@ main (int   argc,
 	test_getn ();
 	test_all_valid ();
 	test_expand ();
+	test_expand_realistic ();
+	test_table_add ();
 
 	return 0;
 }
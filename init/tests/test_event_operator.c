@@ -26,6 +26,7 @@
 #include <nih/string.h>
 #include <nih/tree.h>
 
+#include "intern.h"
 #include "event_operator.h"
 #include "blocked.h"
 #include "parse_job.h"
@@ -416,11 +417,14 @@ test_operator_destroy (void)
 
 
 	/* Check that when an event operator without an event is destroyed,
-	 * everything works.
+	 * everything works, and its name is no longer watched.
 	 */
 	TEST_FEATURE ("without referenced event");
 	oper = event_operator_new (NULL, EVENT_MATCH, "foo", NULL);
+	TEST_TRUE (intern_watched ("foo"));
+
 	nih_free (oper);
+	TEST_FALSE (intern_watched ("foo"));
 
 
 	event_poll ();
@@ -1323,6 +1327,61 @@ test_operator_reset (void)
 	event_poll ();
 }
 
+
+void
+test_operator_job_name (void)
+{
+	EventOperator *oper;
+
+	TEST_FUNCTION ("event_operator_job_name");
+
+
+	/* Check that the job named by the first positional argument of
+	 * a job event is returned.
+	 */
+	TEST_FEATURE ("with positional argument");
+	oper = event_operator_new (NULL, EVENT_MATCH, "started", NULL);
+	oper->env = nih_str_array_new (oper);
+	NIH_MUST (nih_str_array_add (&oper->env, oper, NULL, "foo"));
+
+	TEST_EQ_STR (event_operator_job_name (oper), "foo");
+
+	nih_free (oper);
+
+
+	/* Check that the job may also be named by JOB=, in any
+	 * position.
+	 */
+	TEST_FEATURE ("with JOB variable");
+	oper = event_operator_new (NULL, EVENT_MATCH, "stopping", NULL);
+	oper->env = nih_str_array_new (oper);
+	NIH_MUST (nih_str_array_add (&oper->env, oper, NULL, "RESULT=ok"));
+	NIH_MUST (nih_str_array_add (&oper->env, oper, NULL, "JOB=bar"));
+
+	TEST_EQ_STR (event_operator_job_name (oper), "bar");
+
+	nih_free (oper);
+
+
+	/* Check that other events, and job events without a job, do not
+	 * name one.
+	 */
+	TEST_FEATURE ("without job");
+	oper = event_operator_new (NULL, EVENT_MATCH, "wibble", NULL);
+	oper->env = nih_str_array_new (oper);
+	NIH_MUST (nih_str_array_add (&oper->env, oper, NULL, "foo"));
+
+	TEST_EQ_P (event_operator_job_name (oper), NULL);
+
+	nih_free (oper);
+
+	oper = event_operator_new (NULL, EVENT_MATCH, "stopped", NULL);
+
+	TEST_EQ_P (event_operator_job_name (oper), NULL);
+
+	nih_free (oper);
+}
+
 void
 test_operator_serialisation (void)
 {
@@ -1448,6 +1507,7 @@ main (int   argc,
 	test_operator_environment ();
 	test_operator_events ();
 	test_operator_reset ();
+	test_operator_job_name ();
 	test_operator_serialisation ();
 
 	return 0;
@@ -0,0 +1,223 @@
+/* upstart
+ *
+ * test_intern.c - test suite for init/intern.c
+ *
+ * Copyright © 2014 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <nih/test.h>
+
+#include <string.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/string.h>
+#include <nih/hash.h>
+
+#include "intern.h"
+
+
+void
+test_string (void)
+{
+	void *parent1, *parent2;
+	char *str1, *str2;
+
+	TEST_FUNCTION ("intern_string");
+
+
+	/* Check that interning a string for the first time returns a
+	 * copy referenced by the parent, and adds it to the table.
+	 */
+	TEST_FEATURE ("with new string");
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			parent1 = nih_alloc (NULL, 1);
+		}
+
+		str1 = intern_string (parent1, "starting");
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (str1, NULL);
+			TEST_EQ_P (intern_lookup ("starting"), NULL);
+
+			nih_free (parent1);
+			continue;
+		}
+
+		TEST_EQ_STR (str1, "starting");
+		TEST_ALLOC_PARENT (str1, parent1);
+		TEST_EQ_P (intern_lookup ("starting"), str1);
+
+		nih_free (parent1);
+	}
+
+
+	/* Check that interning an equal string returns the same pointer,
+	 * now referenced by both parents, and that the string survives
+	 * until the last of them is freed.
+	 */
+	TEST_FEATURE ("with existing string");
+	parent1 = nih_alloc (NULL, 1);
+	parent2 = nih_alloc (NULL, 1);
+
+	str1 = intern_string (parent1, "stopped");
+	str2 = intern_string (parent2, "stopped");
+
+	TEST_EQ_P (str1, str2);
+	TEST_ALLOC_PARENT (str1, parent1);
+	TEST_ALLOC_PARENT (str1, parent2);
+
+	TEST_FREE_TAG (str1);
+
+	nih_free (parent1);
+
+	TEST_NOT_FREE (str1);
+	TEST_EQ_P (intern_lookup ("stopped"), str1);
+
+	nih_free (parent2);
+
+	TEST_FREE (str1);
+	TEST_EQ_P (intern_lookup ("stopped"), NULL);
+
+
+	/* Check that different strings are different pointers. */
+	TEST_FEATURE ("with different strings");
+	parent1 = nih_alloc (NULL, 1);
+
+	str1 = intern_string (parent1, "started");
+	str2 = intern_string (parent1, "stopping");
+
+	TEST_NE_P (str1, str2);
+	TEST_EQ_STR (str1, "started");
+	TEST_EQ_STR (str2, "stopping");
+
+	nih_free (parent1);
+
+	TEST_EQ_P (intern_lookup ("started"), NULL);
+	TEST_EQ_P (intern_lookup ("stopping"), NULL);
+}
+
+void
+test_stringn (void)
+{
+	void *parent;
+	char *str1, *str2;
+
+	/* Check that the name part of an environment string can be
+	 * interned, and is the same pointer as the whole string interned
+	 * separately.
+	 */
+	TEST_FUNCTION ("intern_stringn");
+	parent = nih_alloc (NULL, 1);
+
+	str1 = intern_stringn (parent, "INSTANCE=foo", 8);
+	str2 = intern_string (parent, "INSTANCE");
+
+	TEST_EQ_STR (str1, "INSTANCE");
+	TEST_EQ_P (str1, str2);
+	TEST_EQ_P (intern_lookupn ("INSTANCE=bar", 8), str1);
+
+	nih_free (parent);
+
+	TEST_EQ_P (intern_lookupn ("INSTANCE=bar", 8), NULL);
+}
+
+void
+test_lookupn (void)
+{
+	void *parent;
+	char  key[202];
+	char *str;
+
+	TEST_FUNCTION ("intern_lookupn");
+	parent = nih_alloc (NULL, 1);
+
+	memset (key, 'K', 200);
+	key[200] = '\0';
+
+
+	/* Check that a value too long to be copied onto the stack can
+	 * still be looked up, and that only the whole value matches.
+	 */
+	TEST_FEATURE ("with long value");
+	str = intern_string (parent, key);
+
+	key[200] = '=';
+	key[201] = '\0';
+
+	TEST_EQ_P (intern_lookupn (key, 200), str);
+	TEST_EQ_P (intern_lookupn (key, 199), NULL);
+
+	nih_free (parent);
+
+	TEST_EQ_P (intern_lookupn (key, 200), NULL);
+}
+
+void
+test_watch (void)
+{
+	void *parent;
+	char *str;
+
+	TEST_FUNCTION ("intern_watch");
+	parent = nih_alloc (NULL, 1);
+
+
+	/* Check that an interned string is not watched until a holder
+	 * says so, and that a string never interned is not watched.
+	 */
+	TEST_FEATURE ("with unwatched string");
+	str = intern_string (parent, "wibble");
+
+	TEST_FALSE (intern_watched ("wibble"));
+	TEST_FALSE (intern_watched ("wobble"));
+
+
+	/* Check that the string is watched until every watcher has
+	 * stopped watching it.
+	 */
+	TEST_FEATURE ("with watched string");
+	intern_watch (str);
+	intern_watch (str);
+
+	TEST_TRUE (intern_watched ("wibble"));
+
+	intern_unwatch (str);
+
+	TEST_TRUE (intern_watched ("wibble"));
+
+	intern_unwatch (str);
+
+	TEST_FALSE (intern_watched ("wibble"));
+
+	nih_free (parent);
+
+	TEST_FALSE (intern_watched ("wibble"));
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	test_string ();
+	test_stringn ();
+	test_lookupn ();
+	test_watch ();
+
+	return 0;
+}
@@ -69,6 +69,12 @@ static int continue_deserialise_ptrace = FALSE;
 
 static int child_wait_fd;
 
+/* Event operators keeping the started and stopped events observable so
+ * that job_emit_event() constructs them.
+ */
+static EventOperator *started_oper = NULL;
+static EventOperator *stopped_oper = NULL;
+
 
 void
 test_new (void)
@@ -143,18 +149,31 @@ test_new (void)
 		for (i = 0; i < PROCESS_LAST; i++)
 			TEST_EQ (job->pid[i], 0);
 
+		TEST_NE_P (job->pidfd, NULL);
+		TEST_ALLOC_PARENT (job->pidfd, job);
+		TEST_ALLOC_SIZE (job->pidfd, sizeof (NihIoWatch *) * PROCESS_LAST);
+
+		for (i = 0; i < PROCESS_LAST; i++)
+			TEST_EQ_P (job->pidfd[i], NULL);
+
 		TEST_EQ_P (job->blocker, NULL);
 		TEST_LIST_EMPTY (&job->blocking);
 
 		TEST_EQ_P (job->kill_timer, NULL);
 		TEST_EQ (job->kill_process, PROCESS_INVALID);
 
+		TEST_EQ_P (job->notify, NULL);
+		TEST_EQ_P (job->ready_timer, NULL);
+		TEST_EQ_P (job->watchdog_timer, NULL);
+
 		TEST_EQ (job->failed, FALSE);
 		TEST_EQ (job->failed_process, PROCESS_INVALID);
 		TEST_EQ (job->exit_status, 0);
 
 		TEST_EQ (job->respawn_count, 0);
 		TEST_EQ (job->respawn_time, 0);
+		TEST_EQ (job->respawn_delay, 0);
+		TEST_EQ_P (job->respawn_timer, NULL);
 
 		TEST_EQ (job->trace_forks, 0);
 		TEST_EQ (job->trace_state, TRACE_NONE);
@@ -4429,10 +4448,13 @@ test_finished (void)
 void
 test_emit_event (void)
 {
-	JobClass *class;
-	Job      *job;
-	Event    *event;
-	Blocked  *blocked;
+	pid_t           dbus_pid;
+	DBusConnection *conn;
+	NihListEntry   *entry;
+	JobClass       *class;
+	Job            *job;
+	Event          *event;
+	Blocked        *blocked;
 
 	TEST_FUNCTION ("job_emit_event");
 
@@ -5558,6 +5580,93 @@ test_emit_event (void)
 	}
 
 	nih_free (class);
+
+
+	/* Check that no event is constructed for a job reaching the
+	 * running state when nothing waits for the started event, and that
+	 * the skipped emission is counted; while a blocking starting event
+	 * is always constructed.
+	 */
+	TEST_FEATURE ("with unobserved event");
+	nih_free (started_oper);
+
+	class = job_class_new (NULL, "test", NULL);
+
+	job = job_new (class, "");
+	job->goal = JOB_START;
+	job->state = JOB_RUNNING;
+
+	job_events_skipped = 0;
+
+	event = job_emit_event (job);
+
+	TEST_EQ_P (event, NULL);
+	TEST_EQ (job_events_skipped, 1);
+	TEST_LIST_EMPTY (events);
+
+	job->state = JOB_STARTING;
+
+	event = job_emit_event (job);
+
+	TEST_NE_P (event, NULL);
+	TEST_EQ_STR (event->name, "starting");
+	TEST_EQ (job_events_skipped, 1);
+
+	nih_free (event);
+
+
+	/* Check that the started event is constructed again once an event
+	 * operator waits for it.
+	 */
+	TEST_FEATURE ("with observed event");
+	started_oper = event_operator_new (NULL, EVENT_MATCH, "started", NULL);
+
+	job->state = JOB_RUNNING;
+
+	event = job_emit_event (job);
+
+	TEST_NE_P (event, NULL);
+	TEST_EQ_STR (event->name, "started");
+	TEST_EQ (job_events_skipped, 1);
+
+	nih_free (event);
+
+
+	/* Check that while a D-Bus bus connection is open the event is
+	 * always constructed, even though nothing waits for it, since the
+	 * EventEmitted signal is broadcast on the bus and we cannot know
+	 * whether anyone listens.
+	 */
+	TEST_FEATURE ("with D-Bus bus connection");
+	nih_free (started_oper);
+
+	TEST_DBUS (dbus_pid);
+	TEST_DBUS_OPEN (conn);
+
+	control_init ();
+
+	entry = nih_list_entry_new (NULL);
+	entry->data = conn;
+	nih_list_add (control_conns, &entry->entry);
+
+	event = job_emit_event (job);
+
+	TEST_NE_P (event, NULL);
+	TEST_EQ_STR (event->name, "started");
+	TEST_EQ (job_events_skipped, 1);
+
+	nih_free (event);
+
+	nih_free (entry);
+
+	TEST_DBUS_CLOSE (conn);
+	TEST_DBUS_END (dbus_pid);
+
+	dbus_shutdown ();
+
+	started_oper = event_operator_new (NULL, EVENT_MATCH, "started", NULL);
+
+	nih_free (class);
 }
 
 
@@ -6950,6 +7059,79 @@ test_get_state (void)
 	}
 }
 
+void
+test_snapshot (void)
+{
+	JobClass    *class;
+	Job         *job;
+	JobSnapshot *snapshot, *snapshot2;
+	void        *parent;
+	char        *state;
+
+	TEST_FUNCTION ("job_snapshot");
+	job_class_init ();
+
+	class = job_class_new (NULL, "test", NULL);
+	job = job_new (class, "");
+
+
+	/* Check that a snapshot is built from the current goal, state
+	 * and processes of the job, and cached in the job.
+	 */
+	TEST_FEATURE ("with new snapshot");
+	job->goal = JOB_START;
+	job->state = JOB_RUNNING;
+	job->pid[PROCESS_MAIN] = 1000;
+
+	snapshot = job_snapshot (job);
+
+	TEST_ALLOC_SIZE (snapshot, sizeof (JobSnapshot));
+	TEST_ALLOC_PARENT (snapshot, job);
+	TEST_EQ_P (job->snapshot, snapshot);
+	TEST_EQ_STR (snapshot->goal_name, "start");
+	TEST_EQ_STR (snapshot->state_name, "running");
+	TEST_EQ_STR (snapshot->processes[0]->item0, "main");
+	TEST_EQ (snapshot->processes[0]->item1, 1000);
+	TEST_EQ_P (snapshot->processes[1], NULL);
+
+
+	/* Check that the same snapshot is returned while the job is
+	 * unchanged.
+	 */
+	TEST_FEATURE ("with unchanged job");
+	snapshot2 = job_snapshot (job);
+
+	TEST_EQ_P (snapshot2, snapshot);
+
+
+	/* Check that a new snapshot is built once the job changes, and
+	 * that values of the old one still referenced elsewhere survive
+	 * it being discarded.
+	 */
+	TEST_FEATURE ("with changed job");
+	parent = nih_alloc (NULL, 1);
+	state = snapshot->state_name;
+	nih_ref (state, parent);
+
+	TEST_FREE_TAG (snapshot);
+
+	job->state = JOB_STOPPING;
+	job->pid[PROCESS_MAIN] = 0;
+
+	snapshot2 = job_snapshot (job);
+
+	TEST_FREE (snapshot);
+	TEST_NE_P (snapshot2, NULL);
+	TEST_EQ_P (job->snapshot, snapshot2);
+	TEST_EQ_STR (snapshot2->state_name, "stopping");
+	TEST_EQ_P (snapshot2->processes[0], NULL);
+
+	TEST_EQ_STR (state, "running");
+
+	nih_free (parent);
+	nih_free (class);
+}
+
 
 void
 test_get_processes (void)
@@ -7410,6 +7592,92 @@ test_get_processes (void)
 	}
 }
 
+void
+test_get_stats (void)
+{
+	NihDBusMessage *          message = NULL;
+	JobClass *                class = NULL;
+	Job *                     job = NULL;
+	JobGetStatsStatsElement **stats;
+	NihError *                error;
+	int                       ret;
+
+	TEST_FUNCTION ("job_get_stats");
+	nih_error_init ();
+	job_class_init ();
+
+
+	/* Check that the running totals and latencies of the job, and the
+	 * respawns and watchdog expiries of its class, are returned by name.
+	 */
+	TEST_FEATURE ("with statistics");
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			class = job_class_new (NULL, "test", NULL);
+			class->respawns = 3;
+			class->watchdog_expiries = 1;
+
+			job = job_new (class, "");
+			job->stats.cpu_usec = 1500000;
+			job->stats.max_rss_kb = 2048;
+			job->stats.io_read_bytes = 40960;
+			job->stats.io_write_bytes = 8192;
+			job->stats.start_usec = 1200;
+			job->stats.exec_usec = 850;
+			job->stats.ready_usec = 3100;
+
+			message = nih_new (NULL, NihDBusMessage);
+			message->connection = NULL;
+			message->message = NULL;
+		}
+
+		stats = NULL;
+
+		ret = job_get_stats (job, message, &stats);
+
+		if (test_alloc_failed) {
+			TEST_LT (ret, 0);
+
+			error = nih_error_get ();
+			TEST_EQ (error->number, ENOMEM);
+			nih_free (error);
+
+			nih_free (message);
+			nih_free (class);
+			continue;
+		}
+
+		TEST_EQ (ret, 0);
+
+		TEST_ALLOC_PARENT (stats, message);
+		TEST_ALLOC_SIZE (stats, sizeof (JobGetStatsStatsElement *) * 10);
+
+		TEST_ALLOC_PARENT (stats[0], stats);
+		TEST_EQ_STR (stats[0]->item0, "cpu_usec");
+		TEST_EQ (stats[0]->item1, 1500000);
+		TEST_EQ_STR (stats[1]->item0, "max_rss_kb");
+		TEST_EQ (stats[1]->item1, 2048);
+		TEST_EQ_STR (stats[2]->item0, "io_read_bytes");
+		TEST_EQ (stats[2]->item1, 40960);
+		TEST_EQ_STR (stats[3]->item0, "io_write_bytes");
+		TEST_EQ (stats[3]->item1, 8192);
+		TEST_EQ_STR (stats[4]->item0, "start_usec");
+		TEST_EQ (stats[4]->item1, 1200);
+		TEST_EQ_STR (stats[5]->item0, "exec_usec");
+		TEST_EQ (stats[5]->item1, 850);
+		TEST_EQ_STR (stats[6]->item0, "ready_usec");
+		TEST_EQ (stats[6]->item1, 3100);
+		TEST_EQ_STR (stats[7]->item0, "respawns");
+		TEST_EQ (stats[7]->item1, 3);
+		TEST_EQ_STR (stats[8]->item0, "watchdog_expiries");
+		TEST_EQ (stats[8]->item1, 1);
+		TEST_EQ_P (stats[9], NULL);
+
+		nih_free (message);
+		nih_free (class);
+	}
+}
+
 void
 test_deserialise_ptrace (void)
 {
@@ -7697,6 +7965,9 @@ main (int   argc,
 		exit (0);
 	}
 
+	started_oper = event_operator_new (NULL, EVENT_MATCH, "started", NULL);
+	stopped_oper = event_operator_new (NULL, EVENT_MATCH, "stopped", NULL);
+
 	test_new ();
 	test_register ();
 	test_change_goal ();
@@ -7720,8 +7991,10 @@ main (int   argc,
 	test_get_name ();
 	test_get_goal ();
 	test_get_state ();
+	test_snapshot ();
 
 	test_get_processes ();
+	test_get_stats ();
 
 	test_deserialise_ptrace ();
 
@@ -123,11 +123,17 @@ test_new (void)
 		TEST_EQ (class->kill_timeout, 5);
 		TEST_EQ (class->kill_signal, SIGTERM);
 
+		TEST_EQ (class->ready_timeout, 90);
+		TEST_EQ (class->watchdog_timeout, 0);
+
 		TEST_EQ (class->reload_signal, SIGHUP);
 
 		TEST_EQ (class->respawn, FALSE);
 		TEST_EQ (class->respawn_limit, 10);
 		TEST_EQ (class->respawn_interval, 5);
+		TEST_EQ (class->respawn_delay_min, 0);
+		TEST_EQ (class->respawn_delay_max, 0);
+		TEST_EQ (class->respawn_stable, JOB_DEFAULT_RESPAWN_STABLE);
 
 		TEST_EQ_P (class->normalexit, NULL);
 		TEST_EQ (class->normalexit_len, 0);
@@ -141,6 +147,15 @@ test_new (void)
 		for (i = 0; i < RLIMIT_NLIMITS; i++)
 			TEST_EQ_P (class->limits[i], NULL);
 
+		TEST_EQ (class->cpu_weight, 0);
+		TEST_EQ (class->cpu_quota, 0);
+		TEST_EQ (class->memory_max, 0);
+		TEST_EQ (class->memory_high, 0);
+		TEST_EQ (class->io_weight, 0);
+		TEST_EQ_P (class->cpu_affinity, NULL);
+		TEST_EQ (class->numa_policy, NUMA_DEFAULT);
+		TEST_EQ_P (class->numa_nodes, NULL);
+
 		TEST_EQ_P (class->chroot, NULL);
 		TEST_EQ_P (class->chdir, NULL);
 
@@ -3509,6 +3524,51 @@ test_get_start_on (void)
 		nih_free (message);
 		nih_free (class);
 	}
+
+
+	/* Check that the array is built only once, later calls returning
+	 * the cached value referenced by each message, which survives
+	 * both the class and the earlier message being freed.
+	 */
+	TEST_FEATURE ("with cached value");
+	class = job_class_new (NULL, "test", NULL);
+	class->start_on = event_operator_new (class, EVENT_MATCH,
+					      "wibble", NULL);
+
+	message = nih_new (NULL, NihDBusMessage);
+	message->connection = NULL;
+	message->message = NULL;
+
+	ret = job_class_get_start_on (class, message, &start_on);
+	TEST_EQ (ret, 0);
+
+	{
+		NihDBusMessage  *message2;
+		char          ***start_on2;
+
+		message2 = nih_new (NULL, NihDBusMessage);
+		message2->connection = NULL;
+		message2->message = NULL;
+
+		ret = job_class_get_start_on (class, message2, &start_on2);
+		TEST_EQ (ret, 0);
+
+		TEST_EQ_P (start_on2, start_on);
+		TEST_ALLOC_PARENT (start_on, message);
+		TEST_ALLOC_PARENT (start_on, message2);
+
+		TEST_FREE_TAG (start_on);
+
+		nih_free (class);
+		nih_free (message);
+
+		TEST_NOT_FREE (start_on);
+		TEST_EQ_STR (start_on[0][0], "wibble");
+
+		nih_free (message2);
+
+		TEST_FREE (start_on);
+	}
 }
 
 void
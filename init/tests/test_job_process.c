@@ -29,8 +29,10 @@
 #include <sys/stat.h>
 #include <sys/wait.h>
 #include <sys/ptrace.h>
+#include <sys/socket.h>
 
 #include <time.h>
+#include <errno.h>
 #include <stdio.h>
 #include <pty.h>
 #include <limits.h>
@@ -51,10 +53,13 @@
 #include <nih/list.h>
 #include <nih/io.h>
 #include <nih/main.h>
+#include <nih/timer.h>
 #include <nih/error.h>
 #include <nih/logging.h>
 
 #include "job_process.h"
+#include "timeline.h"
+#include "timer_wheel.h"
 #include "job.h"
 #include "event.h"
 #include "blocked.h"
@@ -142,6 +147,8 @@ enum child_tests {
 
 pid_t pty_child_pid;
 
+extern int use_pidfds;
+
 static char *argv0;
 
 static int get_available_pty_count (void) __attribute__((unused));
@@ -1121,6 +1128,60 @@ test_run (void)
 		nih_free (class);
 	}
 
+	/* Check that if we're running a job that notifies us when it's
+	 * ready, a socket is created for it to do so, named in its
+	 * environment, and the ready timer is set.
+	 */
+	TEST_FEATURE ("with notifying job");
+	TEST_HASH_EMPTY (job_classes);
+
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			class = job_class_new (NULL, "test", NULL);
+			class->console = CONSOLE_NONE;
+			class->expect = EXPECT_NOTIFY;
+			class->process[PROCESS_MAIN] = process_new (class);
+			class->process[PROCESS_MAIN]->script = FALSE;
+			class->process[PROCESS_MAIN]->command = nih_sprintf (
+				class->process[PROCESS_MAIN],
+				"%s %d %s", argv0, TEST_ENVIRONMENT, filename);
+
+			job = job_new (class, "");
+			job->goal = JOB_START;
+			job->state = JOB_SPAWNED;
+		}
+
+		ret = job_process_run (job, PROCESS_MAIN);
+		TEST_EQ (ret, 0);
+
+		TEST_NE (job->pid[PROCESS_MAIN], 0);
+
+		TEST_NE_P (job->notify, NULL);
+		TEST_ALLOC_PARENT (job->notify, job);
+
+		TEST_NE_P (job->ready_timer, NULL);
+		TEST_EQ (job->ready_timer->timeout, JOB_DEFAULT_READY_TIMEOUT);
+
+		waitpid (job->pid[PROCESS_MAIN], NULL, 0);
+		TEST_EQ (stat (filename, &statbuf), 0);
+
+		output = fopen (filename, "r");
+		TEST_FILE_MATCH (output, "NOTIFY_SOCKET=@*\n");
+		TEST_FILE_EQ (output, "UPSTART_INSTANCE=\n");
+		TEST_FILE_EQ (output, "UPSTART_JOB=test\n");
+		TEST_FILE_EQ (output, "UPSTART_NO_SESSIONS=1\n");
+		TEST_FILE_END (output);
+		fclose (output);
+		unlink (filename);
+
+		job_process_notify_close (job);
+
+		TEST_EQ_P (job->notify, NULL);
+		TEST_EQ_P (job->ready_timer, NULL);
+
+		nih_free (class);
+	}
+
 	/* Check that if we try and run a command that doesn't exist,
 	 * job_process_run() raises a ProcessError and the command doesn't
 	 * have any stored process id for it.
@@ -5510,10 +5571,273 @@ test_kill (void)
 		event_poll ();
 	}
 
+	/* Check that a process watched through a pidfd is still sent the
+	 * signal, the pidfd confirming it has not been reaped.
+	 */
+	TEST_FEATURE ("with pidfd");
+	use_pidfds = TRUE;
+
+	job = job_new (class, "");
+	job->goal = JOB_STOP;
+	job->state = JOB_KILLED;
+	TEST_CHILD (job->pid[PROCESS_MAIN]) {
+		pause ();
+	}
+	pid = job->pid[PROCESS_MAIN];
+	setpgid (pid, pid);
+
+	job_process_watch (job, PROCESS_MAIN);
+	job_process_kill (job, PROCESS_MAIN);
+
+	TEST_EQ (job->pid[PROCESS_MAIN], pid);
+
+	waitpid (job->pid[PROCESS_MAIN], &status, 0);
+	TEST_TRUE (WIFSIGNALED (status));
+	TEST_EQ (WTERMSIG (status), SIGTERM);
+
+	TEST_EQ (job->kill_process, PROCESS_MAIN);
+
+	nih_free (job->kill_timer);
+	job->kill_timer = NULL;
+	job->kill_process = PROCESS_INVALID;
+
+	nih_free (job);
+	use_pidfds = FALSE;
+
+	event_poll ();
+
 	nih_free (class);
 }
 
 
+void
+test_notify (void)
+{
+	JobClass *class;
+	Job      *job;
+	FILE     *output;
+	fd_set    readfds, writefds, exceptfds;
+	int       nfds, sock[2], opt = 1;
+	pid_t     pid;
+	int       status;
+
+	TEST_FUNCTION ("job_process_notify_watch");
+	program_name = "test";
+	output = tmpfile ();
+
+	nih_timer_init ();
+	event_init ();
+
+	class = job_class_new (NULL, "test", NULL);
+	class->expect = EXPECT_NOTIFY;
+
+
+	/* Check that when the main process sends READY=1 to its socket,
+	 * the job moves out of the spawned state to running and the
+	 * socket is closed.
+	 */
+	TEST_FEATURE ("with ready notification");
+	job = job_new (class, "");
+	job->goal = JOB_START;
+	job->state = JOB_SPAWNED;
+	job->pid[PROCESS_MAIN] = getpid ();
+
+	assert0 (socketpair (AF_UNIX, SOCK_DGRAM, 0, sock));
+	assert0 (setsockopt (sock[0], SOL_SOCKET, SO_PASSCRED,
+			     &opt, sizeof (opt)));
+
+	job_process_notify_watch (job, sock[0]);
+
+	TEST_NE_P (job->notify, NULL);
+	TEST_ALLOC_PARENT (job->notify, job);
+
+	assert (send (sock[1], "STATUS=Serving\nREADY=1\n", 23, 0) == 23);
+
+	nfds = 0;
+	FD_ZERO (&readfds);
+	FD_ZERO (&writefds);
+	FD_ZERO (&exceptfds);
+
+	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
+	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+
+	TEST_EQ (job->goal, JOB_START);
+	TEST_EQ (job->state, JOB_RUNNING);
+	TEST_EQ_P (job->notify, NULL);
+
+	close (sock[1]);
+	nih_free (job);
+
+
+	/* Check that a notification sent by a process other than the main
+	 * process is ignored.
+	 */
+	TEST_FEATURE ("with notification from other process");
+	job = job_new (class, "");
+	job->goal = JOB_START;
+	job->state = JOB_SPAWNED;
+	job->pid[PROCESS_MAIN] = 1;
+
+	assert0 (socketpair (AF_UNIX, SOCK_DGRAM, 0, sock));
+	assert0 (setsockopt (sock[0], SOL_SOCKET, SO_PASSCRED,
+			     &opt, sizeof (opt)));
+
+	job_process_notify_watch (job, sock[0]);
+
+	assert (send (sock[1], "READY=1", 7, 0) == 7);
+
+	nfds = 0;
+	FD_ZERO (&readfds);
+	FD_ZERO (&writefds);
+	FD_ZERO (&exceptfds);
+
+	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
+	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+
+	TEST_EQ (job->state, JOB_SPAWNED);
+	TEST_NE_P (job->notify, NULL);
+
+	job_process_notify_close (job);
+	TEST_EQ_P (job->notify, NULL);
+
+	close (sock[1]);
+	nih_free (job);
+
+
+	/* Check that if the main process isn't ready by the time the ready
+	 * timer expires, the job is marked as failed and stopped.
+	 */
+	TEST_FEATURE ("with ready timeout");
+	job = job_new (class, "");
+	job->goal = JOB_START;
+	job->state = JOB_SPAWNED;
+	job->pid[PROCESS_MAIN] = 1;
+
+	job_process_set_ready_timer (job, 0);
+	TEST_NE_P (job->ready_timer, NULL);
+
+	TEST_DIVERT_STDERR (output) {
+		timer_wheel_poll ();
+	}
+	rewind (output);
+
+	TEST_EQ_P (job->ready_timer, NULL);
+
+	TEST_EQ (job->goal, JOB_STOP);
+	TEST_EQ (job->state, JOB_STOPPING);
+	TEST_EQ (job->failed, TRUE);
+	TEST_EQ (job->failed_process, PROCESS_MAIN);
+
+	TEST_FILE_EQ (output, ("test: test main process (1) not ready "
+			       "after 90 seconds, stopping\n"));
+	TEST_FILE_END (output);
+	TEST_FILE_RESET (output);
+
+	TEST_NE_P (job->blocker, NULL);
+	nih_free (job->blocker->blocking.next);
+
+	nih_free (job);
+
+
+	/* Check that when the main process sends WATCHDOG=1 its watchdog
+	 * timer is restarted, and that the socket is kept open after the
+	 * job has moved out of the spawned state while the process is
+	 * being supervised.
+	 */
+	TEST_FEATURE ("with watchdog keepalive");
+	class->watchdog_timeout = 10;
+
+	job = job_new (class, "");
+	job->goal = JOB_START;
+	job->state = JOB_SPAWNED;
+	job->pid[PROCESS_MAIN] = getpid ();
+
+	assert0 (socketpair (AF_UNIX, SOCK_DGRAM, 0, sock));
+	assert0 (setsockopt (sock[0], SOL_SOCKET, SO_PASSCRED,
+			     &opt, sizeof (opt)));
+
+	job_process_notify_watch (job, sock[0]);
+	job_process_set_watchdog_timer (job, 1);
+
+	assert (send (sock[1], "READY=1\nWATCHDOG=1", 18, 0) == 18);
+
+	nfds = 0;
+	FD_ZERO (&readfds);
+	FD_ZERO (&writefds);
+	FD_ZERO (&exceptfds);
+
+	nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
+	nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+
+	TEST_EQ (job->state, JOB_RUNNING);
+	TEST_NE_P (job->notify, NULL);
+
+	TEST_NE_P (job->watchdog_timer, NULL);
+	TEST_ALLOC_PARENT (job->watchdog_timer, job);
+	TEST_EQ (job->watchdog_timer->timeout, 10);
+
+	job->pid[PROCESS_MAIN] = 0;
+	job_process_notify_close (job);
+
+	TEST_EQ_P (job->notify, NULL);
+	TEST_EQ_P (job->watchdog_timer, NULL);
+
+	close (sock[1]);
+	nih_free (job);
+
+
+	/* Check that if the main process stops notifying us that it is
+	 * alive, it is sent the ABRT signal when the watchdog timer
+	 * expires, with the kill timer set in case that isn't enough, and
+	 * the expiry is counted.
+	 */
+	TEST_FEATURE ("with watchdog timeout");
+	job = job_new (class, "");
+	job->goal = JOB_START;
+	job->state = JOB_RUNNING;
+
+	TEST_CHILD (job->pid[PROCESS_MAIN]) {
+		struct rlimit core = { 0, 0 };
+
+		setrlimit (RLIMIT_CORE, &core);
+		pause ();
+	}
+	pid = job->pid[PROCESS_MAIN];
+	setpgid (pid, pid);
+
+	job_process_set_watchdog_timer (job, 0);
+
+	TEST_DIVERT_STDERR (output) {
+		timer_wheel_poll ();
+	}
+	rewind (output);
+
+	TEST_EQ_P (job->watchdog_timer, NULL);
+	TEST_EQ (class->watchdog_expiries, 1);
+
+	TEST_EQ (job->goal, JOB_START);
+	TEST_EQ (job->state, JOB_RUNNING);
+
+	TEST_NE_P (job->kill_timer, NULL);
+	TEST_EQ (job->kill_process, PROCESS_MAIN);
+
+	waitpid (pid, &status, 0);
+	TEST_TRUE (WIFSIGNALED (status));
+	TEST_EQ (WTERMSIG (status), SIGABRT);
+
+	TEST_FILE_EQ_N (output, "test: test main process (");
+	TEST_FILE_END (output);
+	TEST_FILE_RESET (output);
+
+	nih_free (job);
+
+	class->watchdog_timeout = 0;
+
+	nih_free (class);
+	fclose (output);
+}
+
+
 void
 test_handler (void)
 {
@@ -5527,11 +5851,15 @@ test_handler (void)
 	FILE *          output;
 	int             exitcodes[2] = { 100, SIGINT << 8 };
 	int             status;
-	pid_t           pid;
+	pid_t           pid, child, grandchild;
 	siginfo_t       info;
 	unsigned long   data;
 	struct timespec now;
 	char            dirname[PATH_MAX];
+	char            cgroup[PATH_MAX];
+	char            procs[PATH_MAX];
+	FILE *          f;
+	int             wait_fd;
 
 	TEST_FILENAME (dirname);       
 	TEST_EQ (mkdir (dirname, 0755), 0);
@@ -5669,6 +5997,84 @@ test_handler (void)
 	}
 
 
+	/* Check that the resources used by a process are added to the
+	 * running totals of its job when it's reaped.
+	 */
+	TEST_FEATURE ("with resource usage");
+	job = job_new (class, "");
+	job->goal = JOB_START;
+	job->state = JOB_RUNNING;
+
+	TEST_CHILD (job->pid[PROCESS_MAIN]) {
+		struct timespec start, spin;
+
+		clock_gettime (CLOCK_PROCESS_CPUTIME_ID, &start);
+		do {
+			clock_gettime (CLOCK_PROCESS_CPUTIME_ID, &spin);
+		} while ((spin.tv_sec - start.tv_sec) * 1000000000L
+			 + (spin.tv_nsec - start.tv_nsec) < 20000000L);
+
+		exit (0);
+	}
+	pid = job->pid[PROCESS_MAIN];
+
+	waitpid (pid, NULL, 0);
+	job_process_handler (NULL, pid, NIH_CHILD_EXITED, 0);
+
+	TEST_EQ (job->pid[PROCESS_MAIN], 0);
+	TEST_GE (job->stats.cpu_usec, 10000);
+
+	nih_free (job);
+
+
+	/* Check that when processes are watched through a pidfd, the
+	 * termination of the running task is reaped and handled as soon as
+	 * the main loop finds its pidfd readable, without needing SIGCHLD.
+	 */
+	TEST_FEATURE ("with pidfd");
+	use_pidfds = TRUE;
+
+	job = job_new (class, "");
+	job->goal = JOB_START;
+	job->state = JOB_RUNNING;
+
+	TEST_CHILD (job->pid[PROCESS_MAIN]) {
+		exit (0);
+	}
+	pid = job->pid[PROCESS_MAIN];
+
+	job_process_watch (job, PROCESS_MAIN);
+
+	if (job->pidfd[PROCESS_MAIN]) {
+		fd_set readfds, writefds, exceptfds;
+		int    nfds = 0;
+
+		TEST_ALLOC_PARENT (job->pidfd[PROCESS_MAIN], job);
+
+		FD_ZERO (&readfds);
+		FD_ZERO (&writefds);
+		FD_ZERO (&exceptfds);
+
+		nih_io_select_fds (&nfds, &readfds, &writefds, &exceptfds);
+		TEST_GT (select (nfds, &readfds, &writefds, &exceptfds,
+				 NULL), 0);
+		nih_io_handle_fds (&readfds, &writefds, &exceptfds);
+
+		TEST_EQ (job->goal, JOB_STOP);
+		TEST_EQ (job->state, JOB_STOPPING);
+		TEST_EQ (job->pid[PROCESS_MAIN], 0);
+		TEST_EQ_P (job->pidfd[PROCESS_MAIN], NULL);
+
+		TEST_LT (waitpid (pid, NULL, WNOHANG), 0);
+		TEST_EQ (errno, ECHILD);
+	} else {
+		waitpid (pid, NULL, 0);
+	}
+
+	nih_free (job);
+	use_pidfds = FALSE;
+
+
 	/* Check that we can handle a running task of the job after it's been
 	 * sent the TERM signal and a kill timer set.  The kill timer should
 	 * be cancelled and freed, and since we killed it, the job should
@@ -6264,6 +6670,150 @@ test_handler (void)
 	class->respawn = FALSE;
 
 
+	/* Check that when the job has a respawn delay, it is respawned
+	 * however often it has been respawned recently but only once a
+	 * timer has expired, the delay doubling each time up to the
+	 * maximum.
+	 */
+	TEST_FEATURE ("with respawn delay");
+	class->respawn = TRUE;
+	class->respawn_limit = 5;
+	class->respawn_interval = 10;
+	class->respawn_delay_min = 4;
+	class->respawn_delay_max = 12;
+
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			job = job_new (class, "");
+
+			assert0 (clock_gettime (CLOCK_MONOTONIC, &now));
+
+			job->respawn_count = 5;
+			job->respawn_time = now.tv_sec - 5;
+			job->respawn_delay = 8;
+			job->stats.spawned_time = timeline_now ();
+		}
+
+		job->goal = JOB_START;
+		job->state = JOB_RUNNING;
+		job->pid[PROCESS_MAIN] = 1;
+
+		job->blocker = NULL;
+		job->failed = FALSE;
+
+		TEST_DIVERT_STDERR (output) {
+			job_process_handler (NULL, 1, NIH_CHILD_EXITED, 1);
+		}
+		rewind (output);
+
+		TEST_EQ (job->goal, JOB_START);
+		TEST_EQ (job->state, JOB_STOPPING);
+		TEST_EQ (job->pid[PROCESS_MAIN], 0);
+		TEST_EQ (job->failed, FALSE);
+
+		TEST_EQ (job->respawn_delay, 12);
+		TEST_NE_P (job->respawn_timer, NULL);
+		TEST_ALLOC_PARENT (job->respawn_timer, job);
+		TEST_GE (job->respawn_timer->timeout, 12);
+		TEST_LE (job->respawn_timer->timeout, 15);
+
+		TEST_FILE_EQ (output, ("test: test main process (1) "
+				       "terminated with status 1\n"));
+		TEST_FILE_MATCH (output, ("test: test main process ended, "
+					  "respawning in 1? seconds\n"));
+		TEST_FILE_END (output);
+		TEST_FILE_RESET (output);
+
+		blocked = (Blocked *)job->blocker->blocking.next;
+		nih_free (blocked);
+
+		nih_free (job);
+	}
+
+
+	/* Check that once the process has run for the stable period, its
+	 * respawn delay starts again from the minimum.
+	 */
+	TEST_FEATURE ("with respawn delay after stable period");
+	class->respawn_stable = 0;
+
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			job = job_new (class, "");
+
+			job->respawn_delay = 8;
+			job->stats.spawned_time = timeline_now ();
+		}
+
+		job->goal = JOB_START;
+		job->state = JOB_RUNNING;
+		job->pid[PROCESS_MAIN] = 1;
+
+		job->blocker = NULL;
+
+		TEST_DIVERT_STDERR (output) {
+			job_process_handler (NULL, 1, NIH_CHILD_EXITED, 1);
+		}
+		rewind (output);
+
+		TEST_EQ (job->state, JOB_STOPPING);
+		TEST_EQ (job->respawn_delay, 4);
+		TEST_NE_P (job->respawn_timer, NULL);
+		TEST_GE (job->respawn_timer->timeout, 4);
+		TEST_LE (job->respawn_timer->timeout, 5);
+
+		TEST_FILE_EQ (output, ("test: test main process (1) "
+				       "terminated with status 1\n"));
+		TEST_FILE_MATCH (output, ("test: test main process ended, "
+					  "respawning in ? seconds\n"));
+		TEST_FILE_END (output);
+		TEST_FILE_RESET (output);
+
+		blocked = (Blocked *)job->blocker->blocking.next;
+		nih_free (blocked);
+
+		nih_free (job);
+	}
+
+	class->respawn_stable = JOB_DEFAULT_RESPAWN_STABLE;
+
+
+	/* Check that a job waiting for its respawn delay stays in the
+	 * post-stop state until the timer expires, and is then started
+	 * again.
+	 */
+	TEST_FEATURE ("with respawn delay expiring");
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			job = job_new (class, "");
+			job_process_set_respawn_timer (job, 0);
+		}
+
+		job->goal = JOB_START;
+		job->state = JOB_KILLED;
+		job->blocker = NULL;
+
+		job_change_state (job, JOB_STARTING);
+
+		TEST_EQ (job->state, JOB_POST_STOP);
+		TEST_NE_P (job->respawn_timer, NULL);
+
+		timer_wheel_poll ();
+
+		TEST_EQ_P (job->respawn_timer, NULL);
+		TEST_EQ (job->state, JOB_STARTING);
+
+		blocked = (Blocked *)job->blocker->blocking.next;
+		nih_free (blocked);
+
+		nih_free (job);
+	}
+
+	class->respawn = FALSE;
+	class->respawn_delay_min = 0;
+	class->respawn_delay_max = 0;
+
+
 	/* Check that we can catch a running task exiting with a "normal"
 	 * exit code, and even if it's marked respawn, set the goal to
 	 * stop and transition into the stopping state.
@@ -8791,6 +9341,170 @@ test_handler (void)
 	}
 
 	class->expect = EXPECT_NONE;
+
+
+	/* Check that when a daemon followed by its control group has
+	 * forked twice and both its initial process and the intermediate
+	 * child have exited before we handle either, the surviving process
+	 * becomes the main process and the job moves into the running state,
+	 * and that the later exit of the intermediate child is ignored.
+	 */
+	TEST_FEATURE ("with both forks of daemon followed by control group");
+	class->expect = EXPECT_DAEMON;
+
+	TEST_FILENAME (cgroup);
+	TEST_EQ (mkdir (cgroup, 0755), 0);
+	strcpy (procs, cgroup);
+	strcat (procs, "/cgroup.procs");
+
+	job = job_new (class, "");
+	job->cgroup = nih_strdup (job, cgroup);
+	job->trace_state = TRACE_CGROUP;
+
+	TEST_CHILD (pid) {
+		exit (0);
+	}
+	waitpid (pid, NULL, 0);
+
+	TEST_CHILD (child) {
+		exit (0);
+	}
+	waitpid (child, NULL, 0);
+
+	TEST_CHILD (grandchild) {
+		pause ();
+		exit (0);
+	}
+
+	f = fopen (procs, "w");
+	fprintf (f, "%d\n", grandchild);
+	fclose (f);
+
+	job->goal = JOB_START;
+	job->state = JOB_SPAWNED;
+	job->pid[PROCESS_MAIN] = pid;
+
+	TEST_DIVERT_STDERR (output) {
+		job_process_handler (NULL, pid, NIH_CHILD_EXITED, 0);
+		job_process_handler (NULL, child, NIH_CHILD_EXITED, 0);
+	}
+	rewind (output);
+
+	TEST_EQ (job->goal, JOB_START);
+	TEST_EQ (job->state, JOB_RUNNING);
+	TEST_EQ (job->pid[PROCESS_MAIN], grandchild);
+	TEST_EQ (job->trace_state, TRACE_NONE);
+
+	kill (grandchild, SIGTERM);
+	waitpid (grandchild, NULL, 0);
+
+	nih_free (job);
+
+
+	/* Check that when the process found is the intermediate child of
+	 * a daemon, having called setsid() but not yet forked again, the
+	 * job remains spawned; and that once that child exits, the process
+	 * it left becomes the main process and the job moves into the
+	 * running state.
+	 */
+	TEST_FEATURE ("with intermediate child of daemon followed by control group");
+	job = job_new (class, "");
+	job->cgroup = nih_strdup (job, cgroup);
+	job->trace_state = TRACE_CGROUP;
+
+	TEST_CHILD (pid) {
+		exit (0);
+	}
+	waitpid (pid, NULL, 0);
+
+	TEST_CHILD_WAIT (child, wait_fd) {
+		setsid ();
+		TEST_CHILD_RELEASE (wait_fd);
+		pause ();
+		exit (0);
+	}
+
+	f = fopen (procs, "w");
+	fprintf (f, "%d\n", child);
+	fclose (f);
+
+	job->goal = JOB_START;
+	job->state = JOB_SPAWNED;
+	job->pid[PROCESS_MAIN] = pid;
+
+	TEST_DIVERT_STDERR (output) {
+		job_process_handler (NULL, pid, NIH_CHILD_EXITED, 0);
+	}
+	rewind (output);
+
+	TEST_EQ (job->goal, JOB_START);
+	TEST_EQ (job->state, JOB_SPAWNED);
+	TEST_EQ (job->pid[PROCESS_MAIN], child);
+	TEST_EQ (job->trace_state, TRACE_CGROUP);
+
+	TEST_CHILD (grandchild) {
+		pause ();
+		exit (0);
+	}
+
+	kill (child, SIGTERM);
+	waitpid (child, NULL, 0);
+
+	f = fopen (procs, "w");
+	fprintf (f, "%d\n", grandchild);
+	fclose (f);
+
+	TEST_DIVERT_STDERR (output) {
+		job_process_handler (NULL, child, NIH_CHILD_EXITED, 0);
+	}
+	rewind (output);
+
+	TEST_EQ (job->goal, JOB_START);
+	TEST_EQ (job->state, JOB_RUNNING);
+	TEST_EQ (job->pid[PROCESS_MAIN], grandchild);
+	TEST_EQ (job->trace_state, TRACE_NONE);
+
+
+	/* Check that once the job has moved on from the spawned state,
+	 * the main process exiting normally is its termination even if
+	 * it left a process re-parented to us behind.
+	 */
+	TEST_FEATURE ("with running daemon leaving process behind");
+	job->trace_state = TRACE_CGROUP;
+	pid = grandchild;
+
+	TEST_CHILD (grandchild) {
+		pause ();
+		exit (0);
+	}
+
+	kill (pid, SIGTERM);
+	waitpid (pid, NULL, 0);
+
+	f = fopen (procs, "w");
+	fprintf (f, "%d\n", grandchild);
+	fclose (f);
+
+	TEST_DIVERT_STDERR (output) {
+		job_process_handler (NULL, pid, NIH_CHILD_EXITED, 0);
+	}
+	rewind (output);
+
+	TEST_EQ (job->goal, JOB_STOP);
+	TEST_EQ (job->state, JOB_STOPPING);
+	TEST_EQ (job->pid[PROCESS_MAIN], 0);
+
+	kill (grandchild, SIGTERM);
+	waitpid (grandchild, &status, 0);
+	TEST_TRUE (WIFSIGNALED (status));
+	TEST_EQ (WTERMSIG (status), SIGTERM);
+
+	nih_free (job);
+
+	unlink (procs);
+	rmdir (cgroup);
+
+	class->expect = EXPECT_NONE;
 #if HAVE_VALGRIND_VALGRIND_H
 	}
 #endif
@@ -9185,6 +9899,7 @@ run_tests (void)
 	test_spawn ();
 	test_log_path ();
 	test_kill ();
+	test_notify ();
 	test_handler ();
 	test_utmp ();
 	test_find ();
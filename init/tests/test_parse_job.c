@@ -2015,7 +2015,7 @@ test_stanza_post_stop (void)
 void
 test_stanza_start (void)
 {
-	JobClass     *job;
+	JobClass     *job, *other;
 	EventOperator *oper;
 	NihError      *err;
 	size_t         pos, lineno;
@@ -2066,6 +2066,32 @@ test_stanza_start (void)
 	}
 
 
+	/* Check that the event names of start on stanzas are interned,
+	 * so that jobs waiting for the same event share a single copy of
+	 * its name rather than each having their own.
+	 */
+	TEST_FEATURE ("with event name shared by another job");
+	strcpy (buf, "start on wibble\n");
+
+	pos = 0;
+	lineno = 1;
+	job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf),
+			 &pos, &lineno);
+	TEST_NE_P (job, NULL);
+
+	pos = 0;
+	lineno = 1;
+	other = parse_job (NULL, NULL, NULL, "other", buf, strlen (buf),
+			   &pos, &lineno);
+	TEST_NE_P (other, NULL);
+
+	TEST_EQ_STR (other->start_on->name, "wibble");
+	TEST_EQ_P (other->start_on->name, job->start_on->name);
+
+	nih_free (other);
+	nih_free (job);
+
+
 	/* Check that a start on stanza may have an event name followed
 	 * by multiple arguments,the event will be the sole operator in
 	 * the expression, and have the additional arguments as arguments
@@ -4320,6 +4346,39 @@ test_stanza_expect (void)
 	}
 
 
+	/* Check that expect notify sets the job's expect member to
+	 * EXPECT_NOTIFY.
+	 */
+	TEST_FEATURE ("with notify argument");
+	strcpy (buf, "expect notify\n");
+
+	TEST_ALLOC_FAIL {
+		pos = 0;
+		lineno = 1;
+		job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf),
+				 &pos, &lineno);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (job, NULL);
+
+			err = nih_error_get ();
+			TEST_EQ (err->number, ENOMEM);
+			nih_free (err);
+
+			continue;
+		}
+
+		TEST_EQ (pos, strlen (buf));
+		TEST_EQ (lineno, 2);
+
+		TEST_ALLOC_SIZE (job, sizeof (JobClass));
+
+		TEST_EQ (job->expect, EXPECT_NOTIFY);
+
+		nih_free (job);
+	}
+
+
 	/* Check that expect none sets the job's expect member to
 	 * EXPECT_NONE.
 	 */
@@ -4828,6 +4887,132 @@ test_stanza_respawn (void)
 	nih_free (err);
 
 
+	/* Check that a respawn delay stanza sets the bounds of the delay
+	 * before respawning, but not the respawn flag itself.
+	 */
+	TEST_FEATURE ("with delay");
+	strcpy (buf, "respawn delay 1 60\n");
+
+	TEST_ALLOC_FAIL {
+		pos = 0;
+		lineno = 1;
+		job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf),
+				 &pos, &lineno);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (job, NULL);
+
+			err = nih_error_get ();
+			TEST_EQ (err->number, ENOMEM);
+			nih_free (err);
+
+			continue;
+		}
+
+		TEST_EQ (pos, strlen (buf));
+		TEST_EQ (lineno, 2);
+
+		TEST_ALLOC_SIZE (job, sizeof (JobClass));
+
+		TEST_FALSE (job->respawn);
+		TEST_EQ (job->respawn_delay_min, 1);
+		TEST_EQ (job->respawn_delay_max, 60);
+		TEST_EQ (job->respawn_stable, JOB_DEFAULT_RESPAWN_STABLE);
+
+		nih_free (job);
+	}
+
+
+	/* Check that a respawn delay stanza with a zero minimum results
+	 * in a syntax error.
+	 */
+	TEST_FEATURE ("with zero minimum delay");
+	strcpy (buf, "respawn delay 0 60\n");
+
+	pos = 0;
+	lineno = 1;
+	job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf), &pos, &lineno);
+
+	TEST_EQ_P (job, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, PARSE_ILLEGAL_INTERVAL);
+	TEST_EQ (pos, 14);
+	TEST_EQ (lineno, 1);
+	nih_free (err);
+
+
+	/* Check that a respawn delay stanza with a maximum less than its
+	 * minimum results in a syntax error.
+	 */
+	TEST_FEATURE ("with maximum delay less than minimum");
+	strcpy (buf, "respawn delay 10 5\n");
+
+	pos = 0;
+	lineno = 1;
+	job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf), &pos, &lineno);
+
+	TEST_EQ_P (job, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, PARSE_ILLEGAL_INTERVAL);
+	TEST_EQ (pos, 17);
+	TEST_EQ (lineno, 1);
+	nih_free (err);
+
+
+	/* Check that a respawn delay stanza without a maximum results in
+	 * a syntax error.
+	 */
+	TEST_FEATURE ("with missing maximum delay");
+	strcpy (buf, "respawn delay 10\n");
+
+	pos = 0;
+	lineno = 1;
+	job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf), &pos, &lineno);
+
+	TEST_EQ_P (job, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, NIH_CONFIG_EXPECTED_TOKEN);
+	TEST_EQ (pos, 16);
+	TEST_EQ (lineno, 1);
+	nih_free (err);
+
+
+	/* Check that a respawn stable stanza sets how long a process must
+	 * run for its respawn delay to be reset.
+	 */
+	TEST_FEATURE ("with stable period");
+	strcpy (buf, "respawn stable 300\n");
+
+	TEST_ALLOC_FAIL {
+		pos = 0;
+		lineno = 1;
+		job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf),
+				 &pos, &lineno);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (job, NULL);
+
+			err = nih_error_get ();
+			TEST_EQ (err->number, ENOMEM);
+			nih_free (err);
+
+			continue;
+		}
+
+		TEST_EQ (pos, strlen (buf));
+		TEST_EQ (lineno, 2);
+
+		TEST_ALLOC_SIZE (job, sizeof (JobClass));
+
+		TEST_EQ (job->respawn_stable, 300);
+
+		nih_free (job);
+	}
+
+
 	/* Check that a respawn stanza with an unknown second argument
 	 * results in a syntax error.
 	 */
@@ -5652,21 +5837,20 @@ test_stanza_reload (void)
 
 
 void
-test_stanza_normal (void)
+test_stanza_ready (void)
 {
-	JobClass*job;
+	JobClass *job;
 	NihError *err;
 	size_t    pos, lineno;
 	char      buf[1024];
 
-	TEST_FUNCTION ("stanza_normal");
+	TEST_FUNCTION ("stanza_ready");
 
-	/* Check that a normal exit stanza with a single argument results in
-	 * the exit code given being added to the normalexit array, which
-	 * should be allocated.
+	/* Check that a ready stanza with the timeout argument and a numeric
+	 * timeout results in it being stored in the job.
 	 */
-	TEST_FEATURE ("with single argument");
-	strcpy (buf, "normal exit 99\n");
+	TEST_FEATURE ("with timeout and single argument");
+	strcpy (buf, "ready timeout 30\n");
 
 	TEST_ALLOC_FAIL {
 		pos = 0;
@@ -5689,23 +5873,106 @@ test_stanza_normal (void)
 
 		TEST_ALLOC_SIZE (job, sizeof (JobClass));
 
-		TEST_EQ (job->normalexit_len, 1);
-		TEST_ALLOC_SIZE (job->normalexit,
-				 sizeof (int) * job->normalexit_len);
-		TEST_ALLOC_PARENT (job->normalexit, job);
-
-		TEST_EQ (job->normalexit[0], 99);
+		TEST_EQ (job->ready_timeout, 30);
 
 		nih_free (job);
 	}
 
 
-	/* Check that an argument in a normal exit stanza may be a signal name,
-	 * in which case the signal number is shifted left and then added
-	 * to the normalexit array.
+
+	/* Check that a ready stanza with an invalid second-level stanza
+	 * results in a syntax error.
 	 */
-	TEST_FEATURE ("with single argument containing signal name");
-	strcpy (buf, "normal exit INT\n");
+	TEST_FEATURE ("with unknown second argument");
+	strcpy (buf, "ready foo\n");
+
+	pos = 0;
+	lineno = 1;
+	job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf), &pos, &lineno);
+
+	TEST_EQ_P (job, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, NIH_CONFIG_UNKNOWN_STANZA);
+	TEST_EQ (pos, 6);
+	TEST_EQ (lineno, 1);
+	nih_free (err);
+
+
+	/* Check that a ready stanza with the timeout argument but no
+	 * timeout results in a syntax error.
+	 */
+	TEST_FEATURE ("with timeout and missing argument");
+	strcpy (buf, "ready timeout\n");
+
+	pos = 0;
+	lineno = 1;
+	job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf), &pos, &lineno);
+
+	TEST_EQ_P (job, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, NIH_CONFIG_EXPECTED_TOKEN);
+	TEST_EQ (pos, 13);
+	TEST_EQ (lineno, 1);
+	nih_free (err);
+
+
+	/* Check that a ready timeout stanza with a negative value results
+	 * in a syntax error.
+	 */
+	TEST_FEATURE ("with timeout and negative argument");
+	strcpy (buf, "ready timeout -1\n");
+
+	pos = 0;
+	lineno = 1;
+	job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf), &pos, &lineno);
+
+	TEST_EQ_P (job, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, PARSE_ILLEGAL_INTERVAL);
+	TEST_EQ (pos, 14);
+	TEST_EQ (lineno, 1);
+	nih_free (err);
+
+
+	/* Check that a ready stanza with the timeout argument and timeout,
+	 * but with an extra argument afterwards results in a syntax
+	 * error.
+	 */
+	TEST_FEATURE ("with timeout and extra argument");
+	strcpy (buf, "ready timeout 99 foo\n");
+
+	pos = 0;
+	lineno = 1;
+	job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf), &pos, &lineno);
+
+	TEST_EQ_P (job, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, NIH_CONFIG_UNEXPECTED_TOKEN);
+	TEST_EQ (pos, 17);
+	TEST_EQ (lineno, 1);
+	nih_free (err);
+}
+
+
+void
+test_stanza_watchdog (void)
+{
+	JobClass *job;
+	NihError *err;
+	size_t    pos, lineno;
+	char      buf[1024];
+
+	TEST_FUNCTION ("stanza_watchdog");
+
+	/* Check that a watchdog stanza with a numeric interval results in
+	 * it being stored in the job.
+	 */
+	TEST_FEATURE ("with single argument");
+	strcpy (buf, "watchdog 30\n");
 
 	TEST_ALLOC_FAIL {
 		pos = 0;
@@ -5728,18 +5995,179 @@ test_stanza_normal (void)
 
 		TEST_ALLOC_SIZE (job, sizeof (JobClass));
 
-		TEST_EQ (job->normalexit_len, 1);
-		TEST_ALLOC_SIZE (job->normalexit,
-				 sizeof (int) * job->normalexit_len);
-		TEST_ALLOC_PARENT (job->normalexit, job);
-
-		TEST_EQ (job->normalexit[0], SIGINT << 8);
+		TEST_EQ (job->watchdog_timeout, 30);
 
 		nih_free (job);
 	}
 
 
-	/* Check that a normal exit stanza with multiple arguments results in
+
+	/* Check that a watchdog stanza without an argument results in a
+	 * syntax error.
+	 */
+	TEST_FEATURE ("with missing argument");
+	strcpy (buf, "watchdog\n");
+
+	pos = 0;
+	lineno = 1;
+	job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf), &pos, &lineno);
+
+	TEST_EQ_P (job, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, NIH_CONFIG_EXPECTED_TOKEN);
+	TEST_EQ (pos, 8);
+	TEST_EQ (lineno, 1);
+	nih_free (err);
+
+
+	/* Check that a watchdog stanza with a negative interval results
+	 * in a syntax error.
+	 */
+	TEST_FEATURE ("with negative argument");
+	strcpy (buf, "watchdog -1\n");
+
+	pos = 0;
+	lineno = 1;
+	job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf), &pos, &lineno);
+
+	TEST_EQ_P (job, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, PARSE_ILLEGAL_INTERVAL);
+	TEST_EQ (pos, 9);
+	TEST_EQ (lineno, 1);
+	nih_free (err);
+
+
+	/* Check that a watchdog stanza with a non-integer argument results
+	 * in a syntax error.
+	 */
+	TEST_FEATURE ("with non-integer argument");
+	strcpy (buf, "watchdog 10foo\n");
+
+	pos = 0;
+	lineno = 1;
+	job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf), &pos, &lineno);
+
+	TEST_EQ_P (job, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, PARSE_ILLEGAL_INTERVAL);
+	TEST_EQ (pos, 9);
+	TEST_EQ (lineno, 1);
+	nih_free (err);
+
+
+	/* Check that a watchdog stanza with an extra argument results in
+	 * a syntax error.
+	 */
+	TEST_FEATURE ("with extra argument");
+	strcpy (buf, "watchdog 10 foo\n");
+
+	pos = 0;
+	lineno = 1;
+	job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf), &pos, &lineno);
+
+	TEST_EQ_P (job, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, NIH_CONFIG_UNEXPECTED_TOKEN);
+	TEST_EQ (pos, 12);
+	TEST_EQ (lineno, 1);
+	nih_free (err);
+}
+
+
+void
+test_stanza_normal (void)
+{
+	JobClass*job;
+	NihError *err;
+	size_t    pos, lineno;
+	char      buf[1024];
+
+	TEST_FUNCTION ("stanza_normal");
+
+	/* Check that a normal exit stanza with a single argument results in
+	 * the exit code given being added to the normalexit array, which
+	 * should be allocated.
+	 */
+	TEST_FEATURE ("with single argument");
+	strcpy (buf, "normal exit 99\n");
+
+	TEST_ALLOC_FAIL {
+		pos = 0;
+		lineno = 1;
+		job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf),
+				 &pos, &lineno);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (job, NULL);
+
+			err = nih_error_get ();
+			TEST_EQ (err->number, ENOMEM);
+			nih_free (err);
+
+			continue;
+		}
+
+		TEST_EQ (pos, strlen (buf));
+		TEST_EQ (lineno, 2);
+
+		TEST_ALLOC_SIZE (job, sizeof (JobClass));
+
+		TEST_EQ (job->normalexit_len, 1);
+		TEST_ALLOC_SIZE (job->normalexit,
+				 sizeof (int) * job->normalexit_len);
+		TEST_ALLOC_PARENT (job->normalexit, job);
+
+		TEST_EQ (job->normalexit[0], 99);
+
+		nih_free (job);
+	}
+
+
+	/* Check that an argument in a normal exit stanza may be a signal name,
+	 * in which case the signal number is shifted left and then added
+	 * to the normalexit array.
+	 */
+	TEST_FEATURE ("with single argument containing signal name");
+	strcpy (buf, "normal exit INT\n");
+
+	TEST_ALLOC_FAIL {
+		pos = 0;
+		lineno = 1;
+		job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf),
+				 &pos, &lineno);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (job, NULL);
+
+			err = nih_error_get ();
+			TEST_EQ (err->number, ENOMEM);
+			nih_free (err);
+
+			continue;
+		}
+
+		TEST_EQ (pos, strlen (buf));
+		TEST_EQ (lineno, 2);
+
+		TEST_ALLOC_SIZE (job, sizeof (JobClass));
+
+		TEST_EQ (job->normalexit_len, 1);
+		TEST_ALLOC_SIZE (job->normalexit,
+				 sizeof (int) * job->normalexit_len);
+		TEST_ALLOC_PARENT (job->normalexit, job);
+
+		TEST_EQ (job->normalexit[0], SIGINT << 8);
+
+		nih_free (job);
+	}
+
+
+	/* Check that a normal exit stanza with multiple arguments results in
 	 * all of the given exit codes being added to the array, which should
 	 * have been increased in size.
 	 */
@@ -8238,6 +8666,787 @@ test_stanza_limit (void)
 	nih_free (err);
 }
 
+void
+test_stanza_cpu_weight (void)
+{
+	JobClass *job;
+	NihError *err;
+	size_t    pos, lineno;
+	char      buf[1024];
+
+	TEST_FUNCTION ("stanza_cpu_weight");
+
+	/* Check that a cpu-weight stanza results in the weight being
+	 * stored in the job.
+	 */
+	TEST_FEATURE ("with argument");
+	strcpy (buf, "cpu-weight 500\n");
+
+	TEST_ALLOC_FAIL {
+		pos = 0;
+		lineno = 1;
+		job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf),
+				 &pos, &lineno);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (job, NULL);
+
+			err = nih_error_get ();
+			TEST_EQ (err->number, ENOMEM);
+			nih_free (err);
+
+			continue;
+		}
+
+		TEST_EQ (pos, strlen (buf));
+		TEST_EQ (lineno, 2);
+
+		TEST_ALLOC_SIZE (job, sizeof (JobClass));
+
+		TEST_EQ (job->cpu_weight, 500);
+
+		nih_free (job);
+	}
+
+
+	/* Check that the last of multiple cpu-weight stanzas is used.
+	 */
+	TEST_FEATURE ("with multiple stanzas");
+	strcpy (buf, "cpu-weight 500\n");
+	strcat (buf, "cpu-weight 50\n");
+
+	TEST_ALLOC_FAIL {
+		pos = 0;
+		lineno = 1;
+		job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf),
+				 &pos, &lineno);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (job, NULL);
+
+			err = nih_error_get ();
+			TEST_EQ (err->number, ENOMEM);
+			nih_free (err);
+
+			continue;
+		}
+
+		TEST_EQ (pos, strlen (buf));
+		TEST_EQ (lineno, 3);
+
+		TEST_ALLOC_SIZE (job, sizeof (JobClass));
+
+		TEST_EQ (job->cpu_weight, 50);
+
+		nih_free (job);
+	}
+
+
+	/* Check that a cpu-weight stanza without an argument results in
+	 * a syntax error.
+	 */
+	TEST_FEATURE ("with missing argument");
+	strcpy (buf, "cpu-weight\n");
+
+	pos = 0;
+	lineno = 1;
+	job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf), &pos, &lineno);
+
+	TEST_EQ_P (job, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, NIH_CONFIG_EXPECTED_TOKEN);
+	TEST_EQ (pos, 10);
+	TEST_EQ (lineno, 1);
+	nih_free (err);
+
+
+	/* Check that a cpu-weight stanza with a zero argument results in
+	 * a syntax error.
+	 */
+	TEST_FEATURE ("with zero argument");
+	strcpy (buf, "cpu-weight 0\n");
+
+	pos = 0;
+	lineno = 1;
+	job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf), &pos, &lineno);
+
+	TEST_EQ_P (job, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, PARSE_ILLEGAL_WEIGHT);
+	TEST_EQ (pos, 11);
+	TEST_EQ (lineno, 1);
+	nih_free (err);
+
+
+	/* Check that a cpu-weight stanza with an overly large argument
+	 * results in a syntax error.
+	 */
+	TEST_FEATURE ("with overly large argument");
+	strcpy (buf, "cpu-weight 10001\n");
+
+	pos = 0;
+	lineno = 1;
+	job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf), &pos, &lineno);
+
+	TEST_EQ_P (job, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, PARSE_ILLEGAL_WEIGHT);
+	TEST_EQ (pos, 11);
+	TEST_EQ (lineno, 1);
+	nih_free (err);
+}
+
+void
+test_stanza_cpu_quota (void)
+{
+	JobClass *job;
+	NihError *err;
+	size_t    pos, lineno;
+	char      buf[1024];
+
+	TEST_FUNCTION ("stanza_cpu_quota");
+
+	/* Check that a cpu-quota stanza with a percentage results in the
+	 * quota being stored in the job.
+	 */
+	TEST_FEATURE ("with percentage");
+	strcpy (buf, "cpu-quota 50%\n");
+
+	TEST_ALLOC_FAIL {
+		pos = 0;
+		lineno = 1;
+		job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf),
+				 &pos, &lineno);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (job, NULL);
+
+			err = nih_error_get ();
+			TEST_EQ (err->number, ENOMEM);
+			nih_free (err);
+
+			continue;
+		}
+
+		TEST_EQ (pos, strlen (buf));
+		TEST_EQ (lineno, 2);
+
+		TEST_ALLOC_SIZE (job, sizeof (JobClass));
+
+		TEST_EQ (job->cpu_quota, 50);
+
+		nih_free (job);
+	}
+
+
+	/* Check that the percent sign is optional, and that quotas over
+	 * one CPU are permitted.
+	 */
+	TEST_FEATURE ("with number");
+	strcpy (buf, "cpu-quota 200\n");
+
+	TEST_ALLOC_FAIL {
+		pos = 0;
+		lineno = 1;
+		job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf),
+				 &pos, &lineno);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (job, NULL);
+
+			err = nih_error_get ();
+			TEST_EQ (err->number, ENOMEM);
+			nih_free (err);
+
+			continue;
+		}
+
+		TEST_EQ (pos, strlen (buf));
+		TEST_EQ (lineno, 2);
+
+		TEST_ALLOC_SIZE (job, sizeof (JobClass));
+
+		TEST_EQ (job->cpu_quota, 200);
+
+		nih_free (job);
+	}
+
+
+	/* Check that a cpu-quota stanza with a zero argument results in
+	 * a syntax error.
+	 */
+	TEST_FEATURE ("with zero argument");
+	strcpy (buf, "cpu-quota 0%\n");
+
+	pos = 0;
+	lineno = 1;
+	job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf), &pos, &lineno);
+
+	TEST_EQ_P (job, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, PARSE_ILLEGAL_QUOTA);
+	TEST_EQ (pos, 10);
+	TEST_EQ (lineno, 1);
+	nih_free (err);
+
+
+	/* Check that a cpu-quota stanza with a non-numeric argument
+	 * results in a syntax error.
+	 */
+	TEST_FEATURE ("with non-numeric argument");
+	strcpy (buf, "cpu-quota %\n");
+
+	pos = 0;
+	lineno = 1;
+	job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf), &pos, &lineno);
+
+	TEST_EQ_P (job, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, PARSE_ILLEGAL_QUOTA);
+	TEST_EQ (pos, 10);
+	TEST_EQ (lineno, 1);
+	nih_free (err);
+}
+
+void
+test_stanza_memory_max (void)
+{
+	JobClass *job;
+	NihError *err;
+	size_t    pos, lineno;
+	char      buf[1024];
+
+	TEST_FUNCTION ("stanza_memory_max");
+
+	/* Check that a memory-max stanza with a plain number of bytes
+	 * results in it being stored in the job.
+	 */
+	TEST_FEATURE ("with bytes");
+	strcpy (buf, "memory-max 1048576\n");
+
+	TEST_ALLOC_FAIL {
+		pos = 0;
+		lineno = 1;
+		job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf),
+				 &pos, &lineno);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (job, NULL);
+
+			err = nih_error_get ();
+			TEST_EQ (err->number, ENOMEM);
+			nih_free (err);
+
+			continue;
+		}
+
+		TEST_EQ (pos, strlen (buf));
+		TEST_EQ (lineno, 2);
+
+		TEST_ALLOC_SIZE (job, sizeof (JobClass));
+
+		TEST_EQ (job->memory_max, 1048576);
+
+		nih_free (job);
+	}
+
+
+	/* Check that a memory-max stanza with a suffix results in the
+	 * number being multiplied by the appropriate power of 1024.
+	 */
+	TEST_FEATURE ("with suffix");
+	strcpy (buf, "memory-max 2G\n");
+
+	TEST_ALLOC_FAIL {
+		pos = 0;
+		lineno = 1;
+		job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf),
+				 &pos, &lineno);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (job, NULL);
+
+			err = nih_error_get ();
+			TEST_EQ (err->number, ENOMEM);
+			nih_free (err);
+
+			continue;
+		}
+
+		TEST_EQ (pos, strlen (buf));
+		TEST_EQ (lineno, 2);
+
+		TEST_ALLOC_SIZE (job, sizeof (JobClass));
+
+		TEST_EQ (job->memory_max, 2ULL << 30);
+
+		nih_free (job);
+	}
+
+
+	/* Check that a memory-max stanza with an unknown suffix results
+	 * in a syntax error.
+	 */
+	TEST_FEATURE ("with unknown suffix");
+	strcpy (buf, "memory-max 2X\n");
+
+	pos = 0;
+	lineno = 1;
+	job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf), &pos, &lineno);
+
+	TEST_EQ_P (job, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, PARSE_ILLEGAL_MEMORY);
+	TEST_EQ (pos, 11);
+	TEST_EQ (lineno, 1);
+	nih_free (err);
+
+
+	/* Check that a memory-max stanza with a negative argument results
+	 * in a syntax error.
+	 */
+	TEST_FEATURE ("with negative argument");
+	strcpy (buf, "memory-max -1\n");
+
+	pos = 0;
+	lineno = 1;
+	job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf), &pos, &lineno);
+
+	TEST_EQ_P (job, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, PARSE_ILLEGAL_MEMORY);
+	TEST_EQ (pos, 11);
+	TEST_EQ (lineno, 1);
+	nih_free (err);
+
+
+	/* Check that a memory-max stanza whose size overflows results
+	 * in a syntax error.
+	 */
+	TEST_FEATURE ("with overflowing argument");
+	strcpy (buf, "memory-max 17179869184T\n");
+
+	pos = 0;
+	lineno = 1;
+	job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf), &pos, &lineno);
+
+	TEST_EQ_P (job, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, PARSE_ILLEGAL_MEMORY);
+	TEST_EQ (pos, 11);
+	TEST_EQ (lineno, 1);
+	nih_free (err);
+}
+
+void
+test_stanza_memory_high (void)
+{
+	JobClass *job;
+	NihError *err;
+	size_t    pos, lineno;
+	char      buf[1024];
+
+	TEST_FUNCTION ("stanza_memory_high");
+
+	/* Check that a memory-high stanza results in the size being
+	 * stored in the job.
+	 */
+	TEST_FEATURE ("with suffix");
+	strcpy (buf, "memory-high 512m\n");
+
+	TEST_ALLOC_FAIL {
+		pos = 0;
+		lineno = 1;
+		job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf),
+				 &pos, &lineno);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (job, NULL);
+
+			err = nih_error_get ();
+			TEST_EQ (err->number, ENOMEM);
+			nih_free (err);
+
+			continue;
+		}
+
+		TEST_EQ (pos, strlen (buf));
+		TEST_EQ (lineno, 2);
+
+		TEST_ALLOC_SIZE (job, sizeof (JobClass));
+
+		TEST_EQ (job->memory_high, 512ULL << 20);
+		TEST_EQ (job->memory_max, 0);
+
+		nih_free (job);
+	}
+
+
+	/* Check that a memory-high stanza with a zero argument results
+	 * in a syntax error.
+	 */
+	TEST_FEATURE ("with zero argument");
+	strcpy (buf, "memory-high 0\n");
+
+	pos = 0;
+	lineno = 1;
+	job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf), &pos, &lineno);
+
+	TEST_EQ_P (job, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, PARSE_ILLEGAL_MEMORY);
+	TEST_EQ (pos, 12);
+	TEST_EQ (lineno, 1);
+	nih_free (err);
+}
+
+void
+test_stanza_io_weight (void)
+{
+	JobClass *job;
+	NihError *err;
+	size_t    pos, lineno;
+	char      buf[1024];
+
+	TEST_FUNCTION ("stanza_io_weight");
+
+	/* Check that an io-weight stanza results in the weight being
+	 * stored in the job.
+	 */
+	TEST_FEATURE ("with argument");
+	strcpy (buf, "io-weight 200\n");
+
+	TEST_ALLOC_FAIL {
+		pos = 0;
+		lineno = 1;
+		job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf),
+				 &pos, &lineno);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (job, NULL);
+
+			err = nih_error_get ();
+			TEST_EQ (err->number, ENOMEM);
+			nih_free (err);
+
+			continue;
+		}
+
+		TEST_EQ (pos, strlen (buf));
+		TEST_EQ (lineno, 2);
+
+		TEST_ALLOC_SIZE (job, sizeof (JobClass));
+
+		TEST_EQ (job->io_weight, 200);
+		TEST_EQ (job->cpu_weight, 0);
+
+		nih_free (job);
+	}
+
+
+	/* Check that an io-weight stanza with an overly large argument
+	 * results in a syntax error.
+	 */
+	TEST_FEATURE ("with overly large argument");
+	strcpy (buf, "io-weight 20000\n");
+
+	pos = 0;
+	lineno = 1;
+	job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf), &pos, &lineno);
+
+	TEST_EQ_P (job, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, PARSE_ILLEGAL_WEIGHT);
+	TEST_EQ (pos, 10);
+	TEST_EQ (lineno, 1);
+	nih_free (err);
+}
+
+void
+test_stanza_cpu_affinity (void)
+{
+	JobClass *job;
+	NihError *err;
+	size_t    pos, lineno;
+	char      buf[1024];
+
+	TEST_FUNCTION ("stanza_cpu_affinity");
+
+	/* Check that a cpu-affinity stanza results in the list of CPUs
+	 * being stored in the job.
+	 */
+	TEST_FEATURE ("with list");
+	strcpy (buf, "cpu-affinity 0-3,8\n");
+
+	TEST_ALLOC_FAIL {
+		pos = 0;
+		lineno = 1;
+		job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf),
+				 &pos, &lineno);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (job, NULL);
+
+			err = nih_error_get ();
+			TEST_EQ (err->number, ENOMEM);
+			nih_free (err);
+
+			continue;
+		}
+
+		TEST_EQ (pos, strlen (buf));
+		TEST_EQ (lineno, 2);
+
+		TEST_ALLOC_SIZE (job, sizeof (JobClass));
+
+		TEST_ALLOC_PARENT (job->cpu_affinity, job);
+		TEST_EQ_STR (job->cpu_affinity, "0-3,8");
+
+		nih_free (job);
+	}
+
+
+	/* Check that a list referencing a variable is stored unchecked,
+	 * to be expanded when the process is spawned.
+	 */
+	TEST_FEATURE ("with variable");
+	strcpy (buf, "cpu-affinity $CPU\n");
+
+	TEST_ALLOC_FAIL {
+		pos = 0;
+		lineno = 1;
+		job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf),
+				 &pos, &lineno);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (job, NULL);
+
+			err = nih_error_get ();
+			TEST_EQ (err->number, ENOMEM);
+			nih_free (err);
+
+			continue;
+		}
+
+		TEST_EQ (pos, strlen (buf));
+		TEST_EQ (lineno, 2);
+
+		TEST_ALLOC_SIZE (job, sizeof (JobClass));
+
+		TEST_EQ_STR (job->cpu_affinity, "$CPU");
+
+		nih_free (job);
+	}
+
+
+	/* Check that the last of multiple cpu-affinity stanzas is used.
+	 */
+	TEST_FEATURE ("with multiple stanzas");
+	strcpy (buf, "cpu-affinity 0\n");
+	strcat (buf, "cpu-affinity 1\n");
+
+	TEST_ALLOC_FAIL {
+		pos = 0;
+		lineno = 1;
+		job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf),
+				 &pos, &lineno);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (job, NULL);
+
+			err = nih_error_get ();
+			TEST_EQ (err->number, ENOMEM);
+			nih_free (err);
+
+			continue;
+		}
+
+		TEST_EQ (pos, strlen (buf));
+		TEST_EQ (lineno, 3);
+
+		TEST_ALLOC_SIZE (job, sizeof (JobClass));
+
+		TEST_EQ_STR (job->cpu_affinity, "1");
+
+		nih_free (job);
+	}
+
+
+	/* Check that a cpu-affinity stanza with a malformed list results
+	 * in a syntax error.
+	 */
+	TEST_FEATURE ("with malformed list");
+	strcpy (buf, "cpu-affinity 3-1\n");
+
+	pos = 0;
+	lineno = 1;
+	job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf), &pos, &lineno);
+
+	TEST_EQ_P (job, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, PARSE_ILLEGAL_LIST);
+	TEST_EQ (pos, 13);
+	TEST_EQ (lineno, 1);
+	nih_free (err);
+
+
+	/* Check that a cpu-affinity stanza without an argument results
+	 * in a syntax error.
+	 */
+	TEST_FEATURE ("with missing argument");
+	strcpy (buf, "cpu-affinity\n");
+
+	pos = 0;
+	lineno = 1;
+	job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf), &pos, &lineno);
+
+	TEST_EQ_P (job, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, NIH_CONFIG_EXPECTED_TOKEN);
+	TEST_EQ (pos, 12);
+	TEST_EQ (lineno, 1);
+	nih_free (err);
+}
+
+void
+test_stanza_numa_policy (void)
+{
+	JobClass *job;
+	NihError *err;
+	size_t    pos, lineno;
+	char      buf[1024];
+
+	TEST_FUNCTION ("stanza_numa_policy");
+
+	/* Check that a numa-policy stanza results in the policy being
+	 * stored in the job.
+	 */
+	TEST_FEATURE ("with policy");
+	strcpy (buf, "numa-policy interleave\n");
+
+	TEST_ALLOC_FAIL {
+		pos = 0;
+		lineno = 1;
+		job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf),
+				 &pos, &lineno);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (job, NULL);
+
+			err = nih_error_get ();
+			TEST_EQ (err->number, ENOMEM);
+			nih_free (err);
+
+			continue;
+		}
+
+		TEST_EQ (pos, strlen (buf));
+		TEST_EQ (lineno, 2);
+
+		TEST_ALLOC_SIZE (job, sizeof (JobClass));
+
+		TEST_EQ (job->numa_policy, NUMA_INTERLEAVE);
+
+		nih_free (job);
+	}
+
+
+	/* Check that a numa-policy stanza with an unknown policy results
+	 * in a syntax error.
+	 */
+	TEST_FEATURE ("with unknown policy");
+	strcpy (buf, "numa-policy wibble\n");
+
+	pos = 0;
+	lineno = 1;
+	job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf), &pos, &lineno);
+
+	TEST_EQ_P (job, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, NIH_CONFIG_UNKNOWN_STANZA);
+	TEST_EQ (pos, 12);
+	TEST_EQ (lineno, 1);
+	nih_free (err);
+}
+
+void
+test_stanza_numa_nodes (void)
+{
+	JobClass *job;
+	NihError *err;
+	size_t    pos, lineno;
+	char      buf[1024];
+
+	TEST_FUNCTION ("stanza_numa_nodes");
+
+	/* Check that a numa-nodes stanza results in the list of nodes
+	 * being stored in the job.
+	 */
+	TEST_FEATURE ("with list");
+	strcpy (buf, "numa-policy bind\n");
+	strcat (buf, "numa-nodes 1\n");
+
+	TEST_ALLOC_FAIL {
+		pos = 0;
+		lineno = 1;
+		job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf),
+				 &pos, &lineno);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (job, NULL);
+
+			err = nih_error_get ();
+			TEST_EQ (err->number, ENOMEM);
+			nih_free (err);
+
+			continue;
+		}
+
+		TEST_EQ (pos, strlen (buf));
+		TEST_EQ (lineno, 3);
+
+		TEST_ALLOC_SIZE (job, sizeof (JobClass));
+
+		TEST_EQ (job->numa_policy, NUMA_BIND);
+		TEST_ALLOC_PARENT (job->numa_nodes, job);
+		TEST_EQ_STR (job->numa_nodes, "1");
+
+		nih_free (job);
+	}
+
+
+	/* Check that a numa-nodes stanza with a malformed list results
+	 * in a syntax error.
+	 */
+	TEST_FEATURE ("with malformed list");
+	strcpy (buf, "numa-nodes 0,\n");
+
+	pos = 0;
+	lineno = 1;
+	job = parse_job (NULL, NULL, NULL, "test", buf, strlen (buf), &pos, &lineno);
+
+	TEST_EQ_P (job, NULL);
+
+	err = nih_error_get ();
+	TEST_EQ (err->number, PARSE_ILLEGAL_LIST);
+	TEST_EQ (pos, 11);
+	TEST_EQ (lineno, 1);
+	nih_free (err);
+}
+
 void
 test_stanza_chroot (void)
 {
@@ -8855,6 +10064,8 @@ main (int   argc,
 	test_stanza_kill ();
 
 	test_stanza_reload ();
+	test_stanza_ready ();
+	test_stanza_watchdog ();
 
 	test_stanza_respawn ();
 	test_stanza_normal ();
@@ -8865,6 +10076,14 @@ main (int   argc,
 	test_stanza_nice ();
 	test_stanza_oom ();
 	test_stanza_limit ();
+	test_stanza_cpu_weight ();
+	test_stanza_cpu_quota ();
+	test_stanza_memory_max ();
+	test_stanza_memory_high ();
+	test_stanza_io_weight ();
+	test_stanza_cpu_affinity ();
+	test_stanza_numa_policy ();
+	test_stanza_numa_nodes ();
 	test_stanza_chroot ();
 	test_stanza_chdir ();
 	test_stanza_setuid ();
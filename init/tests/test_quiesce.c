@@ -0,0 +1,265 @@
+/* upstart
+ *
+ * test_quiesce.c - test suite for init/quiesce.c
+ *
+ * Copyright © 2014 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include <nih/test.h>
+
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#include <stdlib.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/string.h>
+#include <nih/hash.h>
+#include <nih/tree.h>
+#include <nih/main.h>
+
+#include "job_class.h"
+#include "job.h"
+#include "event.h"
+#include "event_operator.h"
+#include "quiesce.h"
+
+
+/**
+ * match_new:
+ * @parent: parent object,
+ * @name: name of event,
+ * @arg: first argument.
+ *
+ * Returns: new EVENT_MATCH operator.
+ **/
+static EventOperator *
+match_new (const void *parent,
+	   const char *name,
+	   const char *arg)
+{
+	EventOperator *oper;
+
+	oper = event_operator_new (parent, EVENT_MATCH, name, NULL);
+	oper->env = nih_str_array_new (oper);
+	NIH_MUST (nih_str_array_add (&oper->env, oper, NULL, arg));
+
+	return oper;
+}
+
+/**
+ * running_job_new:
+ * @class: job class.
+ *
+ * Returns: new instance of @class, running with a main process.
+ **/
+static Job *
+running_job_new (JobClass *class)
+{
+	Job *job;
+
+	job = job_new (class, "");
+	job->goal = JOB_START;
+	job->state = JOB_RUNNING;
+	job->pid[PROCESS_MAIN] = 1;
+
+	return job;
+}
+
+/**
+ * job_finish:
+ * @job: job instance.
+ *
+ * Removes @job from its class and frees it in the same way as when it
+ * reaches the waiting state.
+ **/
+static void
+job_finish (Job *job)
+{
+	nih_list_remove (&job->entry);
+	quiesce_job_finished (job);
+	nih_free (job);
+}
+
+
+void
+test_quiesce (void)
+{
+	JobClass *foo_class, *bar_class, *baz_class, *a_class, *b_class;
+	Job      *foo, *bar, *baz, *a, *b;
+
+	TEST_FUNCTION ("quiesce");
+	job_class_init ();
+
+	foo_class = job_class_new (NULL, "foo", NULL);
+	nih_hash_add (job_classes, &foo_class->entry);
+
+	bar_class = job_class_new (NULL, "bar", NULL);
+	bar_class->start_on = match_new (bar_class, "started", "foo");
+	nih_hash_add (job_classes, &bar_class->entry);
+
+	baz_class = job_class_new (NULL, "baz", NULL);
+	baz_class->stop_on = match_new (baz_class, "stopping", "JOB=bar");
+	nih_hash_add (job_classes, &baz_class->entry);
+
+	a_class = job_class_new (NULL, "a", NULL);
+	a_class->start_on = match_new (a_class, "started", "b");
+	nih_hash_add (job_classes, &a_class->entry);
+
+	b_class = job_class_new (NULL, "b", NULL);
+	b_class->start_on = match_new (b_class, "started", "a");
+	nih_hash_add (job_classes, &b_class->entry);
+
+	foo = running_job_new (foo_class);
+	bar = running_job_new (bar_class);
+	baz = running_job_new (baz_class);
+	a = running_job_new (a_class);
+	b = running_job_new (b_class);
+
+	quiesce (QUIESCE_REQUESTER_SYSTEM);
+	TEST_TRUE (quiesce_in_progress ());
+
+
+	/* Check that only the jobs that no other job depends on are
+	 * stopped at first, and that jobs whose dependencies are circular
+	 * are held back while others are stopping.
+	 */
+	TEST_FEATURE ("with dependent jobs");
+	quiesce_poll ();
+
+	TEST_EQ (baz->goal, JOB_STOP);
+	TEST_EQ (bar->goal, JOB_START);
+	TEST_EQ (foo->goal, JOB_START);
+	TEST_EQ (a->goal, JOB_START);
+	TEST_EQ (b->goal, JOB_START);
+
+
+	/* Check that once a job has finished, the jobs it depended on are
+	 * stopped in turn.
+	 */
+	TEST_FEATURE ("with dependent job finished");
+	job_finish (baz);
+	quiesce_poll ();
+
+	TEST_EQ (bar->goal, JOB_STOP);
+	TEST_EQ (foo->goal, JOB_START);
+	TEST_EQ (a->goal, JOB_START);
+
+	job_finish (bar);
+	quiesce_poll ();
+
+	TEST_EQ (foo->goal, JOB_STOP);
+	TEST_EQ (a->goal, JOB_START);
+	TEST_EQ (b->goal, JOB_START);
+
+
+	/* Check that nothing is stopped until a job has finished. */
+	TEST_FEATURE ("without finished job");
+	foo->goal = JOB_START;
+	quiesce_poll ();
+
+	TEST_EQ (foo->goal, JOB_START);
+	foo->goal = JOB_STOP;
+
+
+	/* Check that once no other job is stopping, jobs whose
+	 * dependencies are circular are all stopped.
+	 */
+	TEST_FEATURE ("with circular dependencies");
+	job_finish (foo);
+	quiesce_poll ();
+
+	TEST_EQ (a->goal, JOB_STOP);
+	TEST_EQ (b->goal, JOB_STOP);
+
+	nih_free (a);
+	nih_free (b);
+
+	nih_free (foo_class);
+	nih_free (bar_class);
+	nih_free (baz_class);
+	nih_free (a_class);
+	nih_free (b_class);
+}
+
+void
+test_quiesce_wait (void)
+{
+	JobClass *end_class, *c_class, *d_class;
+	Job      *c, *d, *end;
+	pid_t     pid;
+	int       status;
+
+	/* Check that jobs whose dependencies are circular are stopped in
+	 * the wait phase rather than held back until the kill phase, while
+	 * a job that starts on the session-end event is not stopped.  The
+	 * shutdown state cannot be reset so this is run in a child.
+	 */
+	TEST_FUNCTION_FEATURE ("quiesce",
+			       "with circular dependencies in wait phase");
+	TEST_CHILD (pid) {
+		job_class_init ();
+
+		end_class = job_class_new (NULL, "end", NULL);
+		end_class->start_on = event_operator_new (end_class, EVENT_MATCH,
+							  "session-end", NULL);
+		nih_hash_add (job_classes, &end_class->entry);
+
+		c_class = job_class_new (NULL, "c", NULL);
+		c_class->start_on = match_new (c_class, "started", "d");
+		nih_hash_add (job_classes, &c_class->entry);
+
+		d_class = job_class_new (NULL, "d", NULL);
+		d_class->start_on = match_new (d_class, "started", "c");
+		nih_hash_add (job_classes, &d_class->entry);
+
+		c = running_job_new (c_class);
+		d = running_job_new (d_class);
+
+		quiesce (QUIESCE_REQUESTER_SESSION);
+		TEST_TRUE (quiesce_in_progress ());
+
+		end = running_job_new (end_class);
+
+		quiesce_poll ();
+
+		TEST_EQ (c->goal, JOB_STOP);
+		TEST_EQ (d->goal, JOB_STOP);
+		TEST_EQ (end->goal, JOB_START);
+
+		exit (0);
+	}
+
+	waitpid (pid, &status, 0);
+	TEST_TRUE (WIFEXITED (status));
+	TEST_EQ (WEXITSTATUS (status), 0);
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	/* run tests in legacy (pre-session support) mode */
+	setenv ("UPSTART_NO_SESSIONS", "1", 1);
+
+	test_quiesce_wait ();
+	test_quiesce ();
+
+	return 0;
+}
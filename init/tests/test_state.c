@@ -589,6 +589,12 @@ job_class_diff (const JobClass *a, const JobClass *b,
 	if (obj_num_check (a, b, kill_signal))
 		goto fail;
 
+	if (obj_num_check (a, b, ready_timeout))
+		goto fail;
+
+	if (obj_num_check (a, b, watchdog_timeout))
+		goto fail;
+
 	if (obj_num_check (a, b, reload_signal))
 		goto fail;
 
@@ -601,6 +607,21 @@ job_class_diff (const JobClass *a, const JobClass *b,
 	if (obj_num_check (a, b, respawn_interval))
 		goto fail;
 
+	if (obj_num_check (a, b, respawn_delay_min))
+		goto fail;
+
+	if (obj_num_check (a, b, respawn_delay_max))
+		goto fail;
+
+	if (obj_num_check (a, b, respawn_stable))
+		goto fail;
+
+	if (obj_num_check (a, b, respawns))
+		goto fail;
+
+	if (obj_num_check (a, b, watchdog_expiries))
+		goto fail;
+
 	if (obj_num_check (a, b, normalexit_len))
 		goto fail;
 
@@ -630,6 +651,30 @@ job_class_diff (const JobClass *a, const JobClass *b,
 			goto fail;
 	}
 
+	if (obj_num_check (a, b, cpu_weight))
+		goto fail;
+
+	if (obj_num_check (a, b, cpu_quota))
+		goto fail;
+
+	if (obj_num_check (a, b, memory_max))
+		goto fail;
+
+	if (obj_num_check (a, b, memory_high))
+		goto fail;
+
+	if (obj_num_check (a, b, io_weight))
+		goto fail;
+
+	if (obj_string_check (a, b, cpu_affinity))
+		goto fail;
+
+	if (obj_num_check (a, b, numa_policy))
+		goto fail;
+
+	if (obj_string_check (a, b, numa_nodes))
+		goto fail;
+
 	if (obj_string_check (a, b, chroot))
 		goto fail;
 
@@ -760,6 +805,12 @@ job_diff (const Job *a, const Job *b, AlreadySeen seen, int check_class)
 	if (obj_num_check (a, b, kill_process))
 		goto fail;
 
+	if (nih_timer_diff (a->ready_timer, b->ready_timer))
+		goto fail;
+
+	if (nih_timer_diff (a->watchdog_timer, b->watchdog_timer))
+		goto fail;
+
 	if (obj_num_check (a, b, failed))
 		goto fail;
 
@@ -775,12 +826,39 @@ job_diff (const Job *a, const Job *b, AlreadySeen seen, int check_class)
 	if (obj_num_check (a, b, respawn_count))
 		goto fail;
 
+	if (obj_num_check (a, b, respawn_delay))
+		goto fail;
+
 	if (obj_num_check (a, b, trace_forks))
 		goto fail;
 
 	if (obj_num_check (a, b, trace_state))
 		goto fail;
 
+	if (obj_string_check (a, b, cgroup))
+		goto fail;
+
+	if (obj_num_check (a, b, stats.cpu_usec))
+		goto fail;
+
+	if (obj_num_check (a, b, stats.max_rss_kb))
+		goto fail;
+
+	if (obj_num_check (a, b, stats.io_read_bytes))
+		goto fail;
+
+	if (obj_num_check (a, b, stats.io_write_bytes))
+		goto fail;
+
+	if (obj_num_check (a, b, stats.start_usec))
+		goto fail;
+
+	if (obj_num_check (a, b, stats.exec_usec))
+		goto fail;
+
+	if (obj_num_check (a, b, stats.ready_usec))
+		goto fail;
+
 	for (i = 0; i < PROCESS_LAST; i++) {
 		if (! a->log[i] && ! b->log[i])
 			continue;
@@ -24,8 +24,13 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 
+#include <errno.h>
+#include <limits.h>
 #include <unistd.h>
 
+#include <nih/macros.h>
+#include <nih/error.h>
+
 #include "system.h"
 
 
@@ -129,6 +134,50 @@ test_kill (void)
 }
 
 
+void
+test_parse_list (void)
+{
+	unsigned long  mask[128 / (sizeof (unsigned long) * CHAR_BIT)];
+	NihError      *err;
+	int            ret;
+
+	TEST_FUNCTION ("system_parse_list");
+
+	/* Check that single numbers and ranges are both set in the mask,
+	 * and nothing else.
+	 */
+	TEST_FEATURE ("with numbers and ranges");
+	ret = system_parse_list ("0-2,5,70-71", mask, 128);
+
+	TEST_EQ (ret, 0);
+	for (unsigned long i = 0; i < 128; i++) {
+		int set = (mask[i / (sizeof (unsigned long) * CHAR_BIT)]
+			   >> (i % (sizeof (unsigned long) * CHAR_BIT))) & 1;
+
+		TEST_EQ (set, ((i <= 2) || (i == 5) || (i == 70) || (i == 71)));
+	}
+
+
+	/* Check that malformed lists, reversed ranges and numbers beyond
+	 * the size of the mask are all rejected.
+	 */
+	TEST_FEATURE ("with invalid lists");
+	{
+		const char *lists[] = { "", "1,", ",1", "a", "1-", "3-1",
+					"128", "0-128", "1 2", NULL };
+
+		for (const char **l = lists; *l; l++) {
+			ret = system_parse_list (*l, mask, 128);
+
+			TEST_LT (ret, 0);
+			err = nih_error_get ();
+			TEST_EQ (err->number, EINVAL);
+			nih_free (err);
+		}
+	}
+}
+
+
 int
 main (int   argc,
       char *argv[])
@@ -137,6 +186,7 @@ main (int   argc,
 	setenv ("UPSTART_NO_SESSIONS", "1", 1);
 
 	test_kill ();
+	test_parse_list ();
 
 	return 0;
 }
@@ -0,0 +1,115 @@
+/* upstart
+ *
+ * test_timeline.c - test suite for init/timeline.c
+ *
+ * Copyright © 2014 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <nih/test.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/list.h>
+
+#include "timeline.h"
+
+
+void
+test_record (void)
+{
+	TimelineEntry *entry, *last;
+	size_t         len;
+
+	TEST_FUNCTION ("timeline_record");
+	timeline_init ();
+
+
+	/* Check that an event is appended to the timeline with no job
+	 * or instance name, and the current time.
+	 */
+	TEST_FEATURE ("with event");
+	TEST_ALLOC_FAIL {
+		len = timeline_len;
+
+		timeline_record ("startup", NULL, NULL);
+
+		if (test_alloc_failed) {
+			TEST_EQ (timeline_len, len);
+			continue;
+		}
+
+		TEST_EQ (timeline_len, len + 1);
+
+		entry = (TimelineEntry *)timeline->prev;
+		TEST_ALLOC_SIZE (entry, sizeof (TimelineEntry));
+		TEST_EQ_STR (entry->name, "startup");
+		TEST_EQ_P (entry->job, NULL);
+		TEST_EQ_P (entry->instance, NULL);
+		TEST_GT (entry->usec, 0);
+
+		nih_free (entry);
+		timeline_len--;
+	}
+
+
+	/* Check that a job event records the job and instance names, and
+	 * that entries are kept in order of time.
+	 */
+	TEST_FEATURE ("with job event");
+	timeline_record ("starting", "foo", "");
+	last = (TimelineEntry *)timeline->prev;
+
+	timeline_record ("started", "foo", "");
+	entry = (TimelineEntry *)timeline->prev;
+
+	TEST_EQ_STR (entry->name, "started");
+	TEST_EQ_STR (entry->job, "foo");
+	TEST_EQ_STR (entry->instance, "");
+	TEST_GE (entry->usec, last->usec);
+
+	nih_free (entry);
+	nih_free (last);
+	timeline_len -= 2;
+
+
+	/* Check that once the timeline is full nothing further is
+	 * recorded.
+	 */
+	TEST_FEATURE ("with full timeline");
+	while (timeline_len < TIMELINE_MAX)
+		timeline_record ("wibble", NULL, NULL);
+
+	last = (TimelineEntry *)timeline->prev;
+
+	timeline_record ("wobble", NULL, NULL);
+
+	TEST_EQ (timeline_len, TIMELINE_MAX);
+	TEST_EQ_P (timeline->prev, &last->entry);
+
+	nih_free (timeline);
+	timeline = NULL;
+	timeline_len = 0;
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	test_record ();
+
+	return 0;
+}
@@ -0,0 +1,357 @@
+/* upstart
+ *
+ * test_timer_wheel.c - test suite for init/timer_wheel.c
+ *
+ * Copyright © 2014 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include <nih/test.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/list.h>
+#include <nih/timer.h>
+
+#include "timer_wheel.h"
+
+
+static int callback_called = 0;
+static void *last_data = NULL;
+static NihTimer *last_timer = NULL;
+
+static void
+my_callback (void     *data,
+	     NihTimer *timer)
+{
+	callback_called++;
+	last_data = data;
+	last_timer = timer;
+}
+
+static void
+my_free_callback (void     *data,
+		  NihTimer *timer)
+{
+	callback_called++;
+	nih_free (data);
+}
+
+
+void
+test_add (void)
+{
+	NihTimer *timer;
+	void     *parent;
+	time_t    now;
+
+	TEST_FUNCTION ("timer_wheel_add");
+	timer_wheel_init ();
+
+
+	/* Check that a timer is placed in the wheel, due after the
+	 * timeout given, and is removed again when freed.
+	 */
+	TEST_FEATURE ("with timeout");
+	parent = nih_alloc (NULL, 0);
+
+	TEST_ALLOC_FAIL {
+		now = timer_wheel_now ();
+
+		timer = timer_wheel_add (parent, 10, my_callback, &timer);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (timer, NULL);
+			TEST_EQ (timer_wheel_len, 0);
+			continue;
+		}
+
+		TEST_ALLOC_SIZE (timer, sizeof (NihTimer));
+		TEST_ALLOC_PARENT (timer, parent);
+		TEST_LIST_NOT_EMPTY (&timer->entry);
+
+		TEST_EQ (timer->type, NIH_TIMER_TIMEOUT);
+		TEST_EQ (timer->timeout, 10);
+		TEST_GE (timer->due, now + 10);
+		TEST_LE (timer->due, timer_wheel_now () + 10);
+		TEST_EQ_P (timer->callback, my_callback);
+		TEST_EQ_P (timer->data, &timer);
+
+		TEST_EQ (timer_wheel_len, 1);
+
+		nih_free (timer);
+
+		TEST_EQ (timer_wheel_len, 0);
+	}
+
+
+	/* Check that freeing the parent of a timer cancels it. */
+	TEST_FEATURE ("with freed parent");
+	timer = timer_wheel_add (parent, 10, my_callback, &timer);
+	TEST_FREE_TAG (timer);
+
+	nih_free (parent);
+
+	TEST_FREE (timer);
+	TEST_EQ (timer_wheel_len, 0);
+}
+
+
+void
+test_adjust (void)
+{
+	NihTimer *timer;
+	time_t    now;
+
+	TEST_FUNCTION ("timer_wheel_adjust");
+	timer_wheel_init ();
+
+
+	/* Check that a timer may be brought forward so that it is called
+	 * when it is newly due rather than at its original time.
+	 */
+	TEST_FEATURE ("with earlier time");
+	timer = timer_wheel_add (NULL, 5000, my_callback, NULL);
+	now = timer_wheel_now ();
+
+	timer_wheel_adjust (timer, now + 2);
+
+	TEST_EQ (timer->due, now + 2);
+	TEST_EQ (timer_wheel_len, 1);
+
+	callback_called = 0;
+	TEST_FREE_TAG (timer);
+
+	timer_wheel_advance (now + 1);
+
+	TEST_EQ (callback_called, 0);
+	TEST_NOT_FREE (timer);
+
+	timer_wheel_advance (now + 2);
+
+	TEST_EQ (callback_called, 1);
+	TEST_FREE (timer);
+	TEST_EQ (timer_wheel_len, 0);
+
+
+	/* Check that a timer may be put back so that it is not called
+	 * at its original time.
+	 */
+	TEST_FEATURE ("with later time");
+	timer = timer_wheel_add (NULL, 2, my_callback, NULL);
+	now = timer_wheel_now ();
+
+	timer_wheel_adjust (timer, now + 100);
+
+	callback_called = 0;
+	TEST_FREE_TAG (timer);
+
+	timer_wheel_advance (now + 99);
+
+	TEST_EQ (callback_called, 0);
+	TEST_NOT_FREE (timer);
+
+	timer_wheel_advance (now + 100);
+
+	TEST_EQ (callback_called, 1);
+	TEST_FREE (timer);
+	TEST_EQ (timer_wheel_len, 0);
+}
+
+
+void
+test_next (void)
+{
+	NihTimer *timer1, *timer2;
+	time_t    next;
+
+	TEST_FUNCTION ("timer_wheel_next");
+	timer_wheel_init ();
+
+
+	/* Check that an empty wheel has nothing to do. */
+	TEST_FEATURE ("with no timers");
+	TEST_EQ (timer_wheel_len, 0);
+	TEST_EQ (timer_wheel_next (), 0);
+
+
+	/* Check that the wheel next has work to do in the second a timer
+	 * in the first level is due, rather than in the next second.
+	 */
+	TEST_FEATURE ("with timer in first level");
+	timer1 = timer_wheel_add (NULL, 10, my_callback, &timer1);
+
+	TEST_EQ (timer_wheel_next (), timer1->due);
+
+	nih_free (timer1);
+
+
+	/* Check that a timer further ahead is first visited when its slot
+	 * is cascaded, which is no later than it is due.
+	 */
+	TEST_FEATURE ("with timer in higher level");
+	timer1 = timer_wheel_add (NULL, 90, my_callback, &timer1);
+
+	next = timer_wheel_next ();
+	TEST_GT (next, timer_wheel_time);
+	TEST_LE (next, timer1->due);
+	TEST_EQ (next & TIMER_WHEEL_MASK, 0);
+
+
+	/* Check that the sooner of two timers decides the next time. */
+	TEST_FEATURE ("with sooner timer added");
+	timer2 = timer_wheel_add (NULL, 2, my_callback, &timer2);
+
+	TEST_EQ (timer_wheel_next (), timer2->due);
+
+	nih_free (timer2);
+
+	TEST_EQ (timer_wheel_next (), next);
+
+	nih_free (timer1);
+
+	TEST_EQ (timer_wheel_len, 0);
+}
+
+
+void
+test_advance (void)
+{
+	NihTimer *timer1, *timer2, *timer3, *timer4;
+	void     *parent;
+	time_t    now;
+
+	TEST_FUNCTION ("timer_wheel_advance");
+	timer_wheel_init ();
+
+
+	/* Check that only timers that are due are called, and that each
+	 * is freed once called; timers due beyond the first level of the
+	 * wheel must be cascaded down to be called at the right time.
+	 */
+	TEST_FEATURE ("with timers due");
+	timer1 = timer_wheel_add (NULL, 3, my_callback, &timer1);
+	timer2 = timer_wheel_add (NULL, 100, my_callback, &timer2);
+	timer3 = timer_wheel_add (NULL, 5000, my_callback, &timer3);
+	timer4 = timer_wheel_add (NULL, 20000000, my_callback, &timer4);
+
+	TEST_EQ (timer_wheel_len, 4);
+
+	TEST_FREE_TAG (timer1);
+	TEST_FREE_TAG (timer2);
+	TEST_FREE_TAG (timer3);
+	TEST_FREE_TAG (timer4);
+
+	callback_called = 0;
+	last_data = NULL;
+	timer_wheel_advance (timer1->due);
+
+	TEST_EQ (callback_called, 1);
+	TEST_EQ_P (last_data, &timer1);
+	TEST_FREE (timer1);
+	TEST_NOT_FREE (timer2);
+
+	callback_called = 0;
+	timer_wheel_advance (timer2->due - 1);
+
+	TEST_EQ (callback_called, 0);
+	TEST_NOT_FREE (timer2);
+
+	timer_wheel_advance (timer2->due);
+
+	TEST_EQ (callback_called, 1);
+	TEST_EQ_P (last_data, &timer2);
+	TEST_FREE (timer2);
+
+	callback_called = 0;
+	timer_wheel_advance (timer3->due - 1);
+
+	TEST_EQ (callback_called, 0);
+	TEST_NOT_FREE (timer3);
+
+	timer_wheel_advance (timer3->due);
+
+	TEST_EQ (callback_called, 1);
+	TEST_EQ_P (last_data, &timer3);
+	TEST_FREE (timer3);
+
+	callback_called = 0;
+	timer_wheel_advance (timer4->due - 1);
+
+	TEST_EQ (callback_called, 0);
+	TEST_NOT_FREE (timer4);
+
+	timer_wheel_advance (timer4->due);
+
+	TEST_EQ (callback_called, 1);
+	TEST_EQ_P (last_data, &timer4);
+	TEST_FREE (timer4);
+
+	TEST_EQ (timer_wheel_len, 0);
+
+
+	/* Check that a timer with no timeout is called the next time the
+	 * wheel is polled.
+	 */
+	TEST_FEATURE ("with no timeout");
+	timer1 = timer_wheel_add (NULL, 0, my_callback, &timer1);
+	TEST_FREE_TAG (timer1);
+
+	callback_called = 0;
+	last_timer = NULL;
+	timer_wheel_poll ();
+
+	TEST_EQ (callback_called, 1);
+	TEST_EQ_P (last_timer, timer1);
+	TEST_FREE (timer1);
+	TEST_EQ (timer_wheel_len, 0);
+
+
+	/* Check that a callback may free the parent of its timer, and
+	 * with it the other timers of that parent due at the same time.
+	 */
+	TEST_FEATURE ("with parent freed by callback");
+	parent = nih_alloc (NULL, 0);
+	timer1 = timer_wheel_add (parent, 1, my_free_callback, parent);
+	timer2 = timer_wheel_add (parent, 1, my_free_callback, parent);
+	now = timer_wheel_now ();
+
+	TEST_FREE_TAG (parent);
+	TEST_FREE_TAG (timer1);
+	TEST_FREE_TAG (timer2);
+
+	callback_called = 0;
+	timer_wheel_advance (now + 1);
+
+	TEST_EQ (callback_called, 1);
+	TEST_FREE (parent);
+	TEST_FREE (timer1);
+	TEST_FREE (timer2);
+	TEST_EQ (timer_wheel_len, 0);
+}
+
+
+int
+main (int   argc,
+      char *argv[])
+{
+	test_add ();
+	test_adjust ();
+	test_next ();
+	test_advance ();
+
+	return 0;
+}
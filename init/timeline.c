@@ -0,0 +1,134 @@
+/* upstart
+ *
+ * timeline.c - record of event and job state change times
+ *
+ * Copyright © 2014 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+
+#include <time.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/string.h>
+#include <nih/list.h>
+#include <nih/logging.h>
+
+#include "timeline.h"
+
+
+/**
+ * timeline:
+ *
+ * This list holds the recorded TimelineEntry structures in the order
+ * they were recorded, and so in order of time.
+ **/
+NihList *timeline = NULL;
+
+/**
+ * timeline_len:
+ *
+ * Number of entries in timeline.
+ **/
+size_t timeline_len = 0;
+
+
+/**
+ * timeline_init:
+ *
+ * Initialise the timeline list.
+ **/
+void
+timeline_init (void)
+{
+	if (! timeline)
+		timeline = NIH_MUST (nih_list_new (NULL));
+}
+
+/**
+ * timeline_now:
+ *
+ * Returns: current time in microseconds on the monotonic clock, or zero
+ * if it cannot be read.
+ **/
+uint64_t
+timeline_now (void)
+{
+	struct timespec now;
+
+	if (clock_gettime (CLOCK_MONOTONIC, &now) < 0)
+		return 0;
+
+	return ((uint64_t)now.tv_sec * 1000000
+		+ (uint64_t)now.tv_nsec / 1000);
+}
+
+/**
+ * timeline_record:
+ * @name: name of event,
+ * @job: name of job class for job events, or NULL,
+ * @instance: name of job instance for job events, or NULL.
+ *
+ * Appends an entry for the event @name to the timeline with the current
+ * time.  Once TIMELINE_MAX entries have been recorded, or if there is
+ * insufficient memory, nothing is recorded since the timeline is only
+ * used for analysis.
+ **/
+void
+timeline_record (const char *name,
+		 const char *job,
+		 const char *instance)
+{
+	TimelineEntry *entry;
+	uint64_t       usec;
+
+	nih_assert (name != NULL);
+
+	timeline_init ();
+
+	if (timeline_len >= TIMELINE_MAX)
+		return;
+
+	usec = timeline_now ();
+	if (! usec)
+		return;
+
+	entry = nih_new (timeline, TimelineEntry);
+	if (! entry)
+		return;
+
+	nih_list_init (&entry->entry);
+	nih_alloc_set_destructor (entry, nih_list_destroy);
+
+	entry->name = nih_strdup (entry, name);
+	entry->job = job ? nih_strdup (entry, job) : NULL;
+	entry->instance = instance ? nih_strdup (entry, instance) : NULL;
+
+	if ((! entry->name) || (job && (! entry->job))
+	    || (instance && (! entry->instance))) {
+		nih_free (entry);
+		return;
+	}
+
+	entry->usec = usec;
+
+	nih_list_add (timeline, &entry->entry);
+	timeline_len++;
+}
@@ -0,0 +1,75 @@
+/* upstart
+ *
+ * Copyright © 2014 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef INIT_TIMELINE_H
+#define INIT_TIMELINE_H
+
+#include <stdint.h>
+
+#include <nih/macros.h>
+#include <nih/list.h>
+
+
+/**
+ * TIMELINE_MAX:
+ *
+ * Number of entries recorded in the timeline, once reached later events
+ * and job state changes are no longer recorded so that the timeline
+ * always covers boot.
+ **/
+#define TIMELINE_MAX 8192
+
+
+/**
+ * TimelineEntry:
+ * @entry: list header,
+ * @name: name of event,
+ * @job: name of job class for job events, or NULL,
+ * @instance: name of job instance for job events, or NULL,
+ * @usec: time in microseconds on the monotonic clock.
+ *
+ * Each entry records the time that an event was handled or that a job
+ * instance reached one of the states emitting the starting, started,
+ * stopping and stopped events, whether or not that event was actually
+ * emitted.
+ **/
+typedef struct timeline_entry {
+	NihList   entry;
+	char     *name;
+	char     *job;
+	char     *instance;
+	uint64_t  usec;
+} TimelineEntry;
+
+
+NIH_BEGIN_EXTERN
+
+extern NihList *timeline;
+extern size_t   timeline_len;
+
+
+void     timeline_init   (void);
+
+uint64_t timeline_now    (void);
+
+void     timeline_record (const char *name, const char *job,
+			  const char *instance);
+
+NIH_END_EXTERN
+
+#endif /* INIT_TIMELINE_H */
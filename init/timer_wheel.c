@@ -0,0 +1,522 @@
+/* upstart
+ *
+ * timer_wheel.c - hierarchical timer wheel for per-job timeouts
+ *
+ * Copyright © 2014 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+# include <config.h>
+#endif /* HAVE_CONFIG_H */
+
+
+#include <time.h>
+
+#include <nih/macros.h>
+#include <nih/alloc.h>
+#include <nih/list.h>
+#include <nih/timer.h>
+#include <nih/logging.h>
+
+#include "timer_wheel.h"
+
+
+/* Prototypes for static functions */
+static int  timer_wheel_destroy  (NihTimer *timer);
+static void timer_wheel_insert   (NihTimer *timer);
+static void timer_wheel_splice   (NihList *list, NihList *slot);
+static void timer_wheel_cascade  (NihList *slot);
+static void timer_wheel_schedule (void);
+static void timer_wheel_tick     (void *data, NihTimer *timer);
+
+
+/**
+ * timer_wheel_slots:
+ *
+ * Lists of NihTimer structures for each slot of each level of the wheel,
+ * timers in a level 0 slot are due in the second it represents while
+ * those in higher levels are cascaded into lower levels as their time
+ * comes into range.
+ *
+ * This object also holds a reference to each timer while its callback
+ * is running.
+ **/
+static NihList (*timer_wheel_slots)[TIMER_WHEEL_SLOTS] = NULL;
+
+/**
+ * timer_wheel_timer:
+ *
+ * Main loop timer that advances the wheel when its next non-empty slot
+ * comes due, only present while the wheel holds timers.
+ **/
+static NihTimer *timer_wheel_timer = NULL;
+
+/**
+ * timer_wheel_wake:
+ *
+ * Time on the monotonic clock that timer_wheel_timer is armed for.
+ **/
+static time_t timer_wheel_wake = 0;
+
+/**
+ * timer_wheel_len:
+ *
+ * Number of timers held in the wheel.
+ **/
+size_t timer_wheel_len = 0;
+
+/**
+ * timer_wheel_time:
+ *
+ * Time on the monotonic clock of the next second the wheel will process.
+ **/
+time_t timer_wheel_time = 0;
+
+
+/**
+ * timer_wheel_init:
+ *
+ * Initialise the slots of the timer wheel.
+ **/
+void
+timer_wheel_init (void)
+{
+	if (timer_wheel_slots)
+		return;
+
+	timer_wheel_slots = NIH_MUST (nih_alloc (NULL, sizeof (NihList)
+						 * TIMER_WHEEL_LEVELS
+						 * TIMER_WHEEL_SLOTS));
+
+	for (int level = 0; level < TIMER_WHEEL_LEVELS; level++)
+		for (int slot = 0; slot < TIMER_WHEEL_SLOTS; slot++)
+			nih_list_init (&timer_wheel_slots[level][slot]);
+
+	timer_wheel_time = timer_wheel_now ();
+}
+
+/**
+ * timer_wheel_now:
+ *
+ * Returns: current time in seconds on the monotonic clock, or the time
+ * the wheel has reached if it cannot be read.
+ **/
+time_t
+timer_wheel_now (void)
+{
+	struct timespec now;
+
+	if (clock_gettime (CLOCK_MONOTONIC, &now) < 0)
+		return timer_wheel_time;
+
+	return now.tv_sec;
+}
+
+/**
+ * timer_wheel_add:
+ * @parent: parent object for new timer,
+ * @timeout: seconds to wait before triggering,
+ * @callback: function to be called,
+ * @data: pointer to pass to function as first argument.
+ *
+ * Arranges for the @callback function to be called in @timeout seconds
+ * time, or the soonest period thereafter, in the same way as
+ * nih_timer_add_timeout().  Rather than being added to the main loop's
+ * list of timers, which is scanned in full each time it is polled, the
+ * timer is placed in a slot of the wheel so that adding and cancelling
+ * it take constant time however many timers are pending.
+ *
+ * The timer structure is allocated using nih_alloc() and stored in the
+ * wheel; to cancel it, simply free it, it will be automatically removed
+ * from the wheel.  It is also freed once the @callback has returned.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned timer.  When all parents
+ * of the returned timer are freed, the returned timer will also be
+ * freed.
+ *
+ * Returns: the new timer information, or NULL if insufficient memory.
+ **/
+NihTimer *
+timer_wheel_add (const void *parent,
+		 time_t      timeout,
+		 NihTimerCb  callback,
+		 void       *data)
+{
+	NihTimer *timer;
+	time_t    now;
+
+	nih_assert (callback != NULL);
+
+	timer_wheel_init ();
+
+	timer = nih_new (parent, NihTimer);
+	if (! timer)
+		return NULL;
+
+	nih_list_init (&timer->entry);
+	nih_alloc_set_destructor (timer, timer_wheel_destroy);
+
+	now = timer_wheel_now ();
+
+	/* Don't make the wheel catch up on the time that passed while
+	 * it was empty.
+	 */
+	if (! timer_wheel_len)
+		timer_wheel_time = now;
+
+	timer->type = NIH_TIMER_TIMEOUT;
+	timer->timeout = timeout;
+	timer->due = now + timeout;
+
+	timer->callback = callback;
+	timer->data = data;
+
+	timer_wheel_insert (timer);
+	timer_wheel_schedule ();
+
+	return timer;
+}
+
+/**
+ * timer_wheel_destroy:
+ * @timer: timer to be destroyed.
+ *
+ * Removes @timer from the wheel if it is still waiting in it; this is
+ * the destructor of timers returned by timer_wheel_add().
+ *
+ * Returns: zero.
+ **/
+static int
+timer_wheel_destroy (NihTimer *timer)
+{
+	nih_assert (timer != NULL);
+
+	if (! NIH_LIST_EMPTY (&timer->entry)) {
+		nih_list_remove (&timer->entry);
+		timer_wheel_len--;
+	}
+
+	return 0;
+}
+
+/**
+ * timer_wheel_adjust:
+ * @timer: timer returned by timer_wheel_add(),
+ * @due: new time on the monotonic clock the timer is due.
+ *
+ * Moves @timer to the slot of the wheel for @due.
+ **/
+void
+timer_wheel_adjust (NihTimer *timer,
+		    time_t    due)
+{
+	nih_assert (timer != NULL);
+
+	timer_wheel_init ();
+
+	if (! NIH_LIST_EMPTY (&timer->entry)) {
+		nih_list_remove (&timer->entry);
+		timer_wheel_len--;
+	}
+
+	timer->due = due;
+
+	timer_wheel_insert (timer);
+	timer_wheel_schedule ();
+}
+
+/**
+ * timer_wheel_insert:
+ * @timer: timer to insert.
+ *
+ * Places @timer in the lowest level of the wheel whose range covers the
+ * number of seconds until it is due, in the slot for the due time at
+ * that level.  Timers already overdue are placed in the slot for the
+ * next second processed.
+ **/
+static void
+timer_wheel_insert (NihTimer *timer)
+{
+	time_t due;
+	time_t delta;
+	int    level;
+	int    slot;
+
+	nih_assert (timer != NULL);
+	nih_assert (NIH_LIST_EMPTY (&timer->entry));
+
+	due = timer->due;
+	if (due < timer_wheel_time)
+		due = timer_wheel_time;
+
+	delta = due - timer_wheel_time;
+
+	for (level = 0; level < TIMER_WHEEL_LEVELS - 1; level++)
+		if (delta < ((time_t)1 << (TIMER_WHEEL_BITS * (level + 1))))
+			break;
+
+	/* Timers beyond the range of the wheel wait in the furthest
+	 * slot of the top level, and are placed there again each time
+	 * it is cascaded until they come into range.
+	 */
+	if (delta >= ((time_t)1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS)))
+		due = (timer_wheel_time
+		       + ((time_t)1 << (TIMER_WHEEL_BITS * TIMER_WHEEL_LEVELS))
+		       - 1);
+
+	slot = (due >> (TIMER_WHEEL_BITS * level)) & TIMER_WHEEL_MASK;
+
+	nih_list_add (&timer_wheel_slots[level][slot], &timer->entry);
+	timer_wheel_len++;
+}
+
+/**
+ * timer_wheel_splice:
+ * @list: empty list to receive entries,
+ * @slot: slot to take entries from.
+ *
+ * Moves every timer in @slot to @list, leaving @slot empty.
+ **/
+static void
+timer_wheel_splice (NihList *list,
+		    NihList *slot)
+{
+	nih_assert (list != NULL);
+	nih_assert (NIH_LIST_EMPTY (list));
+	nih_assert (slot != NULL);
+
+	if (NIH_LIST_EMPTY (slot))
+		return;
+
+	list->next = slot->next;
+	list->prev = slot->prev;
+	list->next->prev = list;
+	list->prev->next = list;
+
+	nih_list_init (slot);
+}
+
+/**
+ * timer_wheel_cascade:
+ * @slot: slot of a higher level of the wheel.
+ *
+ * Inserts every timer in @slot into the wheel again, which places them
+ * in lower levels now that their time is in range.
+ **/
+static void
+timer_wheel_cascade (NihList *slot)
+{
+	NihList pending;
+
+	nih_assert (slot != NULL);
+
+	nih_list_init (&pending);
+	timer_wheel_splice (&pending, slot);
+
+	while (! NIH_LIST_EMPTY (&pending)) {
+		NihTimer *timer = (NihTimer *)pending.next;
+
+		nih_list_remove (&timer->entry);
+		timer_wheel_len--;
+
+		timer_wheel_insert (timer);
+	}
+}
+
+/**
+ * timer_wheel_advance:
+ * @now: time on the monotonic clock to advance to.
+ *
+ * Processes each second of the wheel up to and including @now, calling
+ * and then freeing every timer due in it.  At the start of each lap of
+ * a level, the timers in the next slot of the level above are cascaded
+ * into it.
+ **/
+void
+timer_wheel_advance (time_t now)
+{
+	timer_wheel_init ();
+
+	if (! timer_wheel_len) {
+		if (now >= timer_wheel_time)
+			timer_wheel_time = now + 1;
+
+		return;
+	}
+
+	while (timer_wheel_time <= now) {
+		NihList pending;
+		int     index;
+
+		index = timer_wheel_time & TIMER_WHEEL_MASK;
+		if (! index) {
+			for (int level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+				int cascade;
+
+				cascade = ((timer_wheel_time >> (TIMER_WHEEL_BITS * level))
+					   & TIMER_WHEEL_MASK);
+				timer_wheel_cascade (&timer_wheel_slots[level][cascade]);
+
+				if (cascade)
+					break;
+			}
+		}
+
+		nih_list_init (&pending);
+		timer_wheel_splice (&pending, &timer_wheel_slots[0][index]);
+
+		/* Timers added by the callbacks are due no sooner than
+		 * the next second.
+		 */
+		timer_wheel_time++;
+
+		while (! NIH_LIST_EMPTY (&pending)) {
+			NihTimer *timer = (NihTimer *)pending.next;
+
+			nih_list_remove (&timer->entry);
+			timer_wheel_len--;
+
+			/* Hold a reference so that the callback may free
+			 * the parent of the timer.
+			 */
+			nih_ref (timer, timer_wheel_slots);
+
+			timer->callback (timer->data, timer);
+			nih_free (timer);
+		}
+	}
+
+	timer_wheel_schedule ();
+}
+
+/**
+ * timer_wheel_poll:
+ *
+ * Advances the wheel to the current time, calling every timer that is
+ * due.
+ **/
+void
+timer_wheel_poll (void)
+{
+	timer_wheel_advance (timer_wheel_now ());
+}
+
+/**
+ * timer_wheel_next:
+ *
+ * Finds the next second the wheel has work to do in; that is the first
+ * second whose level 0 slot holds timers, or the first lap of a level
+ * that cascades a slot of the level above holding timers, whichever is
+ * sooner.
+ *
+ * Returns: time on the monotonic clock the wheel should next be advanced
+ * to, or zero if it holds no timers.
+ **/
+time_t
+timer_wheel_next (void)
+{
+	time_t next = 0;
+
+	timer_wheel_init ();
+
+	if (! timer_wheel_len)
+		return 0;
+
+	for (int level = 0; level < TIMER_WHEEL_LEVELS; level++) {
+		int    shift = TIMER_WHEEL_BITS * level;
+		time_t lap;
+		int    first;
+
+		/* Slots of higher levels are cascaded at the start of a
+		 * lap of the level below, which may be the second the
+		 * wheel will process next.
+		 */
+		lap = timer_wheel_time >> shift;
+		first = (timer_wheel_time & (((time_t)1 << shift) - 1)) ? 1 : 0;
+
+		for (int i = first; i < first + TIMER_WHEEL_SLOTS; i++) {
+			int    slot = (lap + i) & TIMER_WHEEL_MASK;
+			time_t due = (lap + i) << shift;
+
+			if (next && (due >= next))
+				break;
+
+			if (! NIH_LIST_EMPTY (&timer_wheel_slots[level][slot])) {
+				next = due;
+				break;
+			}
+		}
+	}
+
+	return next;
+}
+
+/**
+ * timer_wheel_schedule:
+ *
+ * Ensures the main loop timer that advances the wheel is present while
+ * the wheel holds timers, and armed for the next second it has work to
+ * do in rather than waking the main loop every second.
+ **/
+static void
+timer_wheel_schedule (void)
+{
+	time_t next;
+	time_t now;
+
+	if (! timer_wheel_len) {
+		if (timer_wheel_timer) {
+			nih_free (timer_wheel_timer);
+			timer_wheel_timer = NULL;
+		}
+
+		return;
+	}
+
+	next = timer_wheel_next ();
+	if (timer_wheel_timer && (timer_wheel_wake == next))
+		return;
+
+	if (timer_wheel_timer)
+		nih_free (timer_wheel_timer);
+
+	now = timer_wheel_now ();
+
+	timer_wheel_wake = next;
+	timer_wheel_timer = NIH_MUST (nih_timer_add_timeout (
+					      NULL, next > now ? next - now : 0,
+					      timer_wheel_tick, NULL));
+}
+
+/**
+ * timer_wheel_tick:
+ * @data: not used,
+ * @timer: timer that caused us to be called.
+ *
+ * Called by the main loop when the next non-empty slot of the wheel is
+ * due.
+ **/
+static void
+timer_wheel_tick (void     *data,
+		  NihTimer *timer)
+{
+	nih_assert (timer != NULL);
+
+	timer_wheel_timer = NULL;
+
+	timer_wheel_poll ();
+}
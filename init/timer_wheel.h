@@ -0,0 +1,83 @@
+/* upstart
+ *
+ * Copyright © 2014 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef INIT_TIMER_WHEEL_H
+#define INIT_TIMER_WHEEL_H
+
+#include <time.h>
+
+#include <nih/macros.h>
+#include <nih/list.h>
+#include <nih/timer.h>
+
+
+/**
+ * TIMER_WHEEL_BITS:
+ *
+ * Number of bits of the due time that index the slots of each level of
+ * the wheel.
+ **/
+#define TIMER_WHEEL_BITS 6
+
+/**
+ * TIMER_WHEEL_SLOTS:
+ *
+ * Number of slots in each level of the wheel; timers in level N are due
+ * within TIMER_WHEEL_SLOTS^(N+1) seconds.
+ **/
+#define TIMER_WHEEL_SLOTS (1 << TIMER_WHEEL_BITS)
+
+/**
+ * TIMER_WHEEL_MASK:
+ *
+ * Mask applied to a shifted due time to obtain its slot.
+ **/
+#define TIMER_WHEEL_MASK (TIMER_WHEEL_SLOTS - 1)
+
+/**
+ * TIMER_WHEEL_LEVELS:
+ *
+ * Number of levels in the wheel, timers due further ahead than the top
+ * level covers are held in its last slot until they come into range.
+ **/
+#define TIMER_WHEEL_LEVELS 4
+
+
+NIH_BEGIN_EXTERN
+
+extern size_t timer_wheel_len;
+extern time_t timer_wheel_time;
+
+
+void      timer_wheel_init    (void);
+
+time_t    timer_wheel_now     (void);
+
+NihTimer *timer_wheel_add     (const void *parent, time_t timeout,
+			       NihTimerCb callback, void *data)
+	__attribute__ ((warn_unused_result, malloc));
+
+void      timer_wheel_adjust  (NihTimer *timer, time_t due);
+
+time_t    timer_wheel_next    (void);
+void      timer_wheel_advance (time_t now);
+void      timer_wheel_poll    (void);
+
+NIH_END_EXTERN
+
+#endif /* INIT_TIMER_WHEEL_H */
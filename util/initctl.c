@@ -26,8 +26,11 @@
 
 #include <sys/types.h>
 
+#include <errno.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include <fnmatch.h>
 #include <pwd.h>
@@ -68,13 +71,47 @@ NihDBusProxy *upstart_open (const void *parent)
 char *        job_status   (const void *parent,
 			    NihDBusProxy *job_class, NihDBusProxy *job)
 	__attribute__ ((warn_unused_result));
+char *        job_status_element (const void *parent,
+			    const UpstartGetAllJobStatusStatusElement *status)
+	__attribute__ ((warn_unused_result));
+char *        job_status_add_stats (char **str, const void *parent,
+			    JobGetStatsStatsElement * const *stats)
+	__attribute__ ((warn_unused_result));
 char *        job_usage    (const void *parent,
 			    NihDBusProxy *job_class)
 	__attribute__ ((warn_unused_result));
+int           analyze_critical_chain (NihHash *jobs,
+			    UpstartGetTimelineTimelineElement * const *timeline,
+			    const char *target)
+	__attribute__ ((warn_unused_result));
+void          analyze_blame (UpstartGetTimelineTimelineElement * const *timeline);
 
 /* Prototypes for static functions */
+static char * job_status_string   (const void *parent,
+				   const char *job_class_name,
+				   const char *name, const char *goal,
+				   const char *state)
+	__attribute__ ((warn_unused_result));
+static char * job_status_add_process (char **str, const void *parent,
+				      int first, const char *process,
+				      int32_t pid)
+	__attribute__ ((warn_unused_result));
 static void   start_reply_handler (char **job_path, NihDBusMessage *message,
 				   const char *instance);
+static BatchCommand *batch_command_new (const void *parent,
+					const char *line)
+	__attribute__ ((warn_unused_result));
+static void   batch_send          (void);
+static void   batch_sent          (BatchCommand *cmd,
+				   DBusPendingCall *pending_call);
+static void   batch_done          (BatchCommand *cmd, const char *error);
+static void   batch_job_handler   (BatchCommand *cmd, NihDBusMessage *message,
+				   const char *job_class_path);
+static void   batch_instance_handler (BatchCommand *cmd,
+				      NihDBusMessage *message,
+				      const char *instance);
+static void   batch_reply_handler (BatchCommand *cmd, NihDBusMessage *message);
+static void   batch_error_handler (BatchCommand *cmd, NihDBusMessage *message);
 static void   reply_handler       (int *ret, NihDBusMessage *message);
 static void   error_handler       (void *data, NihDBusMessage *message);
 
@@ -94,6 +131,28 @@ static void   job_class_show_emits (const void *parent,
 static void   job_class_show_conditions (NihDBusProxy *job_class_proxy,
 		const char *job_class_name);
 
+static ssize_t analyze_find (UpstartGetTimelineTimelineElement * const *timeline,
+		ssize_t before, const char *name, const char *job,
+		const char *instance)
+	__attribute__ ((warn_unused_result));
+static ssize_t analyze_emitter (NihHash *jobs,
+		UpstartGetTimelineTimelineElement * const *timeline,
+		ssize_t event)
+	__attribute__ ((warn_unused_result));
+static void   analyze_show (int depth, const char *name,
+		const char *instance, const char *state, uint64_t usec,
+		uint64_t start);
+static void   analyze_chain_job (NihHash *jobs,
+		UpstartGetTimelineTimelineElement * const *timeline,
+		ssize_t index, ssize_t start, int depth);
+static void   analyze_chain_event (NihHash *jobs,
+		UpstartGetTimelineTimelineElement * const *timeline,
+		ssize_t index, int depth);
+static void   analyze_chain_gate (NihHash *jobs,
+		UpstartGetTimelineTimelineElement * const *timeline,
+		const char *job, ssize_t before, int depth);
+static int    analyze_blame_cmp (const void *a, const void *b);
+
 static void   eval_expr_tree (const char *expr, NihList **stack);
 
 static int    check_condition (const char *job_class,
@@ -110,6 +169,7 @@ static int    allow_job (const char *job);
 static int    allow_event (const char *event);
 static char **get_job_details (void)
 	__attribute__ ((warn_unused_result));
+static int    check_config_offline (char * const *args);
 
 #ifndef TEST
 
@@ -126,11 +186,13 @@ int reload_action                 (NihCommand *command, char * const *args);
 int status_action                 (NihCommand *command, char * const *args);
 int list_action                   (NihCommand *command, char * const *args);
 int emit_action                   (NihCommand *command, char * const *args);
+int batch_action                  (NihCommand *command, char * const *args);
 int reload_configuration_action   (NihCommand *command, char * const *args);
 int version_action                (NihCommand *command, char * const *args);
 int log_priority_action           (NihCommand *command, char * const *args);
 int show_config_action            (NihCommand *command, char * const *args);
 int check_config_action           (NihCommand *command, char * const *args);
+int analyze_action                (NihCommand *command, char * const *args);
 int usage_action                  (NihCommand *command, char * const *args);
 int notify_disk_writeable_action  (NihCommand *command, char * const *args);
 int get_env_action                (NihCommand *command, char * const *args);
@@ -187,6 +249,50 @@ const char *dest_address = DBUS_ADDRESS_UPSTART;
  **/
 int no_wait = FALSE;
 
+/**
+ * batch_window:
+ *
+ * Maximum number of commands the batch command will have awaiting a
+ * reply from the init daemon at any one time.
+ **/
+int batch_window = 64;
+
+/**
+ * batch_upstart:
+ *
+ * Proxy used by the batch command for all of its requests.
+ **/
+static NihDBusProxy *batch_upstart = NULL;
+
+/**
+ * batch_queue:
+ *
+ * List of BatchCommand structures not yet sent by the batch command.
+ **/
+static NihList *batch_queue = NULL;
+
+/**
+ * batch_outstanding:
+ *
+ * Number of batch commands sent that have not yet completed.
+ **/
+static int batch_outstanding = 0;
+
+/**
+ * batch_failed:
+ *
+ * Set to TRUE if any batch command failed.
+ **/
+static int batch_failed = FALSE;
+
+/**
+ * batch_sending:
+ *
+ * Set to TRUE while batch_send() is sending commands, so that commands
+ * failing as they are sent don't send the next one from within it.
+ **/
+static int batch_sending = FALSE;
+
 /**
  * enumerate_events:
  *
@@ -222,6 +328,14 @@ int check_config_mode = FALSE;
  **/
 int check_config_warn = FALSE;
 
+/**
+ * check_config_confdir:
+ *
+ * If set, check-config checks the job configuration files in this
+ * directory offline rather than querying a running init.
+ **/
+char *check_config_confdir = NULL;
+
 /**
  * check_config_data:
  *
@@ -237,6 +351,14 @@ CheckConfigData check_config_data;
  **/
 int apply_globally = FALSE;
 
+/**
+ * show_stats:
+ *
+ * If TRUE, show the resource usage and start latencies of an instance
+ * with its status.
+ **/
+int show_stats = FALSE;
+
 /**
  * NihOption setter function to handle selection of appropriate D-Bus
  * bus.
@@ -464,62 +586,108 @@ job_status (const void *  parent,
 		}
 	}
 
-	if (props && *props->name) {
-		str = nih_sprintf (parent, "%s (%s)",
-				   job_class_name, props->name);
-		if (! str)
-			nih_return_no_memory_error (NULL);
+	if (! props)
+		return job_status_string (parent, job_class_name,
+					  NULL, NULL, NULL);
+
+	str = job_status_string (parent, job_class_name, props->name,
+				 props->goal, props->state);
+	if (! str)
+		return NULL;
+
+	for (size_t i = 0; props->processes[i]; i++) {
+		if (! job_status_add_process (&str, parent, i == 0,
+					      props->processes[i]->item0,
+					      props->processes[i]->item1)) {
+			nih_free (str);
+			return NULL;
+		}
+	}
+
+	return str;
+}
+
+/**
+ * job_status_element:
+ * @parent: parent object for new string,
+ * @status: status structure returned by GetAllJobStatus.
+ *
+ * Constructs a string defining the status of the instance described by
+ * @status in the same form as job_status(), without making any further
+ * calls to the remote objects.
+ *
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned string.  When all parents
+ * of the returned string are freed, the returned string will also be
+ * freed.
+ *
+ * Returns: newly allocated string or NULL on raised error.
+ **/
+char *
+job_status_element (const void *                          parent,
+		    const UpstartGetAllJobStatusStatusElement *status)
+{
+	char *str;
+
+	nih_assert (status != NULL);
+
+	str = job_status_string (parent, status->item0, status->item1,
+				 status->item2, status->item3);
+	if (! str)
+		return NULL;
+
+	for (size_t i = 0; status->item4 && status->item4[i]; i++) {
+		if (! job_status_add_process (&str, parent, i == 0,
+					      status->item4[i]->item0,
+					      status->item4[i]->item1)) {
+			nih_free (str);
+			return NULL;
+		}
+	}
+
+	return str;
+}
+
+/**
+ * job_status_string:
+ * @parent: parent object for new string,
+ * @job_class_name: name of job class,
+ * @name: name of instance,
+ * @goal: goal of instance,
+ * @state: state of instance.
+ *
+ * Constructs the first part of a status string, containing the name of
+ * the job class and instance, the goal and state.  If @goal is NULL, a
+ * non-running job is assumed.
+ *
+ * Returns: newly allocated string or NULL on raised error.
+ **/
+static char *
+job_status_string (const void *parent,
+		   const char *job_class_name,
+		   const char *name,
+		   const char *goal,
+		   const char *state)
+{
+	char *str;
+
+	nih_assert (job_class_name != NULL);
+
+	if (name && *name) {
+		str = nih_sprintf (parent, "%s (%s)", job_class_name, name);
 	} else {
 		str = nih_strdup (parent, job_class_name);
-		if (! str)
-			nih_return_no_memory_error (NULL);
 	}
+	if (! str)
+		nih_return_no_memory_error (NULL);
 
-	if (props) {
+	if (goal) {
 		if (! nih_strcat_sprintf (&str, parent, " %s/%s",
-					  props->goal, props->state)) {
+					  goal, state)) {
 			nih_error_raise_no_memory ();
 			nih_free (str);
 			return NULL;
 		}
-
-		/* The first process returned is always the main process,
-		 * which is the process we always want to display alongside
-		 * the state if there is one.  Prefix if it's not one of
-		 * the standard processes.
-		 */
-		if (props->processes[0]) {
-			if (strcmp (props->processes[0]->item0, "main")
-			    && strcmp (props->processes[0]->item0, "pre-start")
-			    && strcmp (props->processes[0]->item0, "post-stop")) {
-				if (! nih_strcat_sprintf (&str, parent, ", (%s) process %d",
-							  props->processes[0]->item0,
-							  props->processes[0]->item1)) {
-					nih_error_raise_no_memory ();
-					nih_free (str);
-					return NULL;
-				}
-			} else {
-				if (! nih_strcat_sprintf (&str, parent, ", process %d",
-							  props->processes[0]->item1)) {
-					nih_error_raise_no_memory ();
-					nih_free (str);
-					return NULL;
-				}
-			}
-
-			/* Append a line for each additional process */
-			for (JobProcessesElement **p = &props->processes[1];
-			     p && *p; p++) {
-				if (! nih_strcat_sprintf (&str, parent, "\n\t%s process %d",
-							  (*p)->item0,
-							  (*p)->item1)) {
-					nih_error_raise_no_memory ();
-					nih_free (str);
-					return NULL;
-				}
-			}
-		}
 	} else {
 		if (! nih_strcat (&str, parent, " stop/waiting")) {
 			nih_error_raise_no_memory ();
@@ -531,6 +699,83 @@ job_status (const void *  parent,
 	return str;
 }
 
+/**
+ * job_status_add_process:
+ * @str: pointer to status string,
+ * @parent: parent object of @str,
+ * @first: TRUE if this is the first process of the instance,
+ * @process: name of process,
+ * @pid: process id.
+ *
+ * Appends the process @process to the status string @str.
+ *
+ * The first process returned is always the main process, which is the
+ * process we always want to display alongside the state if there is one;
+ * it's prefixed if it's not one of the standard processes.  Each
+ * additional process is appended on a line of its own.
+ *
+ * Returns: new string pointer or NULL on raised error, in which case
+ * @str is left unmodified.
+ **/
+static char *
+job_status_add_process (char **     str,
+			const void *parent,
+			int         first,
+			const char *process,
+			int32_t     pid)
+{
+	char *ret;
+
+	nih_assert (str != NULL);
+	nih_assert (process != NULL);
+
+	if (! first) {
+		ret = nih_strcat_sprintf (str, parent, "\n\t%s process %d",
+					  process, pid);
+	} else if (strcmp (process, "main")
+		   && strcmp (process, "pre-start")
+		   && strcmp (process, "post-stop")) {
+		ret = nih_strcat_sprintf (str, parent, ", (%s) process %d",
+					  process, pid);
+	} else {
+		ret = nih_strcat_sprintf (str, parent, ", process %d", pid);
+	}
+
+	if (! ret)
+		nih_error_raise_no_memory ();
+
+	return ret;
+}
+
+/**
+ * job_status_add_stats:
+ * @str: pointer to status string,
+ * @parent: parent object of @str,
+ * @stats: NULL-terminated array of statistics returned by GetStats.
+ *
+ * Appends each of the statistics in @stats to the status string @str,
+ * each on a line of its own as its name and value.
+ *
+ * Returns: new string pointer or NULL on raised error, in which case
+ * @str may have been partially extended.
+ **/
+char *
+job_status_add_stats (char **                          str,
+		      const void *                     parent,
+		      JobGetStatsStatsElement * const *stats)
+{
+	nih_assert (str != NULL);
+	nih_assert (stats != NULL);
+
+	for (size_t i = 0; stats[i]; i++) {
+		if (! nih_strcat_sprintf (str, parent, "\n\t%s %" PRIu64,
+					  stats[i]->item0, stats[i]->item1))
+			nih_return_no_memory_error (NULL);
+	}
+
+	return *str;
+}
+
 /**
  * job_usage:
  * @parent: parent object,
@@ -1060,16 +1305,17 @@ int
 status_action (NihCommand *  command,
 	       char * const *args)
 {
-	nih_local NihDBusProxy *upstart = NULL;
-	const char *            upstart_job = NULL;
-	const char *            upstart_instance = NULL;
-	nih_local char *        job_class_path = NULL;
-	nih_local NihDBusProxy *job_class = NULL;
-	nih_local char *        job_path = NULL;
-	nih_local NihDBusProxy *job = NULL;
-	nih_local char *        status = NULL;
-	NihError *              err;
-	NihDBusError *          dbus_err;
+	nih_local NihDBusProxy *                         upstart = NULL;
+	const char *                                     upstart_job = NULL;
+	const char *                                     upstart_instance = NULL;
+	nih_local UpstartGetAllJobStatusStatusElement **all_status = NULL;
+	nih_local char *                                 job_class_path = NULL;
+	nih_local NihDBusProxy *                         job_class = NULL;
+	nih_local char *                                 job_path = NULL;
+	nih_local NihDBusProxy *                         job = NULL;
+	nih_local char *                                 status = NULL;
+	NihError *                                       err;
+	NihDBusError *                                   dbus_err;
 
 	nih_assert (command != NULL);
 	nih_assert (args != NULL);
@@ -1091,6 +1337,49 @@ status_action (NihCommand *  command,
 	if (! upstart)
 		return 1;
 
+	/* Without any environment to expand the instance name from, the
+	 * instance can be found in the status of every job, which we can
+	 * obtain in a single call.  If it's not there, or init is too old
+	 * to support that, fall back to looking the instance up so that
+	 * any error is the same as it's always been.  Statistics can only
+	 * be obtained from the instance itself.
+	 *
+	 * A job with no instances is listed as a stopped instance with an
+	 * empty name, that's not a real instance and GetInstance may well
+	 * refuse the empty environment for it, so fall back for that too.
+	 */
+	if ((! show_stats) && (! args[0] || ! args[1])) {
+		if (upstart_get_all_job_status_sync (NULL, upstart,
+						     &all_status) < 0) {
+			dbus_err = (NihDBusError *)nih_error_get ();
+			if ((dbus_err->number != NIH_DBUS_ERROR)
+			    || strcmp (dbus_err->name, DBUS_ERROR_UNKNOWN_METHOD))
+				goto error;
+
+			nih_free (dbus_err);
+		}
+
+		for (UpstartGetAllJobStatusStatusElement **elem = all_status;
+		     elem && *elem; elem++) {
+			if (strcmp ((*elem)->item0, upstart_job)
+			    || strcmp ((*elem)->item1,
+				       upstart_instance ? upstart_instance : ""))
+				continue;
+
+			if ((! *(*elem)->item1)
+			    && ((! (*elem)->item4) || (! (*elem)->item4[0])))
+				break;
+
+			status = job_status_element (NULL, *elem);
+			if (! status)
+				goto error;
+
+			nih_message ("%s", status);
+
+			return 0;
+		}
+	}
+
 	/* Obtain a proxy to the job */
 	if (upstart_get_job_by_name_sync (NULL, upstart, upstart_job,
 					  &job_class_path) < 0)
@@ -1142,6 +1431,16 @@ status_action (NihCommand *  command,
 	if (! status)
 		goto error;
 
+	if (show_stats && job) {
+		nih_local JobGetStatsStatsElement **stats = NULL;
+
+		if (job_get_stats_sync (NULL, job, &stats) < 0)
+			goto error;
+
+		if (! job_status_add_stats (&status, NULL, stats))
+			goto error;
+	}
+
 	nih_message ("%s", status);
 
 	return 0;
@@ -1168,10 +1467,11 @@ int
 list_action (NihCommand *  command,
 	     char * const *args)
 {
-	nih_local NihDBusProxy *upstart = NULL;
-	nih_local char **       job_class_paths = NULL;
-	NihError *              err;
-	NihDBusError *          dbus_err;
+	nih_local NihDBusProxy *                         upstart = NULL;
+	nih_local UpstartGetAllJobStatusStatusElement **all_status = NULL;
+	nih_local char **                                job_class_paths = NULL;
+	NihError *                                       err;
+	NihDBusError *                                   dbus_err;
 
 	nih_assert (command != NULL);
 	nih_assert (args != NULL);
@@ -1180,6 +1480,32 @@ list_action (NihCommand *  command,
 	if (! upstart)
 		return 1;
 
+	/* Obtain the status of every job and instance in a single call;
+	 * if init is too old to support that, fall back to querying each
+	 * job and instance in turn.
+	 */
+	if (upstart_get_all_job_status_sync (NULL, upstart, &all_status) == 0) {
+		for (UpstartGetAllJobStatusStatusElement **elem = all_status;
+		     elem && *elem; elem++) {
+			nih_local char *status = NULL;
+
+			status = job_status_element (NULL, *elem);
+			if (! status)
+				goto error;
+
+			nih_message ("%s", status);
+		}
+
+		return 0;
+	}
+
+	dbus_err = (NihDBusError *)nih_error_get ();
+	if ((dbus_err->number != NIH_DBUS_ERROR)
+	    || strcmp (dbus_err->name, DBUS_ERROR_UNKNOWN_METHOD))
+		goto error;
+
+	nih_free (dbus_err);
+
 	/* Obtain a list of jobs */
 	if (upstart_get_all_jobs_sync (NULL, upstart, &job_class_paths) < 0)
 		goto error;
@@ -1751,107 +2077,476 @@ error:
 
 
 /**
- * reload_configuration_action:
+ * batch_action:
  * @command: NihCommand invoked,
  * @args: command-line arguments.
  *
- * This function is called for the "reload-configuration" command.
+ * This function is called for the "batch" command.
+ *
+ * Commands are read from the file named in @args, or standard input, one
+ * per line and all issued over a single connection; up to batch_window
+ * of them are outstanding at once and the result of each is reported as
+ * it completes.
  *
  * Returns: command exit status.
  **/
 int
-reload_configuration_action (NihCommand *  command,
-			     char * const *args)
+batch_action (NihCommand *  command,
+	      char * const *args)
 {
 	nih_local NihDBusProxy *upstart = NULL;
-	NihError *              err;
+	FILE *                  input;
+	char *                  line = NULL;
+	size_t                  size = 0;
 
 	nih_assert (command != NULL);
 	nih_assert (args != NULL);
 
-	upstart = upstart_open (NULL);
-	if (! upstart)
+	if (batch_window < 1) {
+		fprintf (stderr, _("%s: window must be at least 1\n"),
+			 program_name);
+		nih_main_suggest_help ();
 		return 1;
+	}
 
-	if (upstart_reload_configuration_sync (NULL, upstart) < 0)
-		goto error;
+	if (args[0] && strcmp (args[0], "-")) {
+		input = fopen (args[0], "r");
+		if (! input) {
+			nih_error ("%s: %s", args[0], strerror (errno));
+			return 1;
+		}
+	} else {
+		input = stdin;
+	}
 
-	return 0;
+	batch_queue = NIH_MUST (nih_list_new (NULL));
+	batch_outstanding = 0;
+	batch_failed = FALSE;
 
-error:
-	err = nih_error_get ();
-	nih_error ("%s", err->message);
-	nih_free (err);
+	/* Read and check every command before any is sent, so that
+	 * mistakes are reported before anything has been changed.
+	 */
+	while (getline (&line, &size, input) >= 0) {
+		BatchCommand *cmd;
 
-	return 1;
-}
+		cmd = batch_command_new (batch_queue, line);
+		if (cmd)
+			nih_list_add (batch_queue, &cmd->entry);
+	}
 
+	free (line);
 
-/**
- * version_action:
- * @command: NihCommand invoked,
- * @args: command-line arguments.
- *
- * This function is called for the "version" command.
- *
- * Returns: command exit status.
- **/
-int
-version_action (NihCommand *  command,
-		char * const *args)
-{
-	nih_local NihDBusProxy *upstart = NULL;
-	nih_local char *        version = NULL;
-	NihError *              err;
+	if (input != stdin)
+		fclose (input);
 
-	nih_assert (command != NULL);
-	nih_assert (args != NULL);
+	if (batch_failed || NIH_LIST_EMPTY (batch_queue))
+		goto out;
 
 	upstart = upstart_open (NULL);
-	if (! upstart)
-		return 1;
+	if (! upstart) {
+		batch_failed = TRUE;
+		goto out;
+	}
 
-	if (upstart_get_version_sync (NULL, upstart, &version) < 0)
-		goto error;
+	batch_upstart = upstart;
 
-	nih_message ("%s", version);
+	batch_send ();
 
-	return 0;
+	while (batch_outstanding) {
+		if (! dbus_connection_read_write_dispatch (upstart->connection,
+							   -1)) {
+			nih_error (_("Lost connection to init daemon"));
+			batch_failed = TRUE;
+			break;
+		}
+	}
 
-error:
-	err = nih_error_get ();
-	nih_error ("%s", err->message);
-	nih_free (err);
+	batch_upstart = NULL;
 
-	return 1;
-}
+out:
+	nih_free (batch_queue);
+	batch_queue = NULL;
 
+	return batch_failed ? 1 : 0;
+}
 
 /**
- * log_priority_action:
- * @command: NihCommand invoked,
- * @args: command-line arguments.
+ * batch_command_new:
+ * @parent: parent object for new command,
+ * @line: line read from input.
  *
- * This function is called for the "log-priority" command.
+ * Parses @line, which may be empty or a comment, into a new command for
+ * the batch command; errors in the line are reported and batch_failed
+ * set.
  *
- * Returns: command exit status.
+ * If @parent is not NULL, it should be a pointer to another object which
+ * will be used as a parent for the returned command.  When all parents
+ * of the returned command are freed, the returned command will also be
+ * freed.
+ *
+ * Returns: newly allocated BatchCommand structure or NULL if there is no
+ * command in @line.
  **/
-int
-log_priority_action (NihCommand *  command,
-		     char * const *args)
+static BatchCommand *
+batch_command_new (const void *parent,
+		   const char *line)
 {
-	nih_local NihDBusProxy *upstart = NULL;
-	NihError *              err;
+	BatchCommand *cmd;
+	size_t        len;
 
-	nih_assert (command != NULL);
-	nih_assert (args != NULL);
+	nih_assert (line != NULL);
 
-	upstart = upstart_open (NULL);
-	if (! upstart)
-		return 1;
+	line += strspn (line, " \t");
 
-	if (args[0]) {
-		if (upstart_set_log_priority_sync (NULL, upstart, args[0]) < 0)
+	len = strcspn (line, "\r\n");
+	while (len && strchr (" \t", line[len - 1]))
+		len--;
+
+	if (! len || (*line == '#'))
+		return NULL;
+
+	cmd = NIH_MUST (nih_new (parent, BatchCommand));
+	nih_list_init (&cmd->entry);
+	nih_alloc_set_destructor (cmd, nih_list_destroy);
+
+	cmd->line = NIH_MUST (nih_strndup (cmd, line, len));
+	cmd->args = NIH_MUST (nih_str_split (cmd, cmd->line, " \t", TRUE));
+
+	if (strcmp (cmd->args[0], "start")
+	    && strcmp (cmd->args[0], "stop")
+	    && strcmp (cmd->args[0], "restart")
+	    && strcmp (cmd->args[0], "emit")) {
+		nih_error ("%s: %s", cmd->line, _("unknown command"));
+		goto error;
+	}
+
+	if (! cmd->args[1]) {
+		nih_error ("%s: %s", cmd->line,
+			   strcmp (cmd->args[0], "emit")
+			   ? _("missing job name") : _("missing event name"));
+		goto error;
+	}
+
+	return cmd;
+
+error:
+	batch_failed = TRUE;
+	nih_free (cmd);
+	return NULL;
+}
+
+/**
+ * batch_send:
+ *
+ * Sends commands from batch_queue until batch_window are outstanding or
+ * there are none left.
+ **/
+static void
+batch_send (void)
+{
+	nih_assert (batch_upstart != NULL);
+
+	/* Commands completed while we're sending are replaced by the
+	 * loop below, rather than by calling ourselves again for each
+	 * of them.
+	 */
+	if (batch_sending)
+		return;
+
+	batch_sending = TRUE;
+
+	while ((batch_outstanding < batch_window)
+	       && ! NIH_LIST_EMPTY (batch_queue)) {
+		BatchCommand *   cmd = (BatchCommand *)batch_queue->next;
+		DBusPendingCall *pending_call;
+
+		nih_list_remove (&cmd->entry);
+		batch_outstanding++;
+
+		if (! strcmp (cmd->args[0], "emit")) {
+			pending_call = upstart_emit_event (
+				batch_upstart, cmd->args[1], &cmd->args[2],
+				(! no_wait),
+				(UpstartEmitEventReply)batch_reply_handler,
+				(NihDBusErrorHandler)batch_error_handler, cmd,
+				NIH_DBUS_TIMEOUT_NEVER);
+		} else {
+			pending_call = upstart_get_job_by_name (
+				batch_upstart, cmd->args[1],
+				(UpstartGetJobByNameReply)batch_job_handler,
+				(NihDBusErrorHandler)batch_error_handler, cmd,
+				NIH_DBUS_TIMEOUT_NEVER);
+		}
+
+		batch_sent (cmd, pending_call);
+	}
+
+	batch_sending = FALSE;
+}
+
+/**
+ * batch_sent:
+ * @cmd: batch command,
+ * @pending_call: pending call for request, or NULL on raised error.
+ *
+ * Completes @cmd with the raised error if its request could not be sent.
+ **/
+static void
+batch_sent (BatchCommand    *cmd,
+	    DBusPendingCall *pending_call)
+{
+	NihError *err;
+
+	nih_assert (cmd != NULL);
+
+	if (pending_call) {
+		dbus_pending_call_unref (pending_call);
+		return;
+	}
+
+	err = nih_error_get ();
+	batch_done (cmd, err->message);
+	nih_free (err);
+}
+
+/**
+ * batch_done:
+ * @cmd: batch command,
+ * @error: error message, or NULL on success.
+ *
+ * Reports the result of @cmd, frees it and sends the next command unless
+ * batch_send() is already doing so.
+ **/
+static void
+batch_done (BatchCommand *cmd,
+	    const char   *error)
+{
+	nih_assert (cmd != NULL);
+	nih_assert (batch_outstanding > 0);
+
+	if (error) {
+		nih_error ("%s: %s", cmd->line, error);
+		batch_failed = TRUE;
+	} else {
+		nih_message ("%s: %s", cmd->line, _("ok"));
+	}
+
+	nih_free (cmd);
+	batch_outstanding--;
+
+	batch_send ();
+}
+
+/**
+ * batch_job_handler:
+ * @cmd: batch command,
+ * @message: D-Bus message received,
+ * @job_class_path: path of job class.
+ *
+ * Called with the job class named by @cmd; changes the goal of the
+ * instance selected by its environment.
+ **/
+static void
+batch_job_handler (BatchCommand   *cmd,
+		   NihDBusMessage *message,
+		   const char     *job_class_path)
+{
+	NihDBusProxy *   job_class;
+	DBusPendingCall *pending_call = NULL;
+
+	nih_assert (cmd != NULL);
+	nih_assert (message != NULL);
+	nih_assert (job_class_path != NULL);
+
+	job_class = nih_dbus_proxy_new (cmd, batch_upstart->connection,
+					batch_upstart->name, job_class_path,
+					NULL, NULL);
+	if (job_class) {
+		job_class->auto_start = FALSE;
+
+		if (! strcmp (cmd->args[0], "start")) {
+			pending_call = job_class_start (
+				job_class, &cmd->args[2], (! no_wait),
+				(JobClassStartReply)batch_instance_handler,
+				(NihDBusErrorHandler)batch_error_handler, cmd,
+				NIH_DBUS_TIMEOUT_NEVER);
+		} else if (! strcmp (cmd->args[0], "stop")) {
+			pending_call = job_class_stop (
+				job_class, &cmd->args[2], (! no_wait),
+				(JobClassStopReply)batch_reply_handler,
+				(NihDBusErrorHandler)batch_error_handler, cmd,
+				NIH_DBUS_TIMEOUT_NEVER);
+		} else {
+			pending_call = job_class_restart (
+				job_class, &cmd->args[2], (! no_wait),
+				(JobClassRestartReply)batch_instance_handler,
+				(NihDBusErrorHandler)batch_error_handler, cmd,
+				NIH_DBUS_TIMEOUT_NEVER);
+		}
+	}
+
+	batch_sent (cmd, pending_call);
+}
+
+/**
+ * batch_instance_handler:
+ * @cmd: batch command,
+ * @message: D-Bus message received,
+ * @instance: path of instance started or restarted.
+ *
+ * Called when the start or restart request of @cmd completes.
+ **/
+static void
+batch_instance_handler (BatchCommand   *cmd,
+			NihDBusMessage *message,
+			const char     *instance)
+{
+	nih_assert (instance != NULL);
+
+	batch_reply_handler (cmd, message);
+}
+
+/**
+ * batch_reply_handler:
+ * @cmd: batch command,
+ * @message: D-Bus message received.
+ *
+ * Called when the request of @cmd completes successfully.
+ **/
+static void
+batch_reply_handler (BatchCommand   *cmd,
+		     NihDBusMessage *message)
+{
+	nih_assert (cmd != NULL);
+	nih_assert (message != NULL);
+
+	batch_done (cmd, NULL);
+}
+
+/**
+ * batch_error_handler:
+ * @cmd: batch command,
+ * @message: D-Bus message received.
+ *
+ * Called when the request of @cmd fails, the error is raised.
+ **/
+static void
+batch_error_handler (BatchCommand   *cmd,
+		     NihDBusMessage *message)
+{
+	NihError *err;
+
+	nih_assert (cmd != NULL);
+	nih_assert (message != NULL);
+
+	err = nih_error_get ();
+	batch_done (cmd, err->message);
+	nih_free (err);
+}
+
+
+/**
+ * reload_configuration_action:
+ * @command: NihCommand invoked,
+ * @args: command-line arguments.
+ *
+ * This function is called for the "reload-configuration" command.
+ *
+ * Returns: command exit status.
+ **/
+int
+reload_configuration_action (NihCommand *  command,
+			     char * const *args)
+{
+	nih_local NihDBusProxy *upstart = NULL;
+	NihError *              err;
+
+	nih_assert (command != NULL);
+	nih_assert (args != NULL);
+
+	upstart = upstart_open (NULL);
+	if (! upstart)
+		return 1;
+
+	if (upstart_reload_configuration_sync (NULL, upstart) < 0)
+		goto error;
+
+	return 0;
+
+error:
+	err = nih_error_get ();
+	nih_error ("%s", err->message);
+	nih_free (err);
+
+	return 1;
+}
+
+
+/**
+ * version_action:
+ * @command: NihCommand invoked,
+ * @args: command-line arguments.
+ *
+ * This function is called for the "version" command.
+ *
+ * Returns: command exit status.
+ **/
+int
+version_action (NihCommand *  command,
+		char * const *args)
+{
+	nih_local NihDBusProxy *upstart = NULL;
+	nih_local char *        version = NULL;
+	NihError *              err;
+
+	nih_assert (command != NULL);
+	nih_assert (args != NULL);
+
+	upstart = upstart_open (NULL);
+	if (! upstart)
+		return 1;
+
+	if (upstart_get_version_sync (NULL, upstart, &version) < 0)
+		goto error;
+
+	nih_message ("%s", version);
+
+	return 0;
+
+error:
+	err = nih_error_get ();
+	nih_error ("%s", err->message);
+	nih_free (err);
+
+	return 1;
+}
+
+
+/**
+ * log_priority_action:
+ * @command: NihCommand invoked,
+ * @args: command-line arguments.
+ *
+ * This function is called for the "log-priority" command.
+ *
+ * Returns: command exit status.
+ **/
+int
+log_priority_action (NihCommand *  command,
+		     char * const *args)
+{
+	nih_local NihDBusProxy *upstart = NULL;
+	NihError *              err;
+
+	nih_assert (command != NULL);
+	nih_assert (args != NULL);
+
+	upstart = upstart_open (NULL);
+	if (! upstart)
+		return 1;
+
+	if (args[0]) {
+		if (upstart_set_log_priority_sync (NULL, upstart, args[0]) < 0)
 			goto error;
 	} else {
 		nih_local char *log_priority = NULL;
@@ -1874,6 +2569,66 @@ error:
 }
 
 
+/**
+ * check_config_offline:
+ * @args: command-line arguments.
+ *
+ * Checks the job configuration files in check_config_confdir without a
+ * running init.  Parsing job configuration requires the same code as
+ * init itself so this replaces initctl with init in its check-config
+ * mode, passing on the options given to initctl.
+ *
+ * Returns: command exit status, only on error.
+ **/
+static int
+check_config_offline (char * const *args)
+{
+	nih_local char  **argv = NULL;
+	nih_local char   *ignored = NULL;
+	size_t            argc = 0;
+
+	nih_assert (check_config_confdir);
+
+	argv = NIH_MUST (nih_str_array_new (NULL));
+
+	NIH_MUST (nih_str_array_add (&argv, NULL, &argc, SBINDIR "/init"));
+	NIH_MUST (nih_str_array_add (&argv, NULL, &argc, "--check-config"));
+	NIH_MUST (nih_str_array_add (&argv, NULL, &argc, "--confdir"));
+	NIH_MUST (nih_str_array_add (&argv, NULL, &argc, check_config_confdir));
+
+	if (check_config_warn)
+		NIH_MUST (nih_str_array_add (&argv, NULL, &argc,
+					     "--check-config-warn"));
+
+	if (check_config_data.ignored_events_hash) {
+		NIH_HASH_FOREACH (check_config_data.ignored_events_hash, iter) {
+			NihListEntry *entry = (NihListEntry *)iter;
+
+			if (ignored)
+				NIH_MUST (nih_strcat_sprintf (&ignored, NULL,
+							      ",%s", entry->str));
+			else
+				ignored = NIH_MUST (nih_strdup (NULL, entry->str));
+		}
+	}
+
+	if (ignored) {
+		NIH_MUST (nih_str_array_add (&argv, NULL, &argc,
+					     "--check-config-ignore"));
+		NIH_MUST (nih_str_array_add (&argv, NULL, &argc, ignored));
+	}
+
+	if (args[0])
+		NIH_MUST (nih_str_array_add (&argv, NULL, &argc, args[0]));
+
+	execv (argv[0], argv);
+
+	nih_error ("%s: %s: %s", _("Unable to check configuration"),
+		   argv[0], strerror (errno));
+
+	return 1;
+}
+
 /**
  * check_config_action:
  * @command: NihCommand invoked,
@@ -1891,6 +2646,9 @@ check_config_action (NihCommand *command,
 	char            *no_args[1] = { NULL };
 	char            *job_class  = NULL;
 
+	if (check_config_confdir)
+		return check_config_offline (args);
+
 	check_config_data.job_class_hash = NIH_MUST (nih_hash_string_new (NULL, 0));
 	check_config_data.event_hash     = NIH_MUST (nih_hash_string_new (NULL, 0));
 
@@ -1948,6 +2706,506 @@ check_config_action (NihCommand *command,
 	return ret ? 1 : 0;
 }
 
+/**
+ * analyze_find:
+ * @timeline: timeline received from init,
+ * @before: index of entry to search backwards from,
+ * @name: name of event,
+ * @job: name of job class, or NULL for any,
+ * @instance: name of job instance, or NULL for any.
+ *
+ * Searches @timeline for the most recent entry before @before for the
+ * event @name; when @job or @instance are given, they must match the job
+ * the event was recorded for.
+ *
+ * Returns: index of entry or -1 if not found.
+ **/
+static ssize_t
+analyze_find (UpstartGetTimelineTimelineElement * const *timeline,
+	      ssize_t                                    before,
+	      const char                                *name,
+	      const char                                *job,
+	      const char                                *instance)
+{
+	nih_assert (timeline != NULL);
+	nih_assert (name != NULL);
+
+	for (ssize_t i = before - 1; i >= 0; i--) {
+		if (strcmp (timeline[i]->item0, name))
+			continue;
+		if (job && strcmp (timeline[i]->item1, job))
+			continue;
+		if (instance && strcmp (timeline[i]->item2, instance))
+			continue;
+
+		return i;
+	}
+
+	return -1;
+}
+
+/**
+ * analyze_emitter:
+ * @jobs: hash of AnalyzeJob structures,
+ * @timeline: timeline received from init,
+ * @event: index of event entry.
+ *
+ * The emitter of an event is not recorded, so the job assumed to have
+ * emitted it is the one that most recently began starting before it
+ * among those that declare in their emits stanza that they emit it.
+ *
+ * Returns: index of starting entry of emitting job or -1 if none.
+ **/
+static ssize_t
+analyze_emitter (NihHash                                   *jobs,
+		 UpstartGetTimelineTimelineElement * const *timeline,
+		 ssize_t                                    event)
+{
+	const char *name;
+
+	nih_assert (jobs != NULL);
+	nih_assert (timeline != NULL);
+	nih_assert (event >= 0);
+
+	name = timeline[event]->item0;
+
+	for (ssize_t i = event - 1; i >= 0; i--) {
+		AnalyzeJob *job;
+
+		if ((! *timeline[i]->item1)
+		    || strcmp (timeline[i]->item0, JOB_STARTING_EVENT))
+			continue;
+
+		job = (AnalyzeJob *)nih_hash_lookup (jobs, timeline[i]->item1);
+		if (! job)
+			continue;
+
+		for (char **e = job->emits; e && *e; e++)
+			if (! fnmatch (*e, name, 0))
+				return i;
+	}
+
+	return -1;
+}
+
+/**
+ * analyze_show:
+ * @depth: depth in critical chain,
+ * @name: name of job or event,
+ * @instance: name of job instance, may be NULL,
+ * @state: event emitted by job, may be NULL,
+ * @usec: time the job or event was reached,
+ * @start: time the job began starting, or zero for an event.
+ *
+ * Outputs a single line of a critical chain.
+ **/
+static void
+analyze_show (int         depth,
+	      const char *name,
+	      const char *instance,
+	      const char *state,
+	      uint64_t    usec,
+	      uint64_t    start)
+{
+	nih_local char *line = NULL;
+
+	nih_assert (name != NULL);
+
+	line = NIH_MUST (nih_sprintf (NULL, "%*s%s", depth * 2, "", name));
+
+	if (instance && *instance)
+		NIH_MUST (nih_strcat_sprintf (&line, NULL, " (%s)", instance));
+
+	if (state)
+		NIH_MUST (nih_strcat_sprintf (&line, NULL, " %s", state));
+
+	NIH_MUST (nih_strcat_sprintf (&line, NULL, " @%.3fs",
+				      usec / 1000000.0));
+
+	if (start)
+		NIH_MUST (nih_strcat_sprintf (&line, NULL, " +%.3fs",
+					      (usec - start) / 1000000.0));
+
+	nih_message ("%s", line);
+}
+
+/**
+ * analyze_chain_job:
+ * @jobs: hash of AnalyzeJob structures,
+ * @timeline: timeline received from init,
+ * @index: index of job entry reached,
+ * @start: index of the starting entry of the same job, or -1,
+ * @depth: depth in critical chain.
+ *
+ * Outputs the job that reached the entry @index of @timeline, with the
+ * time taken since it began starting, followed by the chain of events
+ * and jobs that caused it to start.
+ **/
+static void
+analyze_chain_job (NihHash                                   *jobs,
+		   UpstartGetTimelineTimelineElement * const *timeline,
+		   ssize_t                                    index,
+		   ssize_t                                    start,
+		   int                                        depth)
+{
+	UpstartGetTimelineTimelineElement *entry;
+
+	nih_assert (jobs != NULL);
+	nih_assert (timeline != NULL);
+	nih_assert (index >= 0);
+
+	entry = timeline[index];
+
+	if (start < 0)
+		start = analyze_find (timeline, index + 1, JOB_STARTING_EVENT,
+				      entry->item1, entry->item2);
+
+	analyze_show (depth, entry->item1, entry->item2, entry->item0,
+		      entry->item3, start >= 0 ? timeline[start]->item3 : 0);
+
+	if (start >= 0)
+		analyze_chain_gate (jobs, timeline, entry->item1, start,
+				    depth + 1);
+}
+
+/**
+ * analyze_chain_event:
+ * @jobs: hash of AnalyzeJob structures,
+ * @timeline: timeline received from init,
+ * @index: index of event entry,
+ * @depth: depth in critical chain.
+ *
+ * Outputs the event recorded at @index of @timeline followed by the
+ * chain of the job that emitted it.
+ **/
+static void
+analyze_chain_event (NihHash                                   *jobs,
+		     UpstartGetTimelineTimelineElement * const *timeline,
+		     ssize_t                                    index,
+		     int                                        depth)
+{
+	UpstartGetTimelineTimelineElement *entry;
+	ssize_t                            emitter;
+
+	nih_assert (jobs != NULL);
+	nih_assert (timeline != NULL);
+	nih_assert (index >= 0);
+
+	entry = timeline[index];
+
+	analyze_show (depth, entry->item0, NULL, NULL, entry->item3, 0);
+
+	emitter = analyze_emitter (jobs, timeline, index);
+	if (emitter < 0)
+		return;
+
+	analyze_show (depth + 1, timeline[emitter]->item1,
+		      timeline[emitter]->item2, NULL, entry->item3,
+		      timeline[emitter]->item3);
+
+	analyze_chain_gate (jobs, timeline, timeline[emitter]->item1,
+			    emitter, depth + 2);
+}
+
+/**
+ * analyze_chain_gate:
+ * @jobs: hash of AnalyzeJob structures,
+ * @timeline: timeline received from init,
+ * @job: name of job class,
+ * @before: index of starting entry of @job,
+ * @depth: depth in critical chain.
+ *
+ * Of the events and job events named in the start on condition of @job,
+ * the one that happened last before @before is the one that caused the
+ * job to start, and so is the next link of the critical chain.
+ **/
+static void
+analyze_chain_gate (NihHash                                   *jobs,
+		    UpstartGetTimelineTimelineElement * const *timeline,
+		    const char                                *job,
+		    ssize_t                                    before,
+		    int                                        depth)
+{
+	AnalyzeJob *class;
+	ssize_t     gate = -1;
+
+	nih_assert (jobs != NULL);
+	nih_assert (timeline != NULL);
+	nih_assert (job != NULL);
+
+	class = (AnalyzeJob *)nih_hash_lookup (jobs, job);
+	if (! class)
+		return;
+
+	for (char ** const *variant = class->start_on;
+	     variant && *variant && **variant; variant++) {
+		char    *name = NULL;
+		ssize_t  i;
+
+		if (IS_OPERATOR (**variant))
+			continue;
+
+		if (IS_JOB_EVENT (**variant) && (*variant)[1]) {
+			GET_JOB_NAME (name, 0, (*variant)[1]);
+			if (name && (*name == '$'))
+				name = NULL;
+		}
+
+		i = analyze_find (timeline, before, **variant, name, NULL);
+		if (i > gate)
+			gate = i;
+	}
+
+	if (gate < 0)
+		return;
+
+	if (*timeline[gate]->item1) {
+		analyze_chain_job (jobs, timeline, gate, -1, depth);
+	} else {
+		analyze_chain_event (jobs, timeline, gate, depth);
+	}
+}
+
+/**
+ * analyze_critical_chain:
+ * @jobs: hash of AnalyzeJob structures,
+ * @timeline: timeline received from init,
+ * @target: name of job or event, or NULL.
+ *
+ * Outputs the critical chain of @target: the sequence of events and jobs
+ * that each had to happen before the next could, found by following the
+ * start on condition of each job back to whichever of its events
+ * happened last.  Each job is shown with the time it took to start, so
+ * that the jobs delaying @target the most can be identified.
+ *
+ * A job @target is analyzed from the first time it was started, an
+ * event from the first time it was handled; when @target is NULL the
+ * last job to be started is used.
+ *
+ * Returns: zero on success, negative value if @target was never reached.
+ **/
+int
+analyze_critical_chain (NihHash                                   *jobs,
+			UpstartGetTimelineTimelineElement * const *timeline,
+			const char                                *target)
+{
+	ssize_t len = 0;
+
+	nih_assert (jobs != NULL);
+	nih_assert (timeline != NULL);
+
+	while (timeline[len])
+		len++;
+
+	if (! target) {
+		ssize_t i;
+
+		i = analyze_find (timeline, len, JOB_STARTED_EVENT, NULL, NULL);
+		if (i < 0)
+			return -1;
+
+		analyze_chain_job (jobs, timeline, i, -1, 0);
+		return 0;
+	}
+
+	for (ssize_t i = 0; i < len; i++) {
+		if ((! strcmp (timeline[i]->item1, target))
+		    && (! strcmp (timeline[i]->item0, JOB_STARTED_EVENT))) {
+			analyze_chain_job (jobs, timeline, i, -1, 0);
+			return 0;
+		}
+
+		if ((! *timeline[i]->item1)
+		    && (! strcmp (timeline[i]->item0, target))) {
+			analyze_chain_event (jobs, timeline, i, 0);
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+/**
+ * analyze_blame_cmp:
+ * @a: pointer to first pair of timeline entries,
+ * @b: pointer to second pair of timeline entries.
+ *
+ * Compare function for qsort() ordering pairs of starting and started
+ * entries by the time taken between them, longest first.
+ *
+ * Returns: integer less than, equal to or greater than zero if @a took
+ * longer than, as long as or less long than @b.
+ **/
+static int
+analyze_blame_cmp (const void *a,
+		   const void *b)
+{
+	UpstartGetTimelineTimelineElement * const *pa = a;
+	UpstartGetTimelineTimelineElement * const *pb = b;
+	uint64_t                                   da, db;
+
+	da = pa[1]->item3 - pa[0]->item3;
+	db = pb[1]->item3 - pb[0]->item3;
+
+	return (da < db) - (da > db);
+}
+
+/**
+ * analyze_blame:
+ * @timeline: timeline received from init.
+ *
+ * Outputs every job instance that was started, with the time it took
+ * from its starting event to its started event, longest first.
+ **/
+void
+analyze_blame (UpstartGetTimelineTimelineElement * const *timeline)
+{
+	nih_local UpstartGetTimelineTimelineElement **pairs = NULL;
+	size_t                                        len = 0, num = 0;
+
+	nih_assert (timeline != NULL);
+
+	while (timeline[len])
+		len++;
+
+	pairs = NIH_MUST (nih_alloc (NULL, sizeof (UpstartGetTimelineTimelineElement *)
+				     * 2 * (len + 1)));
+
+	for (size_t i = 0; i < len; i++) {
+		ssize_t start;
+
+		if ((! *timeline[i]->item1)
+		    || strcmp (timeline[i]->item0, JOB_STARTED_EVENT))
+			continue;
+
+		start = analyze_find (timeline, i, JOB_STARTING_EVENT,
+				      timeline[i]->item1, timeline[i]->item2);
+		if (start < 0)
+			continue;
+
+		pairs[num * 2] = timeline[start];
+		pairs[num * 2 + 1] = timeline[i];
+		num++;
+	}
+
+	qsort (pairs, num, sizeof (UpstartGetTimelineTimelineElement *) * 2,
+	       analyze_blame_cmp);
+
+	for (size_t i = 0; i < num; i++) {
+		UpstartGetTimelineTimelineElement *started = pairs[i * 2 + 1];
+
+		if (*started->item2) {
+			nih_message ("%10.3fs %s (%s)",
+				     (started->item3 - pairs[i * 2]->item3) / 1000000.0,
+				     started->item1, started->item2);
+		} else {
+			nih_message ("%10.3fs %s",
+				     (started->item3 - pairs[i * 2]->item3) / 1000000.0,
+				     started->item1);
+		}
+	}
+}
+
+/**
+ * analyze_action:
+ * @command: NihCommand invoked,
+ * @args: command-line arguments.
+ *
+ * This function is called for the "analyze" command.
+ *
+ * The "critical-chain" analysis combines the timeline of events and job
+ * state changes recorded by init with the start on conditions of the
+ * job classes, see analyze_critical_chain(); the "blame" analysis lists
+ * the time each job took to start, see analyze_blame().
+ *
+ * Returns: command exit status.
+ **/
+int
+analyze_action (NihCommand *  command,
+		char * const *args)
+{
+	nih_local NihDBusProxy *                       upstart = NULL;
+	nih_local UpstartGetTimelineTimelineElement ** timeline = NULL;
+	nih_local char **                              job_class_paths = NULL;
+	nih_local NihHash *                            jobs = NULL;
+	NihError *                                     err;
+
+	nih_assert (command != NULL);
+	nih_assert (args != NULL);
+
+	if ((! args[0])
+	    || (strcmp (args[0], "critical-chain") && strcmp (args[0], "blame"))
+	    || ((! strcmp (args[0], "blame")) && args[1])
+	    || (args[1] && args[2])) {
+		fprintf (stderr, _("%s: invalid analysis\n"), program_name);
+		nih_main_suggest_help ();
+		return 1;
+	}
+
+	upstart = upstart_open (NULL);
+	if (! upstart)
+		return 1;
+
+	if (upstart_get_timeline_sync (NULL, upstart, &timeline) < 0)
+		goto error;
+
+	if (! strcmp (args[0], "blame")) {
+		analyze_blame (timeline);
+		return 0;
+	}
+
+	/* Obtain the start on condition and emits of every job */
+	jobs = NIH_MUST (nih_hash_string_new (NULL, 0));
+
+	if (upstart_get_all_jobs_sync (NULL, upstart, &job_class_paths) < 0)
+		goto error;
+
+	for (char **job_class_path = job_class_paths;
+	     job_class_path && *job_class_path; job_class_path++) {
+		nih_local NihDBusProxy *job_class = NULL;
+		JobClassProperties *    props = NULL;
+		AnalyzeJob *            job;
+
+		job_class = nih_dbus_proxy_new (NULL, upstart->connection,
+						upstart->name, *job_class_path,
+						NULL, NULL);
+		if (! job_class)
+			goto error;
+
+		job_class->auto_start = FALSE;
+
+		job = NIH_MUST (nih_new (jobs, AnalyzeJob));
+		nih_list_init (&job->entry);
+		nih_alloc_set_destructor (job, nih_list_destroy);
+
+		if (job_class_get_all_sync (job, job_class, &props) < 0) {
+			nih_free (job);
+			goto error;
+		}
+
+		job->name = props->name;
+		job->start_on = props->start_on;
+		job->emits = props->emits;
+
+		nih_hash_add (jobs, &job->entry);
+	}
+
+	if (analyze_critical_chain (jobs, timeline, args[1]) < 0) {
+		nih_error ("%s: %s", _("Not reached since boot"),
+			   args[1] ? args[1] : JOB_STARTED_EVENT);
+		return 1;
+	}
+
+	return 0;
+
+error:
+	err = nih_error_get ();
+	nih_error ("%s", err->message);
+	nih_free (err);
+
+	return 1;
+}
+
 /**
  * notify_disk_writeable_action:
  * @command: NihCommand invoked,
@@ -2935,6 +4193,9 @@ NihOption reload_options[] = {
  * Command-line options accepted for the status command.
  **/
 NihOption status_options[] = {
+	{ 0, "stats", N_("show resource usage and start latencies of the instance"),
+	  NULL, NULL, &show_stats, NULL },
+
 	NIH_OPTION_LAST
 };
 
@@ -2959,6 +4220,20 @@ NihOption emit_options[] = {
 	NIH_OPTION_LAST
 };
 
+/**
+ * batch_options:
+ *
+ * Command-line options accepted for the batch command.
+ **/
+NihOption batch_options[] = {
+	{ 'n', "no-wait", N_("do not wait for each job or event to finish"),
+	  NULL, NULL, &no_wait, NULL },
+	{ 'w', "window", N_("maximum number of commands awaiting a reply"),
+	  NULL, "NUMBER", &batch_window, nih_option_int },
+
+	NIH_OPTION_LAST
+};
+
 /**
  * reload_configuration_options:
  *
@@ -3011,6 +4286,17 @@ NihOption check_config_options[] = {
 	  NULL, "EVENT_LIST", NULL, ignored_events_setter },
 	{ 'w', "warn", N_("Generate warning for any unreachable events/jobs"),
 	  NULL, NULL, &check_config_warn, NULL },
+	{ 0, "confdir", N_("check job configuration in DIR without a running init"),
+	  NULL, "DIR", &check_config_confdir, NULL },
+	NIH_OPTION_LAST
+};
+
+/**
+ * analyze_options:
+ *
+ * Command-line options accepted for the analyze command.
+ **/
+NihOption analyze_options[] = {
 	NIH_OPTION_LAST
 };
 
@@ -3167,6 +4453,18 @@ static NihCommand commands[] = {
 	     "to be included in the event.\n"),
 	  &event_commands, emit_options, emit_action },
 
+	{ "batch", N_("[FILE]"),
+	  N_("Run many commands over one connection."),
+	  N_("Reads start, stop, restart and emit commands, one per line "
+	     "with the same arguments as the commands themselves, from "
+	     "FILE or standard input if not given or \"-\".  Blank lines "
+	     "and lines beginning with '#' are ignored.\n"
+	     "\n"
+	     "Commands are issued without waiting for earlier ones to "
+	     "finish, up to the --window limit, and the result of each "
+	     "is reported as it completes."),
+	  NULL, batch_options, batch_action },
+
 	{ "reload-configuration", NULL,
 	  N_("Reload the configuration of the init daemon."),
 	  NULL,
@@ -3207,6 +4505,14 @@ static NihCommand commands[] = {
 	     "currently available job configuration files."),
 	  NULL, check_config_options, check_config_action },
 
+	{ "analyze", N_("critical-chain [JOB|EVENT] | blame"),
+	  N_("Analyze the time taken to start jobs since boot."),
+	  N_("critical-chain shows the chain of jobs and events that "
+	     "JOB or EVENT, or the last job to start, waited for with the "
+	     "time each job took to start.  blame lists the time every job "
+	     "took to start, longest first."),
+	  NULL, analyze_options, analyze_action },
+
 	{ "get-env", N_("VARIABLE"),
 	  N_("Retrieve value of a job environment variable."),
 	  N_("Display the value of a variable from the job environment table."),
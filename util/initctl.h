@@ -381,6 +381,42 @@ typedef struct condition_handler_data {
 } ConditionHandlerData;
 
 
+/**
+ * AnalyzeJob:
+ *
+ * @entry: hash entry,
+ * @name: name of job class,
+ * @start_on: start on condition in Reverse Polish Notation,
+ * @emits: events the job class declares that it emits.
+ *
+ * Job class details used by the analyze command, kept in a hash indexed
+ * by @name.
+ **/
+typedef struct analyze_job {
+	NihList     entry;
+	char       *name;
+	char     ***start_on;
+	char      **emits;
+} AnalyzeJob;
+
+
+/**
+ * BatchCommand:
+ *
+ * @entry: list header,
+ * @line: command as read, used when reporting its result,
+ * @args: @line split into command name and arguments.
+ *
+ * Command read by the batch command.
+ **/
+typedef struct batch_command {
+	NihList   entry;
+
+	char     *line;
+	char    **args;
+} BatchCommand;
+
+
 /**
  * ExprNode:
  *
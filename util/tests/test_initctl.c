@@ -26,6 +26,7 @@
 
 #include <dbus/dbus.h>
 
+#include <stdarg.h>
 #include <stdio.h>
 #include <signal.h>
 #include <unistd.h>
@@ -48,11 +49,14 @@
 #include <nih/error.h>
 #include <nih/file.h>
 #include <nih/string.h>
+#include <nih/hash.h>
 
 #include "dbus/upstart.h"
 
 #include "com.ubuntu.Upstart.h"
 
+#include "initctl.h"
+
 #include "test_util_common.h"
 
 extern int use_dbus;
@@ -75,10 +79,17 @@ extern int reload_action               (NihCommand *command, char * const *args)
 extern int status_action               (NihCommand *command, char * const *args);
 extern int list_action                 (NihCommand *command, char * const *args);
 extern int emit_action                 (NihCommand *command, char * const *args);
+extern int batch_action                (NihCommand *command, char * const *args);
 extern int reload_configuration_action (NihCommand *command, char * const *args);
 extern int version_action              (NihCommand *command, char * const *args);
 extern int log_priority_action         (NihCommand *command, char * const *args);
 extern int usage_action                (NihCommand *command, char * const *args);
+extern int analyze_critical_chain      (NihHash *jobs,
+					UpstartGetTimelineTimelineElement * const *timeline,
+					const char *target);
+extern void analyze_blame              (UpstartGetTimelineTimelineElement * const *timeline);
+extern char *job_status_add_stats       (char **str, const void *parent,
+					JobGetStatsStatsElement * const *stats);
 
 
 static int my_connect_handler_called = FALSE;
@@ -3321,6 +3332,57 @@ test_job_status (void)
 }
 
 
+void
+test_job_status_add_stats (void)
+{
+	JobGetStatsStatsElement  cpu = { (char *)"cpu_usec", 1500000 };
+	JobGetStatsStatsElement  rss = { (char *)"max_rss_kb", 2048 };
+	JobGetStatsStatsElement *stats[] = { &cpu, &rss, NULL };
+	JobGetStatsStatsElement *none[] = { NULL };
+	char                    *str, *ret;
+
+	TEST_FUNCTION ("job_status_add_stats");
+
+
+	/* Check that each statistic is appended to the status on a line
+	 * of its own as its name and value.
+	 */
+	TEST_FEATURE ("with statistics");
+	TEST_ALLOC_FAIL {
+		TEST_ALLOC_SAFE {
+			str = nih_strdup (NULL, "foo start/running, process 1234");
+		}
+
+		ret = job_status_add_stats (&str, NULL, stats);
+
+		if (test_alloc_failed) {
+			TEST_EQ_P (ret, NULL);
+			nih_free (str);
+			continue;
+		}
+
+		TEST_EQ_P (ret, str);
+		TEST_EQ_STR (str, ("foo start/running, process 1234\n"
+				   "\tcpu_usec 1500000\n"
+				   "\tmax_rss_kb 2048"));
+
+		nih_free (str);
+	}
+
+
+	/* Check that the status is unchanged without any statistics. */
+	TEST_FEATURE ("without statistics");
+	str = nih_strdup (NULL, "foo start/running, process 1234");
+
+	ret = job_status_add_stats (&str, NULL, none);
+
+	TEST_EQ_P (ret, str);
+	TEST_EQ_STR (str, "foo start/running, process 1234");
+
+	nih_free (str);
+}
+
+
 void
 test_start_action (void)
 {
@@ -9178,6 +9240,91 @@ test_reload_action (void)
 }
 
 
+/**
+ * append_job_status:
+ * @arrayiter: iterator for array of status structures,
+ * @job_class: name of job class,
+ * @name: name of instance,
+ * @goal: goal of instance,
+ * @state: state of instance,
+ * @...: pairs of process name and pid, terminated by NULL.
+ *
+ * Append a structure of the form returned by the GetAllJobStatus method
+ * to @arrayiter.
+ **/
+static void
+append_job_status (DBusMessageIter *arrayiter,
+		   const char      *job_class,
+		   const char      *name,
+		   const char      *goal,
+		   const char      *state,
+		   ...)
+{
+	DBusMessageIter structiter;
+	DBusMessageIter prociter;
+	DBusMessageIter subiter;
+	const char *    process;
+	int32_t         pid;
+	va_list         ap;
+
+	dbus_message_iter_open_container (arrayiter, DBUS_TYPE_STRUCT,
+					  NULL, &structiter);
+
+	dbus_message_iter_append_basic (&structiter, DBUS_TYPE_STRING,
+					&job_class);
+	dbus_message_iter_append_basic (&structiter, DBUS_TYPE_STRING,
+					&name);
+	dbus_message_iter_append_basic (&structiter, DBUS_TYPE_STRING,
+					&goal);
+	dbus_message_iter_append_basic (&structiter, DBUS_TYPE_STRING,
+					&state);
+
+	dbus_message_iter_open_container (&structiter, DBUS_TYPE_ARRAY,
+					  (DBUS_STRUCT_BEGIN_CHAR_AS_STRING
+					   DBUS_TYPE_STRING_AS_STRING
+					   DBUS_TYPE_INT32_AS_STRING
+					   DBUS_STRUCT_END_CHAR_AS_STRING),
+					  &prociter);
+
+	va_start (ap, state);
+	while ((process = va_arg (ap, const char *)) != NULL) {
+		pid = va_arg (ap, int32_t);
+
+		dbus_message_iter_open_container (&prociter, DBUS_TYPE_STRUCT,
+						  NULL, &subiter);
+
+		dbus_message_iter_append_basic (&subiter, DBUS_TYPE_STRING,
+						&process);
+		dbus_message_iter_append_basic (&subiter, DBUS_TYPE_INT32,
+						&pid);
+
+		dbus_message_iter_close_container (&prociter, &subiter);
+	}
+	va_end (ap);
+
+	dbus_message_iter_close_container (&structiter, &prociter);
+
+	dbus_message_iter_close_container (arrayiter, &structiter);
+}
+
+/**
+ * JOB_STATUS_SIGNATURE:
+ *
+ * D-Bus signature of each structure returned by GetAllJobStatus.
+ **/
+#define JOB_STATUS_SIGNATURE			\
+	(DBUS_STRUCT_BEGIN_CHAR_AS_STRING	\
+	 DBUS_TYPE_STRING_AS_STRING		\
+	 DBUS_TYPE_STRING_AS_STRING		\
+	 DBUS_TYPE_STRING_AS_STRING		\
+	 DBUS_TYPE_STRING_AS_STRING		\
+	 DBUS_TYPE_ARRAY_AS_STRING		\
+	 DBUS_STRUCT_BEGIN_CHAR_AS_STRING	\
+	 DBUS_TYPE_STRING_AS_STRING		\
+	 DBUS_TYPE_INT32_AS_STRING		\
+	 DBUS_STRUCT_END_CHAR_AS_STRING		\
+	 DBUS_STRUCT_END_CHAR_AS_STRING)
+
 void
 test_status_action (void)
 {
@@ -9237,6 +9384,31 @@ test_status_action (void)
 	TEST_FEATURE ("with single argument");
 	TEST_ALLOC_FAIL {
 		TEST_CHILD (server_pid) {
+			/* Expect the GetAllJobStatus method call on the
+			 * manager object, reply with an error as an older
+			 * init would so that the job is queried directly.
+			 */
+			TEST_DBUS_MESSAGE (server_conn, method_call);
+
+			TEST_TRUE (dbus_message_is_method_call (method_call,
+								DBUS_INTERFACE_UPSTART,
+								"GetAllJobStatus"));
+
+			TEST_EQ_STR (dbus_message_get_path (method_call),
+							    DBUS_PATH_UPSTART);
+
+			TEST_ALLOC_SAFE {
+				reply = dbus_message_new_error (method_call,
+								DBUS_ERROR_UNKNOWN_METHOD,
+								"Unknown method");
+			}
+
+			dbus_connection_send (server_conn, reply, NULL);
+			dbus_connection_flush (server_conn);
+
+			dbus_message_unref (method_call);
+			dbus_message_unref (reply);
+
 			/* Expect the GetJobByName method call on the
 			 * manager object, make sure the job name is passed
 			 * and reply with a path.
@@ -9545,39 +9717,42 @@ test_status_action (void)
 	}
 
 
-	/* Check that additional arguments to the status action are passed
-	 * as entries in the environment to GetInstance.
+	/* Check that the status action with a single argument finds the
+	 * instance in the reply to the GetAllJobStatus method call and
+	 * outputs its status without making any further calls.
 	 */
-	TEST_FEATURE ("with multiple arguments");
+	TEST_FEATURE ("with single argument and GetAllJobStatus reply");
 	TEST_ALLOC_FAIL {
 		TEST_CHILD (server_pid) {
-			/* Expect the GetJobByName method call on the
-			 * manager object, make sure the job name is passed
-			 * and reply with a path.
+			/* Expect the GetAllJobStatus method call on the
+			 * manager object, reply with the status of the
+			 * job and of others.
 			 */
 			TEST_DBUS_MESSAGE (server_conn, method_call);
 
 			TEST_TRUE (dbus_message_is_method_call (method_call,
 								DBUS_INTERFACE_UPSTART,
-								"GetJobByName"));
+								"GetAllJobStatus"));
 
 			TEST_EQ_STR (dbus_message_get_path (method_call),
 							    DBUS_PATH_UPSTART);
 
-			TEST_TRUE (dbus_message_get_args (method_call, NULL,
-							  DBUS_TYPE_STRING, &name_value,
-							  DBUS_TYPE_INVALID));
-
-			TEST_EQ_STR (name_value, "test");
-
 			TEST_ALLOC_SAFE {
 				reply = dbus_message_new_method_return (method_call);
 
-				str_value = DBUS_PATH_UPSTART "/jobs/test";
+				dbus_message_iter_init_append (reply, &iter);
 
-				dbus_message_append_args (reply,
-							  DBUS_TYPE_OBJECT_PATH, &str_value,
-							  DBUS_TYPE_INVALID);
+				dbus_message_iter_open_container (&iter, DBUS_TYPE_ARRAY,
+								  JOB_STATUS_SIGNATURE,
+								  &arrayiter);
+
+				append_job_status (&arrayiter, "frodo", "",
+						   "stop", "waiting", NULL);
+				append_job_status (&arrayiter, "test", "",
+						   "start", "running",
+						   "main", 3648, NULL);
+
+				dbus_message_iter_close_container (&iter, &arrayiter);
 			}
 
 			dbus_connection_send (server_conn, reply, NULL);
@@ -9586,36 +9761,89 @@ test_status_action (void)
 			dbus_message_unref (method_call);
 			dbus_message_unref (reply);
 
-			/* Expect the GetInstance method call on the
-			 * job object, make sure the environment args are
-			 * passed and reply with a path.
+			TEST_DBUS_CLOSE (server_conn);
+
+			dbus_shutdown ();
+
+			exit (0);
+		}
+
+		memset (&command, 0, sizeof command);
+
+		args[0] = "test";
+		args[1] = NULL;
+
+		TEST_DIVERT_STDOUT (output) {
+			TEST_DIVERT_STDERR (errors) {
+				ret = status_action (&command, args);
+			}
+		}
+		rewind (output);
+		rewind (errors);
+
+		if (test_alloc_failed
+		    && (ret != 0)) {
+			TEST_FILE_END (output);
+			TEST_FILE_RESET (output);
+
+			TEST_FILE_EQ (errors, "test: Cannot allocate memory\n");
+			TEST_FILE_END (errors);
+			TEST_FILE_RESET (errors);
+
+			kill (server_pid, SIGTERM);
+			waitpid (server_pid, NULL, 0);
+			continue;
+		}
+
+		TEST_EQ (ret, 0);
+
+		TEST_FILE_EQ (output, "test start/running, process 3648\n");
+		TEST_FILE_END (output);
+		TEST_FILE_RESET (output);
+
+		TEST_FILE_END (errors);
+		TEST_FILE_RESET (errors);
+
+		waitpid (server_pid, &status, 0);
+		TEST_TRUE (WIFEXITED (status));
+		TEST_EQ (WEXITSTATUS (status), 0);
+	}
+
+
+	/* Check that a job listed without instances in the reply to the
+	 * GetAllJobStatus method call is still looked up with GetInstance,
+	 * so that an instance job whose name cannot be expanded gives the
+	 * same error as before rather than being shown as stopped.
+	 */
+	TEST_FEATURE ("with no instances in GetAllJobStatus reply");
+	TEST_ALLOC_FAIL {
+		TEST_CHILD (server_pid) {
+			/* Expect the GetAllJobStatus method call on the
+			 * manager object, reply with the job listed with
+			 * no instances.
 			 */
 			TEST_DBUS_MESSAGE (server_conn, method_call);
 
 			TEST_TRUE (dbus_message_is_method_call (method_call,
-								DBUS_INTERFACE_UPSTART_JOB,
-								"GetInstance"));
+								DBUS_INTERFACE_UPSTART,
+								"GetAllJobStatus"));
 
 			TEST_EQ_STR (dbus_message_get_path (method_call),
-							    DBUS_PATH_UPSTART "/jobs/test");
-
-			TEST_TRUE (dbus_message_get_args (method_call, NULL,
-							  DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &args_value, &args_elements,
-							  DBUS_TYPE_INVALID));
-
-			TEST_EQ (args_elements, 2);
-			TEST_EQ_STR (args_value[0], "FOO=foo");
-			TEST_EQ_STR (args_value[1], "BAR=bar");
-			dbus_free_string_array (args_value);
+							    DBUS_PATH_UPSTART);
 
 			TEST_ALLOC_SAFE {
 				reply = dbus_message_new_method_return (method_call);
 
-				str_value = DBUS_PATH_UPSTART "/jobs/test/_";
+				dbus_message_iter_init_append (reply, &iter);
 
-				dbus_message_append_args (reply,
-							  DBUS_TYPE_OBJECT_PATH, &str_value,
-							  DBUS_TYPE_INVALID);
+				dbus_message_iter_open_container (&iter, DBUS_TYPE_ARRAY,
+								  JOB_STATUS_SIGNATURE,
+								  &arrayiter);
+
+				append_job_status (&arrayiter, "test", "",
+						   "stop", "waiting", NULL);
+
+				dbus_message_iter_close_container (&iter, &arrayiter);
 			}
 
 			dbus_connection_send (server_conn, reply, NULL);
@@ -9624,40 +9852,33 @@ test_status_action (void)
 			dbus_message_unref (method_call);
 			dbus_message_unref (reply);
 
-			/* Expect the Get call for the job name, reply with
-			 * the name.
+			/* Expect the GetJobByName method call on the
+			 * manager object, make sure the job name is passed
+			 * and reply with a path.
 			 */
 			TEST_DBUS_MESSAGE (server_conn, method_call);
 
 			TEST_TRUE (dbus_message_is_method_call (method_call,
-								DBUS_INTERFACE_PROPERTIES,
-								"Get"));
+								DBUS_INTERFACE_UPSTART,
+								"GetJobByName"));
 
 			TEST_EQ_STR (dbus_message_get_path (method_call),
-				     DBUS_PATH_UPSTART "/jobs/test");
+							    DBUS_PATH_UPSTART);
 
 			TEST_TRUE (dbus_message_get_args (method_call, NULL,
-							  DBUS_TYPE_STRING, &interface,
-							  DBUS_TYPE_STRING, &property,
+							  DBUS_TYPE_STRING, &name_value,
 							  DBUS_TYPE_INVALID));
 
-			TEST_EQ_STR (interface, DBUS_INTERFACE_UPSTART_JOB);
-			TEST_EQ_STR (property, "name");
+			TEST_EQ_STR (name_value, "test");
 
 			TEST_ALLOC_SAFE {
 				reply = dbus_message_new_method_return (method_call);
 
-				dbus_message_iter_init_append (reply, &iter);
-
-				dbus_message_iter_open_container (&iter, DBUS_TYPE_VARIANT,
-								  DBUS_TYPE_STRING_AS_STRING,
-								  &subiter);
-
-				str_value = "test";
-				dbus_message_iter_append_basic (&subiter, DBUS_TYPE_STRING,
-								&str_value);
+				str_value = DBUS_PATH_UPSTART "/jobs/test";
 
-				dbus_message_iter_close_container (&iter, &subiter);
+				dbus_message_append_args (reply,
+							  DBUS_TYPE_OBJECT_PATH, &str_value,
+							  DBUS_TYPE_INVALID);
 			}
 
 			dbus_connection_send (server_conn, reply, NULL);
@@ -9666,60 +9887,247 @@ test_status_action (void)
 			dbus_message_unref (method_call);
 			dbus_message_unref (reply);
 
-			/* Expect the GetAll call for the instance properties,
-			 * reply with the properties.
+			/* Expect the GetInstance method call on the
+			 * job object and reply with the error init gives
+			 * when the instance name cannot be expanded.
 			 */
 			TEST_DBUS_MESSAGE (server_conn, method_call);
 
 			TEST_TRUE (dbus_message_is_method_call (method_call,
-								DBUS_INTERFACE_PROPERTIES,
-								"GetAll"));
+								DBUS_INTERFACE_UPSTART_JOB,
+								"GetInstance"));
 
 			TEST_EQ_STR (dbus_message_get_path (method_call),
-				     DBUS_PATH_UPSTART "/jobs/test/_");
+							    DBUS_PATH_UPSTART "/jobs/test");
 
 			TEST_TRUE (dbus_message_get_args (method_call, NULL,
-							  DBUS_TYPE_STRING, &interface,
+							  DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &args_value, &args_elements,
 							  DBUS_TYPE_INVALID));
 
-			TEST_EQ_STR (interface, DBUS_INTERFACE_UPSTART_INSTANCE);
+			TEST_EQ (args_elements, 0);
+			dbus_free_string_array (args_value);
 
 			TEST_ALLOC_SAFE {
-				reply = dbus_message_new_method_return (method_call);
+				reply = dbus_message_new_error (method_call,
+								DBUS_ERROR_INVALID_ARGS,
+								"Unknown parameter: TTY");
+			}
 
-				dbus_message_iter_init_append (reply, &iter);
+			dbus_connection_send (server_conn, reply, NULL);
+			dbus_connection_flush (server_conn);
 
-				dbus_message_iter_open_container (&iter, DBUS_TYPE_ARRAY,
-								  (DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
-								   DBUS_TYPE_STRING_AS_STRING
-								   DBUS_TYPE_VARIANT_AS_STRING
-								   DBUS_DICT_ENTRY_END_CHAR_AS_STRING),
-								  &arrayiter);
+			dbus_message_unref (method_call);
+			dbus_message_unref (reply);
 
-				/* Name */
-				dbus_message_iter_open_container (&arrayiter, DBUS_TYPE_DICT_ENTRY,
-								  NULL,
-								  &dictiter);
+			TEST_DBUS_CLOSE (server_conn);
 
-				str_value = "name";
-				dbus_message_iter_append_basic (&dictiter, DBUS_TYPE_STRING,
-								&str_value);
+			dbus_shutdown ();
 
-				dbus_message_iter_open_container (&dictiter, DBUS_TYPE_VARIANT,
-								  DBUS_TYPE_STRING_AS_STRING,
-								  &subiter);
+			exit (0);
+		}
 
-				str_value = "";
-				dbus_message_iter_append_basic (&subiter, DBUS_TYPE_STRING,
-								&str_value);
+		memset (&command, 0, sizeof command);
 
-				dbus_message_iter_close_container (&dictiter, &subiter);
+		args[0] = "test";
+		args[1] = NULL;
 
-				dbus_message_iter_close_container (&arrayiter, &dictiter);
+		TEST_DIVERT_STDOUT (output) {
+			TEST_DIVERT_STDERR (errors) {
+				ret = status_action (&command, args);
+			}
+		}
+		rewind (output);
+		rewind (errors);
 
-				/* Goal */
-				dbus_message_iter_open_container (&arrayiter, DBUS_TYPE_DICT_ENTRY,
-								  NULL,
+		TEST_GT (ret, 0);
+
+		TEST_FILE_END (output);
+		TEST_FILE_RESET (output);
+
+		TEST_FILE_MATCH (errors, "test: *\n");
+		TEST_FILE_END (errors);
+		TEST_FILE_RESET (errors);
+
+		kill (server_pid, SIGTERM);
+		waitpid (server_pid, NULL, 0);
+	}
+
+
+	/* Check that additional arguments to the status action are passed
+	 * as entries in the environment to GetInstance.
+	 */
+	TEST_FEATURE ("with multiple arguments");
+	TEST_ALLOC_FAIL {
+		TEST_CHILD (server_pid) {
+			/* Expect the GetJobByName method call on the
+			 * manager object, make sure the job name is passed
+			 * and reply with a path.
+			 */
+			TEST_DBUS_MESSAGE (server_conn, method_call);
+
+			TEST_TRUE (dbus_message_is_method_call (method_call,
+								DBUS_INTERFACE_UPSTART,
+								"GetJobByName"));
+
+			TEST_EQ_STR (dbus_message_get_path (method_call),
+							    DBUS_PATH_UPSTART);
+
+			TEST_TRUE (dbus_message_get_args (method_call, NULL,
+							  DBUS_TYPE_STRING, &name_value,
+							  DBUS_TYPE_INVALID));
+
+			TEST_EQ_STR (name_value, "test");
+
+			TEST_ALLOC_SAFE {
+				reply = dbus_message_new_method_return (method_call);
+
+				str_value = DBUS_PATH_UPSTART "/jobs/test";
+
+				dbus_message_append_args (reply,
+							  DBUS_TYPE_OBJECT_PATH, &str_value,
+							  DBUS_TYPE_INVALID);
+			}
+
+			dbus_connection_send (server_conn, reply, NULL);
+			dbus_connection_flush (server_conn);
+
+			dbus_message_unref (method_call);
+			dbus_message_unref (reply);
+
+			/* Expect the GetInstance method call on the
+			 * job object, make sure the environment args are
+			 * passed and reply with a path.
+			 */
+			TEST_DBUS_MESSAGE (server_conn, method_call);
+
+			TEST_TRUE (dbus_message_is_method_call (method_call,
+								DBUS_INTERFACE_UPSTART_JOB,
+								"GetInstance"));
+
+			TEST_EQ_STR (dbus_message_get_path (method_call),
+							    DBUS_PATH_UPSTART "/jobs/test");
+
+			TEST_TRUE (dbus_message_get_args (method_call, NULL,
+							  DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &args_value, &args_elements,
+							  DBUS_TYPE_INVALID));
+
+			TEST_EQ (args_elements, 2);
+			TEST_EQ_STR (args_value[0], "FOO=foo");
+			TEST_EQ_STR (args_value[1], "BAR=bar");
+			dbus_free_string_array (args_value);
+
+			TEST_ALLOC_SAFE {
+				reply = dbus_message_new_method_return (method_call);
+
+				str_value = DBUS_PATH_UPSTART "/jobs/test/_";
+
+				dbus_message_append_args (reply,
+							  DBUS_TYPE_OBJECT_PATH, &str_value,
+							  DBUS_TYPE_INVALID);
+			}
+
+			dbus_connection_send (server_conn, reply, NULL);
+			dbus_connection_flush (server_conn);
+
+			dbus_message_unref (method_call);
+			dbus_message_unref (reply);
+
+			/* Expect the Get call for the job name, reply with
+			 * the name.
+			 */
+			TEST_DBUS_MESSAGE (server_conn, method_call);
+
+			TEST_TRUE (dbus_message_is_method_call (method_call,
+								DBUS_INTERFACE_PROPERTIES,
+								"Get"));
+
+			TEST_EQ_STR (dbus_message_get_path (method_call),
+				     DBUS_PATH_UPSTART "/jobs/test");
+
+			TEST_TRUE (dbus_message_get_args (method_call, NULL,
+							  DBUS_TYPE_STRING, &interface,
+							  DBUS_TYPE_STRING, &property,
+							  DBUS_TYPE_INVALID));
+
+			TEST_EQ_STR (interface, DBUS_INTERFACE_UPSTART_JOB);
+			TEST_EQ_STR (property, "name");
+
+			TEST_ALLOC_SAFE {
+				reply = dbus_message_new_method_return (method_call);
+
+				dbus_message_iter_init_append (reply, &iter);
+
+				dbus_message_iter_open_container (&iter, DBUS_TYPE_VARIANT,
+								  DBUS_TYPE_STRING_AS_STRING,
+								  &subiter);
+
+				str_value = "test";
+				dbus_message_iter_append_basic (&subiter, DBUS_TYPE_STRING,
+								&str_value);
+
+				dbus_message_iter_close_container (&iter, &subiter);
+			}
+
+			dbus_connection_send (server_conn, reply, NULL);
+			dbus_connection_flush (server_conn);
+
+			dbus_message_unref (method_call);
+			dbus_message_unref (reply);
+
+			/* Expect the GetAll call for the instance properties,
+			 * reply with the properties.
+			 */
+			TEST_DBUS_MESSAGE (server_conn, method_call);
+
+			TEST_TRUE (dbus_message_is_method_call (method_call,
+								DBUS_INTERFACE_PROPERTIES,
+								"GetAll"));
+
+			TEST_EQ_STR (dbus_message_get_path (method_call),
+				     DBUS_PATH_UPSTART "/jobs/test/_");
+
+			TEST_TRUE (dbus_message_get_args (method_call, NULL,
+							  DBUS_TYPE_STRING, &interface,
+							  DBUS_TYPE_INVALID));
+
+			TEST_EQ_STR (interface, DBUS_INTERFACE_UPSTART_INSTANCE);
+
+			TEST_ALLOC_SAFE {
+				reply = dbus_message_new_method_return (method_call);
+
+				dbus_message_iter_init_append (reply, &iter);
+
+				dbus_message_iter_open_container (&iter, DBUS_TYPE_ARRAY,
+								  (DBUS_DICT_ENTRY_BEGIN_CHAR_AS_STRING
+								   DBUS_TYPE_STRING_AS_STRING
+								   DBUS_TYPE_VARIANT_AS_STRING
+								   DBUS_DICT_ENTRY_END_CHAR_AS_STRING),
+								  &arrayiter);
+
+				/* Name */
+				dbus_message_iter_open_container (&arrayiter, DBUS_TYPE_DICT_ENTRY,
+								  NULL,
+								  &dictiter);
+
+				str_value = "name";
+				dbus_message_iter_append_basic (&dictiter, DBUS_TYPE_STRING,
+								&str_value);
+
+				dbus_message_iter_open_container (&dictiter, DBUS_TYPE_VARIANT,
+								  DBUS_TYPE_STRING_AS_STRING,
+								  &subiter);
+
+				str_value = "";
+				dbus_message_iter_append_basic (&subiter, DBUS_TYPE_STRING,
+								&str_value);
+
+				dbus_message_iter_close_container (&dictiter, &subiter);
+
+				dbus_message_iter_close_container (&arrayiter, &dictiter);
+
+				/* Goal */
+				dbus_message_iter_open_container (&arrayiter, DBUS_TYPE_DICT_ENTRY,
+								  NULL,
 								  &dictiter);
 
 				str_value = "goal";
@@ -9875,6 +10283,31 @@ test_status_action (void)
 
 	TEST_ALLOC_FAIL {
 		TEST_CHILD (server_pid) {
+			/* Expect the GetAllJobStatus method call on the
+			 * manager object, reply with an error as an older
+			 * init would so that the job is queried directly.
+			 */
+			TEST_DBUS_MESSAGE (server_conn, method_call);
+
+			TEST_TRUE (dbus_message_is_method_call (method_call,
+								DBUS_INTERFACE_UPSTART,
+								"GetAllJobStatus"));
+
+			TEST_EQ_STR (dbus_message_get_path (method_call),
+							    DBUS_PATH_UPSTART);
+
+			TEST_ALLOC_SAFE {
+				reply = dbus_message_new_error (method_call,
+								DBUS_ERROR_UNKNOWN_METHOD,
+								"Unknown method");
+			}
+
+			dbus_connection_send (server_conn, reply, NULL);
+			dbus_connection_flush (server_conn);
+
+			dbus_message_unref (method_call);
+			dbus_message_unref (reply);
+
 			/* Expect the GetJobByName method call on the
 			 * manager object, make sure the job name is passed
 			 * and reply with a path.
@@ -10191,6 +10624,31 @@ test_status_action (void)
 	TEST_FEATURE ("with unknown instance");
 	TEST_ALLOC_FAIL {
 		TEST_CHILD (server_pid) {
+			/* Expect the GetAllJobStatus method call on the
+			 * manager object, reply with an error as an older
+			 * init would so that the job is queried directly.
+			 */
+			TEST_DBUS_MESSAGE (server_conn, method_call);
+
+			TEST_TRUE (dbus_message_is_method_call (method_call,
+								DBUS_INTERFACE_UPSTART,
+								"GetAllJobStatus"));
+
+			TEST_EQ_STR (dbus_message_get_path (method_call),
+							    DBUS_PATH_UPSTART);
+
+			TEST_ALLOC_SAFE {
+				reply = dbus_message_new_error (method_call,
+								DBUS_ERROR_UNKNOWN_METHOD,
+								"Unknown method");
+			}
+
+			dbus_connection_send (server_conn, reply, NULL);
+			dbus_connection_flush (server_conn);
+
+			dbus_message_unref (method_call);
+			dbus_message_unref (reply);
+
 			/* Expect the GetJobByName method call on the
 			 * manager object, make sure the job name is passed
 			 * and reply with a path.
@@ -10356,6 +10814,31 @@ test_status_action (void)
 	TEST_FEATURE ("with error reply to GetJobByName");
 	TEST_ALLOC_FAIL {
 		TEST_CHILD (server_pid) {
+			/* Expect the GetAllJobStatus method call on the
+			 * manager object, reply with an error as an older
+			 * init would so that the job is queried directly.
+			 */
+			TEST_DBUS_MESSAGE (server_conn, method_call);
+
+			TEST_TRUE (dbus_message_is_method_call (method_call,
+								DBUS_INTERFACE_UPSTART,
+								"GetAllJobStatus"));
+
+			TEST_EQ_STR (dbus_message_get_path (method_call),
+							    DBUS_PATH_UPSTART);
+
+			TEST_ALLOC_SAFE {
+				reply = dbus_message_new_error (method_call,
+								DBUS_ERROR_UNKNOWN_METHOD,
+								"Unknown method");
+			}
+
+			dbus_connection_send (server_conn, reply, NULL);
+			dbus_connection_flush (server_conn);
+
+			dbus_message_unref (method_call);
+			dbus_message_unref (reply);
+
 			/* Expect the GetJobByName method call on the
 			 * manager object, make sure the job name is passed
 			 * and reply with an error.
@@ -10428,15 +10911,40 @@ test_status_action (void)
 	TEST_FEATURE ("with error reply to GetInstance");
 	TEST_ALLOC_FAIL {
 		TEST_CHILD (server_pid) {
-			/* Expect the GetJobByName method call on the
-			 * manager object, make sure the job name is passed
-			 * and reply with a path.
+			/* Expect the GetAllJobStatus method call on the
+			 * manager object, reply with an error as an older
+			 * init would so that the job is queried directly.
 			 */
 			TEST_DBUS_MESSAGE (server_conn, method_call);
 
 			TEST_TRUE (dbus_message_is_method_call (method_call,
 								DBUS_INTERFACE_UPSTART,
-								"GetJobByName"));
+								"GetAllJobStatus"));
+
+			TEST_EQ_STR (dbus_message_get_path (method_call),
+							    DBUS_PATH_UPSTART);
+
+			TEST_ALLOC_SAFE {
+				reply = dbus_message_new_error (method_call,
+								DBUS_ERROR_UNKNOWN_METHOD,
+								"Unknown method");
+			}
+
+			dbus_connection_send (server_conn, reply, NULL);
+			dbus_connection_flush (server_conn);
+
+			dbus_message_unref (method_call);
+			dbus_message_unref (reply);
+
+			/* Expect the GetJobByName method call on the
+			 * manager object, make sure the job name is passed
+			 * and reply with a path.
+			 */
+			TEST_DBUS_MESSAGE (server_conn, method_call);
+
+			TEST_TRUE (dbus_message_is_method_call (method_call,
+								DBUS_INTERFACE_UPSTART,
+								"GetJobByName"));
 
 			TEST_EQ_STR (dbus_message_get_path (method_call),
 							    DBUS_PATH_UPSTART);
@@ -10536,6 +11044,31 @@ test_status_action (void)
 	TEST_FEATURE ("with error reply to status query");
 	TEST_ALLOC_FAIL {
 		TEST_CHILD (server_pid) {
+			/* Expect the GetAllJobStatus method call on the
+			 * manager object, reply with an error as an older
+			 * init would so that the job is queried directly.
+			 */
+			TEST_DBUS_MESSAGE (server_conn, method_call);
+
+			TEST_TRUE (dbus_message_is_method_call (method_call,
+								DBUS_INTERFACE_UPSTART,
+								"GetAllJobStatus"));
+
+			TEST_EQ_STR (dbus_message_get_path (method_call),
+							    DBUS_PATH_UPSTART);
+
+			TEST_ALLOC_SAFE {
+				reply = dbus_message_new_error (method_call,
+								DBUS_ERROR_UNKNOWN_METHOD,
+								"Unknown method");
+			}
+
+			dbus_connection_send (server_conn, reply, NULL);
+			dbus_connection_flush (server_conn);
+
+			dbus_message_unref (method_call);
+			dbus_message_unref (reply);
+
 			/* Expect the GetJobByName method call on the
 			 * manager object, make sure the job name is passed
 			 * and reply with a path.
@@ -13232,7 +13765,8 @@ test_list_action (void)
 	errors = tmpfile ();
 
 
-	/* Check that the list action makes the GetAllJobs method call
+	/* Check that when init doesn't support the GetAllJobStatus method
+	 * call, the list action makes the GetAllJobs method call
 	 * to obtain a list of paths, then for each job calls the
 	 * GetAllInstances method call to obtain a list of the instances.
 	 * If there are instances, the job name and instance properties are
@@ -13242,6 +13776,31 @@ test_list_action (void)
 	TEST_FEATURE ("with valid reply");
 	TEST_ALLOC_FAIL {
 		TEST_CHILD (server_pid) {
+			/* Expect the GetAllJobStatus method call on the
+			 * manager object, reply with an error as an older
+			 * init would so that the job is queried directly.
+			 */
+			TEST_DBUS_MESSAGE (server_conn, method_call);
+
+			TEST_TRUE (dbus_message_is_method_call (method_call,
+								DBUS_INTERFACE_UPSTART,
+								"GetAllJobStatus"));
+
+			TEST_EQ_STR (dbus_message_get_path (method_call),
+							    DBUS_PATH_UPSTART);
+
+			TEST_ALLOC_SAFE {
+				reply = dbus_message_new_error (method_call,
+								DBUS_ERROR_UNKNOWN_METHOD,
+								"Unknown method");
+			}
+
+			dbus_connection_send (server_conn, reply, NULL);
+			dbus_connection_flush (server_conn);
+
+			dbus_message_unref (method_call);
+			dbus_message_unref (reply);
+
 			/* Expect the GetAllJobs method call on the
 			 * manager object, reply with a list of interesting
 			 * paths.
@@ -14073,6 +14632,31 @@ test_list_action (void)
 	TEST_FEATURE ("with error reply to GetAllInstances");
 	TEST_ALLOC_FAIL {
 		TEST_CHILD (server_pid) {
+			/* Expect the GetAllJobStatus method call on the
+			 * manager object, reply with an error as an older
+			 * init would so that the job is queried directly.
+			 */
+			TEST_DBUS_MESSAGE (server_conn, method_call);
+
+			TEST_TRUE (dbus_message_is_method_call (method_call,
+								DBUS_INTERFACE_UPSTART,
+								"GetAllJobStatus"));
+
+			TEST_EQ_STR (dbus_message_get_path (method_call),
+							    DBUS_PATH_UPSTART);
+
+			TEST_ALLOC_SAFE {
+				reply = dbus_message_new_error (method_call,
+								DBUS_ERROR_UNKNOWN_METHOD,
+								"Unknown method");
+			}
+
+			dbus_connection_send (server_conn, reply, NULL);
+			dbus_connection_flush (server_conn);
+
+			dbus_message_unref (method_call);
+			dbus_message_unref (reply);
+
 			/* Expect the GetAllJobs method call on the
 			 * manager object, reply with a list of interesting
 			 * paths.
@@ -14416,6 +15000,31 @@ test_list_action (void)
 	TEST_FEATURE ("with error reply to GetAllJobs");
 	TEST_ALLOC_FAIL {
 		TEST_CHILD (server_pid) {
+			/* Expect the GetAllJobStatus method call on the
+			 * manager object, reply with an error as an older
+			 * init would so that the job is queried directly.
+			 */
+			TEST_DBUS_MESSAGE (server_conn, method_call);
+
+			TEST_TRUE (dbus_message_is_method_call (method_call,
+								DBUS_INTERFACE_UPSTART,
+								"GetAllJobStatus"));
+
+			TEST_EQ_STR (dbus_message_get_path (method_call),
+							    DBUS_PATH_UPSTART);
+
+			TEST_ALLOC_SAFE {
+				reply = dbus_message_new_error (method_call,
+								DBUS_ERROR_UNKNOWN_METHOD,
+								"Unknown method");
+			}
+
+			dbus_connection_send (server_conn, reply, NULL);
+			dbus_connection_flush (server_conn);
+
+			dbus_message_unref (method_call);
+			dbus_message_unref (reply);
+
 			/* Expect the GetAllJobs method call on the
 			 * manager object, reply with an error.
 			 */
@@ -14473,6 +15082,108 @@ test_list_action (void)
 	}
 
 
+	/* Check that the list action outputs the status of every job and
+	 * instance from the reply to the GetAllJobStatus method call,
+	 * without making any further calls.
+	 */
+	TEST_FEATURE ("with GetAllJobStatus reply");
+	TEST_ALLOC_FAIL {
+		TEST_CHILD (server_pid) {
+			/* Expect the GetAllJobStatus method call on the
+			 * manager object, reply with the status of each
+			 * job and instance.
+			 */
+			TEST_DBUS_MESSAGE (server_conn, method_call);
+
+			TEST_TRUE (dbus_message_is_method_call (method_call,
+								DBUS_INTERFACE_UPSTART,
+								"GetAllJobStatus"));
+
+			TEST_EQ_STR (dbus_message_get_path (method_call),
+							    DBUS_PATH_UPSTART);
+
+			TEST_ALLOC_SAFE {
+				reply = dbus_message_new_method_return (method_call);
+
+				dbus_message_iter_init_append (reply, &iter);
+
+				dbus_message_iter_open_container (&iter, DBUS_TYPE_ARRAY,
+								  JOB_STATUS_SIGNATURE,
+								  &arrayiter);
+
+				append_job_status (&arrayiter, "frodo", "",
+						   "stop", "waiting", NULL);
+				append_job_status (&arrayiter, "bilbo", "",
+						   "start", "running",
+						   "main", 3648, NULL);
+				append_job_status (&arrayiter, "drogo", "foo",
+						   "stop", "killed",
+						   "main", 1234,
+						   "post-stop", 5678, NULL);
+				append_job_status (&arrayiter, "drogo", "bar",
+						   "start", "pre-start",
+						   "pre-start", 6312, NULL);
+
+				dbus_message_iter_close_container (&iter, &arrayiter);
+			}
+
+			dbus_connection_send (server_conn, reply, NULL);
+			dbus_connection_flush (server_conn);
+
+			dbus_message_unref (method_call);
+			dbus_message_unref (reply);
+
+			TEST_DBUS_CLOSE (server_conn);
+
+			dbus_shutdown ();
+
+			exit (0);
+		}
+
+		memset (&command, 0, sizeof command);
+
+		args[0] = NULL;
+
+		TEST_DIVERT_STDOUT (output) {
+			TEST_DIVERT_STDERR (errors) {
+				ret = list_action (&command, args);
+			}
+		}
+		rewind (output);
+		rewind (errors);
+
+		if (test_alloc_failed
+		    && (ret != 0)) {
+			TEST_FILE_END (output);
+			TEST_FILE_RESET (output);
+
+			TEST_FILE_EQ (errors, "test: Cannot allocate memory\n");
+			TEST_FILE_END (errors);
+			TEST_FILE_RESET (errors);
+
+			kill (server_pid, SIGTERM);
+			waitpid (server_pid, NULL, 0);
+			continue;
+		}
+
+		TEST_EQ (ret, 0);
+
+		TEST_FILE_EQ (output, "frodo stop/waiting\n");
+		TEST_FILE_EQ (output, "bilbo start/running, process 3648\n");
+		TEST_FILE_EQ (output, "drogo (foo) stop/killed, process 1234\n");
+		TEST_FILE_EQ (output, "\tpost-stop process 5678\n");
+		TEST_FILE_EQ (output, "drogo (bar) start/pre-start, process 6312\n");
+		TEST_FILE_END (output);
+		TEST_FILE_RESET (output);
+
+		TEST_FILE_END (errors);
+		TEST_FILE_RESET (errors);
+
+		waitpid (server_pid, &status, 0);
+		TEST_TRUE (WIFEXITED (status));
+		TEST_EQ (WEXITSTATUS (status), 0);
+	}
+
 	fclose (errors);
 	fclose (output);
 
@@ -14921,6 +15632,426 @@ test_emit_action (void)
 }
 
 
+void
+test_batch_action (void)
+{
+	pid_t           dbus_pid;
+	DBusConnection *server_conn;
+	FILE *          output;
+	FILE *          errors;
+	FILE *          input;
+	pid_t           server_pid;
+	DBusMessage *   method_call;
+	DBusMessage *   reply = NULL;
+	const char *    name_value;
+	char **         args_value;
+	int             args_elements;
+	int             wait_value;
+	const char *    str_value;
+	NihCommand      command;
+	char            filename[PATH_MAX];
+	char *          args[2];
+	int             ret = 0;
+	int             status;
+
+	TEST_FUNCTION ("batch_action");
+	TEST_DBUS (dbus_pid);
+	TEST_DBUS_OPEN (server_conn);
+
+	assert (dbus_bus_request_name (server_conn, DBUS_SERVICE_UPSTART,
+				       0, NULL)
+			== DBUS_REQUEST_NAME_REPLY_PRIMARY_OWNER);
+
+	TEST_DBUS_MESSAGE (server_conn, method_call);
+	assert (dbus_message_is_signal (method_call, DBUS_INTERFACE_DBUS,
+					"NameAcquired"));
+	dbus_message_unref (method_call);
+
+	use_dbus = TRUE;
+	dbus_bus_type = DBUS_BUS_SYSTEM;
+	dest_name = DBUS_SERVICE_UPSTART;
+	dest_address = DBUS_ADDRESS_UPSTART;
+
+	output = tmpfile ();
+	errors = tmpfile ();
+
+	TEST_FILENAME (filename);
+
+
+	/* Check that the batch action sends every command without waiting
+	 * for the earlier ones to complete: both the GetJobByName call for
+	 * the start command and the EmitEvent call are received before
+	 * either is replied to, and the Start call follows once the job
+	 * has been found.  Comments and blank lines are skipped and each
+	 * result is reported as it arrives.
+	 */
+	TEST_FEATURE ("with multiple commands");
+	input = fopen (filename, "w");
+	fprintf (input, "# a comment\n");
+	fprintf (input, "start test FOO=BAR\n");
+	fprintf (input, "\n");
+	fprintf (input, "  emit wibble  \n");
+	fclose (input);
+
+	TEST_CHILD (server_pid) {
+		DBusMessage *get_job_call;
+
+		/* Expect the GetJobByName method call on the manager
+		 * object, but don't reply until the EmitEvent call has
+		 * also been received.
+		 */
+		TEST_DBUS_MESSAGE (server_conn, get_job_call);
+
+		TEST_TRUE (dbus_message_is_method_call (get_job_call,
+							DBUS_INTERFACE_UPSTART,
+							"GetJobByName"));
+
+		TEST_TRUE (dbus_message_get_args (get_job_call, NULL,
+						  DBUS_TYPE_STRING, &name_value,
+						  DBUS_TYPE_INVALID));
+
+		TEST_EQ_STR (name_value, "test");
+
+		/* Expect the EmitEvent method call, reply to it and then
+		 * to the GetJobByName call.
+		 */
+		TEST_DBUS_MESSAGE (server_conn, method_call);
+
+		TEST_TRUE (dbus_message_is_method_call (method_call,
+							DBUS_INTERFACE_UPSTART,
+							"EmitEvent"));
+
+		TEST_TRUE (dbus_message_get_args (method_call, NULL,
+						  DBUS_TYPE_STRING, &name_value,
+						  DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &args_value, &args_elements,
+						  DBUS_TYPE_BOOLEAN, &wait_value,
+						  DBUS_TYPE_INVALID));
+
+		TEST_EQ_STR (name_value, "wibble");
+		TEST_EQ (args_elements, 0);
+		dbus_free_string_array (args_value);
+		TEST_TRUE (wait_value);
+
+		reply = dbus_message_new_method_return (method_call);
+
+		dbus_connection_send (server_conn, reply, NULL);
+		dbus_connection_flush (server_conn);
+
+		dbus_message_unref (method_call);
+		dbus_message_unref (reply);
+
+		reply = dbus_message_new_method_return (get_job_call);
+
+		str_value = DBUS_PATH_UPSTART "/jobs/test";
+
+		dbus_message_append_args (reply,
+					  DBUS_TYPE_OBJECT_PATH, &str_value,
+					  DBUS_TYPE_INVALID);
+
+		dbus_connection_send (server_conn, reply, NULL);
+		dbus_connection_flush (server_conn);
+
+		dbus_message_unref (get_job_call);
+		dbus_message_unref (reply);
+
+		/* Expect the Start method call on the job object with the
+		 * environment given, reply with an instance path.
+		 */
+		TEST_DBUS_MESSAGE (server_conn, method_call);
+
+		TEST_TRUE (dbus_message_is_method_call (method_call,
+							DBUS_INTERFACE_UPSTART_JOB,
+							"Start"));
+
+		TEST_EQ_STR (dbus_message_get_path (method_call),
+			     DBUS_PATH_UPSTART "/jobs/test");
+
+		TEST_TRUE (dbus_message_get_args (method_call, NULL,
+						  DBUS_TYPE_ARRAY, DBUS_TYPE_STRING, &args_value, &args_elements,
+						  DBUS_TYPE_BOOLEAN, &wait_value,
+						  DBUS_TYPE_INVALID));
+
+		TEST_EQ (args_elements, 1);
+		TEST_EQ_STR (args_value[0], "FOO=BAR");
+		dbus_free_string_array (args_value);
+		TEST_TRUE (wait_value);
+
+		reply = dbus_message_new_method_return (method_call);
+
+		str_value = DBUS_PATH_UPSTART "/jobs/test/_";
+
+		dbus_message_append_args (reply,
+					  DBUS_TYPE_OBJECT_PATH, &str_value,
+					  DBUS_TYPE_INVALID);
+
+		dbus_connection_send (server_conn, reply, NULL);
+		dbus_connection_flush (server_conn);
+
+		dbus_message_unref (method_call);
+		dbus_message_unref (reply);
+
+		TEST_DBUS_CLOSE (server_conn);
+
+		dbus_shutdown ();
+
+		exit (0);
+	}
+
+	memset (&command, 0, sizeof command);
+
+	args[0] = filename;
+	args[1] = NULL;
+
+	TEST_DIVERT_STDOUT (output) {
+		TEST_DIVERT_STDERR (errors) {
+			ret = batch_action (&command, args);
+		}
+	}
+	rewind (output);
+	rewind (errors);
+
+	TEST_EQ (ret, 0);
+
+	TEST_FILE_EQ (output, "emit wibble: ok\n");
+	TEST_FILE_EQ (output, "start test FOO=BAR: ok\n");
+	TEST_FILE_END (output);
+	TEST_FILE_RESET (output);
+
+	TEST_FILE_END (errors);
+	TEST_FILE_RESET (errors);
+
+	waitpid (server_pid, &status, 0);
+	TEST_TRUE (WIFEXITED (status));
+	TEST_EQ (WEXITSTATUS (status), 0);
+
+
+	/* Check that an unknown command is reported with the line it
+	 * appeared on, and that nothing is sent to the server.
+	 */
+	TEST_FEATURE ("with unknown command");
+	input = fopen (filename, "w");
+	fprintf (input, "start test\n");
+	fprintf (input, "frobnicate test\n");
+	fclose (input);
+
+	TEST_DIVERT_STDOUT (output) {
+		TEST_DIVERT_STDERR (errors) {
+			ret = batch_action (&command, args);
+		}
+	}
+	rewind (output);
+	rewind (errors);
+
+	TEST_NE (ret, 0);
+
+	TEST_FILE_END (output);
+	TEST_FILE_RESET (output);
+
+	TEST_FILE_EQ (errors, "test: frobnicate test: unknown command\n");
+	TEST_FILE_END (errors);
+	TEST_FILE_RESET (errors);
+
+	unlink (filename);
+
+
+	fclose (errors);
+	fclose (output);
+
+	TEST_DBUS_CLOSE (server_conn);
+	TEST_DBUS_END (dbus_pid);
+
+	dbus_shutdown ();
+}
+
+
+static UpstartGetTimelineTimelineElement *
+timeline_element (const void *parent,
+		  const char *name,
+		  const char *job,
+		  uint64_t    usec)
+{
+	UpstartGetTimelineTimelineElement *elem;
+
+	elem = NIH_MUST (nih_new (parent, UpstartGetTimelineTimelineElement));
+	elem->item0 = NIH_MUST (nih_strdup (elem, name));
+	elem->item1 = NIH_MUST (nih_strdup (elem, job ? job : ""));
+	elem->item2 = NIH_MUST (nih_strdup (elem, ""));
+	elem->item3 = usec;
+
+	return elem;
+}
+
+static AnalyzeJob *
+analyze_job (NihHash    *jobs,
+	     const char *name,
+	     const char *emits)
+{
+	AnalyzeJob *job;
+
+	job = NIH_MUST (nih_new (jobs, AnalyzeJob));
+	nih_list_init (&job->entry);
+	job->name = NIH_MUST (nih_strdup (job, name));
+	job->start_on = NULL;
+	job->emits = NULL;
+
+	if (emits) {
+		job->emits = NIH_MUST (nih_str_array_new (job));
+		NIH_MUST (nih_str_array_add (&job->emits, job, NULL, emits));
+	}
+
+	nih_hash_add (jobs, &job->entry);
+
+	return job;
+}
+
+static void
+analyze_start_on (AnalyzeJob *job,
+		  ...)
+{
+	va_list     ap;
+	const char *token;
+	size_t      len = 0;
+
+	job->start_on = NIH_MUST (nih_alloc (job, sizeof (char **)));
+	job->start_on[0] = NULL;
+
+	va_start (ap, job);
+	while ((token = va_arg (ap, const char *)) != NULL) {
+		char **variant;
+
+		variant = NIH_MUST (nih_str_split (job, token, " ", TRUE));
+
+		job->start_on = NIH_MUST (nih_realloc (job->start_on, job,
+						       sizeof (char **) * (len + 2)));
+		job->start_on[len++] = variant;
+		job->start_on[len] = NULL;
+	}
+	va_end (ap);
+}
+
+void
+test_analyze (void)
+{
+	UpstartGetTimelineTimelineElement **timeline;
+	NihHash                            *jobs;
+	AnalyzeJob                         *job;
+	FILE                               *output;
+	int                                 ret;
+
+	TEST_FUNCTION ("analyze_critical_chain");
+
+	output = tmpfile ();
+
+	jobs = nih_hash_string_new (NULL, 0);
+
+	job = analyze_job (jobs, "udev", NULL);
+	analyze_start_on (job, "startup", NULL);
+
+	job = analyze_job (jobs, "mountall", "filesystem");
+	analyze_start_on (job, "started udev", NULL);
+
+	job = analyze_job (jobs, "rc", NULL);
+	analyze_start_on (job, "filesystem", "started udev", "/AND", NULL);
+
+	timeline = nih_alloc (NULL, sizeof (UpstartGetTimelineTimelineElement *) * 9);
+	timeline[0] = timeline_element (timeline, "startup", NULL, 1000000);
+	timeline[1] = timeline_element (timeline, "starting", "udev", 1100000);
+	timeline[2] = timeline_element (timeline, "started", "udev", 1500000);
+	timeline[3] = timeline_element (timeline, "starting", "mountall", 1600000);
+	timeline[4] = timeline_element (timeline, "filesystem", NULL, 2500000);
+	timeline[5] = timeline_element (timeline, "started", "mountall", 2600000);
+	timeline[6] = timeline_element (timeline, "starting", "rc", 2700000);
+	timeline[7] = timeline_element (timeline, "started", "rc", 3000000);
+	timeline[8] = NULL;
+
+
+	/* Check that the critical chain of a job follows its start on
+	 * condition back through the event that happened last, to the
+	 * job that emits that event, and so on back to startup.
+	 */
+	TEST_FEATURE ("with job");
+	TEST_DIVERT_STDOUT (output) {
+		ret = analyze_critical_chain (jobs, timeline, "rc");
+	}
+	rewind (output);
+
+	TEST_EQ (ret, 0);
+
+	TEST_FILE_EQ (output, "rc started @3.000s +0.300s\n");
+	TEST_FILE_EQ (output, "  filesystem @2.500s\n");
+	TEST_FILE_EQ (output, "    mountall @2.500s +0.900s\n");
+	TEST_FILE_EQ (output, "      udev started @1.500s +0.400s\n");
+	TEST_FILE_EQ (output, "        startup @1.000s\n");
+	TEST_FILE_END (output);
+	TEST_FILE_RESET (output);
+
+
+	/* Check that the critical chain of an event starts from the
+	 * job that emits it.
+	 */
+	TEST_FEATURE ("with event");
+	TEST_DIVERT_STDOUT (output) {
+		ret = analyze_critical_chain (jobs, timeline, "filesystem");
+	}
+	rewind (output);
+
+	TEST_EQ (ret, 0);
+
+	TEST_FILE_EQ (output, "filesystem @2.500s\n");
+	TEST_FILE_EQ (output, "  mountall @2.500s +0.900s\n");
+	TEST_FILE_EQ (output, "    udev started @1.500s +0.400s\n");
+	TEST_FILE_EQ (output, "      startup @1.000s\n");
+	TEST_FILE_END (output);
+	TEST_FILE_RESET (output);
+
+
+	/* Check that without a target the last job to start is used. */
+	TEST_FEATURE ("with no target");
+	TEST_DIVERT_STDOUT (output) {
+		ret = analyze_critical_chain (jobs, timeline, NULL);
+	}
+	rewind (output);
+
+	TEST_EQ (ret, 0);
+
+	TEST_FILE_EQ (output, "rc started @3.000s +0.300s\n");
+	TEST_FILE_RESET (output);
+
+
+	/* Check that a job or event never reached is an error. */
+	TEST_FEATURE ("with unknown target");
+	TEST_DIVERT_STDOUT (output) {
+		ret = analyze_critical_chain (jobs, timeline, "wibble");
+	}
+	rewind (output);
+
+	TEST_LT (ret, 0);
+	TEST_FILE_END (output);
+	TEST_FILE_RESET (output);
+
+
+	/* Check that blame lists the time every job took to start,
+	 * longest first.
+	 */
+	TEST_FUNCTION ("analyze_blame");
+	TEST_DIVERT_STDOUT (output) {
+		analyze_blame (timeline);
+	}
+	rewind (output);
+
+	TEST_FILE_EQ (output, "     1.000s mountall\n");
+	TEST_FILE_EQ (output, "     0.400s udev\n");
+	TEST_FILE_EQ (output, "     0.300s rc\n");
+	TEST_FILE_END (output);
+	TEST_FILE_RESET (output);
+
+	nih_free (timeline);
+	nih_free (jobs);
+
+	fclose (output);
+}
+
+
 void
 test_reload_configuration_action (void)
 {
@@ -17174,6 +18305,7 @@ main (int   argc,
 
 	test_upstart_open ();
 	test_job_status ();
+	test_job_status_add_stats ();
 
 	test_start_action ();
 	test_stop_action ();
@@ -17182,6 +18314,8 @@ main (int   argc,
 	test_status_action ();
 	test_list_action ();
 	test_emit_action ();
+	test_batch_action ();
+	test_analyze ();
 	test_reload_configuration_action ();
 	test_version_action ();
 	test_log_priority_action ();